@@ -15,9 +15,19 @@ import androidx.annotation.NonNull;
  * {@link android.hardware.camera2.CameraCaptureSession}
  *
  * @todo capture request with configuration
- * @todo multiple surface request
  */
 public class CameraHandle {
+    /**
+     * The output is the target of the repeating request
+     *
+     * @see CameraHandle#start(Surface[], int[])
+     */
+    public static final int OUTPUT_REPEATING = 1;
+    /**
+     * The output is the target of {@link CameraHandle#captureStill()}
+     */
+    public static final int OUTPUT_STILL = 2;
+
     private long ptr = 0;
 
     /**
@@ -27,6 +37,26 @@ public class CameraHandle {
      */
     public native int facing();
 
+    /**
+     * Clockwise rotation which makes the output image upright in the device's
+     * natural orientation. The native kernels apply this while they read the
+     * image, so the frames don't need another rotation pass.
+     *
+     * @return 0, 90, 180, 270
+     * @see CameraCharacteristics#SENSOR_ORIENTATION
+     */
+    public native int sensorOrientation();
+
+    /**
+     * Clockwise rotation which makes the output image upright on the display of
+     * the rotated device. The image of {@link CameraCharacteristics#LENS_FACING_FRONT}
+     * is mirrored after the rotation, like the preview.
+     *
+     * @param deviceRotation clockwise rotation of the device. 0, 90, 180, 270
+     * @return 0, 90, 180, 270
+     */
+    public native int orientation(int deviceRotation);
+
     private native int maxWidth();
 
     private native int maxHeight();
@@ -102,6 +132,42 @@ public class CameraHandle {
      */
     public native void stopCapture();
 
+    /**
+     * Open a camera and create a session with multiple outputs. For example, a
+     * preview surface of the full resolution, an {@link android.media.ImageReader}
+     * of YUV at the model's resolution, and a JPEG reader for the still capture.
+     * The camera scales each stream, so the analysis doesn't resize the frames.
+     * The repeating request targets the outputs of {@link #OUTPUT_REPEATING}.
+     *
+     * @param surfaces outputs of the session. Their sizes and formats can be
+     *                 different
+     * @param usages   {@link #OUTPUT_REPEATING}, {@link #OUTPUT_STILL}, or both
+     *                 for each surface
+     * @see "https://developer.android.com/reference/android/hardware/camera2/CameraDevice#regular-capture"
+     */
+    public void start(Surface[] surfaces, int[] usages) {
+        open();
+        startSession(surfaces, usages);
+    }
+
+    private native void startSession(Surface[] surfaces, int[] usages);
+
+    /**
+     * Capture a still image to the outputs of {@link #OUTPUT_STILL}. The
+     * repeating request continues
+     *
+     * @see CameraHandle#start(Surface[], int[])
+     */
+    public native void captureStill();
+
+    /**
+     * @param format {@link android.graphics.ImageFormat#YUV_420_888},
+     *               {@link android.graphics.ImageFormat#JPEG} ...
+     * @return true if the camera can output the stream of the format and size
+     * @see CameraCharacteristics#SCALER_STREAM_CONFIGURATION_MAP
+     */
+    public native boolean isOutputSupported(int format, int width, int height);
+
     @NonNull
     @Override
     public String toString() {
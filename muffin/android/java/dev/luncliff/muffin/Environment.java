@@ -17,4 +17,24 @@ public class Environment {
      * @return True if supported
      */
     public static native boolean HasEGL(String extension);
+
+    /**
+     * @apiNote Names of the memory budgets in the native library.
+     *  For example, "buffers", "images" and "snapshots"
+     */
+    public static native String[] GetMemoryBudgets();
+
+    /**
+     * @apiNote Current usage of the memory budget. The budget is created if not found
+     * @param name For example, "snapshots"
+     * @return { limit, bytes, peak, rejected }. The limit is 0 if unlimited
+     */
+    public static native long[] GetMemoryUsage(String name);
+
+    /**
+     * @apiNote Limit the memory budget. The pipeline drops the frames rather than growing over it.
+     *  Use this for `onTrimMemory` or the low-RAM devices
+     * @param limit bytes. 0 to make it unlimited
+     */
+    public static native void SetMemoryBudget(String name, long limit);
 }
@@ -0,0 +1,138 @@
+package dev.luncliff.muffin;
+
+import android.graphics.ImageFormat;
+import android.graphics.PixelFormat;
+import android.media.Image;
+
+import androidx.annotation.NonNull;
+
+import java.io.File;
+import java.nio.ByteBuffer;
+
+/**
+ * Save the images in the native I/O thread. The planes are copied in native
+ * code, so the {@link Image} can be closed right after {@link #savePNG} or
+ * {@link #saveYUV} returns. The copies are compressed with the writer's own
+ * native thread pool, so the analysis doesn't wait for them.
+ */
+public class SnapshotWriter implements AutoCloseable {
+    private long ptr = 0;
+
+    private static native long create1(int maxPending);
+
+    private static native void destroy1(long ptr);
+
+    private static native boolean write1(long ptr, ByteBuffer y, ByteBuffer u, ByteBuffer v, int width, int height,
+            int yRowStride, int uvRowStride, int uvPixelStride, String path, boolean png);
+
+    private static native boolean write2(long ptr, ByteBuffer rgba, int width, int height, int rowStride,
+            String path);
+
+    private static native void flush1(long ptr);
+
+    private static native long[] query1(long ptr);
+
+    /**
+     * @param maxPending images waiting for the I/O thread. If it's full, the
+     *                   new image is dropped
+     */
+    public SnapshotWriter(int maxPending) throws RuntimeException, UnsatisfiedLinkError {
+        Environment.Init();
+        ptr = create1(maxPending); // throw in native code
+    }
+
+    /**
+     * @throws IllegalStateException if the writer is closed
+     */
+    private long handle() throws IllegalStateException {
+        if (ptr == 0)
+            throw new IllegalStateException("SnapshotWriter is closed");
+        return ptr;
+    }
+
+    /**
+     * @param image {@link ImageFormat#YUV_420_888} or
+     *              {@link PixelFormat#RGBA_8888}
+     * @return false if the image is dropped
+     */
+    public boolean savePNG(Image image, File file) throws RuntimeException {
+        Image.Plane[] planes = image.getPlanes();
+        if (image.getFormat() == PixelFormat.RGBA_8888)
+            return write2(handle(), planes[0].getBuffer(), image.getWidth(), image.getHeight(),
+                    planes[0].getRowStride(), file.getPath());
+        return writeYUV(image, file, true);
+    }
+
+    /**
+     * @apiNote The file is a gzip of I420. The comment in the gzip header has
+     *          the size of the image. For example, "I420 640x480"
+     * @param image {@link ImageFormat#YUV_420_888}
+     * @return false if the image is dropped
+     */
+    public boolean saveYUV(Image image, File file) throws RuntimeException {
+        return writeYUV(image, file, false);
+    }
+
+    /**
+     * @param rgba direct buffer
+     * @return false if the image is dropped
+     */
+    public boolean savePNG(ByteBuffer rgba, int width, int height, int rowStride, File file)
+            throws RuntimeException {
+        return write2(handle(), rgba, width, height, rowStride, file.getPath());
+    }
+
+    private boolean writeYUV(Image image, File file, boolean png) throws RuntimeException {
+        if (image.getFormat() != ImageFormat.YUV_420_888)
+            throw new IllegalArgumentException("unsupported image format");
+        Image.Plane[] planes = image.getPlanes();
+        return write1(handle(), planes[0].getBuffer(), planes[1].getBuffer(), planes[2].getBuffer(), image.getWidth(),
+                image.getHeight(), planes[0].getRowStride(), planes[1].getRowStride(), planes[1].getPixelStride(),
+                file.getPath(), png);
+    }
+
+    /**
+     * @apiNote Wait until the pending images are saved
+     */
+    public void flush() {
+        flush1(handle());
+    }
+
+    /**
+     * @return number of the saved files
+     */
+    public long written() {
+        return query1(handle())[0];
+    }
+
+    /**
+     * @return number of the images dropped because of the pending images
+     */
+    public long dropped() {
+        return query1(handle())[1];
+    }
+
+    /**
+     * @return number of the images failed to encode or write
+     */
+    public long failed() {
+        return query1(handle())[2];
+    }
+
+    /**
+     * @apiNote Save the pending images and stop the I/O thread
+     */
+    @Override
+    public void close() {
+        if (ptr == 0)
+            return;
+        destroy1(ptr);
+        ptr = 0;
+    }
+
+    @NonNull
+    @Override
+    public String toString() {
+        return String.format("SnapshotWriter{ptr=%x}", ptr);
+    }
+}
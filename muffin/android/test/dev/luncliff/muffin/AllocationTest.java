@@ -0,0 +1,49 @@
+package dev.luncliff.muffin;
+
+import android.util.Log;
+
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+/**
+ * Build with `-PallocTracking=ON` to count the allocations. Otherwise the counts are 0
+ */
+public class AllocationTest {
+    static final String TAG = "AllocationTest";
+
+    @BeforeAll
+    public static void setupAll() {
+        Environment.Init();
+    }
+
+    static native boolean isTrackingEnabled();
+
+    static native int detectAllocation();
+
+    static native int countSteadyState(int width, int height, int frames);
+
+    static native String[] reportSites(int count);
+
+    @Test
+    public void detectInScope() {
+        if (isTrackingEnabled())
+            Assertions.assertEquals(1, detectAllocation());
+        else
+            Assertions.assertEquals(0, detectAllocation());
+    }
+
+    /**
+     * The frame loop must not allocate after the warm-up
+     */
+    @Test
+    public void noAllocationInSteadyState() {
+        for (int[] size : new int[][]{{640, 480}, {1280, 720}}) {
+            int violations = countSteadyState(size[0], size[1], 60);
+            if (violations != 0)
+                for (String site : reportSites(5))
+                    Log.w(TAG, site);
+            Assertions.assertEquals(0, violations);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+package dev.luncliff.muffin;
+
+import android.util.Log;
+
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+public class BufferPoolTest {
+    static final String TAG = "BufferPoolTest";
+
+    @BeforeAll
+    public static void setupAll() {
+        Environment.Init();
+    }
+
+    static native int recycleBuffer(boolean memfd, int width, int height, int repeat);
+
+    static native int evictForBudget(boolean memfd);
+
+    static native boolean rejectStaleLease(boolean memfd);
+
+    static native int trimIdleBuffers(boolean memfd, int timeout, int interval, int duration);
+
+    static native long measureAcquire(boolean memfd, boolean pooled, int width, int height, int repeat);
+
+    @Test
+    public void recycleSameDescription() {
+        for (boolean memfd : new boolean[]{true, false})
+            Assertions.assertEquals(1, recycleBuffer(memfd, 640, 480, 30));
+    }
+
+    @Test
+    public void evictOldestForBudget() {
+        for (boolean memfd : new boolean[]{true, false})
+            Assertions.assertEquals(1, evictForBudget(memfd));
+    }
+
+    @Test
+    public void ignoreStaleLease() {
+        for (boolean memfd : new boolean[]{true, false})
+            Assertions.assertTrue(rejectStaleLease(memfd));
+    }
+
+    @Test
+    public void trimWithTimer() {
+        for (boolean memfd : new boolean[]{true, false}) {
+            Assertions.assertEquals(0, trimIdleBuffers(memfd, 100, 20, 400));
+            Assertions.assertEquals(3, trimIdleBuffers(memfd, 5000, 20, 200));
+        }
+    }
+
+    /**
+     * Per-frame allocation versus the recycled buffer
+     */
+    @Test
+    public void measureRecycle1080p() {
+        for (boolean memfd : new boolean[]{true, false}) {
+            long allocate = measureAcquire(memfd, false, 1920, 1080, 30);
+            long pooled = measureAcquire(memfd, true, 1920, 1080, 30);
+            Assertions.assertNotEquals(0, allocate);
+            Assertions.assertNotEquals(0, pooled);
+            Log.i(TAG, String.format("%s: allocate %d ns, pooled %d ns (x%.2f)", memfd ? "memfd" : "gralloc", allocate,
+                    pooled, (double) allocate / pooled));
+        }
+    }
+}
@@ -0,0 +1,97 @@
+package dev.luncliff.muffin;
+
+import android.Manifest;
+import android.content.Context;
+import android.graphics.ImageFormat;
+import android.hardware.camera2.CameraCharacteristics;
+import android.media.Image;
+import android.media.ImageReader;
+import android.os.Handler;
+import android.os.Looper;
+import android.view.Surface;
+import androidx.test.core.app.ApplicationProvider;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.TimeoutException;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import androidx.test.rule.GrantPermissionRule;
+import org.junit.Rule;
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.Assumptions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+public class CameraSessionTest {
+    @Rule
+    public GrantPermissionRule permissions = GrantPermissionRule.grant(Manifest.permission.CAMERA);
+
+    static Handler handler;
+
+    @BeforeAll
+    static void makeHandler() {
+        Context context = ApplicationProvider.getApplicationContext();
+        Looper looper = context.getMainLooper();
+        handler = new Handler(looper);
+    }
+
+    /**
+     * The rotation of the device is added to the sensor's. The front camera
+     * rotates the other way because its image is mirrored
+     */
+    @Test
+    public void orientationForDeviceRotation() {
+        CameraHandle camera = SaveImageTest.getAnyCamera();
+        Assertions.assertNotNull(camera);
+        int sensor = camera.sensorOrientation();
+        Assertions.assertEquals(sensor, camera.orientation(0));
+        int expected = (sensor + 90) % 360;
+        if (camera.facing() == CameraCharacteristics.LENS_FACING_FRONT)
+            expected = (sensor + 270) % 360;
+        Assertions.assertEquals(expected, camera.orientation(90));
+    }
+
+    /**
+     * Preview and analysis streams of the different sizes in 1 session. Then a
+     * still capture without stopping them
+     */
+    @Test
+    public void repeatAndCaptureStill() {
+        CameraHandle camera = SaveImageTest.getAnyCamera();
+        Assertions.assertNotNull(camera);
+        Assumptions.assumeTrue(camera.isOutputSupported(ImageFormat.YUV_420_888, 320, 240));
+        Assumptions.assumeTrue(camera.isOutputSupported(ImageFormat.JPEG, 640, 480));
+        AtomicInteger previews = new AtomicInteger();
+        try (ImageReader preview = ImageReader.newInstance(640, 480, ImageFormat.YUV_420_888, 2);
+                ImageReader analysis = ImageReader.newInstance(320, 240, ImageFormat.YUV_420_888, 2);
+                ImageReader still = ImageReader.newInstance(640, 480, ImageFormat.JPEG, 1)) {
+            // drain the preview so the repeating request doesn't stall
+            preview.setOnImageAvailableListener(reader -> {
+                try (Image image = reader.acquireLatestImage()) {
+                    if (image != null && image.getWidth() == 640)
+                        previews.incrementAndGet();
+                }
+            }, handler);
+            Surface[] surfaces = { preview.getSurface(), analysis.getSurface(), still.getSurface() };
+            int[] usages = { CameraHandle.OUTPUT_REPEATING, CameraHandle.OUTPUT_REPEATING, CameraHandle.OUTPUT_STILL };
+            camera.start(surfaces, usages);
+            try (Image image = TestHelper.WaitForImage(analysis, 2)) {
+                Assertions.assertNotNull(image);
+                Assertions.assertEquals(320, image.getWidth());
+                Assertions.assertEquals(240, image.getHeight());
+            }
+            camera.captureStill();
+            try (Image image = TestHelper.WaitForImage(still, 2)) {
+                Assertions.assertNotNull(image);
+                Assertions.assertEquals(ImageFormat.JPEG, image.getFormat());
+            }
+            // the still capture doesn't stop the repeating request
+            try (Image image = TestHelper.WaitForImage(analysis, 2)) {
+                Assertions.assertNotNull(image);
+            }
+            camera.stopRepeat();
+        } catch (ExecutionException | InterruptedException | TimeoutException ex) {
+            Assertions.fail(ex.getMessage());
+        }
+        Assertions.assertNotEquals(0, previews.get());
+    }
+}
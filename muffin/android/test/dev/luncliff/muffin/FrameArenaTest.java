@@ -0,0 +1,45 @@
+package dev.luncliff.muffin;
+
+import android.util.Log;
+
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+public class FrameArenaTest {
+    static final String TAG = "FrameArenaTest";
+
+    @BeforeAll
+    public static void setupAll() {
+        Environment.Init();
+    }
+
+    static native int countUpstream(int capacity, int frames);
+
+    static native boolean alignLargeBlocks();
+
+    static native long measurePostProcess(boolean arena, int frames);
+
+    /**
+     * The first frame spills to the slabs. After that, the frames must not allocate
+     */
+    @Test
+    public void noAllocationInSteadyState() {
+        Assertions.assertEquals(0, countUpstream(4096, 30));
+        Assertions.assertEquals(0, countUpstream(64 << 10, 30));
+    }
+
+    @Test
+    public void alignToCacheLine() {
+        Assertions.assertTrue(alignLargeBlocks());
+    }
+
+    @Test
+    public void measureArenaAndHeap() {
+        long arena = measurePostProcess(true, 300);
+        long heap = measurePostProcess(false, 300);
+        Assertions.assertNotEquals(0, arena);
+        Assertions.assertNotEquals(0, heap);
+        Log.i(TAG, String.format("arena %d ns, heap %d ns (x%.2f)", arena, heap, (double) heap / arena));
+    }
+}
@@ -0,0 +1,41 @@
+package dev.luncliff.muffin;
+
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+public class FrameBusTest {
+    static final String TAG = "FrameBusTest";
+
+    @BeforeAll
+    public static void setupAll() {
+        Environment.Init();
+    }
+
+    static native int publishFrames(boolean memfd, int subscribers, int frames, int buffers);
+
+    static native int dropForSlowSubscriber(boolean memfd, int credits, int frames);
+
+    static native boolean detachForgotten(boolean memfd);
+
+    /**
+     * Each buffer must be sent once for each subscriber. After that, only the slots are sent
+     */
+    @Test
+    public void sendBufferOnce() {
+        for (boolean memfd : new boolean[]{true, false})
+            Assertions.assertEquals(3 * 2, publishFrames(memfd, 2, 90, 3));
+    }
+
+    @Test
+    public void dropForSlowSubscriber() {
+        for (boolean memfd : new boolean[]{true, false})
+            Assertions.assertEquals(2, dropForSlowSubscriber(memfd, 2, 30));
+    }
+
+    @Test
+    public void detachAfterRelease() {
+        for (boolean memfd : new boolean[]{true, false})
+            Assertions.assertTrue(detachForgotten(memfd));
+    }
+}
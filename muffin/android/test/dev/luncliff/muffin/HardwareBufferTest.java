@@ -0,0 +1,65 @@
+package dev.luncliff.muffin;
+
+import android.hardware.HardwareBuffer;
+import android.util.Log;
+
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+public class HardwareBufferTest {
+    static final String TAG = "HardwareBufferTest";
+    static final int FORMAT_Y8Cb8Cr8_420 = 0x23;
+
+    @BeforeAll
+    public static void setupAll() {
+        Environment.Init();
+    }
+
+    static native boolean moveThroughQueue(int repeat);
+
+    static native int lockPlanes(int format, int width, int height);
+
+    static native long measureQueue(boolean move, int repeat);
+
+    static native int lockAfterFence(int delay);
+
+    @Test
+    public void moveWithoutReference() {
+        Assertions.assertTrue(moveThroughQueue(100));
+    }
+
+    @Test
+    public void lockSinglePlane() {
+        Assertions.assertEquals(1, lockPlanes(HardwareBuffer.RGBA_8888, 640, 480));
+    }
+
+    /**
+     * `AHardwareBuffer_lockPlanes` requires API 29
+     */
+    @Test
+    public void lockMultiplePlanes() {
+        if (android.os.Build.VERSION.SDK_INT >= 29)
+            Assertions.assertEquals(3, lockPlanes(FORMAT_Y8Cb8Cr8_420, 640, 480));
+        else
+            Assertions.assertThrows(RuntimeException.class, () -> lockPlanes(FORMAT_Y8Cb8Cr8_420, 640, 480));
+    }
+
+    /**
+     * The signaled fence must not suspend. Otherwise the thread must keep running until the fence is signaled
+     */
+    @Test
+    public void lockWithFence() {
+        Assertions.assertEquals(0, lockAfterFence(0));
+        Assertions.assertTrue(lockAfterFence(100) > 0);
+    }
+
+    @Test
+    public void measureMoveAndCopy() {
+        long move = measureQueue(true, 10000);
+        long copy = measureQueue(false, 10000);
+        Assertions.assertNotEquals(0, move);
+        Assertions.assertNotEquals(0, copy);
+        Log.i(TAG, String.format("move %d ns, copy %d ns (x%.2f)", move, copy, (double) copy / move));
+    }
+}
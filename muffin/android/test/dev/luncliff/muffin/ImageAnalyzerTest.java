@@ -0,0 +1,50 @@
+package dev.luncliff.muffin;
+
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+public class ImageAnalyzerTest {
+    @BeforeAll
+    public static void setupAll() {
+        Environment.Init();
+    }
+
+    /**
+     * @return received, processed, dropped, skipped, shed, and the index of the
+     *         last processed frame
+     */
+    static native long[] runAnalyzer(int count, int interval, int delay, boolean pressure);
+
+    /**
+     * The handler is slower than the frames. The stale images are dropped, and
+     * the last frame is processed
+     */
+    @Test
+    public void dropStaleImages() {
+        long[] stats = runAnalyzer(30, 2, 20, false);
+        Assertions.assertNotNull(stats);
+        Assertions.assertEquals(30, stats[0]);
+        Assertions.assertTrue(stats[1] >= 1);
+        Assertions.assertTrue(stats[2] >= 1);
+        // the images acquired before their `onImageAvailable` are not counted
+        Assertions.assertTrue(stats[1] + stats[2] <= stats[0]);
+        Assertions.assertEquals(0, stats[3]);
+        Assertions.assertEquals(0, stats[4]);
+        Assertions.assertEquals(29, stats[5]);
+    }
+
+    /**
+     * The images are shed while the budget is exceeded
+     */
+    @Test
+    public void shedUnderPressure() {
+        long[] stats = runAnalyzer(10, 5, 0, true);
+        Assertions.assertNotNull(stats);
+        Assertions.assertEquals(10, stats[0]);
+        Assertions.assertEquals(0, stats[1]);
+        Assertions.assertTrue(stats[4] >= 1);
+        Assertions.assertTrue(stats[2] + stats[4] <= stats[0]);
+        Assertions.assertEquals(-1, stats[5]);
+    }
+}
@@ -0,0 +1,277 @@
+package dev.luncliff.muffin;
+
+import android.util.Log;
+
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+public class ImageKernelTest {
+    static final String TAG = "ImageKernelTest";
+    static final int I420 = 0;
+    static final int NV12 = 1;
+    static final int NV21 = 2;
+    static final int RGBA = 3;
+    // tensor_type_t
+    static final int FLOAT32 = 1;
+    static final int UINT8 = 3;
+    static final int INT8 = 9;
+    static final int FLOAT16 = 10;
+    // tensor_layout_t
+    static final int NHWC = 0;
+    static final int NCHW = 1;
+    // scale_class_t
+    static final int SAME = 1;
+    static final int HALF = 2;
+    static final int QUARTER = 3;
+    // border_mode_t
+    static final int REPLICATE = 0;
+    static final int CONSTANT = 1;
+
+    @BeforeAll
+    public static void setupAll() {
+        Environment.Init();
+    }
+
+    static native float compareReference(int layout, int srcWidth, int srcHeight, int dstWidth, int dstHeight);
+
+    static native float compareRotation(int layout, int srcWidth, int srcHeight, int degrees, boolean mirror);
+
+    static native float comparePacking(int layout, int type, int tensorLayout, int dstWidth, int dstHeight);
+
+    static native float compareKernel(int layout, int srcWidth, int srcHeight, int dstWidth, int dstHeight, int type,
+            int tensorLayout, int scale);
+
+    static native float compareVariant(int layout, int srcWidth, int srcHeight, int dstWidth, int dstHeight, int type);
+
+    static native long measureKernel(int layout, int srcWidth, int srcHeight, int dstWidth, int dstHeight, int type,
+            int repeat, boolean specialize, boolean baseline);
+
+    static native float compareFixedPoint(int layout, int srcWidth, int srcHeight, int dstWidth, int dstHeight,
+            int type, int tensorLayout);
+
+    static native long measureFixedPoint(int layout, int srcWidth, int srcHeight, int dstWidth, int dstHeight,
+            int repeat, boolean fixed);
+
+    static native int comparePyramid(int layout, int srcWidth, int srcHeight, int count);
+
+    static native long measurePyramid(int srcWidth, int srcHeight, int count, float scale, int repeat);
+
+    static native long measureConversion(int srcWidth, int srcHeight, int dstWidth, int dstHeight, int repeat,
+            boolean reference);
+
+    static native int compareBlockSad(int width, int height);
+
+    static native float simulateMotionGate(int width, int height, int frames, int moving);
+
+    static native long measureMotionGate(int width, int height, int repeat);
+
+    static native float compareComposite(int layout, int width, int height, int maskWidth, int maskHeight);
+
+    static native int compareBlur(int layout, int width, int height);
+
+    static native long measureComposite(int layout, int width, int height, boolean blur, int repeat);
+
+    static native float compareWarpIdentity(int layout, int width, int height, int type);
+
+    static native float compareWarp(int layout, int border);
+
+    static native long measureWarp(int layout, int width, int height, int repeat);
+
+    @Test
+    public void sameWithReference() {
+        for (int layout : new int[] { I420, NV12, NV21 }) {
+            // downscale, same size, upscale, and odd sizes
+            Assertions.assertTrue(compareReference(layout, 640, 480, 256, 256) < 1e-3);
+            Assertions.assertTrue(compareReference(layout, 640, 480, 640, 480) < 1e-3);
+            Assertions.assertTrue(compareReference(layout, 320, 240, 641, 479) < 1e-3);
+            Assertions.assertTrue(compareReference(layout, 1921, 1079, 127, 77) < 1e-3);
+        }
+    }
+
+    @Test
+    public void sameWithRotatedImage() {
+        for (int layout : new int[] { I420, NV12, NV21 })
+            for (int degrees = 0; degrees < 360; degrees += 90) {
+                Assertions.assertTrue(compareRotation(layout, 640, 480, degrees, false) < 1e-3);
+                Assertions.assertTrue(compareRotation(layout, 643, 357, degrees, true) < 1e-3);
+            }
+    }
+
+    @Test
+    public void sameWithPackedTensor() {
+        for (int layout : new int[] { I420, NV12, NV21 })
+            for (int tensorLayout : new int[] { NHWC, NCHW }) {
+                Assertions.assertTrue(comparePacking(layout, FLOAT32, tensorLayout, 224, 224) < 1e-4);
+                Assertions.assertTrue(comparePacking(layout, FLOAT32, tensorLayout, 131, 77) < 1e-4);
+                // half of the mantissa's last bit
+                Assertions.assertTrue(comparePacking(layout, FLOAT16, tensorLayout, 224, 224) < 0.51);
+                // rounding of the ties can be different
+                Assertions.assertTrue(comparePacking(layout, UINT8, tensorLayout, 224, 224) <= 1);
+                Assertions.assertTrue(comparePacking(layout, INT8, tensorLayout, 131, 77) <= 1);
+            }
+    }
+
+    @Test
+    public void specializedSameWithGenericKernel() {
+        for (int layout : new int[] { I420, NV12, NV21, RGBA })
+            for (int tensorLayout : new int[] { NHWC, NCHW }) {
+                // FMA of the generic path can change the last bits
+                Assertions.assertTrue(compareKernel(layout, 640, 480, 640, 480, FLOAT32, tensorLayout, SAME) < 1e-4);
+                Assertions.assertTrue(compareKernel(layout, 642, 482, 321, 241, FLOAT32, tensorLayout, HALF) < 1e-4);
+                Assertions.assertTrue(compareKernel(layout, 1280, 720, 320, 180, FLOAT16, tensorLayout, QUARTER) <= 1);
+                Assertions.assertTrue(compareKernel(layout, 640, 480, 320, 240, UINT8, tensorLayout, HALF) <= 1);
+                Assertions.assertTrue(compareKernel(layout, 1280, 960, 320, 240, INT8, tensorLayout, QUARTER) <= 1);
+            }
+    }
+
+    @Test
+    public void measureSpecializedKernels() {
+        for (int layout : new int[] { NV21, RGBA })
+            for (int ratio : new int[] { 1, 2, 4 }) {
+                long generic = measureKernel(layout, 320 * ratio, 240 * ratio, 320, 240, FLOAT32, 50, false, false);
+                long specialized = measureKernel(layout, 320 * ratio, 240 * ratio, 320, 240, FLOAT32, 50, true, false);
+                Assertions.assertNotEquals(0, specialized);
+                Log.i(TAG, String.format("%s %d:1: generic %d ns, specialized %d ns (x%.2f)",
+                        layout == RGBA ? "RGBA" : "NV21", ratio, generic, specialized, (double) generic / specialized));
+            }
+    }
+
+    @Test
+    public void variantSameWithBaseline() {
+        // the variant of the CPU. Same with the baseline if the CPU has no extension
+        for (int layout : new int[] { I420, NV21, RGBA }) {
+            Assertions.assertTrue(compareVariant(layout, 640, 480, 300, 200, FLOAT32) < 1e-4);
+            Assertions.assertTrue(compareVariant(layout, 640, 480, 320, 240, FLOAT16) <= 1);
+            Assertions.assertTrue(compareVariant(layout, 1280, 960, 320, 240, UINT8) <= 1);
+        }
+    }
+
+    @Test
+    public void measureVariants() {
+        for (int layout : new int[] { NV21, RGBA }) {
+            long baseline = measureKernel(layout, 1280, 720, 320, 240, FLOAT32, 50, true, true);
+            long variant = measureKernel(layout, 1280, 720, 320, 240, FLOAT32, 50, true, false);
+            Assertions.assertNotEquals(0, variant);
+            Log.i(TAG, String.format("%s: baseline %d ns, variant %d ns (x%.2f)", layout == RGBA ? "RGBA" : "NV21",
+                    baseline, variant, (double) baseline / variant));
+        }
+    }
+
+    @Test
+    public void fixedPointSameWithFloat() {
+        // the rounding of the ties can be different
+        for (int layout : new int[] { I420, NV12, NV21, RGBA })
+            for (int tensorLayout : new int[] { NHWC, NCHW }) {
+                Assertions.assertTrue(compareFixedPoint(layout, 640, 480, 640, 480, UINT8, tensorLayout) <= 1);
+                Assertions.assertTrue(compareFixedPoint(layout, 642, 482, 321, 241, INT8, tensorLayout) <= 1);
+                Assertions.assertTrue(compareFixedPoint(layout, 1280, 960, 320, 240, UINT8, tensorLayout) <= 1);
+                Assertions.assertTrue(compareFixedPoint(layout, 640, 480, 300, 200, INT8, tensorLayout) <= 1);
+            }
+    }
+
+    @Test
+    public void measureFixedPointKernels() {
+        for (int layout : new int[] { NV21, RGBA })
+            for (int ratio : new int[] { 1, 2, 4 }) {
+                long floating = measureFixedPoint(layout, 320 * ratio, 240 * ratio, 320, 240, 50, false);
+                long fixed = measureFixedPoint(layout, 320 * ratio, 240 * ratio, 320, 240, 50, true);
+                Assertions.assertNotEquals(0, fixed);
+                Log.i(TAG, String.format("%s %d:1: float %d ns, fixed-point %d ns (x%.2f)",
+                        layout == RGBA ? "RGBA" : "NV21", ratio, floating, fixed, (double) floating / fixed));
+            }
+    }
+
+    @Test
+    public void pyramidSameWithLevelByLevel() {
+        for (int layout : new int[] { I420, NV12, NV21 }) {
+            Assertions.assertEquals(0, comparePyramid(layout, 1920, 1080, 4));
+            Assertions.assertEquals(0, comparePyramid(layout, 1279, 721, 3));
+        }
+    }
+
+    @Test
+    public void measurePyramid1080p() {
+        long halves = measurePyramid(1920, 1080, 4, 0.5f, 30);
+        long octaves = measurePyramid(1920, 1080, 6, 0.7071f, 30);
+        Assertions.assertNotEquals(0, halves);
+        Log.i(TAG, String.format("pyramid: 2x %d ns, sqrt(2) %d ns", halves, octaves));
+    }
+
+    @Test
+    public void measure1080pToModelInput() {
+        long reference = measureConversion(1920, 1080, 256, 256, 50, true);
+        long simd = measureConversion(1920, 1080, 256, 256, 50, false);
+        Assertions.assertNotEquals(0, simd);
+        Log.i(TAG, String.format("256x256: reference %d ns, simd %d ns (x%.2f)", reference, simd,
+                (double) reference / simd));
+    }
+
+    @Test
+    public void blockSadSameWithScalar() {
+        Assertions.assertEquals(0, compareBlockSad(160, 90));
+        Assertions.assertEquals(0, compareBlockSad(117, 61));
+    }
+
+    @Test
+    public void motionGateSkipsStaticScene() {
+        // the gate analyzes at least once every 31 frames
+        Assertions.assertTrue(simulateMotionGate(1920, 1080, 90, 0) > 0.9f);
+        Assertions.assertEquals(0.0f, simulateMotionGate(1920, 1080, 90, 90));
+        float ratio = simulateMotionGate(1280, 720, 90, 45);
+        Assertions.assertTrue(ratio > 0.4f && ratio < 0.6f);
+    }
+
+    @Test
+    public void measureMotionGate1080p() {
+        long gate = measureMotionGate(1920, 1080, 50);
+        long conversion = measureConversion(1920, 1080, 256, 256, 50, false);
+        Assertions.assertNotEquals(0, gate);
+        Log.i(TAG, String.format("motion gate: %d ns, conversion %d ns (x%.2f)", gate, conversion,
+                (double) conversion / gate));
+    }
+
+    @Test
+    public void compositeSameWithFloatBlend() {
+        for (int layout : new int[] { I420, NV12, NV21, RGBA }) {
+            // the mask of selfie_segmentation and selfie_segmentation_landscape. odd sizes
+            Assertions.assertTrue(compareComposite(layout, 640, 480, 256, 256) <= 2.5f);
+            Assertions.assertTrue(compareComposite(layout, 317, 181, 144, 256) <= 2.5f);
+            Assertions.assertEquals(0, compareBlur(layout, 640, 480));
+            Assertions.assertEquals(0, compareBlur(layout, 317, 181));
+        }
+    }
+
+    @Test
+    public void measureComposite1080p() {
+        for (int layout : new int[] { NV21, RGBA }) {
+            long blur = measureComposite(layout, 1920, 1080, true, 30);
+            long replace = measureComposite(layout, 1920, 1080, false, 30);
+            Assertions.assertNotEquals(0, blur);
+            Log.i(TAG, String.format("composite %s: blur %d ns, replace %d ns", layout == RGBA ? "RGBA" : "NV21", blur,
+                    replace));
+        }
+    }
+
+    @Test
+    public void warpSameWithReference() {
+        for (int layout : new int[] { I420, NV12, NV21, RGBA }) {
+            // the identity transform is the 1:1 kernel
+            Assertions.assertTrue(compareWarpIdentity(layout, 640, 480, FLOAT32) < 1e-4);
+            Assertions.assertTrue(compareWarpIdentity(layout, 320, 240, FLOAT16) <= 1);
+            Assertions.assertTrue(compareWarpIdentity(layout, 320, 240, UINT8) <= 1);
+            // rotated ROIs over the edges of the image
+            Assertions.assertTrue(compareWarp(layout, REPLICATE) < 1e-3);
+            Assertions.assertTrue(compareWarp(layout, CONSTANT) < 1e-3);
+        }
+    }
+
+    @Test
+    public void measureWarp1080p() {
+        for (int layout : new int[] { NV21, RGBA }) {
+            long elapsed = measureWarp(layout, 1920, 1080, 50);
+            Assertions.assertNotEquals(0, elapsed);
+            Log.i(TAG, String.format("warp %s: face and 2 eyes %d ns", layout == RGBA ? "RGBA" : "NV21", elapsed));
+        }
+    }
+}
@@ -0,0 +1,35 @@
+package dev.luncliff.muffin;
+
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.Assumptions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+public class ImageLeaseTest {
+    @BeforeAll
+    public static void setupAll() {
+        Environment.Init();
+    }
+
+    static native int cycleBuffers(int count, int hold);
+
+    static native boolean replaceCachedEntry();
+
+    /**
+     * The reader cycles through more buffers than the pool's cache. The
+     * outstanding leases must keep their layouts
+     */
+    @Test
+    public void moreBuffersThanCapacity() {
+        Assertions.assertEquals(12, cycleBuffers(12, 4));
+    }
+
+    /**
+     * A lease must keep the layout of its own image when the cache entry it
+     * came from is replaced by the buffer of another size
+     */
+    @Test
+    public void keepLayoutOfLease() {
+        Assumptions.assumeTrue(replaceCachedEntry(), "the reader didn't reuse its buffer");
+    }
+}
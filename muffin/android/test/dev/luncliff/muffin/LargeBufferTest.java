@@ -0,0 +1,48 @@
+package dev.luncliff.muffin;
+
+import android.util.Log;
+
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+public class LargeBufferTest {
+    static final String TAG = "LargeBufferTest";
+
+    @BeforeAll
+    public static void setupAll() {
+        Environment.Init();
+    }
+
+    static native boolean allocateAligned(int size, int alignment);
+
+    static native long measureScatterRead(boolean huge, int megabytes, int count);
+
+    static native long countTlbMisses(boolean huge, int megabytes, int count);
+
+    /**
+     * Heap, mapped, and 2 MB or larger buffers
+     */
+    @Test
+    public void alignHeapAndMapping() {
+        for (int size : new int[]{1000, 300 * 1024, 1920 * 1080 * 3})
+            for (int alignment : new int[]{64, 4096})
+                Assertions.assertTrue(allocateAligned(size, alignment));
+    }
+
+    /**
+     * The transparent huge pages may be disabled by the kernel. Then the results are similar
+     */
+    @Test
+    public void measureHugeAndBasePages() {
+        long base = measureScatterRead(false, 64, 1000000);
+        long huge = measureScatterRead(true, 64, 1000000);
+        Assertions.assertNotEquals(0, base);
+        Assertions.assertNotEquals(0, huge);
+        Log.i(TAG, String.format("base %d ns, huge %d ns (x%.2f)", base, huge, (double) base / huge));
+        // perf_event_open is not allowed for the apps in most devices
+        long baseMisses = countTlbMisses(false, 64, 1000000);
+        long hugeMisses = countTlbMisses(true, 64, 1000000);
+        Log.i(TAG, String.format("dTLB misses: base %d, huge %d", baseMisses, hugeMisses));
+    }
+}
@@ -0,0 +1,61 @@
+package dev.luncliff.muffin;
+
+import android.content.Context;
+import android.util.Log;
+
+import androidx.test.core.app.ApplicationProvider;
+
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+public class MemoryBudgetTest {
+    static final String TAG = "MemoryBudgetTest";
+
+    @BeforeAll
+    public static void setupAll() {
+        Environment.Init();
+    }
+
+    static native boolean reserveOverLimit();
+
+    static native int evictForSharedBudget(int width, int height);
+
+    static native int dropSnapshots(String directory, int width, int height, int frames, int count);
+
+    @Test
+    public void chargeAndRelease() {
+        Assertions.assertTrue(reserveOverLimit());
+    }
+
+    @Test
+    public void evictAcrossPools() {
+        Assertions.assertEquals(1, evictForSharedBudget(640, 480));
+    }
+
+    /**
+     * The I/O thread is slower than the copies, so the frames over the budget of 2 copies are dropped
+     */
+    @Test
+    public void dropSnapshotsOverBudget() {
+        Context context = ApplicationProvider.getApplicationContext();
+        int dropped = dropSnapshots(context.getCacheDir().getAbsolutePath(), 1280, 720, 2, 12);
+        Log.i(TAG, String.format("dropped %d/12", dropped));
+        Assertions.assertTrue(dropped > 0);
+        Assertions.assertTrue(dropped <= 10);
+    }
+
+    @Test
+    public void queryUsage() {
+        Environment.SetMemoryBudget("snapshots", 32 << 20);
+        long[] usage = Environment.GetMemoryUsage("snapshots");
+        Assertions.assertEquals(4, usage.length);
+        Assertions.assertEquals(32 << 20, usage[0]);
+        Assertions.assertTrue(usage[1] <= usage[2]);
+        boolean found = false;
+        for (String name : Environment.GetMemoryBudgets())
+            found |= name.equals("snapshots");
+        Assertions.assertTrue(found);
+        Environment.SetMemoryBudget("snapshots", 0);
+    }
+}
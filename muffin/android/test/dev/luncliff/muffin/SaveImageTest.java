@@ -1,6 +1,8 @@
 package dev.luncliff.muffin;
 
 import android.Manifest;
+import android.graphics.Bitmap;
+import android.graphics.BitmapFactory;
 import android.graphics.ImageFormat;
 import android.media.Image;
 import android.media.ImageReader;
@@ -8,9 +10,11 @@ import android.os.Environment;
 import android.util.Log;
 import java.io.DataOutputStream;
 import java.io.File;
+import java.io.FileInputStream;
 import java.io.FileOutputStream;
 import java.io.IOException;
 import java.nio.ByteBuffer;
+import java.util.zip.GZIPInputStream;
 import java.util.concurrent.ExecutionException;
 import java.util.concurrent.TimeoutException;
 
@@ -76,4 +80,94 @@ public class SaveImageTest {
         }
     }
 
+    /**
+     * @return number of bytes after gunzip
+     */
+    static long gunzip(File file) throws IOException {
+        try (GZIPInputStream stream = new GZIPInputStream(new FileInputStream(file))) {
+            byte[] buffer = new byte[64 * 1024];
+            long total = 0;
+            for (int sz = stream.read(buffer); sz > 0; sz = stream.read(buffer))
+                total += sz;
+            return total;
+        }
+    }
+
+    @Test
+    public void saveSnapshotFromBuffer() {
+        final int width = 1280, height = 720;
+        ByteBuffer rgba = ByteBuffer.allocateDirect(width * height * 4);
+        for (int i = 0; i < rgba.capacity(); ++i)
+            rgba.put(i, i % 4 == 3 ? (byte) 0xFF : (byte) ((i % (width * 4)) / 16));
+        File png = new File(workspace, "buffer.png");
+        try (SnapshotWriter writer = new SnapshotWriter(2)) {
+            Assertions.assertTrue(writer.savePNG(rgba, width, height, width * 4, png));
+            writer.flush();
+            Assertions.assertEquals(1, writer.written());
+            Assertions.assertEquals(0, writer.failed());
+        }
+        Bitmap bitmap = BitmapFactory.decodeFile(png.getPath());
+        Assertions.assertNotNull(bitmap);
+        Assertions.assertEquals(width, bitmap.getWidth());
+        Assertions.assertEquals(height, bitmap.getHeight());
+        // R, G, B of the pixel (8, 0) are 2 and it's opaque
+        Assertions.assertEquals(0xFF020202, bitmap.getPixel(8, 0));
+    }
+
+    static native long[] measurePoolWait(String path);
+
+    /**
+     * The loops of the default pool must not wait for the compression of the
+     * writer
+     */
+    @Test
+    public void saveWithoutBlockingPool() {
+        Environment.Init();
+        long[] elapsed = measurePoolWait(new File(workspace, "noise.png").getPath());
+        Assertions.assertNotNull(elapsed);
+        Log.i("SaveImageTest", String.format("save %d us, longest loop %d us", elapsed[0], elapsed[1]));
+        Assertions.assertTrue(elapsed[1] * 4 < elapsed[0]);
+    }
+
+    @Test
+    public void closeTwice() {
+        SnapshotWriter writer = new SnapshotWriter(1);
+        writer.close();
+        writer.close();
+        Assertions.assertThrows(IllegalStateException.class, writer::flush);
+    }
+
+    @Test
+    public void saveSnapshotFromCamera() {
+        CameraHandle camera = getAnyCamera();
+        Assertions.assertNotNull(camera);
+        File png = new File(workspace, "image.png");
+        File gzip = new File(workspace, "image.ycc.gz");
+        try (ImageReader reader = ImageReader.newInstance(640, 480, ImageFormat.YUV_420_888, 2);
+                SnapshotWriter writer = new SnapshotWriter(2)) {
+            camera.capture(reader.getSurface());
+            try (Image image = TestHelper.WaitForImage(reader, 2)) {
+                Assertions.assertNotNull(image);
+                camera.stopCapture();
+                // the image can be closed before the files are written
+                Assertions.assertTrue(writer.savePNG(image, png));
+                Assertions.assertTrue(writer.saveYUV(image, gzip));
+            }
+            writer.flush();
+            Assertions.assertEquals(2, writer.written());
+            Log.i("SaveImageTest", png.getPath());
+        } catch (ExecutionException | InterruptedException | TimeoutException ex) {
+            Assertions.fail(ex.getMessage());
+        }
+        Bitmap bitmap = BitmapFactory.decodeFile(png.getPath());
+        Assertions.assertNotNull(bitmap);
+        Assertions.assertEquals(640, bitmap.getWidth());
+        Assertions.assertEquals(480, bitmap.getHeight());
+        try {
+            Assertions.assertEquals(640 * 480 * 3 / 2, gunzip(gzip));
+        } catch (IOException ex) {
+            Assertions.fail(ex.getMessage());
+        }
+    }
+
 }
\ No newline at end of file
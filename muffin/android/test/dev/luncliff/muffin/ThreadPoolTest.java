@@ -0,0 +1,86 @@
+package dev.luncliff.muffin;
+
+import android.util.Log;
+
+import java.time.Duration;
+import java.util.Set;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.LongAdder;
+import java.util.function.LongConsumer;
+
+import org.junit.jupiter.api.Assertions;
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+
+public class ThreadPoolTest {
+    static final String TAG = "ThreadPoolTest";
+
+    @BeforeAll
+    public static void setupAll() {
+        Environment.Init();
+    }
+
+    static native double sumRows(int threads, int width, int height);
+
+    static native long measureRows(int threads, int width, int height, int repeat);
+
+    static native long countNested(int threads, int outer, int inner);
+
+    static native int deliverFromWorkers(int threads, int count, LongConsumer consumer);
+
+    @Test
+    public void sameResultForThreads() {
+        int processors = Runtime.getRuntime().availableProcessors();
+        double expected = sumRows(1, 1920, 1080);
+        for (int threads = 2; threads <= processors; ++threads)
+            Assertions.assertEquals(expected, sumRows(threads, 1920, 1080), 1e-3);
+    }
+
+    /**
+     * The loops in the chunks of the caller's lane must run inline, not wait for
+     * the pool
+     */
+    @Test
+    public void nestedLoop() {
+        int processors = Runtime.getRuntime().availableProcessors();
+        long count = Assertions.assertTimeoutPreemptively(Duration.ofSeconds(5),
+                () -> countNested(Math.max(processors, 2), 64, 100));
+        Assertions.assertEquals(64 * 100, count);
+    }
+
+    /**
+     * The workers are attached to invoke the consumer, and detached when the pool
+     * is destroyed
+     */
+    @Test
+    public void callbackFromWorkers() throws InterruptedException {
+        Set<Thread> callers = ConcurrentHashMap.newKeySet();
+        LongAdder sum = new LongAdder();
+        Assertions.assertEquals(0, deliverFromWorkers(3, 32, (value) -> {
+            callers.add(Thread.currentThread());
+            sum.add(value);
+        }));
+        Assertions.assertEquals(31 * 32 / 2, sum.sum());
+        callers.remove(Thread.currentThread());
+        Assertions.assertFalse(callers.isEmpty());
+        for (Thread worker : callers) {
+            worker.join(1000);
+            Assertions.assertFalse(worker.isAlive());
+        }
+    }
+
+    /**
+     * Scaling of 1080p row loop from 1 to N threads
+     */
+    @Test
+    public void scaling1080p() {
+        int processors = Runtime.getRuntime().availableProcessors();
+        long single = measureRows(1, 1920, 1080, 30);
+        Assertions.assertNotEquals(0, single);
+        for (int threads = 2; threads <= processors; ++threads) {
+            long elapsed = measureRows(threads, 1920, 1080, 30);
+            Assertions.assertNotEquals(0, elapsed);
+            Log.i(TAG, String.format("threads %d: %d ns (x%.2f)", threads, elapsed, (double) single / elapsed));
+        }
+    }
+}
@@ -65,6 +65,8 @@ android {
                 cppFlags += "-fno-rtti"
                 arguments += "-DANDROID_STL=c++_shared"
                 arguments += "-DANDROID_ARM_NEON=ON"
+                // ./gradlew connectedAndroidTest -PallocTracking=ON
+                arguments += ("-DMUFFIN_ALLOC_TRACKING=" + (project.findProperty("allocTracking") ?: "OFF"))
                 arguments += ("-DCMAKE_TOOLCHAIN_FILE:FILEPATH=" + BuildParams.vcpkgToolchainFile)
                 arguments += ("-DVCPKG_CHAINLOAD_TOOLCHAIN_FILE:FILEPATH=" + BuildParams.ndkToolchainFile)
                 targets(BuildParams.projectName)
@@ -0,0 +1,355 @@
+#include "alloc_tracker.hpp"
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <unwind.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#if defined(__ANDROID__)
+#include <android/log.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Counters of a thread. The hooks can't use `thread_local` because the emulated TLS allocates
+ * @note The counters are written only by the owner thread
+ */
+struct thread_state_t final {
+    std::atomic<bool> used{};
+    std::atomic<uint64_t> allocations{};
+    std::atomic<uint64_t> deallocations{};
+    std::atomic<uint64_t> bytes{};
+    std::atomic<uint64_t> violations{};
+    uint32_t forbidden = 0;  // depth of the `assert_no_alloc_t`
+    alloc_policy_t policy = alloc_policy_t::abort;
+    bool busy = false;  // in the hook. The allocations of the unwinder are not tracked
+};
+
+struct site_entry_t final {
+    std::atomic<uint64_t> key{};  // hash of the frames. 0 if empty
+    std::atomic<bool> ready{};    // the frames are written
+    std::array<void*, 8> frames{};
+    uint32_t depth = 0;
+    std::atomic<uint64_t> count{};
+    std::atomic<uint64_t> bytes{};
+};
+
+constexpr uint32_t max_threads = 256;
+constexpr uint32_t max_sites = 1024;
+
+thread_state_t states[max_threads]{};
+site_entry_t sites[max_sites]{};
+std::atomic<uint64_t> total_allocations{};
+std::atomic<uint64_t> total_deallocations{};
+std::atomic<uint64_t> total_bytes{};
+std::atomic<uint64_t> total_violations{};
+std::atomic<uint32_t> sampling{64};
+pthread_key_t state_key{};
+pthread_once_t state_once = PTHREAD_ONCE_INIT;
+
+void release_state(void* ptr) noexcept { static_cast<thread_state_t*>(ptr)->used = false; }
+
+void create_state_key() noexcept { pthread_key_create(&state_key, &release_state); }
+
+/// @return null if all states are used by the other threads
+thread_state_t* get_thread_state() noexcept {
+    pthread_once(&state_once, &create_state_key);
+    if (auto state = static_cast<thread_state_t*>(pthread_getspecific(state_key)); state != nullptr) return state;
+    for (thread_state_t& state : states) {
+        bool expected = false;
+        if (state.used.compare_exchange_strong(expected, true) == false) continue;
+        state.allocations = state.deallocations = state.bytes = state.violations = 0;
+        state.forbidden = 0;
+        state.busy = false;
+        pthread_setspecific(state_key, &state);
+        return &state;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+#if defined(MUFFIN_ALLOC_TRACKING)
+namespace {
+
+constexpr uint32_t skip_frames = 3;  // `record_site`, `on_allocate`, and the hook. The others are inlined
+
+struct unwind_context_t final {
+    std::array<void*, 8>& frames;
+    uint32_t depth;
+    uint32_t skip;
+};
+
+_Unwind_Reason_Code add_frame(_Unwind_Context* context, void* ptr) noexcept {
+    auto& output = *static_cast<unwind_context_t*>(ptr);
+    const uintptr_t pc = _Unwind_GetIP(context);
+    if (pc == 0) return _URC_END_OF_STACK;
+    if (output.skip > 0) {
+        output.skip -= 1;
+        return _URC_NO_REASON;
+    }
+    output.frames[output.depth++] = reinterpret_cast<void*>(pc);
+    return output.depth < output.frames.size() ? _URC_NO_REASON : _URC_END_OF_STACK;
+}
+
+__attribute__((noinline)) void record_site(size_t size) noexcept {
+    std::array<void*, 8> frames{};
+    unwind_context_t context{frames, 0, skip_frames};
+    _Unwind_Backtrace(&add_frame, &context);
+    // FNV-1a of the addresses
+    uint64_t key = 14695981039346656037ULL;
+    for (uint32_t i = 0; i < context.depth; ++i)
+        key = (key ^ reinterpret_cast<uintptr_t>(frames[i])) * 1099511628211ULL;
+    key = std::max<uint64_t>(key, 1);
+    for (uint32_t i = 0; i < max_sites; ++i) {
+        site_entry_t& entry = sites[(key + i) % max_sites];
+        uint64_t expected = 0;
+        if (entry.key.compare_exchange_strong(expected, key)) {
+            entry.frames = frames;
+            entry.depth = context.depth;
+            entry.ready = true;
+        } else if (expected != key) {
+            continue;
+        }
+        entry.count.fetch_add(1, std::memory_order_relaxed);
+        entry.bytes.fetch_add(size, std::memory_order_relaxed);
+        return;
+    }
+    // the table is full. the site is not reported
+}
+
+[[noreturn]] void abort_for_violation() noexcept {
+    constexpr auto message = "allocation in assert_no_alloc_t scope";
+#if defined(__ANDROID__)
+    __android_log_write(ANDROID_LOG_FATAL, "muffin", message);
+#else
+    std::fprintf(stderr, "muffin: %s\n", message);
+#endif
+    std::abort();
+}
+
+__attribute__((noinline)) void on_allocate(size_t size) noexcept {
+    total_allocations.fetch_add(1, std::memory_order_relaxed);
+    total_bytes.fetch_add(size, std::memory_order_relaxed);
+    thread_state_t* state = get_thread_state();
+    if (state == nullptr || state->busy) return;
+    const uint64_t count = state->allocations.fetch_add(1, std::memory_order_relaxed) + 1;
+    state->bytes.fetch_add(size, std::memory_order_relaxed);
+    const bool violated = state->forbidden != 0;
+    const uint32_t period = sampling.load(std::memory_order_relaxed);
+    if (violated == false && (period == 0 || count % period != 0)) return;
+    state->busy = true;
+    if (violated) {
+        state->violations.fetch_add(1, std::memory_order_relaxed);
+        total_violations.fetch_add(1, std::memory_order_relaxed);
+        if (state->policy == alloc_policy_t::abort) abort_for_violation();
+    }
+    record_site(size);
+    state->busy = false;
+}
+
+void on_deallocate(void* ptr) noexcept {
+    if (ptr == nullptr) return;
+    total_deallocations.fetch_add(1, std::memory_order_relaxed);
+    if (thread_state_t* state = get_thread_state(); state != nullptr && state->busy == false)
+        state->deallocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+// The library is linked with `--wrap`, so its calls of the `malloc` family come here.
+// `operator new` is replaced for the library and uses the `__real_` functions not to count twice.
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+int __real_posix_memalign(void** ptr, size_t alignment, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    on_allocate(size);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    on_allocate(count * size);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    on_allocate(size);
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+    on_deallocate(ptr);
+    __real_free(ptr);
+}
+
+int __wrap_posix_memalign(void** ptr, size_t alignment, size_t size) {
+    on_allocate(size);
+    return __real_posix_memalign(ptr, alignment, size);
+}
+}
+
+namespace {
+
+__attribute__((always_inline)) inline void* allocate(size_t size, size_t alignment) noexcept {
+    on_allocate(size);
+    size = std::max<size_t>(size, 1);
+    if (alignment <= alignof(std::max_align_t)) return __real_malloc(size);
+    void* ptr = nullptr;
+    if (__real_posix_memalign(&ptr, alignment, size) != 0) return nullptr;
+    return ptr;
+}
+
+__attribute__((always_inline)) inline void* allocate_or_throw(size_t size, size_t alignment) noexcept(false) {
+    void* ptr = allocate(size, alignment);
+    if (ptr == nullptr) throw std::bad_alloc{};
+    return ptr;
+}
+
+void deallocate(void* ptr) noexcept {
+    on_deallocate(ptr);
+    __real_free(ptr);
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return allocate_or_throw(size, 0); }
+void* operator new[](size_t size) { return allocate_or_throw(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) {
+    return allocate_or_throw(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return allocate_or_throw(size, static_cast<size_t>(alignment));
+}
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(ptr); }
+
+bool is_alloc_tracking_enabled() noexcept { return true; }
+#else
+bool is_alloc_tracking_enabled() noexcept { return false; }
+#endif
+
+alloc_counters_t get_thread_alloc_counters() noexcept {
+    alloc_counters_t output{};
+    const thread_state_t* state = get_thread_state();
+    if (state == nullptr) return output;
+    output.allocations = state->allocations.load(std::memory_order_relaxed);
+    output.deallocations = state->deallocations.load(std::memory_order_relaxed);
+    output.bytes = state->bytes.load(std::memory_order_relaxed);
+    output.violations = state->violations.load(std::memory_order_relaxed);
+    return output;
+}
+
+alloc_counters_t get_alloc_counters() noexcept {
+    alloc_counters_t output{};
+    output.allocations = total_allocations.load(std::memory_order_relaxed);
+    output.deallocations = total_deallocations.load(std::memory_order_relaxed);
+    output.bytes = total_bytes.load(std::memory_order_relaxed);
+    output.violations = total_violations.load(std::memory_order_relaxed);
+    return output;
+}
+
+void set_alloc_sampling(uint32_t period) noexcept { sampling = period; }
+
+std::vector<alloc_site_t> get_alloc_sites(size_t count) noexcept(false) {
+    std::vector<alloc_site_t> output{};
+    for (const site_entry_t& entry : sites) {
+        if (entry.ready == false) continue;
+        alloc_site_t& site = output.emplace_back();
+        site.frames = entry.frames;
+        site.depth = entry.depth;
+        site.count = entry.count.load(std::memory_order_relaxed);
+        site.bytes = entry.bytes.load(std::memory_order_relaxed);
+    }
+    std::sort(output.begin(), output.end(),
+              [](const alloc_site_t& lhs, const alloc_site_t& rhs) { return lhs.count > rhs.count; });
+    if (output.size() > count) output.resize(count);
+    return output;
+}
+
+void reset_alloc_sites() noexcept {
+    // the hooks may be writing. a site in the middle can be reported with the old frames
+    for (site_entry_t& entry : sites) {
+        entry.ready = false;
+        entry.count = 0;
+        entry.bytes = 0;
+        entry.key = 0;
+    }
+}
+
+std::string describe_alloc_site(const alloc_site_t& site) noexcept(false) {
+    std::string output{};
+    char buf[256]{};
+    for (uint32_t i = 0; i < site.depth; ++i) {
+        const void* pc = site.frames[i];
+        Dl_info info{};
+        if (dladdr(pc, &info) == 0) {
+            std::snprintf(buf, sizeof(buf), "%p", pc);
+        } else {
+            const char* library = info.dli_fname ? std::strrchr(info.dli_fname, '/') : nullptr;
+            library = library ? library + 1 : (info.dli_fname ? info.dli_fname : "?");
+            const auto address = reinterpret_cast<uintptr_t>(pc);
+            if (info.dli_sname)
+                std::snprintf(buf, sizeof(buf), "%s(%s+0x%zx)", library, info.dli_sname,
+                              static_cast<size_t>(address - reinterpret_cast<uintptr_t>(info.dli_saddr)));
+            else
+                std::snprintf(buf, sizeof(buf), "%s(+0x%zx)", library,
+                              static_cast<size_t>(address - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+        }
+        if (i > 0) output += " < ";
+        output += buf;
+    }
+    return output;
+}
+
+assert_no_alloc_t::assert_no_alloc_t(alloc_policy_t policy) noexcept
+    : start{0}, previous{alloc_policy_t::abort}, tracked{false} {
+    thread_state_t* state = get_thread_state();
+    if (state == nullptr) return;
+    tracked = true;
+    start = state->violations.load(std::memory_order_relaxed);
+    previous = state->policy;
+    state->policy = policy;
+    state->forbidden += 1;
+}
+
+assert_no_alloc_t::~assert_no_alloc_t() noexcept {
+    if (tracked == false) return;
+    thread_state_t* state = get_thread_state();
+    state->forbidden -= 1;
+    state->policy = previous;
+}
+
+uint64_t assert_no_alloc_t::violations() const noexcept {
+    if (tracked == false) return 0;
+    return get_thread_alloc_counters().violations - start;
+}
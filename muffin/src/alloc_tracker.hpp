@@ -0,0 +1,93 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Counters of the heap allocations. With `MUFFIN_ALLOC_TRACKING` build option
+ */
+struct alloc_counters_t final {
+    uint64_t allocations;    // `operator new` and `malloc` family
+    uint64_t deallocations;  // `operator delete` and `free`
+    uint64_t bytes;          // requested by the allocations. The freed bytes are not subtracted
+    uint64_t violations;     // allocations in the `assert_no_alloc_t` scopes
+};
+
+/**
+ * @brief Call site of the sampled allocations
+ */
+struct alloc_site_t final {
+    std::array<void*, 8> frames;  // return addresses. The caller of `operator new` or `malloc` is the first
+    uint32_t depth;
+    uint64_t count;  // sampled allocations of this site
+    uint64_t bytes;
+};
+
+/**
+ * @brief What happens when the thread allocates in the `assert_no_alloc_t` scope
+ */
+enum class alloc_policy_t : uint32_t {
+    count = 0,  // count the violation and sample its call site
+    abort = 1,  // log and `std::abort`. The tombstone has the call stack
+};
+
+/**
+ * @return true if the library is built with `MUFFIN_ALLOC_TRACKING`. Otherwise the counters are always zero
+ */
+bool is_alloc_tracking_enabled() noexcept;
+
+/// @brief Counters of the current thread
+alloc_counters_t get_thread_alloc_counters() noexcept;
+/// @brief Counters of all threads since the process start
+alloc_counters_t get_alloc_counters() noexcept;
+
+/**
+ * @brief Sample the call stack of each `period`-th allocation of a thread
+ * @param period 0 to sample only the violations. 1 to sample all allocations
+ */
+void set_alloc_sampling(uint32_t period) noexcept;
+
+/**
+ * @return sites with the most sampled allocations first. At most `count`
+ * @throw bad_alloc
+ */
+std::vector<alloc_site_t> get_alloc_sites(size_t count) noexcept(false);
+void reset_alloc_sites() noexcept;
+
+/**
+ * @brief Symbols of the site's frames with `dladdr`. For example, "libmuffin.so(_ZN11motion_gate_t6resizeEjj+0x34)"
+ * @throw bad_alloc
+ */
+std::string describe_alloc_site(const alloc_site_t& site) noexcept(false);
+
+/**
+ * @brief Scope of the current thread which must not allocate. For the steady state of the frame loop
+ * @details The allocations of the other threads are not checked. The scopes can be nested.
+ *  Without `MUFFIN_ALLOC_TRACKING`, the guard does nothing.
+ *
+ * ```cpp
+ * warm_up(pipeline); // the first frames can allocate
+ * for (auto i = 0; i < count; ++i) {
+ *     assert_no_alloc_t guard{};
+ *     pipeline.process(source.next());
+ * }
+ * ```
+ */
+class assert_no_alloc_t final {
+    uint64_t start;  // violations of the thread before the scope
+    alloc_policy_t previous;
+    bool tracked;  // false if the thread has no counters. Too many threads
+
+   public:
+    explicit assert_no_alloc_t(alloc_policy_t policy = alloc_policy_t::abort) noexcept;
+    ~assert_no_alloc_t() noexcept;
+    assert_no_alloc_t(const assert_no_alloc_t&) = delete;
+    assert_no_alloc_t(assert_no_alloc_t&&) = delete;
+    assert_no_alloc_t& operator=(const assert_no_alloc_t&) = delete;
+    assert_no_alloc_t& operator=(assert_no_alloc_t&&) = delete;
+
+    /// @return allocations of the thread in this scope. Always 0 with `alloc_policy_t::abort`
+    uint64_t violations() const noexcept;
+};
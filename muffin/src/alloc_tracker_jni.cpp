@@ -0,0 +1,187 @@
+#include <jni.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "alloc_tracker.hpp"
+#include "frame_arena.hpp"
+#include "image_pyramid.hpp"
+#include "motion_gate.hpp"
+#include "yuv_convert.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+
+namespace {
+
+/**
+ * @brief NV21 frames without the camera. A bright square moves over a gradient
+ */
+class synthetic_frame_source_t final {
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> pixels;
+    uint32_t index = 0;
+
+   public:
+    /// @throw invalid_argument if the size is smaller than the square
+    synthetic_frame_source_t(uint32_t width, uint32_t height) noexcept(false)
+        : width{width}, height{height}, pixels(static_cast<size_t>(width) * height * 3 / 2, 128) {
+        if (width < 64 || height < 64) throw std::invalid_argument{"the size must be 64 or larger"};
+    }
+
+    /// @brief Draw the next frame in the same memory
+    yuv_view_t next() noexcept {
+        const uint32_t left = (index * 8) % (width - 63);
+        const uint32_t top = (index * 4) % (height - 63);
+        for (uint32_t y = 0; y < height; ++y) {
+            uint8_t* row = pixels.data() + static_cast<size_t>(y) * width;
+            for (uint32_t x = 0; x < width; ++x) row[x] = static_cast<uint8_t>((x + y) / 8);
+            if (y >= top && y < top + 64)
+                for (uint32_t x = left; x < left + 64; ++x) row[x] = 255;
+        }
+        index += 1;
+        return make_nv21_view(pixels.data(), width, height);
+    }
+};
+
+/**
+ * @brief Per-frame path of the analysis. Pyramid, motion gate, conversion, and post-processing in the arena
+ */
+class synthetic_pipeline_t final {
+    image_pyramid_t pyramid;
+    motion_gate_t gate{};
+    yuv_resize_plan_t plan;  // the level's layout doesn't change. building it allocates
+    std::vector<float> input;
+    frame_arena_t arena{16 << 10};
+
+   public:
+    uint32_t analyzed = 0;
+
+   public:
+    synthetic_pipeline_t(uint32_t width, uint32_t height) noexcept(false)
+        : pyramid{width, height, 3}, plan{pyramid.select(224, 224).view(), 224, 224}, input(224 * 224 * 3) {}
+
+    void process(thread_pool_t& pool, const yuv_view_t& frame) noexcept(false) {
+        pyramid.build(pool, frame);
+        if (gate.update(pyramid.select(160, 0).y) == false) return;
+        const yuv_view_t level = pyramid.select(224, 224).view();
+        const rgb_normalization_t norm{{0.485f, 0.456f, 0.406f}, {0.229f, 0.224f, 0.225f}};
+        convert_yuv_to_rgb(pool, level, plan, norm, input.data());
+        // the bright pixels of the red channel
+        pmr::vector<uint32_t> peaks{&arena};
+        for (uint32_t i = 0; i < input.size(); i += 3)
+            if (input[i] > 2.0f) peaks.emplace_back(i / 3);
+        arena.reset();
+        analyzed += 1;
+    }
+};
+
+/**
+ * @brief Upstream with the `operator new` of this library. `pmr::new_delete_resource()` is in the libc++,
+ *  so its allocations are not tracked
+ */
+class heap_resource_t final : public pmr::memory_resource {
+    void* do_allocate(size_t bytes, size_t alignment) noexcept(false) override {
+        return ::operator new(bytes, std::align_val_t{alignment});
+    }
+    void do_deallocate(void* ptr, size_t, size_t alignment) noexcept override {
+        ::operator delete(ptr, std::align_val_t{alignment});
+    }
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+}  // namespace
+
+extern "C" {
+
+JNIEXPORT jboolean Java_dev_luncliff_muffin_AllocationTest_isTrackingEnabled(JNIEnv*, jclass) {
+    return is_alloc_tracking_enabled();
+}
+
+/**
+ * @brief Allocate in the `assert_no_alloc_t` scope of `alloc_policy_t::count`
+ * @return number of the violations. Must be 1 with `MUFFIN_ALLOC_TRACKING`
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_AllocationTest_detectAllocation(  //
+    JNIEnv* env, jclass) {
+    try {
+        reset_alloc_sites();
+        heap_resource_t upstream{};
+        uint64_t violations = 0;
+        {
+            assert_no_alloc_t guard{alloc_policy_t::count};
+            frame_arena_t arena{4096, &upstream};  // 1 slab
+            violations = guard.violations();
+        }
+        if (is_alloc_tracking_enabled() && get_alloc_sites(1).empty())
+            throw std::runtime_error{"the site of the violation is not sampled"};
+        return static_cast<jint>(violations);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+/**
+ * @brief Run the synthetic frames through the pipeline. The first frames are for the warm-up
+ * @details The guard checks only the caller thread, but the pool's workers run most of the chunks.
+ *  So the process-wide counters are compared too. The other threads of the library must be idle
+ * @return number of the allocations after the warm-up. Must be 0
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_AllocationTest_countSteadyState(  //
+    JNIEnv* env, jclass, jint width, jint height, jint frames) {
+    try {
+        thread_pool_t& pool = get_default_pool();
+        synthetic_frame_source_t source{static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+        synthetic_pipeline_t pipeline{static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+        for (int i = 0; i < 2; ++i) pipeline.process(pool, source.next());
+        reset_alloc_sites();
+        uint64_t violations = 0;
+        const alloc_counters_t before = get_alloc_counters();
+        {
+            assert_no_alloc_t guard{alloc_policy_t::count};
+            for (int i = 0; i < frames; ++i) pipeline.process(pool, source.next());
+            violations = guard.violations();
+        }
+        const uint64_t allocations = get_alloc_counters().allocations - before.allocations;
+        spdlog::info("{}: {} frames analyzed {} violations {} allocations {}", __func__, frames, pipeline.analyzed,
+                     violations, allocations);
+        for (const alloc_site_t& site : get_alloc_sites(5))
+            spdlog::warn("{}: {} times {} bytes {}", __func__, site.count, site.bytes, describe_alloc_site(site));
+        return static_cast<jint>(std::max(violations, allocations));
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+/**
+ * @return descriptions of the call sites with the most sampled allocations
+ */
+JNIEXPORT jobjectArray Java_dev_luncliff_muffin_AllocationTest_reportSites(JNIEnv* env, jclass, jint count) {
+    try {
+        const std::vector<alloc_site_t> sites = get_alloc_sites(static_cast<size_t>(count));
+        jobjectArray result = env->NewObjectArray(static_cast<jsize>(sites.size()), env->FindClass("java/lang/String"),
+                                                  nullptr);
+        if (result == nullptr) return nullptr;
+        for (size_t i = 0; i < sites.size(); ++i) {
+            const std::string line = std::to_string(sites[i].count) + " " + describe_alloc_site(sites[i]);
+            jstring text = env->NewStringUTF(line.c_str());
+            env->SetObjectArrayElement(result, static_cast<jsize>(i), text);
+            env->DeleteLocalRef(text);
+        }
+        return result;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return nullptr;
+    }
+}
+
+}  // extern "C"
@@ -0,0 +1,407 @@
+#include "buffer_pool.hpp"
+
+#include <linux/memfd.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+buffer_handle_t ndk_buffer_allocator_t::allocate(AHardwareBuffer_Desc& desc) noexcept(false) {
+    AHardwareBuffer* buffer = nullptr;
+    if (AHardwareBuffer_allocate(&desc, &buffer) != 0) throw std::runtime_error{"AHardwareBuffer_allocate"};
+    AHardwareBuffer_describe(buffer, &desc);
+    return buffer;
+}
+
+void ndk_buffer_allocator_t::release(buffer_handle_t buffer) noexcept {
+    AHardwareBuffer_release(static_cast<AHardwareBuffer*>(buffer));
+}
+
+void* ndk_buffer_allocator_t::lock(buffer_handle_t buffer, uint64_t usage) noexcept(false) {
+    void* mapping = nullptr;
+    if (AHardwareBuffer_lock(static_cast<AHardwareBuffer*>(buffer), usage, -1, nullptr, &mapping) != 0)
+        throw std::runtime_error{"AHardwareBuffer_lock"};
+    return mapping;
+}
+
+void ndk_buffer_allocator_t::unlock(buffer_handle_t buffer) noexcept(false) {
+    if (AHardwareBuffer_unlock(static_cast<AHardwareBuffer*>(buffer), nullptr) != 0)
+        throw std::runtime_error{"AHardwareBuffer_unlock"};
+}
+
+void ndk_buffer_allocator_t::send(buffer_handle_t buffer, int socket) noexcept(false) {
+    if (auto ec = AHardwareBuffer_sendHandleToUnixSocket(static_cast<AHardwareBuffer*>(buffer), socket); ec != 0)
+        throw std::system_error{-ec, std::system_category(), "AHardwareBuffer_sendHandleToUnixSocket"};
+}
+
+buffer_handle_t ndk_buffer_allocator_t::receive(int socket, AHardwareBuffer_Desc& desc) noexcept(false) {
+    AHardwareBuffer* buffer = nullptr;  // acquired by the function
+    if (auto ec = AHardwareBuffer_recvHandleFromUnixSocket(socket, &buffer); ec != 0)
+        throw std::system_error{-ec, std::system_category(), "AHardwareBuffer_recvHandleFromUnixSocket"};
+    AHardwareBuffer_describe(buffer, &desc);
+    return buffer;
+}
+
+struct memfd_buffer_t final {
+    int fd;
+    void* mapping;
+    size_t size;
+    AHardwareBuffer_Desc desc;  // for the receiver. the memfd can't be described
+};
+
+/// @brief Map the `fd` and own it
+memfd_buffer_t* map_memfd(int fd, const AHardwareBuffer_Desc& desc, size_t size) noexcept(false) {
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        const int ec = errno;
+        close(fd);
+        throw std::system_error{ec, std::system_category(), "mmap"};
+    }
+    return new memfd_buffer_t{fd, mapping, size, desc};
+}
+
+buffer_handle_t memfd_buffer_allocator_t::allocate(AHardwareBuffer_Desc& desc) noexcept(false) {
+    desc.stride = desc.width;
+    const size_t size = get_buffer_size(desc);
+    // `memfd_create` is in the libc since API 30
+    const int fd = static_cast<int>(syscall(__NR_memfd_create, "hardware_buffer", MFD_CLOEXEC));
+    if (fd == -1) throw std::system_error{errno, std::system_category(), "memfd_create"};
+    if (ftruncate(fd, static_cast<off_t>(size)) == -1) {
+        const int ec = errno;
+        close(fd);
+        throw std::system_error{ec, std::system_category(), "ftruncate"};
+    }
+    return map_memfd(fd, desc, size);
+}
+
+void memfd_buffer_allocator_t::release(buffer_handle_t buffer) noexcept {
+    auto* memory = static_cast<memfd_buffer_t*>(buffer);
+    if (memory == nullptr) return;
+    munmap(memory->mapping, memory->size);
+    close(memory->fd);
+    delete memory;
+}
+
+void* memfd_buffer_allocator_t::lock(buffer_handle_t buffer, uint64_t) noexcept(false) {
+    return static_cast<memfd_buffer_t*>(buffer)->mapping;
+}
+
+void memfd_buffer_allocator_t::unlock(buffer_handle_t) noexcept(false) {
+    // the mapping is kept until the release
+}
+
+/// @brief The message of `memfd_buffer_allocator_t::send`
+struct memfd_handle_message_t final {
+    AHardwareBuffer_Desc desc;
+    uint64_t size;
+};
+
+void memfd_buffer_allocator_t::send(buffer_handle_t buffer, int socket) noexcept(false) {
+    const auto* memory = static_cast<const memfd_buffer_t*>(buffer);
+    memfd_handle_message_t message{};
+    message.desc = memory->desc;
+    message.size = memory->size;
+    iovec payload{&message, sizeof(message)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+    msghdr header{};
+    header.msg_iov = &payload;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    cmsghdr* rights = CMSG_FIRSTHDR(&header);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(rights), &memory->fd, sizeof(int));
+    if (sendmsg(socket, &header, MSG_NOSIGNAL) == -1) throw std::system_error{errno, std::system_category(), "sendmsg"};
+}
+
+buffer_handle_t memfd_buffer_allocator_t::receive(int socket, AHardwareBuffer_Desc& desc) noexcept(false) {
+    memfd_handle_message_t message{};
+    iovec payload{&message, sizeof(message)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+    msghdr header{};
+    header.msg_iov = &payload;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    const ssize_t length = recvmsg(socket, &header, MSG_CMSG_CLOEXEC);
+    if (length == -1) throw std::system_error{errno, std::system_category(), "recvmsg"};
+    const cmsghdr* rights = CMSG_FIRSTHDR(&header);
+    if (rights == nullptr || rights->cmsg_type != SCM_RIGHTS)
+        throw std::system_error{EBADMSG, std::generic_category(), "SCM_RIGHTS"};
+    int fd = -1;
+    std::memcpy(&fd, CMSG_DATA(rights), sizeof(int));
+    if (length != sizeof(message)) {
+        close(fd);
+        throw std::system_error{EBADMSG, std::generic_category(), "recvmsg"};
+    }
+    desc = message.desc;
+    return map_memfd(fd, desc, message.size);
+}
+
+int memfd_buffer_allocator_t::get_fd(buffer_handle_t buffer) noexcept {
+    return static_cast<const memfd_buffer_t*>(buffer)->fd;
+}
+
+size_t get_buffer_size(const AHardwareBuffer_Desc& desc) noexcept {
+    const size_t pixels = static_cast<size_t>(std::max(desc.stride, desc.width)) * desc.height *
+                          std::max<uint32_t>(desc.layers, 1);
+    switch (desc.format) {
+        case AHARDWAREBUFFER_FORMAT_BLOB:  // `width` is the bytes. `height` is 1
+            return pixels;
+        case AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420:
+            return pixels * 3 / 2;
+        case AHARDWAREBUFFER_FORMAT_R5G6B5_UNORM:
+            return pixels * 2;
+        case AHARDWAREBUFFER_FORMAT_R8G8B8_UNORM:
+            return pixels * 3;
+        case AHARDWAREBUFFER_FORMAT_R16G16B16A16_FLOAT:
+            return pixels * 8;
+        default:
+            return pixels * 4;
+    }
+}
+
+/// @return true if the buffers of `lhs` can be used for `rhs`
+bool is_same_bucket(const AHardwareBuffer_Desc& lhs, const AHardwareBuffer_Desc& rhs) noexcept {
+    return lhs.width == rhs.width && lhs.height == rhs.height && lhs.format == rhs.format &&
+           lhs.usage == rhs.usage && lhs.layers == rhs.layers;
+}
+
+hardware_buffer_pool_t::hardware_buffer_pool_t(buffer_allocator_t& allocator,
+                                               const buffer_pool_config_t& config) noexcept(false)
+    : allocator{allocator}, config{config} {
+    if (config.budget == 0) throw std::invalid_argument{"budget must be greater than 0"};
+}
+
+hardware_buffer_pool_t::~hardware_buffer_pool_t() noexcept {
+    if (is_trimming()) spdlog::error("{}: {}", "hardware_buffer_pool_t", "destroyed while trimming");
+    clear();
+    if (auto remain = stats().leased_count; remain != 0)
+        spdlog::error("{}: {} leases outlived the pool", "hardware_buffer_pool_t", remain);
+}
+
+hardware_buffer_pool_t::bucket_t* hardware_buffer_pool_t::find_bucket(const AHardwareBuffer_Desc& desc) noexcept {
+    for (bucket_t& bucket : buckets)
+        if (is_same_bucket(bucket.key, desc)) return &bucket;
+    return nullptr;
+}
+
+void hardware_buffer_pool_t::drop(uint32_t index, std::vector<buffer_handle_t>& output) noexcept {
+    slot_t& slot = slots[index];
+    output.emplace_back(slot.buffer);
+    bytes -= slot.bytes;
+    if (config.memory) config.memory->release(slot.bytes);
+    // keep the generation. the stale leases of the previous buffer must not match the next one
+    slot = slot_t{nullptr, {}, 0, slot.generation};
+    unused.emplace_back(index);
+}
+
+bool hardware_buffer_pool_t::evict_oldest(std::vector<buffer_handle_t>& output) noexcept {
+    // the oldest buffer of each bucket is at the front
+    bucket_t* oldest = nullptr;
+    for (bucket_t& bucket : buckets) {
+        if (bucket.slots.empty()) continue;
+        if (oldest == nullptr || slots[bucket.slots.front()].released < slots[oldest->slots.front()].released)
+            oldest = &bucket;
+    }
+    if (oldest == nullptr) return false;
+    drop(oldest->slots.front(), output);
+    oldest->slots.erase(oldest->slots.begin());
+    counters.evicted += 1;
+    return true;
+}
+
+void hardware_buffer_pool_t::evict(size_t required, std::vector<buffer_handle_t>& output) noexcept {
+    while (bytes + required > config.budget)
+        if (evict_oldest(output) == false) return;
+}
+
+bool hardware_buffer_pool_t::reserve_memory(size_t required, std::vector<buffer_handle_t>& output) noexcept {
+    if (config.memory == nullptr) return true;
+    while (config.memory->try_reserve(required) == false)
+        if (evict_oldest(output) == false) return false;
+    return true;
+}
+
+buffer_lease_t hardware_buffer_pool_t::acquire(const AHardwareBuffer_Desc& desc) noexcept(false) {
+    buffer_lease_t output{};
+    std::vector<buffer_handle_t> victims{};
+    uint32_t index = 0;
+    bool fits = false;
+    {
+        std::lock_guard lock{mtx};
+        if (bucket_t* bucket = find_bucket(desc); bucket != nullptr && bucket->slots.empty() == false) {
+            index = bucket->slots.back();
+            bucket->slots.pop_back();
+            slot_t& slot = slots[index];
+            slot.leased = true;
+            slot.generation += 1;
+            leased_bytes += slot.bytes;
+            counters.hits += 1;
+            output.buffer = slot.buffer;
+            output.desc = slot.desc;
+            output.slot = index;
+            output.generation = slot.generation;
+            return output;
+        }
+        // reserve the slot and the bytes before the allocation
+        const size_t required = get_buffer_size(desc);
+        // only the free buffers can be evicted. don't drop them for nothing
+        fits = leased_bytes + required <= config.budget;
+        if (fits) {
+            evict(required, victims);
+            fits = bytes + required <= config.budget && reserve_memory(required, victims);
+        }
+        if (fits) {
+            if (unused.empty()) {
+                index = static_cast<uint32_t>(slots.size());
+                slots.emplace_back();
+            } else {
+                index = unused.back();
+                unused.pop_back();
+            }
+            slot_t& slot = slots[index];
+            slot.used = true;
+            slot.leased = true;
+            slot.bytes = required;
+            slot.generation += 1;
+            bytes += required;
+            leased_bytes += required;
+            counters.misses += 1;
+        }
+    }
+    for (buffer_handle_t victim : victims) allocator.release(victim);
+    if (fits == false) throw std::system_error{ENOMEM, std::generic_category(), "hardware_buffer_pool_t"};
+
+    AHardwareBuffer_Desc allocated = desc;
+    try {
+        output.buffer = allocator.allocate(allocated);
+    } catch (...) {
+        std::lock_guard lock{mtx};
+        slot_t& slot = slots[index];
+        bytes -= slot.bytes;
+        leased_bytes -= slot.bytes;
+        if (config.memory) config.memory->release(slot.bytes);
+        slot = slot_t{nullptr, {}, 0, slot.generation};
+        unused.emplace_back(index);
+        throw;
+    }
+    std::lock_guard lock{mtx};
+    slot_t& slot = slots[index];  // `slots` may be reallocated while the allocation
+    const size_t actual = get_buffer_size(allocated);
+    bytes = bytes - slot.bytes + actual;
+    leased_bytes = leased_bytes - slot.bytes + actual;
+    if (config.memory && actual != slot.bytes) {
+        // the driver may pad more. it's charged without the limit since the buffer exists
+        config.memory->release(slot.bytes);
+        config.memory->charge(actual);
+    }
+    slot.buffer = output.buffer;
+    slot.desc = allocated;
+    slot.bytes = actual;
+    output.desc = allocated;
+    output.slot = index;
+    output.generation = slot.generation;
+    return output;
+}
+
+bool hardware_buffer_pool_t::is_current(const buffer_lease_t& lease) const noexcept {
+    if (lease.slot >= slots.size()) return false;
+    const slot_t& slot = slots[lease.slot];
+    return slot.leased && slot.buffer != nullptr && slot.buffer == lease.buffer &&
+           slot.generation == lease.generation;
+}
+
+bool hardware_buffer_pool_t::is_valid(const buffer_lease_t& lease) const noexcept {
+    std::lock_guard lock{mtx};
+    return is_current(lease);
+}
+
+void hardware_buffer_pool_t::release(buffer_lease_t& lease) noexcept {
+    if (lease.buffer == nullptr) return;
+    std::lock_guard lock{mtx};
+    if (is_current(lease) == false) {
+        spdlog::error("{}: {} {} {}", "hardware_buffer_pool_t", "stale lease", lease.slot, lease.generation);
+        return;
+    }
+    slot_t& slot = slots[lease.slot];
+    bucket_t* bucket = find_bucket(slot.desc);
+    if (bucket == nullptr) bucket = &buckets.emplace_back(bucket_t{slot.desc});
+    bucket->slots.emplace_back(lease.slot);
+    slot.leased = false;
+    slot.released = std::chrono::steady_clock::now();
+    leased_bytes -= slot.bytes;
+    lease = buffer_lease_t{};
+}
+
+uint32_t hardware_buffer_pool_t::trim(time_point_t now) noexcept {
+    std::vector<buffer_handle_t> victims{};
+    {
+        std::lock_guard lock{mtx};
+        for (bucket_t& bucket : buckets) {
+            auto it = bucket.slots.begin();
+            for (; it != bucket.slots.end(); ++it) {
+                if (now - slots[*it].released < config.idle_timeout) break;
+                drop(*it, victims);
+            }
+            bucket.slots.erase(bucket.slots.begin(), it);
+        }
+        // the bucket is created again when its buffer is released
+        buckets.erase(std::remove_if(buckets.begin(), buckets.end(),
+                                     [](const bucket_t& bucket) { return bucket.slots.empty(); }),
+                      buckets.end());
+        counters.trimmed += victims.size();
+    }
+    for (buffer_handle_t victim : victims) allocator.release(victim);
+    return static_cast<uint32_t>(victims.size());
+}
+
+uint32_t hardware_buffer_pool_t::clear() noexcept { return trim(time_point_t::max()); }
+
+forget_frame_t hardware_buffer_pool_t::start_trim(epoll_owner_t& ep, std::chrono::milliseconds interval) noexcept {
+    trimming = true;
+    req.events = EPOLLIN | EPOLLONESHOT;
+    req.data.ptr = nullptr;
+    try {
+        timespec spec{};
+        spec.tv_sec = interval.count() / 1'000;
+        spec.tv_nsec = (interval.count() % 1'000) * 1'000'000;
+        timer.start(spec);
+        while (stopping == false) {
+            co_await ep.submit(timer.fd(), req);
+            uint64_t count = 0;
+            if (read(timer.fd(), &count, sizeof(count)) == -1) continue;  // EAGAIN
+            if (auto released = trim(std::chrono::steady_clock::now()); released != 0)
+                spdlog::debug("{}: {} {}", "hardware_buffer_pool_t", "trimmed", released);
+        }
+        timer.stop();
+        ep.remove(timer.fd());
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", "hardware_buffer_pool_t", ex.what());
+    }
+    stopping = false;
+    trimming = false;
+}
+
+void hardware_buffer_pool_t::stop_trim() noexcept { stopping = true; }
+
+bool hardware_buffer_pool_t::is_trimming() const noexcept { return trimming; }
+
+buffer_pool_stats_t hardware_buffer_pool_t::stats() const noexcept {
+    std::lock_guard lock{mtx};
+    buffer_pool_stats_t output = counters;
+    output.bytes = bytes;
+    output.leased_bytes = leased_bytes;
+    for (const bucket_t& bucket : buckets) output.free_count += static_cast<uint32_t>(bucket.slots.size());
+    for (const slot_t& slot : slots)
+        if (slot.used && slot.leased) output.leased_count += 1;
+    return output;
+}
@@ -0,0 +1,235 @@
+#pragma once
+#include <android/hardware_buffer.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "memory_budget.hpp"
+#include "muffin.hpp"
+
+/// @brief Opaque buffer of the `buffer_allocator_t`. `AHardwareBuffer*` for the `ndk_buffer_allocator_t`
+using buffer_handle_t = void*;
+
+/**
+ * @brief Source of the `hardware_buffer_pool_t`'s buffers
+ */
+class buffer_allocator_t {
+   public:
+    virtual ~buffer_allocator_t() noexcept = default;
+
+    /**
+     * @param desc its `stride` is updated for the allocated buffer
+     * @throw runtime_error
+     */
+    virtual buffer_handle_t allocate(AHardwareBuffer_Desc& desc) noexcept(false) = 0;
+    virtual void release(buffer_handle_t buffer) noexcept = 0;
+
+    /**
+     * @return CPU address of the buffer
+     * @throw runtime_error
+     * @see AHardwareBuffer_lock
+     */
+    virtual void* lock(buffer_handle_t buffer, uint64_t usage) noexcept(false) = 0;
+    virtual void unlock(buffer_handle_t buffer) noexcept(false) = 0;
+
+    /**
+     * @brief Share the buffer with the other process through the `AF_UNIX` socket
+     * @throw system_error
+     * @see AHardwareBuffer_sendHandleToUnixSocket
+     */
+    virtual void send(buffer_handle_t buffer, int socket) noexcept(false) = 0;
+    /**
+     * @brief Receive the buffer from `send`. It must be released with this allocator
+     * @throw system_error
+     * @see AHardwareBuffer_recvHandleFromUnixSocket
+     */
+    virtual buffer_handle_t receive(int socket, AHardwareBuffer_Desc& desc) noexcept(false) = 0;
+};
+
+/**
+ * @brief `AHardwareBuffer_allocate`/`AHardwareBuffer_release`. The handle is `AHardwareBuffer*`
+ */
+class ndk_buffer_allocator_t final : public buffer_allocator_t {
+   public:
+    buffer_handle_t allocate(AHardwareBuffer_Desc& desc) noexcept(false) override;
+    void release(buffer_handle_t buffer) noexcept override;
+    void* lock(buffer_handle_t buffer, uint64_t usage) noexcept(false) override;
+    void unlock(buffer_handle_t buffer) noexcept(false) override;
+    void send(buffer_handle_t buffer, int socket) noexcept(false) override;
+    buffer_handle_t receive(int socket, AHardwareBuffer_Desc& desc) noexcept(false) override;
+};
+
+/**
+ * @brief Shared memory from `memfd_create`, for the host Linux which doesn't have gralloc
+ * @details The buffer is mapped while it is allocated, and the `usage` is ignored.
+ *  The `stride` is the `width`, so the size is same with `get_buffer_size`.
+ *  `send` passes the `memfd` with `SCM_RIGHTS`, and the description in the same message.
+ */
+class memfd_buffer_allocator_t final : public buffer_allocator_t {
+   public:
+    buffer_handle_t allocate(AHardwareBuffer_Desc& desc) noexcept(false) override;
+    void release(buffer_handle_t buffer) noexcept override;
+    void* lock(buffer_handle_t buffer, uint64_t usage) noexcept(false) override;
+    void unlock(buffer_handle_t buffer) noexcept(false) override;
+    void send(buffer_handle_t buffer, int socket) noexcept(false) override;
+    buffer_handle_t receive(int socket, AHardwareBuffer_Desc& desc) noexcept(false) override;
+
+    /// @return the `memfd` of the `buffer`. It can be shared with the other process
+    static int get_fd(buffer_handle_t buffer) noexcept;
+};
+
+/**
+ * @brief Bytes of the buffer. Uses `max(stride, width)` for the row
+ * @note Estimation of the format's pixel size. The driver may pad more
+ */
+size_t get_buffer_size(const AHardwareBuffer_Desc& desc) noexcept;
+
+/**
+ * @brief Buffer from the `hardware_buffer_pool_t`. It must be released to the pool
+ */
+struct buffer_lease_t final {
+    buffer_handle_t buffer = nullptr;
+    AHardwareBuffer_Desc desc{};
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;  // changes whenever the slot is leased again
+
+    explicit operator bool() const noexcept { return buffer != nullptr; }
+};
+
+struct buffer_pool_config_t final {
+    size_t budget = 64 << 20;                      // bytes of the leased and the free buffers
+    std::chrono::milliseconds idle_timeout{2000};  // the free buffers unused for this are released by `trim`
+    memory_budget_t* memory = nullptr;             // shared with the other pools and owners. null to skip
+};
+
+/**
+ * @brief Counters of the `hardware_buffer_pool_t`
+ */
+struct buffer_pool_stats_t final {
+    uint64_t hits;     // `acquire` with a recycled buffer
+    uint64_t misses;   // `acquire` which allocated
+    uint64_t evicted;  // free buffers released to keep the budget or the `memory_budget_t`
+    uint64_t trimmed;  // free buffers released by `trim`
+    size_t bytes;      // leased and free buffers
+    size_t leased_bytes;
+    uint32_t free_count;
+    uint32_t leased_count;
+};
+
+/**
+ * @brief Recycle the buffers of same description instead of allocating per frame
+ * @details The free buffers are bucketed by (width, height, format, usage, layers). A bucket is a stack,
+ *  so the buffer released last is reused first, and the oldest one is trimmed first.
+ *  When an allocation exceeds the `budget`, the least recently released buffers of any bucket are evicted.
+ *  With the `config.memory`, the pool's bytes are charged to it, and the free buffers are evicted in the same way
+ *  until the allocation fits in its limit.
+ *
+ *  The allocation and the release of the buffers are out of the pool's lock.
+ *  Acquire and release from any thread. `start_trim` runs on the thread of `resume_ready`.
+ *
+ * ```cpp
+ * ndk_buffer_allocator_t allocator{};
+ * hardware_buffer_pool_t pool{allocator, config};
+ * pool.start_trim(ep, 500ms);
+ * auto lease = pool.acquire(desc);
+ * // ... render or convert to the `lease.buffer`
+ * pool.release(lease);
+ * // ...
+ * pool.stop_trim();
+ * while (pool.is_trimming())
+ *     resume_ready(ep, 100);
+ * ```
+ */
+class hardware_buffer_pool_t final {
+    using time_point_t = std::chrono::steady_clock::time_point;
+
+    struct slot_t final {
+        buffer_handle_t buffer = nullptr;  // null while allocating or empty
+        AHardwareBuffer_Desc desc{};
+        size_t bytes = 0;  // reserved for the budget
+        uint32_t generation = 0;
+        bool used = false;    // false if the slot can be reused for another buffer
+        bool leased = false;  // true if not in the `bucket_t::slots`
+        time_point_t released{};
+    };
+
+    struct bucket_t final {
+        AHardwareBuffer_Desc key{};      // `stride` is ignored
+        std::vector<uint32_t> slots{};  // free buffers. ordered by `slot_t::released`
+    };
+
+    buffer_allocator_t& allocator;
+    buffer_pool_config_t config;
+    mutable std::mutex mtx{};
+    std::vector<slot_t> slots{};
+    std::vector<uint32_t> unused{};  // slots which can be reused
+    std::vector<bucket_t> buckets{};
+    size_t bytes = 0;
+    size_t leased_bytes = 0;
+    buffer_pool_stats_t counters{};
+    repeat_timer_t timer{};
+    epoll_event req{};
+    std::atomic<bool> trimming{};
+    std::atomic<bool> stopping{};
+
+   public:
+    /**
+     * @throw invalid_argument if the `config.budget` is zero
+     * @throw system_error
+     */
+    hardware_buffer_pool_t(buffer_allocator_t& allocator, const buffer_pool_config_t& config) noexcept(false);
+    /// @note The leased buffers are reported, not released
+    ~hardware_buffer_pool_t() noexcept;
+    hardware_buffer_pool_t(const hardware_buffer_pool_t&) = delete;
+    hardware_buffer_pool_t(hardware_buffer_pool_t&&) = delete;
+    hardware_buffer_pool_t& operator=(const hardware_buffer_pool_t&) = delete;
+    hardware_buffer_pool_t& operator=(hardware_buffer_pool_t&&) = delete;
+
+   private:
+    bucket_t* find_bucket(const AHardwareBuffer_Desc& desc) noexcept;
+    /// @brief Move the free buffers to the `output` until the `bytes` fit in the budget. Needs the lock
+    void evict(size_t required, std::vector<buffer_handle_t>& output) noexcept;
+    /// @return false if there is no free buffer to evict. Needs the lock
+    bool evict_oldest(std::vector<buffer_handle_t>& output) noexcept;
+    /// @brief Reserve the `required` bytes of the `config.memory`. Evicts the free buffers if it doesn't fit
+    bool reserve_memory(size_t required, std::vector<buffer_handle_t>& output) noexcept;
+    /// @brief Move the free buffer to the `output`, and make the slot unused. Needs the lock
+    void drop(uint32_t slot, std::vector<buffer_handle_t>& output) noexcept;
+    /// @brief `is_valid` without the lock
+    bool is_current(const buffer_lease_t& lease) const noexcept;
+
+   public:
+    /**
+     * @brief Recycle a free buffer of the `desc`, or allocate a new one
+     * @throw system_error(ENOMEM) if the buffer doesn't fit in the budget or the `config.memory` with the leased ones
+     * @throw runtime_error the allocator failed
+     */
+    buffer_lease_t acquire(const AHardwareBuffer_Desc& desc) noexcept(false);
+
+    /// @brief Return the buffer to its bucket and reset the `lease`. The stale lease is ignored
+    void release(buffer_lease_t& lease) noexcept;
+
+    /// @return true if the `lease` is the current one of its slot
+    bool is_valid(const buffer_lease_t& lease) const noexcept;
+
+    /**
+     * @brief Release the free buffers unused for `idle_timeout`, and remove the empty buckets
+     * @return number of the released buffers
+     */
+    uint32_t trim(time_point_t now) noexcept;
+    /// @brief Release all free buffers. For `onTrimMemory`
+    uint32_t clear() noexcept;
+
+    /**
+     * @brief Run `trim` with the `interval`. The thread which runs `resume_ready` with the `ep` will trim
+     */
+    forget_frame_t start_trim(epoll_owner_t& ep, std::chrono::milliseconds interval) noexcept;
+    /// @brief Request the loop to stop. It stops at the next tick of the timer
+    void stop_trim() noexcept;
+    bool is_trimming() const noexcept;
+
+    buffer_pool_stats_t stats() const noexcept;
+};
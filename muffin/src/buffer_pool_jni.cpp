@@ -0,0 +1,206 @@
+#include <jni.h>
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "buffer_pool.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+
+namespace {
+
+std::unique_ptr<buffer_allocator_t> make_allocator(bool memfd) noexcept(false) {
+    if (memfd) return std::make_unique<memfd_buffer_allocator_t>();
+    return std::make_unique<ndk_buffer_allocator_t>();
+}
+
+AHardwareBuffer_Desc make_rgba_desc(uint32_t width, uint32_t height) noexcept {
+    AHardwareBuffer_Desc desc{};
+    desc.width = width;
+    desc.height = height;
+    desc.layers = 1;
+    desc.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+    desc.usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN;
+    return desc;
+}
+
+}  // namespace
+
+extern "C" {
+
+/**
+ * @brief Acquire and release the same description for `repeat` times
+ * @return number of the allocations. Must be 1
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_BufferPoolTest_recycleBuffer(  //
+    JNIEnv* env, jclass, jboolean memfd, jint width, jint height, jint repeat) {
+    try {
+        auto allocator = make_allocator(memfd);
+        hardware_buffer_pool_t pool{*allocator, buffer_pool_config_t{}};
+        const AHardwareBuffer_Desc desc = make_rgba_desc(width, height);
+        buffer_lease_t first = pool.acquire(desc);
+        const buffer_handle_t buffer = first.buffer;
+        uint32_t generation = first.generation;
+        pool.release(first);
+        for (int i = 0; i < repeat; ++i) {
+            buffer_lease_t lease = pool.acquire(desc);
+            if (lease.buffer != buffer) throw std::runtime_error{"the free buffer is not recycled"};
+            if (lease.generation == generation) throw std::runtime_error{"the generation is not changed"};
+            generation = lease.generation;
+            // the recycled buffer is still writable
+            auto* pixels = static_cast<uint8_t*>(allocator->lock(lease.buffer, desc.usage));
+            pixels[0] = static_cast<uint8_t>(i);
+            allocator->unlock(lease.buffer);
+            pool.release(lease);
+        }
+        const buffer_pool_stats_t stats = pool.stats();
+        if (stats.hits != static_cast<uint64_t>(repeat)) throw std::runtime_error{"hits != repeat"};
+        if (stats.leased_count != 0 || stats.free_count != 1) throw std::runtime_error{"unexpected buffer count"};
+        return static_cast<jint>(stats.misses);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief The budget fits 2 large buffers. Release them and acquire 2 small buffers
+ * @return number of the evicted buffers. Must be 1, since 1 large buffer and 2 small ones fit in the budget
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_BufferPoolTest_evictForBudget(  //
+    JNIEnv* env, jclass, jboolean memfd) {
+    try {
+        auto allocator = make_allocator(memfd);
+        const AHardwareBuffer_Desc small = make_rgba_desc(320, 240), large = make_rgba_desc(640, 480);
+        buffer_pool_config_t config{};
+        config.budget = 2 * get_buffer_size(large);  // gralloc may pad the rows. use the larger one
+        hardware_buffer_pool_t pool{*allocator, config};
+
+        auto expect_enomem = [&pool](const AHardwareBuffer_Desc& desc) {
+            try {
+                buffer_lease_t lease = pool.acquire(desc);
+                pool.release(lease);
+                throw std::runtime_error{"the budget is not enforced"};
+            } catch (const std::system_error& ex) {
+                if (ex.code().value() != ENOMEM) throw;
+            }
+        };
+        buffer_lease_t a = pool.acquire(large), b = pool.acquire(large);
+        // both are leased. nothing to evict
+        expect_enomem(small);
+        pool.release(a);
+        // the free buffer can't make room with the leased one. it must be kept
+        expect_enomem(make_rgba_desc(1280, 480));
+        if (pool.stats().evicted != 0) throw std::runtime_error{"evicted for the buffer which doesn't fit"};
+        pool.release(b);
+        buffer_lease_t c = pool.acquire(small), d = pool.acquire(small);
+        const buffer_pool_stats_t stats = pool.stats();
+        pool.release(c);
+        pool.release(d);
+        if (stats.bytes > config.budget) throw std::runtime_error{"bytes > budget"};
+        return static_cast<jint>(stats.evicted);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Release a lease twice, and the copy of the lease after the buffer is leased again
+ * @return true if the stale leases didn't change the pool
+ */
+JNIEXPORT jboolean Java_dev_luncliff_muffin_BufferPoolTest_rejectStaleLease(  //
+    JNIEnv* env, jclass, jboolean memfd) {
+    try {
+        auto allocator = make_allocator(memfd);
+        hardware_buffer_pool_t pool{*allocator, buffer_pool_config_t{}};
+        const AHardwareBuffer_Desc desc = make_rgba_desc(320, 240);
+        buffer_lease_t lease = pool.acquire(desc);
+        buffer_lease_t stale = lease;
+        pool.release(lease);
+        pool.release(stale);  // double release
+        if (pool.stats().free_count != 1) return false;
+
+        buffer_lease_t current = pool.acquire(desc);  // same buffer with the next generation
+        if (current.buffer != stale.buffer || pool.is_valid(stale)) return false;
+        pool.release(stale);
+        const bool rejected = pool.is_valid(current) && pool.stats().leased_count == 1;
+        pool.release(current);
+        return rejected;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return false;
+    }
+}
+
+/**
+ * @brief Run `start_trim` for `duration` milliseconds with the free buffers
+ * @return number of the free buffers after the `duration`
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_BufferPoolTest_trimIdleBuffers(  //
+    JNIEnv* env, jclass, jboolean memfd, jint timeout, jint interval, jint duration) {
+    using namespace std::chrono;
+    try {
+        auto allocator = make_allocator(memfd);
+        buffer_pool_config_t config{};
+        config.idle_timeout = milliseconds{timeout};
+        hardware_buffer_pool_t pool{*allocator, config};
+        buffer_lease_t leases[3]{pool.acquire(make_rgba_desc(320, 240)), pool.acquire(make_rgba_desc(640, 480)),
+                                 pool.acquire(make_rgba_desc(640, 480))};
+        for (buffer_lease_t& lease : leases) pool.release(lease);
+
+        epoll_owner_t ep{};
+        pool.start_trim(ep, milliseconds{interval});
+        const auto until = steady_clock::now() + milliseconds{duration};
+        while (steady_clock::now() < until) resume_ready(ep, interval);
+        pool.stop_trim();
+        while (pool.is_trimming()) resume_ready(ep, interval);
+
+        const buffer_pool_stats_t stats = pool.stats();
+        spdlog::info("{}: trimmed {} free {}", __func__, stats.trimmed, stats.free_count);
+        return static_cast<jint>(stats.free_count);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+/**
+ * @return average nanoseconds of the acquire/release pair. Allocates per loop if not `pooled`
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_BufferPoolTest_measureAcquire(  //
+    JNIEnv* env, jclass, jboolean memfd, jboolean pooled, jint width, jint height, jint repeat) {
+    using namespace std::chrono;
+    try {
+        auto allocator = make_allocator(memfd);
+        hardware_buffer_pool_t pool{*allocator, buffer_pool_config_t{}};
+        const AHardwareBuffer_Desc desc = make_rgba_desc(width, height);
+        const auto start = steady_clock::now();
+        for (int i = 0; i < repeat; ++i) {
+            if (pooled) {
+                buffer_lease_t lease = pool.acquire(desc);
+                pool.release(lease);
+            } else {
+                AHardwareBuffer_Desc allocated = desc;
+                allocator->release(allocator->allocate(allocated));
+            }
+        }
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+        spdlog::info("{}: {} {} {}x{} {} ns", __func__, memfd ? "memfd" : "gralloc", pooled ? "pooled" : "allocate",
+                     width, height, elapsed.count() / repeat);
+        return static_cast<jlong>(elapsed.count() / repeat);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+}  // extern "C"
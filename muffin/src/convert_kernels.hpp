@@ -0,0 +1,1676 @@
+#pragma once
+/**
+ * @file convert_kernels.hpp
+ * @brief Building blocks of the conversion kernels. Only for the kernel sources, not for the users
+ * @note Everything is in the anonymous namespace. Each source gets its own copy, so the sources can be built with
+ *  different ISA flags without breaking the ODR.
+ *
+ * The ISA variants define `KERNEL_TARGET_AVX2` and include this file in the region of the target attribute.
+ * @see image_converter_avx2.cpp
+ */
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__) || defined(KERNEL_TARGET_AVX2)
+#define KERNEL_AVX2 1
+#endif
+#if defined(__F16C__) || defined(KERNEL_TARGET_AVX2)
+#define KERNEL_F16C 1
+#endif
+#if defined(__SSE4_1__) || defined(KERNEL_TARGET_AVX2)
+#define KERNEL_SSE4_1 1  // the AVX2 kernels use the 128 bit ones
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(KERNEL_SSE4_1)
+#include <smmintrin.h>
+#endif
+#if defined(KERNEL_AVX2) || defined(KERNEL_F16C)
+#include <immintrin.h>
+#endif
+
+#include "image_converter.hpp"
+#include "yuv_convert.hpp"
+
+namespace {  // each includer uses a part of the functions. they are `inline` to avoid -Wunused-function
+
+/// @see https://www.w3.org/Graphics/JPEG/jfif3.pdf Camera's YUV_420_888 uses JFIF(full range BT.601)
+constexpr float coef_rv = 1.402f;
+constexpr float coef_gu = 0.344136f;
+constexpr float coef_gv = 0.714136f;
+constexpr float coef_bu = 1.772f;
+
+/// @brief Source index(in pixels) of 2 taps and the weight of the second one
+struct tap_t final {
+    int32_t i0;
+    int32_t i1;
+    float weight;
+};
+
+/// @brief Bilinear taps of the `i`th output. The pixel centers are aligned
+inline tap_t get_tap(uint32_t i, uint32_t src_size, uint32_t dst_size) noexcept {
+    const float scale = static_cast<float>(src_size) / static_cast<float>(dst_size);
+    const float limit = static_cast<float>(src_size - 1);
+    const float s = std::clamp((static_cast<float>(i) + 0.5f) * scale - 0.5f, 0.0f, limit);
+    const auto i0 = static_cast<int32_t>(s);
+    const auto i1 = std::min<int32_t>(i0 + 1, static_cast<int32_t>(src_size - 1));
+    return tap_t{i0, i1, s - static_cast<float>(i0)};
+}
+
+/**
+ * @brief `get_tap` of the `F`:1 ratio without the division. The destination size is `src_size / F`
+ * @tparam F 1, 2, 4. 0 for the 1:2 upsample
+ */
+template <int32_t F>
+tap_t get_ratio_tap(uint32_t i, uint32_t src_size) noexcept {
+    const auto last = static_cast<int32_t>(src_size - 1);
+    if constexpr (F == 0) {
+        // 0.75/0.25 between the neighbors. The first one is clamped
+        if (i == 0) return tap_t{0, std::min(1, last), 0.0f};
+        const auto i0 = static_cast<int32_t>((i - 1) / 2);
+        return tap_t{i0, std::min(i0 + 1, last), (i & 1) ? 0.25f : 0.75f};
+    } else if constexpr (F == 1) {
+        const auto i0 = static_cast<int32_t>(i);
+        return tap_t{i0, std::min(i0 + 1, last), 0.0f};
+    } else {
+        const auto i0 = static_cast<int32_t>(F * i + F / 2 - 1);
+        return tap_t{i0, i0 + 1, 0.5f};
+    }
+}
+
+/// @brief Weight in [0, 1] to Q15. 1 is saturated to 32767
+inline int16_t to_q15(float weight) noexcept {
+    return static_cast<int16_t>(std::min<long>(std::lrint(weight * 32768.0f), INT16_MAX));
+}
+
+inline void make_axis(yuv_resize_plan_t::axis_t& axis, uint32_t src_size, uint32_t dst_size, int32_t stride) {
+    axis.offset0.resize(dst_size);
+    axis.offset1.resize(dst_size);
+    axis.weight.resize(dst_size);
+    axis.fraction.resize(dst_size);
+    for (uint32_t i = 0; i < dst_size; ++i) {
+        const tap_t tap = get_tap(i, src_size, dst_size);
+        axis.offset0[i] = tap.i0 * stride;
+        axis.offset1[i] = tap.i1 * stride;
+        axis.weight[i] = tap.weight;
+        axis.fraction[i] = to_q15(tap.weight);
+    }
+}
+
+inline void reverse_axis(yuv_resize_plan_t::axis_t& axis) noexcept {
+    std::reverse(axis.offset0.begin(), axis.offset0.end());
+    std::reverse(axis.offset1.begin(), axis.offset1.end());
+    std::reverse(axis.weight.begin(), axis.weight.end());
+    std::reverse(axis.fraction.begin(), axis.fraction.end());
+}
+
+/// @brief How the output rows/columns walk the source
+struct orientation_map_t final {
+    bool transpose;        // output rows are source columns
+    bool reverse_rows;     // last output row is the first source row(or column)
+    bool reverse_columns;  // last output column is the first source column(or row)
+};
+
+inline orientation_map_t get_orientation_map(orientation_t orientation) noexcept(false) {
+    switch (orientation.degrees) {
+        case 0:
+            return {false, false, orientation.mirror};
+        case 90:
+            return {true, false, !orientation.mirror};
+        case 180:
+            return {false, true, !orientation.mirror};
+        case 270:
+            return {true, true, orientation.mirror};
+        default:
+            throw std::invalid_argument{"unexpected orientation degrees"};
+    }
+}
+
+/// @brief `x * scale + bias` for each channel
+struct rgb_affine_t final {
+    float scale[3];
+    float bias[3];
+};
+
+inline rgb_affine_t make_affine(const rgb_normalization_t& norm) noexcept {
+    rgb_affine_t affine{};
+    for (int i = 0; i < 3; ++i) {
+        affine.scale[i] = 1.0f / (255.0f * norm.stddev[i]);
+        affine.bias[i] = -norm.mean[i] / norm.stddev[i];
+    }
+    return affine;
+}
+
+/// @brief Source rows for one output row
+struct row_sources_t final {
+    const uint8_t* y0;
+    const uint8_t* y1;
+    const uint8_t* u0;
+    const uint8_t* u1;
+    const uint8_t* v0;
+    const uint8_t* v1;
+    float yw;
+    float cw;
+    int16_t yq;  // `yw` in Q15
+    int16_t cq;  // `cw` in Q15
+};
+
+inline row_sources_t get_row(const yuv_view_t& src, const yuv_resize_plan_t& plan, size_t r) noexcept {
+    const auto& luma = plan.luma_rows;
+    const auto& chroma = plan.chroma_rows;
+    row_sources_t row{};
+    row.y0 = src.y.data + luma.offset0[r];
+    row.y1 = src.y.data + luma.offset1[r];
+    row.u0 = src.u.data + chroma.offset0[r];
+    row.u1 = src.u.data + chroma.offset1[r];
+    row.v0 = src.v.data + chroma.offset0[r];
+    row.v1 = src.v.data + chroma.offset1[r];
+    row.yw = luma.weight[r];
+    row.cw = chroma.weight[r];
+    row.yq = luma.fraction[r];
+    row.cq = chroma.fraction[r];
+    return row;
+}
+
+/// @brief Bilinear sample at the byte offsets `o0`, `o1` of the rows
+inline float bilinear(const uint8_t* r0, const uint8_t* r1, int32_t o0, int32_t o1, float wx, float wy) noexcept {
+    const float top = r0[o0] + (r0[o1] - r0[o0]) * wx;
+    const float bottom = r1[o0] + (r1[o1] - r1[o0]) * wx;
+    return top + (bottom - top) * wy;
+}
+
+inline float bilinear(const uint8_t* r0, const uint8_t* r1, const yuv_resize_plan_t::axis_t& columns, size_t c,
+                      float wy) noexcept {
+    return bilinear(r0, r1, columns.offset0[c], columns.offset1[c], columns.weight[c], wy);
+}
+
+/// @param u not centered. [0, 255]
+inline void to_rgb(float y, float u, float v, float rgb[3]) noexcept {
+    u -= 128.0f;
+    v -= 128.0f;
+    rgb[0] = std::clamp(y + coef_rv * v, 0.0f, 255.0f);
+    rgb[1] = std::clamp(y - coef_gu * u - coef_gv * v, 0.0f, 255.0f);
+    rgb[2] = std::clamp(y + coef_bu * u, 0.0f, 255.0f);
+}
+
+inline void sample_rgb(const row_sources_t& row, const yuv_resize_plan_t& plan, size_t c, float rgb[3]) noexcept {
+    const float y = bilinear(row.y0, row.y1, plan.luma_columns, c, row.yw);
+    const float u = bilinear(row.u0, row.u1, plan.chroma_columns, c, row.cw);
+    const float v = bilinear(row.v0, row.v1, plan.chroma_columns, c, row.cw);
+    to_rgb(y, u, v, rgb);
+}
+
+/**
+ * @brief IEEE half with round to nearest even
+ * @see https://gist.github.com/rygorous/2156668 `float_to_half_fast3_rtne`
+ */
+inline uint16_t make_half(float value) noexcept {
+    uint32_t f = 0;
+    std::memcpy(&f, &value, 4);
+    const uint32_t sign = f & 0x8000'0000u;
+    f ^= sign;
+    uint32_t h = 0;
+    if (f >= (127u + 16) << 23) {
+        h = f > 0x7F80'0000u ? 0x7E00 : 0x7C00;  // NaN, Inf
+    } else if (f < 113u << 23) {
+        // subnormal. let the FPU round the mantissa
+        constexpr uint32_t magic_bits = ((127u - 15) + (23 - 10) + 1) << 23;
+        float magic = 0;
+        std::memcpy(&magic, &magic_bits, 4);
+        float shifted = 0;
+        std::memcpy(&shifted, &f, 4);
+        shifted += magic;
+        std::memcpy(&h, &shifted, 4);
+        h -= magic_bits;
+    } else {
+        const uint32_t odd = (f >> 13) & 1;
+        h = (f - (112u << 23) + 0xFFF + odd) >> 13;
+    }
+    return static_cast<uint16_t>(h | sign >> 16);
+}
+
+inline void write1(float value, float* dst) noexcept { *dst = value; }
+
+inline void write1(float value, uint16_t* dst) noexcept { *dst = make_half(value); }
+
+inline void write1(float value, uint8_t* dst) noexcept {
+    *dst = static_cast<uint8_t>(std::lrint(std::clamp(value, 0.0f, 255.0f)));
+}
+
+inline void write1(float value, int8_t* dst) noexcept {
+    *dst = static_cast<int8_t>(std::lrint(std::clamp(value, -128.0f, 127.0f)));
+}
+
+inline void store_pixel(const float rgb[3], uint8_t* dst) noexcept {
+    for (int i = 0; i < 3; ++i) dst[i] = static_cast<uint8_t>(rgb[i] + 0.5f);
+}
+
+#if defined(KERNEL_SSE4_1)
+
+inline __m128 gather4(const uint8_t* base, const int32_t* offsets) noexcept {
+    return _mm_cvtepi32_ps(_mm_setr_epi32(base[offsets[0]], base[offsets[1]], base[offsets[2]], base[offsets[3]]));
+}
+
+inline __m128 bilinear4(const uint8_t* r0, const uint8_t* r1, const yuv_resize_plan_t::axis_t& columns, size_t c,
+                        __m128 wy) noexcept {
+    const int32_t* o0 = columns.offset0.data() + c;
+    const int32_t* o1 = columns.offset1.data() + c;
+    const __m128 wx = _mm_loadu_ps(columns.weight.data() + c);
+    const __m128 a = gather4(r0, o0), b = gather4(r0, o1);
+    const __m128 p = gather4(r1, o0), q = gather4(r1, o1);
+    const __m128 top = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), wx));
+    const __m128 bottom = _mm_add_ps(p, _mm_mul_ps(_mm_sub_ps(q, p), wx));
+    return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), wy));
+}
+
+struct rgb4_t final {
+    __m128 r, g, b;
+};
+
+using vec4_t = __m128;
+
+inline vec4_t set4(float value) noexcept { return _mm_set1_ps(value); }
+
+inline vec4_t set4(float v0, float v1, float v2, float v3) noexcept { return _mm_setr_ps(v0, v1, v2, v3); }
+
+/// @brief `a + (b - a) * w`. Same operations with `bilinear`
+inline vec4_t lerp4(vec4_t a, vec4_t b, vec4_t w) noexcept { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), w)); }
+
+/**
+ * @brief `src[0]`, `src[S]`, `src[2S]`, `src[3S]`
+ * @note For `S` up to 4, it reads 16 bytes(8 bytes if `S` is 2, 4 bytes if `S` is 1)
+ */
+template <int32_t S>
+vec4_t load4(const uint8_t* src) noexcept {
+    if constexpr (S == 1) {
+        int32_t bytes = 0;
+        std::memcpy(&bytes, src, 4);
+        return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes)));
+    } else if constexpr (S == 2) {
+        const __m128i order = _mm_setr_epi8(0, 2, 4, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+        return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_shuffle_epi8(bytes, order)));
+    } else if constexpr (S == 4) {
+        const __m128i order = _mm_setr_epi8(0, -1, -1, -1, 4, -1, -1, -1, 8, -1, -1, -1, 12, -1, -1, -1);
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        return _mm_cvtepi32_ps(_mm_shuffle_epi8(bytes, order));
+    } else {
+        return _mm_cvtepi32_ps(_mm_setr_epi32(src[0], src[S], src[2 * S], src[3 * S]));
+    }
+}
+
+/// @return `[v0 v1 v1 v2]` and `[v1 v2 v2 v3]`. Taps of the 2x upsample
+inline void upsample_taps4(vec4_t v, vec4_t& lo, vec4_t& hi) noexcept {
+    lo = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 1, 1, 0));
+    hi = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 2, 2, 1));
+}
+
+/// @param u not centered. [0, 255]
+inline rgb4_t to_rgb4(vec4_t y, vec4_t u, vec4_t v) noexcept {
+    const __m128 offset = _mm_set1_ps(128.0f), lower = _mm_setzero_ps(), upper = _mm_set1_ps(255.0f);
+    u = _mm_sub_ps(u, offset);
+    v = _mm_sub_ps(v, offset);
+    rgb4_t px{};
+    px.r = _mm_add_ps(y, _mm_mul_ps(_mm_set1_ps(coef_rv), v));
+    px.g = _mm_sub_ps(_mm_sub_ps(y, _mm_mul_ps(_mm_set1_ps(coef_gu), u)), _mm_mul_ps(_mm_set1_ps(coef_gv), v));
+    px.b = _mm_add_ps(y, _mm_mul_ps(_mm_set1_ps(coef_bu), u));
+    px.r = _mm_min_ps(_mm_max_ps(px.r, lower), upper);
+    px.g = _mm_min_ps(_mm_max_ps(px.g, lower), upper);
+    px.b = _mm_min_ps(_mm_max_ps(px.b, lower), upper);
+    return px;
+}
+
+inline rgb4_t sample_rgb4(const row_sources_t& row, const yuv_resize_plan_t& plan, size_t c) noexcept {
+    const __m128 cw = _mm_set1_ps(row.cw);
+    const __m128 y = bilinear4(row.y0, row.y1, plan.luma_columns, c, _mm_set1_ps(row.yw));
+    const __m128 u = bilinear4(row.u0, row.u1, plan.chroma_columns, c, cw);
+    const __m128 v = bilinear4(row.v0, row.v1, plan.chroma_columns, c, cw);
+    return to_rgb4(y, u, v);
+}
+
+/// @brief Interleave 4 pixels into `[r0 g0 b0 r1] [g1 b1 r2 g2] [b2 r3 g3 b3]`
+inline void interleave4(__m128 r, __m128 g, __m128 b, __m128 out[3]) noexcept {
+    const __m128 rg0 = _mm_unpacklo_ps(r, g);  // r0 g0 r1 g1
+    const __m128 rg1 = _mm_unpackhi_ps(r, g);  // r2 g2 r3 g3
+    const __m128 m0 = _mm_shuffle_ps(b, rg0, _MM_SHUFFLE(2, 2, 0, 0));
+    const __m128 m1 = _mm_shuffle_ps(rg0, b, _MM_SHUFFLE(1, 1, 3, 3));
+    const __m128 m2 = _mm_shuffle_ps(b, rg1, _MM_SHUFFLE(2, 2, 2, 2));
+    const __m128 m3 = _mm_shuffle_ps(rg1, b, _MM_SHUFFLE(3, 3, 3, 3));
+    out[0] = _mm_shuffle_ps(rg0, m0, _MM_SHUFFLE(2, 0, 1, 0));
+    out[1] = _mm_shuffle_ps(m1, rg1, _MM_SHUFFLE(1, 0, 2, 0));
+    out[2] = _mm_shuffle_ps(m2, m3, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+inline __m128 apply4(__m128 value, const rgb_affine_t& affine, int channel) noexcept {
+    return _mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(affine.scale[channel])), _mm_set1_ps(affine.bias[channel]));
+}
+
+/// @brief 4 IEEE halfs in the lower 64 bits. Same result with `make_half`
+inline __m128i make_half4(__m128 value) noexcept {
+#if defined(KERNEL_F16C)
+    return _mm_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT);
+#else
+    const __m128i f = _mm_castps_si128(value);
+    const __m128i sign = _mm_and_si128(f, _mm_set1_epi32(INT32_MIN));
+    const __m128i a = _mm_xor_si128(f, sign);
+    const __m128i nan = _mm_cmpgt_epi32(a, _mm_set1_epi32(0x7F80'0000));
+    const __m128i special = _mm_blendv_epi8(_mm_set1_epi32(0x7C00), _mm_set1_epi32(0x7E00), nan);
+    const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23));
+    const __m128i subnormal =
+        _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(a), magic)), _mm_castps_si128(magic));
+    const __m128i odd = _mm_and_si128(_mm_srli_epi32(a, 13), _mm_set1_epi32(1));
+    const __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(a, _mm_set1_epi32((112 << 23) - 0xFFF)), odd), 13);
+    __m128i h = _mm_blendv_epi8(normal, subnormal, _mm_cmplt_epi32(a, _mm_set1_epi32(113 << 23)));
+    h = _mm_blendv_epi8(h, special, _mm_cmpgt_epi32(a, _mm_set1_epi32(((127 + 16) << 23) - 1)));
+    h = _mm_or_si128(h, _mm_srli_epi32(sign, 16));
+    return _mm_packus_epi32(h, h);
+#endif
+}
+
+/// @brief Round to nearest even in the range of int16. The packs saturate the rest
+inline __m128i round4(__m128 value) noexcept {
+    const __m128 limit = _mm_set1_ps(32768.0f);
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(value, _mm_sub_ps(_mm_setzero_ps(), limit)), limit));
+}
+
+inline void write4(__m128 value, float* dst) noexcept { _mm_storeu_ps(dst, value); }
+
+inline void write4(__m128 value, uint16_t* dst) noexcept {
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), make_half4(value));
+}
+
+inline void write4(__m128 value, uint8_t* dst) noexcept {
+    const __m128i q = _mm_packs_epi32(round4(value), _mm_setzero_si128());
+    const int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(q, q));
+    std::memcpy(dst, &bytes, 4);
+}
+
+inline void write4(__m128 value, int8_t* dst) noexcept {
+    const __m128i q = _mm_packs_epi32(round4(value), _mm_setzero_si128());
+    const int32_t bytes = _mm_cvtsi128_si32(_mm_packs_epi16(q, q));
+    std::memcpy(dst, &bytes, 4);
+}
+
+/// @brief 4 pixels of interleaved RGB. Interleaved before the conversion, so all types share the shuffles
+template <typename T>
+void write_nhwc4(__m128 r, __m128 g, __m128 b, T* dst) noexcept {
+    __m128 px[3]{};
+    interleave4(r, g, b, px);
+    write4(px[0], dst);
+    write4(px[1], dst + 4);
+    write4(px[2], dst + 8);
+}
+
+inline void store_pixel4(const rgb4_t& px, uint8_t* dst) noexcept {
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i r = _mm_cvttps_epi32(_mm_add_ps(px.r, half));
+    const __m128i g = _mm_cvttps_epi32(_mm_add_ps(px.g, half));
+    const __m128i b = _mm_cvttps_epi32(_mm_add_ps(px.b, half));
+    // r0 r1 r2 r3 g0 g1 g2 g3 b0 b1 b2 b3 ...
+    const __m128i planar = _mm_packus_epi16(_mm_packus_epi32(r, g), _mm_packus_epi32(b, b));
+    const __m128i order = _mm_setr_epi8(0, 4, 8, 1, 5, 9, 2, 6, 10, 3, 7, 11, -1, -1, -1, -1);
+    const __m128i packed = _mm_shuffle_epi8(planar, order);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), packed);
+    const int32_t tail = _mm_extract_epi32(packed, 2);
+    std::copy_n(reinterpret_cast<const uint8_t*>(&tail), 4, dst + 8);
+}
+
+#endif  // KERNEL_SSE4_1
+
+#if defined(KERNEL_AVX2)
+
+inline __m256 gather8(const uint8_t* base, const int32_t* o) noexcept {
+    return _mm256_cvtepi32_ps(_mm256_setr_epi32(base[o[0]], base[o[1]], base[o[2]], base[o[3]],  //
+                                                base[o[4]], base[o[5]], base[o[6]], base[o[7]]));
+}
+
+inline __m256 bilinear8(const uint8_t* r0, const uint8_t* r1, const yuv_resize_plan_t::axis_t& columns, size_t c,
+                        __m256 wy) noexcept {
+    const int32_t* o0 = columns.offset0.data() + c;
+    const int32_t* o1 = columns.offset1.data() + c;
+    const __m256 wx = _mm256_loadu_ps(columns.weight.data() + c);
+    const __m256 a = gather8(r0, o0), b = gather8(r0, o1);
+    const __m256 p = gather8(r1, o0), q = gather8(r1, o1);
+    const __m256 top = _mm256_fmadd_ps(_mm256_sub_ps(b, a), wx, a);
+    const __m256 bottom = _mm256_fmadd_ps(_mm256_sub_ps(q, p), wx, p);
+    return _mm256_fmadd_ps(_mm256_sub_ps(bottom, top), wy, top);
+}
+
+using vec8_t = __m256;
+
+inline vec8_t set8(float value) noexcept { return _mm256_set1_ps(value); }
+
+/// @brief `a + (b - a) * w` with FMA
+inline vec8_t lerp8(vec8_t a, vec8_t b, vec8_t w) noexcept { return _mm256_fmadd_ps(_mm256_sub_ps(b, a), w, a); }
+
+/**
+ * @brief `src[0]`, `src[S]`, ... `src[7S]`
+ * @note For `S` up to 4, it reads 32 bytes(16 bytes if `S` is 2, 8 bytes if `S` is 1)
+ */
+template <int32_t S>
+vec8_t load8(const uint8_t* src) noexcept {
+    if constexpr (S == 1) {
+        return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))));
+    } else if constexpr (S == 2) {
+        const __m128i order = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_shuffle_epi8(bytes, order)));
+    } else if constexpr (S == 4) {
+        // the shuffle is in each 128-bit lane. The lanes have the pixels 0-3 and 4-7
+        const __m256i order = _mm256_setr_epi8(0, -1, -1, -1, 4, -1, -1, -1, 8, -1, -1, -1, 12, -1, -1, -1,  //
+                                               0, -1, -1, -1, 4, -1, -1, -1, 8, -1, -1, -1, 12, -1, -1, -1);
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        return _mm256_cvtepi32_ps(_mm256_shuffle_epi8(bytes, order));
+    } else {
+        return _mm256_cvtepi32_ps(_mm256_setr_epi32(src[0], src[S], src[2 * S], src[3 * S],  //
+                                                    src[4 * S], src[5 * S], src[6 * S], src[7 * S]));
+    }
+}
+
+/// @brief Split into 2 `rgb4_t` for `tensor_store_t::store4`
+inline void split8(vec8_t r, vec8_t g, vec8_t b, rgb4_t& lo, rgb4_t& hi) noexcept {
+    lo = rgb4_t{_mm256_castps256_ps128(r), _mm256_castps256_ps128(g), _mm256_castps256_ps128(b)};
+    hi = rgb4_t{_mm256_extractf128_ps(r, 1), _mm256_extractf128_ps(g, 1), _mm256_extractf128_ps(b, 1)};
+}
+
+/// @param u not centered. [0, 255]
+inline void to_rgb8(vec8_t y, vec8_t u, vec8_t v, rgb4_t& lo, rgb4_t& hi) noexcept {
+    const __m256 offset = _mm256_set1_ps(128.0f), lower = _mm256_setzero_ps(), upper = _mm256_set1_ps(255.0f);
+    u = _mm256_sub_ps(u, offset);
+    v = _mm256_sub_ps(v, offset);
+    __m256 r = _mm256_fmadd_ps(_mm256_set1_ps(coef_rv), v, y);
+    __m256 g = _mm256_fnmadd_ps(_mm256_set1_ps(coef_gv), v, _mm256_fnmadd_ps(_mm256_set1_ps(coef_gu), u, y));
+    __m256 b = _mm256_fmadd_ps(_mm256_set1_ps(coef_bu), u, y);
+    r = _mm256_min_ps(_mm256_max_ps(r, lower), upper);
+    g = _mm256_min_ps(_mm256_max_ps(g, lower), upper);
+    b = _mm256_min_ps(_mm256_max_ps(b, lower), upper);
+    split8(r, g, b, lo, hi);
+}
+
+inline void sample_rgb8(const row_sources_t& row, const yuv_resize_plan_t& plan, size_t c, rgb4_t& lo,
+                        rgb4_t& hi) noexcept {
+    const __m256 cw = _mm256_set1_ps(row.cw);
+    const __m256 y = bilinear8(row.y0, row.y1, plan.luma_columns, c, _mm256_set1_ps(row.yw));
+    const __m256 u = bilinear8(row.u0, row.u1, plan.chroma_columns, c, cw);
+    const __m256 v = bilinear8(row.v0, row.v1, plan.chroma_columns, c, cw);
+    to_rgb8(y, u, v, lo, hi);
+}
+
+#endif  // KERNEL_AVX2
+
+#if defined(__ARM_NEON)
+
+inline float32x4_t gather4(const uint8_t* base, const int32_t* o) noexcept {
+    const uint32_t values[4]{base[o[0]], base[o[1]], base[o[2]], base[o[3]]};
+    return vcvtq_f32_u32(vld1q_u32(values));
+}
+
+inline float32x4_t bilinear4(const uint8_t* r0, const uint8_t* r1, const yuv_resize_plan_t::axis_t& columns, size_t c,
+                             float32x4_t wy) noexcept {
+    const int32_t* o0 = columns.offset0.data() + c;
+    const int32_t* o1 = columns.offset1.data() + c;
+    const float32x4_t wx = vld1q_f32(columns.weight.data() + c);
+    const float32x4_t a = gather4(r0, o0), b = gather4(r0, o1);
+    const float32x4_t p = gather4(r1, o0), q = gather4(r1, o1);
+    const float32x4_t top = vmlaq_f32(a, vsubq_f32(b, a), wx);
+    const float32x4_t bottom = vmlaq_f32(p, vsubq_f32(q, p), wx);
+    return vmlaq_f32(top, vsubq_f32(bottom, top), wy);
+}
+
+struct rgb4_t final {
+    float32x4_t r, g, b;
+};
+
+using vec4_t = float32x4_t;
+
+inline vec4_t set4(float value) noexcept { return vdupq_n_f32(value); }
+
+inline vec4_t set4(float v0, float v1, float v2, float v3) noexcept {
+    const float values[4]{v0, v1, v2, v3};
+    return vld1q_f32(values);
+}
+
+/// @brief `a + (b - a) * w`. Same operations with `bilinear`
+inline vec4_t lerp4(vec4_t a, vec4_t b, vec4_t w) noexcept { return vmlaq_f32(a, vsubq_f32(b, a), w); }
+
+/// @brief `src[0]`, `src[S]`, `src[2S]`, `src[3S]`
+template <int32_t S>
+vec4_t load4(const uint8_t* src) noexcept {
+    if constexpr (S == 1) {
+        uint32_t bytes = 0;
+        std::memcpy(&bytes, src, 4);
+        const uint16x8_t wide = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(bytes)));
+        return vcvtq_f32_u32(vmovl_u16(vget_low_u16(wide)));
+    } else {
+        const uint32_t values[4]{src[0], src[S], src[2 * S], src[3 * S]};
+        return vcvtq_f32_u32(vld1q_u32(values));
+    }
+}
+
+/// @return `[v0 v1 v1 v2]` and `[v1 v2 v2 v3]`. Taps of the 2x upsample
+inline void upsample_taps4(vec4_t v, vec4_t& lo, vec4_t& hi) noexcept {
+    const float32x4_t v1 = vextq_f32(v, v, 1), v2 = vextq_f32(v, v, 2);
+    lo = vzipq_f32(v, v1).val[0];   // v0 v1 v1 v2
+    hi = vzipq_f32(v1, v2).val[0];  // v1 v2 v2 v3
+}
+
+/// @param u not centered. [0, 255]
+inline rgb4_t to_rgb4(vec4_t y, vec4_t u, vec4_t v) noexcept {
+    const float32x4_t offset = vdupq_n_f32(128.0f), lower = vdupq_n_f32(0.0f), upper = vdupq_n_f32(255.0f);
+    u = vsubq_f32(u, offset);
+    v = vsubq_f32(v, offset);
+    rgb4_t px{};
+    px.r = vminq_f32(vmaxq_f32(vmlaq_n_f32(y, v, coef_rv), lower), upper);
+    px.g = vminq_f32(vmaxq_f32(vmlsq_n_f32(vmlsq_n_f32(y, u, coef_gu), v, coef_gv), lower), upper);
+    px.b = vminq_f32(vmaxq_f32(vmlaq_n_f32(y, u, coef_bu), lower), upper);
+    return px;
+}
+
+inline rgb4_t sample_rgb4(const row_sources_t& row, const yuv_resize_plan_t& plan, size_t c) noexcept {
+    const float32x4_t cw = vdupq_n_f32(row.cw);
+    const float32x4_t y = bilinear4(row.y0, row.y1, plan.luma_columns, c, vdupq_n_f32(row.yw));
+    const float32x4_t u = bilinear4(row.u0, row.u1, plan.chroma_columns, c, cw);
+    const float32x4_t v = bilinear4(row.v0, row.v1, plan.chroma_columns, c, cw);
+    return to_rgb4(y, u, v);
+}
+
+inline float32x4_t apply4(float32x4_t value, const rgb_affine_t& affine, int channel) noexcept {
+    return vmlaq_n_f32(vdupq_n_f32(affine.bias[channel]), value, affine.scale[channel]);
+}
+
+/// @brief Round to nearest in the range of int16. The narrowing saturates the rest
+inline int32x4_t round4(float32x4_t value) noexcept {
+    value = vminq_f32(vmaxq_f32(value, vdupq_n_f32(-32768.0f)), vdupq_n_f32(32768.0f));
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(value);
+#else
+    // ARMv7 has no vcvtn. Ties are rounded away from zero
+    const float32x4_t half = vbslq_f32(vcltq_f32(value, vdupq_n_f32(0)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+    return vcvtq_s32_f32(vaddq_f32(value, half));
+#endif
+}
+
+inline void write4(float32x4_t value, float* dst) noexcept { vst1q_f32(dst, value); }
+
+inline void write4(float32x4_t value, uint16_t* dst) noexcept {
+#if defined(__aarch64__)
+    vst1_u16(dst, vreinterpret_u16_f16(vcvt_f16_f32(value)));
+#else
+    float values[4]{};
+    vst1q_f32(values, value);
+    for (int i = 0; i < 4; ++i) dst[i] = make_half(values[i]);
+#endif
+}
+
+inline void write4(float32x4_t value, uint8_t* dst) noexcept {
+    const int16x4_t q = vqmovn_s32(round4(value));
+    const uint32_t bytes = vget_lane_u32(vreinterpret_u32_u8(vqmovun_s16(vcombine_s16(q, q))), 0);
+    std::memcpy(dst, &bytes, 4);
+}
+
+inline void write4(float32x4_t value, int8_t* dst) noexcept {
+    const int16x4_t q = vqmovn_s32(round4(value));
+    const uint32_t bytes = vget_lane_u32(vreinterpret_u32_s8(vqmovn_s16(vcombine_s16(q, q))), 0);
+    std::memcpy(dst, &bytes, 4);
+}
+
+template <typename T>
+void write_nhwc4(float32x4_t r, float32x4_t g, float32x4_t b, T* dst) noexcept {
+    T planar[3][4]{};
+    write4(r, planar[0]);
+    write4(g, planar[1]);
+    write4(b, planar[2]);
+    for (int c = 0; c < 4; ++c)
+        for (int i = 0; i < 3; ++i) dst[c * 3 + i] = planar[i][c];
+}
+
+inline void write_nhwc4(float32x4_t r, float32x4_t g, float32x4_t b, float* dst) noexcept {
+    vst3q_f32(dst, float32x4x3_t{{r, g, b}});
+}
+
+#if defined(__aarch64__)
+inline void write_nhwc4(float32x4_t r, float32x4_t g, float32x4_t b, uint16_t* dst) noexcept {
+    uint16x4x3_t px{};
+    px.val[0] = vreinterpret_u16_f16(vcvt_f16_f32(r));
+    px.val[1] = vreinterpret_u16_f16(vcvt_f16_f32(g));
+    px.val[2] = vreinterpret_u16_f16(vcvt_f16_f32(b));
+    vst3_u16(dst, px);
+}
+#endif
+
+inline uint16x4_t narrow4(float32x4_t v) noexcept { return vmovn_u32(vcvtq_u32_f32(vaddq_f32(v, vdupq_n_f32(0.5f)))); }
+
+inline void store_pixel8(const rgb4_t& lo, const rgb4_t& hi, uint8_t* dst) noexcept {
+    uint8x8x3_t px{};
+    px.val[0] = vmovn_u16(vcombine_u16(narrow4(lo.r), narrow4(hi.r)));
+    px.val[1] = vmovn_u16(vcombine_u16(narrow4(lo.g), narrow4(hi.g)));
+    px.val[2] = vmovn_u16(vcombine_u16(narrow4(lo.b), narrow4(hi.b)));
+    vst3_u8(dst, px);
+}
+
+#endif  // __ARM_NEON
+
+/*
+ * Fixed-point kernels of the quantized tensors. The pixels are int16 in Q7(`value * 128`), and the weights are in
+ * Q15. The products are `(a * b + 2^14) >> 15`, which is `_mm_mulhrs_epi16` and `vqrdmulhq_s16`, so the scalar and
+ * the SIMD paths have the same result.
+ */
+
+constexpr int32_t q7_max = 255 << 7;
+constexpr int32_t q7_offset = 128 << 7;  // center of the chroma
+
+/// @brief Fractions of the `to_rgb` coefficients in Q15. 1.402 = 1 + 0.402, 1.772 = 2 - 0.228
+constexpr int16_t coef_rv_q15 = 13173;
+constexpr int16_t coef_gu_q15 = 11277;
+constexpr int16_t coef_gv_q15 = 23401;
+constexpr int16_t coef_bu_q15 = 7471;
+
+inline int32_t mulhrs(int32_t a, int32_t b) noexcept { return (a * b + (1 << 14)) >> 15; }
+
+/// @brief `a + (b - a) * w` of the Q7 values with the Q15 weight
+inline int32_t lerpq(int32_t a, int32_t b, int32_t w) noexcept { return a + mulhrs(b - a, w); }
+
+/// @brief `bilinear` in Q7
+inline int32_t bilinearq(const uint8_t* r0, const uint8_t* r1, int32_t o0, int32_t o1, int32_t wx,
+                         int32_t wy) noexcept {
+    const int32_t top = lerpq(r0[o0] << 7, r0[o1] << 7, wx);
+    const int32_t bottom = lerpq(r1[o0] << 7, r1[o1] << 7, wx);
+    return lerpq(top, bottom, wy);
+}
+
+inline int32_t bilinearq(const uint8_t* r0, const uint8_t* r1, const yuv_resize_plan_t::axis_t& columns, size_t c,
+                         int32_t wy) noexcept {
+    return bilinearq(r0, r1, columns.offset0[c], columns.offset1[c], columns.fraction[c], wy);
+}
+
+/**
+ * @brief `to_rgb` in Q7
+ * @details The terms are grouped like `to_rgbq8`. The groups fit in int16, and only the sums with the `y` can
+ *  saturate there. They are out of [0, 255] in that case, so the clamp gives the same result
+ */
+inline void to_rgbq(int32_t y, int32_t u, int32_t v, int32_t rgb[3]) noexcept {
+    u -= q7_offset;
+    v -= q7_offset;
+    rgb[0] = std::clamp(y + (v + mulhrs(v, coef_rv_q15)), 0, q7_max);
+    rgb[1] = std::clamp(y - (mulhrs(u, coef_gu_q15) + mulhrs(v, coef_gv_q15)), 0, q7_max);
+    rgb[2] = std::clamp(y + (u + u - mulhrs(u, coef_bu_q15)), 0, q7_max);
+}
+
+inline void sample_rgbq(const row_sources_t& row, const yuv_resize_plan_t& plan, size_t c, int32_t rgb[3]) noexcept {
+    const int32_t y = bilinearq(row.y0, row.y1, plan.luma_columns, c, row.yq);
+    const int32_t u = bilinearq(row.u0, row.u1, plan.chroma_columns, c, row.cq);
+    const int32_t v = bilinearq(row.v0, row.v1, plan.chroma_columns, c, row.cq);
+    to_rgbq(y, u, v, rgb);
+}
+
+/**
+ * @brief `x * scale + bias` of `rgb_affine_t` for the Q7 pixels. `(x * multiplier + bias) >> shift`
+ * @details The `bias` has the rounding. The `shift` is shared by the channels
+ */
+struct fixed_affine_t final {
+    int32_t multiplier[3];  // in the range of int16
+    int32_t bias[3];
+    int32_t shift;
+};
+
+/// @brief The largest `shift` which keeps the multipliers in int16 and the sums in int32
+inline fixed_affine_t make_fixed_affine(const rgb_affine_t& affine) noexcept {
+    fixed_affine_t fixed{};
+    for (int32_t shift = 30; shift >= 0; --shift) {
+        const double unit = std::ldexp(1.0, shift);
+        bool fit = true;
+        for (int i = 0; i < 3; ++i) {
+            const auto multiplier = std::llround(affine.scale[i] / 128.0 * unit);
+            const auto bias = std::llround(affine.bias[i] * unit) + (shift ? 1ll << (shift - 1) : 0);
+            fit &= std::abs(multiplier) <= INT16_MAX && std::abs(multiplier) * q7_max + std::abs(bias) <= INT32_MAX;
+            fixed.multiplier[i] = static_cast<int32_t>(std::clamp<long long>(multiplier, INT16_MIN, INT16_MAX));
+            fixed.bias[i] = static_cast<int32_t>(std::clamp<long long>(bias, INT32_MIN, INT32_MAX));
+        }
+        fixed.shift = shift;
+        if (fit) break;
+    }
+    return fixed;
+}
+
+template <typename T>
+void write1q(int32_t value, const fixed_affine_t& affine, int channel, T* dst) noexcept {
+    const int32_t q = (value * affine.multiplier[channel] + affine.bias[channel]) >> affine.shift;
+    *dst = static_cast<T>(std::clamp<int32_t>(q, std::numeric_limits<T>::min(), std::numeric_limits<T>::max()));
+}
+
+#if defined(KERNEL_SSE4_1)
+
+using qvec8_t = __m128i;
+
+/// @brief 8 pixels in Q7
+struct rgbq8_t final {
+    __m128i r, g, b;
+};
+
+inline qvec8_t setq8(int16_t value) noexcept { return _mm_set1_epi16(value); }
+
+/// @brief `[even odd even odd ...]`
+inline qvec8_t setq8(int16_t even, int16_t odd) noexcept {
+    return _mm_set1_epi32(static_cast<int32_t>(static_cast<uint32_t>(static_cast<uint16_t>(odd)) << 16 |
+                                               static_cast<uint16_t>(even)));
+}
+
+inline qvec8_t loadq8(const int16_t* src) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)); }
+
+inline qvec8_t gatherq8(const uint8_t* base, const int32_t* o) noexcept {
+    return _mm_slli_epi16(_mm_setr_epi16(base[o[0]], base[o[1]], base[o[2]], base[o[3]],  //
+                                         base[o[4]], base[o[5]], base[o[6]], base[o[7]]),
+                          7);
+}
+
+/**
+ * @brief `src[0]`, `src[S]`, ... `src[7S]` in Q7
+ * @note For `S` up to 4, it reads `8 * S` bytes
+ */
+template <int32_t S>
+qvec8_t loadq8(const uint8_t* src) noexcept {
+    __m128i v{};
+    if constexpr (S == 1) {
+        v = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+    } else if constexpr (S == 2) {
+        v = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), _mm_set1_epi16(0xFF));
+    } else if constexpr (S == 4) {
+        const __m128i mask = _mm_set1_epi32(0xFF);
+        const __m128i lo = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), mask);
+        const __m128i hi = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16)), mask);
+        v = _mm_packus_epi32(lo, hi);
+    } else {
+        v = _mm_setr_epi16(src[0], src[S], src[2 * S], src[3 * S], src[4 * S], src[5 * S], src[6 * S], src[7 * S]);
+    }
+    return _mm_slli_epi16(v, 7);
+}
+
+/**
+ * @brief The bytes `I0` and `I1` of 8 groups of `G` bytes in Q7. Both taps of the downsample in one load
+ * @tparam G 2, 4
+ */
+template <int32_t G, int32_t I0, int32_t I1>
+void load_pairq8(const uint8_t* src, qvec8_t& a, qvec8_t& b) noexcept {
+    if constexpr (G == 2) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        a = _mm_slli_epi16(I0 ? _mm_srli_epi16(bytes, 8) : _mm_and_si128(bytes, _mm_set1_epi16(0xFF)), 7);
+        b = _mm_slli_epi16(I1 ? _mm_srli_epi16(bytes, 8) : _mm_and_si128(bytes, _mm_set1_epi16(0xFF)), 7);
+    } else {
+        static_assert(G == 4);
+        const __m128i mask = _mm_set1_epi32(0xFF);
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+        a = _mm_slli_epi16(_mm_packus_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8 * I0), mask),
+                                            _mm_and_si128(_mm_srli_epi32(hi, 8 * I0), mask)),
+                           7);
+        b = _mm_slli_epi16(_mm_packus_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8 * I1), mask),
+                                            _mm_and_si128(_mm_srli_epi32(hi, 8 * I1), mask)),
+                           7);
+    }
+}
+
+/**
+ * @brief RGB of 8 RGBA pixels in Q7. The channels share the loads
+ * @tparam S pixel stride. 1, 2, 4
+ * @note It reads `32 * S` bytes
+ */
+template <int32_t S>
+rgbq8_t load_rgbq8(const uint8_t* src) noexcept {
+    const __m128i* blocks = reinterpret_cast<const __m128i*>(src);
+    __m128i p0{}, p1{};  // pixels 0-3, 4-7
+    if constexpr (S == 1) {
+        p0 = _mm_loadu_si128(blocks);
+        p1 = _mm_loadu_si128(blocks + 1);
+    } else if constexpr (S == 2) {
+        auto evens = [](__m128i v0, __m128i v1) {
+            const __m128 pixels = _mm_shuffle_ps(_mm_castsi128_ps(v0), _mm_castsi128_ps(v1), _MM_SHUFFLE(2, 0, 2, 0));
+            return _mm_castps_si128(pixels);
+        };
+        p0 = evens(_mm_loadu_si128(blocks), _mm_loadu_si128(blocks + 1));
+        p1 = evens(_mm_loadu_si128(blocks + 2), _mm_loadu_si128(blocks + 3));
+    } else {
+        static_assert(S == 4);
+        auto firsts = [](const __m128i* v) {
+            return _mm_unpacklo_epi64(_mm_unpacklo_epi32(_mm_loadu_si128(v), _mm_loadu_si128(v + 1)),
+                                      _mm_unpacklo_epi32(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3)));
+        };
+        p0 = firsts(blocks);
+        p1 = firsts(blocks + 4);
+    }
+    auto channel = [p0, p1](int i) {
+        const __m128i order = _mm_setr_epi8(i, -1, i + 4, -1, i + 8, -1, i + 12, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        return _mm_slli_epi16(_mm_unpacklo_epi64(_mm_shuffle_epi8(p0, order), _mm_shuffle_epi8(p1, order)), 7);
+    };
+    return rgbq8_t{channel(0), channel(1), channel(2)};
+}
+
+/// @brief `a + (b - a) * w`. Same operations with `lerpq`
+inline qvec8_t lerpq8(qvec8_t a, qvec8_t b, qvec8_t w) noexcept {
+    return _mm_add_epi16(a, _mm_mulhrs_epi16(_mm_sub_epi16(b, a), w));
+}
+
+/// @return `[v0 v1 v1 v2 v2 v3 v3 v4]` and `[v1 v2 v2 v3 v3 v4 v4 v5]`. Taps of the 2x upsample
+inline void upsample_tapsq8(qvec8_t v, qvec8_t& lo, qvec8_t& hi) noexcept {
+    const __m128i v1 = _mm_srli_si128(v, 2), v2 = _mm_srli_si128(v, 4);
+    lo = _mm_unpacklo_epi16(v, v1);
+    hi = _mm_unpacklo_epi16(v1, v2);
+}
+
+/// @brief `to_rgbq` of 8 pixels
+inline rgbq8_t to_rgbq8(qvec8_t y, qvec8_t u, qvec8_t v) noexcept {
+    const __m128i offset = _mm_set1_epi16(q7_offset), lower = _mm_setzero_si128(), upper = _mm_set1_epi16(q7_max);
+    u = _mm_sub_epi16(u, offset);
+    v = _mm_sub_epi16(v, offset);
+    const __m128i r = _mm_add_epi16(v, _mm_mulhrs_epi16(v, _mm_set1_epi16(coef_rv_q15)));
+    const __m128i g = _mm_add_epi16(_mm_mulhrs_epi16(u, _mm_set1_epi16(coef_gu_q15)),
+                                    _mm_mulhrs_epi16(v, _mm_set1_epi16(coef_gv_q15)));
+    const __m128i b = _mm_sub_epi16(_mm_add_epi16(u, u), _mm_mulhrs_epi16(u, _mm_set1_epi16(coef_bu_q15)));
+    rgbq8_t px{};
+    px.r = _mm_min_epi16(_mm_max_epi16(_mm_adds_epi16(y, r), lower), upper);
+    px.g = _mm_min_epi16(_mm_max_epi16(_mm_subs_epi16(y, g), lower), upper);
+    px.b = _mm_min_epi16(_mm_max_epi16(_mm_adds_epi16(y, b), lower), upper);
+    return px;
+}
+
+/// @brief `write1q` of 8 pixels before the narrowing. Saturated to int16
+inline __m128i quantizeq8(qvec8_t value, const fixed_affine_t& affine, int channel) noexcept {
+    const __m128i multiplier = _mm_set1_epi16(static_cast<int16_t>(affine.multiplier[channel]));
+    const __m128i bias = _mm_set1_epi32(affine.bias[channel]), shift = _mm_cvtsi32_si128(affine.shift);
+    const __m128i lo = _mm_mullo_epi16(value, multiplier), hi = _mm_mulhi_epi16(value, multiplier);
+    const __m128i q0 = _mm_sra_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), bias), shift);
+    const __m128i q1 = _mm_sra_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), bias), shift);
+    return _mm_packs_epi32(q0, q1);
+}
+
+/// @brief 8 elements in the lower 64 bits
+inline __m128i narrowq8(__m128i q, const uint8_t*) noexcept { return _mm_packus_epi16(q, q); }
+inline __m128i narrowq8(__m128i q, const int8_t*) noexcept { return _mm_packs_epi16(q, q); }
+
+template <typename T>
+void writeq8(__m128i q, T* dst) noexcept {
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), narrowq8(q, dst));
+}
+
+/// @brief Interleave the narrowed 8 pixels into 24 bytes
+template <typename T>
+void write_nhwcq8(__m128i r, __m128i g, __m128i b, T* dst) noexcept {
+    const __m128i rg = _mm_unpacklo_epi64(narrowq8(r, dst), narrowq8(g, dst));  // r0 .. r7 g0 .. g7
+    const __m128i blue = narrowq8(b, dst);
+    // r0 g0 b0 r1 g1 b1 r2 g2 b2 r3 g3 b3 r4 g4 b4 r5
+    const __m128i lo = _mm_or_si128(
+        _mm_shuffle_epi8(rg, _mm_setr_epi8(0, 8, -1, 1, 9, -1, 2, 10, -1, 3, 11, -1, 4, 12, -1, 5)),
+        _mm_shuffle_epi8(blue, _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1)));
+    // g5 b5 r6 g6 b6 r7 g7 b7
+    const __m128i hi = _mm_or_si128(
+        _mm_shuffle_epi8(rg, _mm_setr_epi8(13, -1, 6, 14, -1, 7, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(blue, _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), lo);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 16), hi);
+}
+
+#elif defined(__ARM_NEON)
+
+using qvec8_t = int16x8_t;
+
+/// @brief 8 pixels in Q7
+struct rgbq8_t final {
+    int16x8_t r, g, b;
+};
+
+inline qvec8_t setq8(int16_t value) noexcept { return vdupq_n_s16(value); }
+
+/// @brief `[even odd even odd ...]`
+inline qvec8_t setq8(int16_t even, int16_t odd) noexcept {
+    const int16_t values[8]{even, odd, even, odd, even, odd, even, odd};
+    return vld1q_s16(values);
+}
+
+inline qvec8_t loadq8(const int16_t* src) noexcept { return vld1q_s16(src); }
+
+inline qvec8_t gatherq8(const uint8_t* base, const int32_t* o) noexcept {
+    const int16_t values[8]{base[o[0]], base[o[1]], base[o[2]], base[o[3]],
+                            base[o[4]], base[o[5]], base[o[6]], base[o[7]]};
+    return vshlq_n_s16(vld1q_s16(values), 7);
+}
+
+/**
+ * @brief `src[0]`, `src[S]`, ... `src[7S]` in Q7
+ * @note For `S` up to 4, it reads `8 * S` bytes
+ */
+template <int32_t S>
+qvec8_t loadq8(const uint8_t* src) noexcept {
+    uint8x8_t bytes{};
+    if constexpr (S == 1) {
+        bytes = vld1_u8(src);
+    } else if constexpr (S == 2) {
+        bytes = vld2_u8(src).val[0];
+    } else if constexpr (S == 4) {
+        bytes = vld4_u8(src).val[0];
+    } else {
+        const uint8_t values[8]{src[0], src[S], src[2 * S], src[3 * S], src[4 * S], src[5 * S], src[6 * S], src[7 * S]};
+        bytes = vld1_u8(values);
+    }
+    return vshlq_n_s16(vreinterpretq_s16_u16(vmovl_u8(bytes)), 7);
+}
+
+/// @brief `uint8x8_t` to Q7
+inline qvec8_t widenq8(uint8x8_t bytes) noexcept { return vshlq_n_s16(vreinterpretq_s16_u16(vmovl_u8(bytes)), 7); }
+
+/**
+ * @brief The bytes `I0` and `I1` of 8 groups of `G` bytes in Q7. Both taps of the downsample in one load
+ * @tparam G 2, 4
+ */
+template <int32_t G, int32_t I0, int32_t I1>
+void load_pairq8(const uint8_t* src, qvec8_t& a, qvec8_t& b) noexcept {
+    if constexpr (G == 2) {
+        const uint8x8x2_t bytes = vld2_u8(src);
+        a = widenq8(bytes.val[I0]);
+        b = widenq8(bytes.val[I1]);
+    } else {
+        static_assert(G == 4);
+        const uint8x8x4_t bytes = vld4_u8(src);
+        a = widenq8(bytes.val[I0]);
+        b = widenq8(bytes.val[I1]);
+    }
+}
+
+/**
+ * @brief RGB of 8 RGBA pixels in Q7. The channels share the loads
+ * @tparam S pixel stride. 1, 2, 4
+ * @note It reads `32 * S` bytes
+ */
+template <int32_t S>
+rgbq8_t load_rgbq8(const uint8_t* src) noexcept {
+    if constexpr (S == 1) {
+        const uint8x8x4_t px = vld4_u8(src);
+        return rgbq8_t{widenq8(px.val[0]), widenq8(px.val[1]), widenq8(px.val[2])};
+    } else if constexpr (S == 2) {
+        // the lower bytes of the 16-bit lanes are the even pixels
+        const uint8x16x4_t px = vld4q_u8(src);
+        auto evens = [](uint8x16_t v) { return widenq8(vmovn_u16(vreinterpretq_u16_u8(v))); };
+        return rgbq8_t{evens(px.val[0]), evens(px.val[1]), evens(px.val[2])};
+    } else {
+        static_assert(S == 4);
+        const uint8x16x4_t lo = vld4q_u8(src), hi = vld4q_u8(src + 64);
+        auto firsts = [](uint8x16_t v0, uint8x16_t v1) {
+            const uint16x8_t words =
+                vcombine_u16(vmovn_u32(vreinterpretq_u32_u8(v0)), vmovn_u32(vreinterpretq_u32_u8(v1)));
+            return vshlq_n_s16(vreinterpretq_s16_u16(vandq_u16(words, vdupq_n_u16(0xFF))), 7);
+        };
+        return rgbq8_t{firsts(lo.val[0], hi.val[0]), firsts(lo.val[1], hi.val[1]), firsts(lo.val[2], hi.val[2])};
+    }
+}
+
+/// @brief `a + (b - a) * w`. Same operations with `lerpq`
+inline qvec8_t lerpq8(qvec8_t a, qvec8_t b, qvec8_t w) noexcept {
+    return vaddq_s16(a, vqrdmulhq_s16(vsubq_s16(b, a), w));
+}
+
+/// @return `[v0 v1 v1 v2 v2 v3 v3 v4]` and `[v1 v2 v2 v3 v3 v4 v4 v5]`. Taps of the 2x upsample
+inline void upsample_tapsq8(qvec8_t v, qvec8_t& lo, qvec8_t& hi) noexcept {
+    const int16x8_t v1 = vextq_s16(v, v, 1), v2 = vextq_s16(v, v, 2);
+    lo = vzipq_s16(v, v1).val[0];
+    hi = vzipq_s16(v1, v2).val[0];
+}
+
+/// @brief `to_rgbq` of 8 pixels
+inline rgbq8_t to_rgbq8(qvec8_t y, qvec8_t u, qvec8_t v) noexcept {
+    const int16x8_t offset = vdupq_n_s16(q7_offset), lower = vdupq_n_s16(0), upper = vdupq_n_s16(q7_max);
+    u = vsubq_s16(u, offset);
+    v = vsubq_s16(v, offset);
+    const int16x8_t r = vaddq_s16(v, vqrdmulhq_n_s16(v, coef_rv_q15));
+    const int16x8_t g = vaddq_s16(vqrdmulhq_n_s16(u, coef_gu_q15), vqrdmulhq_n_s16(v, coef_gv_q15));
+    const int16x8_t b = vsubq_s16(vaddq_s16(u, u), vqrdmulhq_n_s16(u, coef_bu_q15));
+    rgbq8_t px{};
+    px.r = vminq_s16(vmaxq_s16(vqaddq_s16(y, r), lower), upper);
+    px.g = vminq_s16(vmaxq_s16(vqsubq_s16(y, g), lower), upper);
+    px.b = vminq_s16(vmaxq_s16(vqaddq_s16(y, b), lower), upper);
+    return px;
+}
+
+/// @brief `write1q` of 8 pixels before the narrowing. Saturated to int16
+inline int16x8_t quantizeq8(qvec8_t value, const fixed_affine_t& affine, int channel) noexcept {
+    const auto multiplier = static_cast<int16_t>(affine.multiplier[channel]);
+    const int32x4_t bias = vdupq_n_s32(affine.bias[channel]), shift = vdupq_n_s32(-affine.shift);
+    const int32x4_t q0 = vshlq_s32(vmlal_n_s16(bias, vget_low_s16(value), multiplier), shift);
+    const int32x4_t q1 = vshlq_s32(vmlal_n_s16(bias, vget_high_s16(value), multiplier), shift);
+    return vcombine_s16(vqmovn_s32(q0), vqmovn_s32(q1));
+}
+
+inline void writeq8(int16x8_t q, uint8_t* dst) noexcept { vst1_u8(dst, vqmovun_s16(q)); }
+inline void writeq8(int16x8_t q, int8_t* dst) noexcept { vst1_s8(dst, vqmovn_s16(q)); }
+
+inline void write_nhwcq8(int16x8_t r, int16x8_t g, int16x8_t b, uint8_t* dst) noexcept {
+    vst3_u8(dst, uint8x8x3_t{{vqmovun_s16(r), vqmovun_s16(g), vqmovun_s16(b)}});
+}
+
+inline void write_nhwcq8(int16x8_t r, int16x8_t g, int16x8_t b, int8_t* dst) noexcept {
+    vst3_s8(dst, int8x8x3_t{{vqmovn_s16(r), vqmovn_s16(g), vqmovn_s16(b)}});
+}
+
+#endif
+
+#if defined(KERNEL_SSE4_1) || defined(__ARM_NEON)
+
+inline qvec8_t bilinearq8(const uint8_t* r0, const uint8_t* r1, const yuv_resize_plan_t::axis_t& columns, size_t c,
+                          qvec8_t wy) noexcept {
+    const int32_t* o0 = columns.offset0.data() + c;
+    const int32_t* o1 = columns.offset1.data() + c;
+    const qvec8_t wx = loadq8(columns.fraction.data() + c);
+    const qvec8_t top = lerpq8(gatherq8(r0, o0), gatherq8(r0, o1), wx);
+    const qvec8_t bottom = lerpq8(gatherq8(r1, o0), gatherq8(r1, o1), wx);
+    return lerpq8(top, bottom, wy);
+}
+
+inline rgbq8_t sample_rgbq8(const row_sources_t& row, const yuv_resize_plan_t& plan, size_t c) noexcept {
+    const qvec8_t cw = setq8(row.cq);
+    const qvec8_t y = bilinearq8(row.y0, row.y1, plan.luma_columns, c, setq8(row.yq));
+    const qvec8_t u = bilinearq8(row.u0, row.u1, plan.chroma_columns, c, cw);
+    const qvec8_t v = bilinearq8(row.v0, row.v1, plan.chroma_columns, c, cw);
+    return to_rgbq8(y, u, v);
+}
+
+#endif
+
+/**
+ * @brief Store policy of `convert_rows`. Normalize(and quantize) the pixels, and write in the tensor's layout
+ * @tparam T `float`, `uint16_t`(half), `uint8_t`, `int8_t`
+ */
+template <typename T, tensor_layout_t L>
+struct tensor_store_t final {
+    T* data;
+    size_t width;
+    size_t plane;         // elements of each channel
+    rgb_affine_t affine;  // normalization and quantization
+
+   public:
+    T* at(size_t r, size_t c, int channel) const noexcept {
+        if constexpr (L == tensor_layout_t::nhwc) return data + (r * width + c) * 3 + channel;
+        return data + channel * plane + r * width + c;
+    }
+
+    void store1(size_t r, size_t c, const float rgb[3]) const noexcept {
+        for (int i = 0; i < 3; ++i) write1(rgb[i] * affine.scale[i] + affine.bias[i], at(r, c, i));
+    }
+
+#if defined(KERNEL_SSE4_1) || defined(__ARM_NEON)
+    void store4(size_t r, size_t c, const rgb4_t& px) const noexcept {
+        const vec4_t red = apply4(px.r, affine, 0), green = apply4(px.g, affine, 1), blue = apply4(px.b, affine, 2);
+        if constexpr (L == tensor_layout_t::nhwc) return write_nhwc4(red, green, blue, at(r, c, 0));
+        write4(red, at(r, c, 0));
+        write4(green, at(r, c, 1));
+        write4(blue, at(r, c, 2));
+    }
+#endif
+};
+
+template <typename T, tensor_layout_t L>
+tensor_store_t<T, L> make_store(const tensor_packing_t& dst, const rgb_normalization_t& norm) noexcept {
+    tensor_store_t<T, L> store{static_cast<T*>(dst.data), dst.width, static_cast<size_t>(dst.width) * dst.height,
+                               make_affine(norm)};
+    if (dst.type == tensor_type_t::uint8 || dst.type == tensor_type_t::int8) {
+        for (int i = 0; i < 3; ++i) {
+            store.affine.scale[i] /= dst.scale;
+            store.affine.bias[i] = store.affine.bias[i] / dst.scale + static_cast<float>(dst.zero_point);
+        }
+    }
+    return store;
+}
+
+/// @brief Invoke the `fn` with the `tensor_store_t` for the `dst`
+template <typename Fn>
+void visit_store(const tensor_packing_t& dst, const rgb_normalization_t& norm, Fn&& fn) noexcept {
+    auto visit = [&](auto* type) {
+        using T = std::remove_pointer_t<decltype(type)>;
+        if (dst.layout == tensor_layout_t::nhwc) return fn(make_store<T, tensor_layout_t::nhwc>(dst, norm));
+        return fn(make_store<T, tensor_layout_t::nchw>(dst, norm));
+    };
+    switch (dst.type) {
+        case tensor_type_t::float32:
+            return visit(static_cast<float*>(nullptr));
+        case tensor_type_t::float16:
+            return visit(static_cast<uint16_t*>(nullptr));
+        case tensor_type_t::uint8:
+            return visit(static_cast<uint8_t*>(nullptr));
+        case tensor_type_t::int8:
+            return visit(static_cast<int8_t*>(nullptr));
+    }
+}
+
+/**
+ * @brief Store policy of `convert_rows_fixed`. Quantize the Q7 pixels with the `fixed_affine_t`
+ * @tparam T `uint8_t`, `int8_t`
+ */
+template <typename T, tensor_layout_t L>
+struct fixed_store_t final {
+    T* data;
+    size_t width;
+    size_t plane;
+    fixed_affine_t affine;
+
+   public:
+    T* at(size_t r, size_t c, int channel) const noexcept {
+        if constexpr (L == tensor_layout_t::nhwc) return data + (r * width + c) * 3 + channel;
+        return data + channel * plane + r * width + c;
+    }
+
+    void store1(size_t r, size_t c, const int32_t rgb[3]) const noexcept {
+        for (int i = 0; i < 3; ++i) write1q(rgb[i], affine, i, at(r, c, i));
+    }
+
+#if defined(KERNEL_SSE4_1) || defined(__ARM_NEON)
+    void store8(size_t r, size_t c, const rgbq8_t& px) const noexcept {
+        const auto red = quantizeq8(px.r, affine, 0), green = quantizeq8(px.g, affine, 1),
+                   blue = quantizeq8(px.b, affine, 2);
+        if constexpr (L == tensor_layout_t::nhwc) return write_nhwcq8(red, green, blue, at(r, c, 0));
+        writeq8(red, at(r, c, 0));
+        writeq8(green, at(r, c, 1));
+        writeq8(blue, at(r, c, 2));
+    }
+#endif
+};
+
+/// @brief `make_store` in the fixed-point. The quantization is folded in the same way
+template <typename T, tensor_layout_t L>
+fixed_store_t<T, L> make_fixed_store(const tensor_packing_t& dst, const rgb_normalization_t& norm) noexcept {
+    const tensor_store_t<T, L> store = make_store<T, L>(dst, norm);
+    return fixed_store_t<T, L>{store.data, store.width, store.plane, make_fixed_affine(store.affine)};
+}
+
+/**
+ * @brief Sampler of `convert_rows` with the `yuv_resize_plan_t`. Any size and orientation
+ */
+struct plan_sampler_t final {
+    using row_t = row_sources_t;
+
+    const yuv_view_t& src;
+    const yuv_resize_plan_t& plan;
+
+   public:
+    size_t width() const noexcept { return plan.width(); }
+    /// @brief Columns for `sample4`. `c + 4 <= end`
+    index_range_t simd_columns() const noexcept { return {0, plan.width()}; }
+
+    /// @brief Columns for `sample8q`. `c + 8 <= end`
+    index_range_t fixed_columns() const noexcept { return {0, plan.width()}; }
+
+    row_t row(size_t r) const noexcept { return get_row(src, plan, r); }
+    void sample1(const row_t& row, size_t c, float rgb[3]) const noexcept { sample_rgb(row, plan, c, rgb); }
+    void sample1q(const row_t& row, size_t c, int32_t rgb[3]) const noexcept { sample_rgbq(row, plan, c, rgb); }
+#if defined(KERNEL_SSE4_1) || defined(__ARM_NEON)
+    rgb4_t sample4(const row_t& row, size_t c) const noexcept { return sample_rgb4(row, plan, c); }
+    rgbq8_t sample8q(const row_t& row, size_t c) const noexcept { return sample_rgbq8(row, plan, c); }
+#endif
+#if defined(KERNEL_AVX2)
+    void sample8(const row_t& row, size_t c, rgb4_t& lo, rgb4_t& hi) const noexcept {
+        sample_rgb8(row, plan, c, lo, hi);
+    }
+#endif
+};
+
+/**
+ * @brief Sampler of the RGBA(RGBX) with the `yuv_resize_plan_t`
+ * @note The plan is made with `yuv_view_t{rgba.plane, rgba.plane, rgba.plane}`. Only the luma axes are used
+ */
+struct rgba_plan_sampler_t final {
+    using row_t = row_sources_t;
+
+    const yuv_view_t& src;
+    const yuv_resize_plan_t& plan;
+
+   public:
+    size_t width() const noexcept { return plan.width(); }
+    index_range_t simd_columns() const noexcept { return {0, plan.width()}; }
+    index_range_t fixed_columns() const noexcept { return {0, plan.width()}; }
+
+    row_t row(size_t r) const noexcept { return get_row(src, plan, r); }
+    void sample1(const row_t& row, size_t c, float rgb[3]) const noexcept {
+        for (int i = 0; i < 3; ++i) rgb[i] = bilinear(row.y0 + i, row.y1 + i, plan.luma_columns, c, row.yw);
+    }
+    void sample1q(const row_t& row, size_t c, int32_t rgb[3]) const noexcept {
+        for (int i = 0; i < 3; ++i) rgb[i] = bilinearq(row.y0 + i, row.y1 + i, plan.luma_columns, c, row.yq);
+    }
+#if defined(KERNEL_SSE4_1) || defined(__ARM_NEON)
+    rgb4_t sample4(const row_t& row, size_t c) const noexcept {
+        const vec4_t wy = set4(row.yw);
+        return rgb4_t{bilinear4(row.y0, row.y1, plan.luma_columns, c, wy),
+                      bilinear4(row.y0 + 1, row.y1 + 1, plan.luma_columns, c, wy),
+                      bilinear4(row.y0 + 2, row.y1 + 2, plan.luma_columns, c, wy)};
+    }
+    rgbq8_t sample8q(const row_t& row, size_t c) const noexcept {
+        const qvec8_t wy = setq8(row.yq);
+        return rgbq8_t{bilinearq8(row.y0, row.y1, plan.luma_columns, c, wy),
+                       bilinearq8(row.y0 + 1, row.y1 + 1, plan.luma_columns, c, wy),
+                       bilinearq8(row.y0 + 2, row.y1 + 2, plan.luma_columns, c, wy)};
+    }
+#endif
+};
+
+#if defined(KERNEL_SSE4_1) || defined(__ARM_NEON)
+
+/**
+ * @brief 4 outputs of the `F`:1 downsample from `c`. Same taps with `get_ratio_tap`
+ * @details The taps are `(F * c + F / 2 - 1, +1)` with the weight 0.5. For `F` 1, it's a copy of the column `c`
+ * @tparam S pixel stride of the rows
+ */
+template <int32_t F, int32_t S>
+vec4_t downsample4(const uint8_t* r0, const uint8_t* r1, size_t c, vec4_t wy) noexcept {
+    if constexpr (F == 1) {
+        return lerp4(load4<S>(r0 + c * S), load4<S>(r1 + c * S), wy);
+    } else {
+        const size_t offset = (F * c + F / 2 - 1) * S;
+        const vec4_t half = set4(0.5f);
+        const vec4_t top = lerp4(load4<F * S>(r0 + offset), load4<F * S>(r0 + offset + S), half);
+        const vec4_t bottom = lerp4(load4<F * S>(r1 + offset), load4<F * S>(r1 + offset + S), half);
+        return lerp4(top, bottom, wy);
+    }
+}
+
+#if defined(KERNEL_AVX2)
+
+/// @brief 8 outputs of `downsample4`
+template <int32_t F, int32_t S>
+vec8_t downsample8(const uint8_t* r0, const uint8_t* r1, size_t c, vec8_t wy) noexcept {
+    if constexpr (F == 1) {
+        return lerp8(load8<S>(r0 + c * S), load8<S>(r1 + c * S), wy);
+    } else {
+        const size_t offset = (F * c + F / 2 - 1) * S;
+        const vec8_t half = set8(0.5f);
+        const vec8_t top = lerp8(load8<F * S>(r0 + offset), load8<F * S>(r0 + offset + S), half);
+        const vec8_t bottom = lerp8(load8<F * S>(r1 + offset), load8<F * S>(r1 + offset + S), half);
+        return lerp8(top, bottom, wy);
+    }
+}
+
+#endif
+
+/**
+ * @brief 4 outputs of the 1:2 upsample from the even `c`. Same taps with `get_ratio_tap`
+ * @details The outputs `2k` and `2k + 1` are 0.75/0.25 between the source `k - 1`, `k`, and `k + 1`
+ */
+template <int32_t S>
+vec4_t upsample4(const uint8_t* r0, const uint8_t* r1, size_t c, vec4_t wy) noexcept {
+    const size_t offset = (c / 2 - 1) * S;
+    const vec4_t wx = set4(0.75f, 0.25f, 0.75f, 0.25f);
+    vec4_t a = {}, b = {}, p = {}, q = {};
+    upsample_taps4(load4<S>(r0 + offset), a, b);
+    upsample_taps4(load4<S>(r1 + offset), p, q);
+    return lerp4(lerp4(a, b, wx), lerp4(p, q, wx), wy);
+}
+
+/**
+ * @brief `downsample4` of 8 outputs in Q7
+ * @note For `F` 1, the weight of the rows is always 0 and `lerpq8` returns the first row
+ */
+template <int32_t F, int32_t S>
+qvec8_t downsampleq8(const uint8_t* r0, const uint8_t* r1, size_t c, qvec8_t wy) noexcept {
+    if constexpr (F == 1) {
+        return loadq8<S>(r0 + c * S);
+    } else {
+        // the taps `(F * c + F / 2 - 1) * S` and `+S` are in the group of `F * S` bytes
+        constexpr int32_t i0 = (F / 2 - 1) * S;
+        const size_t offset = F * c * S;
+        const qvec8_t half = setq8(1 << 14);
+        qvec8_t a = {}, b = {}, p = {}, q = {};
+        load_pairq8<F * S, i0, i0 + S>(r0 + offset, a, b);
+        load_pairq8<F * S, i0, i0 + S>(r1 + offset, p, q);
+        return lerpq8(lerpq8(a, b, half), lerpq8(p, q, half), wy);
+    }
+}
+
+/// @brief `upsample4` of 8 outputs in Q7. It reads the source `c / 2 - 1` to `c / 2 + 6`
+template <int32_t S>
+qvec8_t upsampleq8(const uint8_t* r0, const uint8_t* r1, size_t c, qvec8_t wy) noexcept {
+    const size_t offset = (c / 2 - 1) * S;
+    const qvec8_t wx = setq8(to_q15(0.75f), to_q15(0.25f));
+    qvec8_t a = {}, b = {}, p = {}, q = {};
+    upsample_tapsq8(loadq8<S>(r0 + offset), a, b);
+    upsample_tapsq8(loadq8<S>(r1 + offset), p, q);
+    return lerpq8(lerpq8(a, b, wx), lerpq8(p, q, wx), wy);
+}
+
+#endif
+
+/**
+ * @brief Sampler of the unrotated YUV with the fixed ratio. No offset tables and gathers
+ * @details The luma is `F` times of the output, and the chroma is `F / 2` times. Same result with the
+ *  `plan_sampler_t` for the same image
+ * @tparam F 1, 2, 4
+ * @tparam S pixel stride of the chroma planes. 1 for I420, 2 for NV12/NV21
+ */
+template <int32_t F, int32_t S>
+struct yuv_ratio_sampler_t final {
+    using row_t = row_sources_t;
+
+    const yuv_view_t& src;
+    uint32_t out_width;
+
+   public:
+    size_t width() const noexcept { return out_width; }
+    /// @note `load4` may read 16 bytes. Leave the last column for the scalar path
+    index_range_t simd_columns() const noexcept {
+        if constexpr (F == 1) return out_width >= 10 ? index_range_t{2, out_width - 4} : index_range_t{0, 0};
+        return {0, out_width - 1};
+    }
+    /// @note The upsample reads 6 chroma columns after `c / 2`
+    index_range_t fixed_columns() const noexcept {
+        if constexpr (F == 1) return out_width >= 18 ? index_range_t{2, out_width - 8} : index_range_t{0, 0};
+        return {0, out_width - 1};
+    }
+
+    row_t row(size_t r) const noexcept {
+        const auto y = static_cast<uint32_t>(r);
+        const tap_t luma = get_ratio_tap<F>(y, src.y.height);
+        const tap_t chroma = get_ratio_tap<F / 2>(y, src.u.height);
+        return row_t{src.y.row(luma.i0), src.y.row(luma.i1), src.u.row(chroma.i0), src.u.row(chroma.i1),
+                     src.v.row(chroma.i0), src.v.row(chroma.i1), luma.weight, chroma.weight,
+                     to_q15(luma.weight), to_q15(chroma.weight)};
+    }
+
+    void sample1(const row_t& row, size_t c, float rgb[3]) const noexcept {
+        const auto x = static_cast<uint32_t>(c);
+        const tap_t luma = get_ratio_tap<F>(x, src.y.width);
+        const tap_t chroma = get_ratio_tap<F / 2>(x, src.u.width);
+        const float y = bilinear(row.y0, row.y1, luma.i0, luma.i1, luma.weight, row.yw);
+        const float u = bilinear(row.u0, row.u1, chroma.i0 * S, chroma.i1 * S, chroma.weight, row.cw);
+        const float v = bilinear(row.v0, row.v1, chroma.i0 * S, chroma.i1 * S, chroma.weight, row.cw);
+        to_rgb(y, u, v, rgb);
+    }
+
+    void sample1q(const row_t& row, size_t c, int32_t rgb[3]) const noexcept {
+        const auto x = static_cast<uint32_t>(c);
+        const tap_t luma = get_ratio_tap<F>(x, src.y.width);
+        const tap_t chroma = get_ratio_tap<F / 2>(x, src.u.width);
+        const int32_t cw = to_q15(chroma.weight);
+        const int32_t y = bilinearq(row.y0, row.y1, luma.i0, luma.i1, to_q15(luma.weight), row.yq);
+        const int32_t u = bilinearq(row.u0, row.u1, chroma.i0 * S, chroma.i1 * S, cw, row.cq);
+        const int32_t v = bilinearq(row.v0, row.v1, chroma.i0 * S, chroma.i1 * S, cw, row.cq);
+        to_rgbq(y, u, v, rgb);
+    }
+
+#if defined(KERNEL_SSE4_1) || defined(__ARM_NEON)
+    rgbq8_t sample8q(const row_t& row, size_t c) const noexcept {
+        const qvec8_t yw = setq8(row.yq), cw = setq8(row.cq);
+        const qvec8_t y = downsampleq8<F, 1>(row.y0, row.y1, c, yw);
+        if constexpr (F == 1)
+            return to_rgbq8(y, upsampleq8<S>(row.u0, row.u1, c, cw), upsampleq8<S>(row.v0, row.v1, c, cw));
+        else
+            return to_rgbq8(y, downsampleq8<F / 2, S>(row.u0, row.u1, c, cw),
+                            downsampleq8<F / 2, S>(row.v0, row.v1, c, cw));
+    }
+
+    rgb4_t sample4(const row_t& row, size_t c) const noexcept {
+        const vec4_t yw = set4(row.yw), cw = set4(row.cw);
+        const vec4_t y = downsample4<F, 1>(row.y0, row.y1, c, yw);
+        if constexpr (F == 1)
+            return to_rgb4(y, upsample4<S>(row.u0, row.u1, c, cw), upsample4<S>(row.v0, row.v1, c, cw));
+        else
+            return to_rgb4(y, downsample4<F / 2, S>(row.u0, row.u1, c, cw),
+                           downsample4<F / 2, S>(row.v0, row.v1, c, cw));
+    }
+#endif
+#if defined(KERNEL_AVX2)
+    /// @note The 1:2 upsample of the chroma has no 8 wide path
+    void sample8(const row_t& row, size_t c, rgb4_t& lo, rgb4_t& hi) const noexcept requires(F > 1) {
+        const vec8_t yw = set8(row.yw), cw = set8(row.cw);
+        to_rgb8(downsample8<F, 1>(row.y0, row.y1, c, yw), downsample8<F / 2, S>(row.u0, row.u1, c, cw),
+                downsample8<F / 2, S>(row.v0, row.v1, c, cw), lo, hi);
+    }
+#endif
+};
+
+/**
+ * @brief Sampler of the unrotated RGBA(RGBX) with the fixed ratio. The alpha is ignored
+ * @tparam F 1, 2, 4
+ */
+template <int32_t F>
+struct rgba_ratio_sampler_t final {
+    using row_t = row_sources_t;
+
+    const yuv_view_t& src;  // RGBA in the `y`
+    uint32_t out_width;
+
+   public:
+    size_t width() const noexcept { return out_width; }
+    index_range_t simd_columns() const noexcept { return {0, out_width - 1}; }
+    index_range_t fixed_columns() const noexcept { return {0, out_width - 1}; }
+
+    row_t row(size_t r) const noexcept {
+        const tap_t tap = get_ratio_tap<F>(static_cast<uint32_t>(r), src.y.height);
+        row_t row{};
+        row.y0 = src.y.row(tap.i0);
+        row.y1 = src.y.row(tap.i1);
+        row.yw = tap.weight;
+        row.yq = to_q15(tap.weight);
+        return row;
+    }
+
+    void sample1(const row_t& row, size_t c, float rgb[3]) const noexcept {
+        const tap_t tap = get_ratio_tap<F>(static_cast<uint32_t>(c), src.y.width);
+        for (int i = 0; i < 3; ++i)
+            rgb[i] = bilinear(row.y0 + i, row.y1 + i, tap.i0 * 4, tap.i1 * 4, tap.weight, row.yw);
+    }
+
+    void sample1q(const row_t& row, size_t c, int32_t rgb[3]) const noexcept {
+        const tap_t tap = get_ratio_tap<F>(static_cast<uint32_t>(c), src.y.width);
+        const int32_t wx = to_q15(tap.weight);
+        for (int i = 0; i < 3; ++i) rgb[i] = bilinearq(row.y0 + i, row.y1 + i, tap.i0 * 4, tap.i1 * 4, wx, row.yq);
+    }
+
+#if defined(KERNEL_SSE4_1) || defined(__ARM_NEON)
+    /// @note Same with `downsampleq8`, but the taps are loaded once for the 3 channels
+    rgbq8_t sample8q(const row_t& row, size_t c) const noexcept {
+        if constexpr (F == 1) {
+            return load_rgbq8<1>(row.y0 + c * 4);
+        } else {
+            const size_t offset = (F * c + F / 2 - 1) * 4;
+            const qvec8_t half = setq8(1 << 14), wy = setq8(row.yq);
+            const rgbq8_t a = load_rgbq8<F>(row.y0 + offset), b = load_rgbq8<F>(row.y0 + offset + 4);
+            const rgbq8_t p = load_rgbq8<F>(row.y1 + offset), q = load_rgbq8<F>(row.y1 + offset + 4);
+            auto filter = [half, wy](qvec8_t a, qvec8_t b, qvec8_t p, qvec8_t q) {
+                return lerpq8(lerpq8(a, b, half), lerpq8(p, q, half), wy);
+            };
+            return rgbq8_t{filter(a.r, b.r, p.r, q.r), filter(a.g, b.g, p.g, q.g), filter(a.b, b.b, p.b, q.b)};
+        }
+    }
+
+    rgb4_t sample4(const row_t& row, size_t c) const noexcept {
+        const vec4_t wy = set4(row.yw);
+        return rgb4_t{downsample4<F, 4>(row.y0, row.y1, c, wy), downsample4<F, 4>(row.y0 + 1, row.y1 + 1, c, wy),
+                      downsample4<F, 4>(row.y0 + 2, row.y1 + 2, c, wy)};
+    }
+#endif
+#if defined(KERNEL_AVX2)
+    void sample8(const row_t& row, size_t c, rgb4_t& lo, rgb4_t& hi) const noexcept {
+        const vec8_t wy = set8(row.yw);
+        split8(downsample8<F, 4>(row.y0, row.y1, c, wy), downsample8<F, 4>(row.y0 + 1, row.y1 + 1, c, wy),
+               downsample8<F, 4>(row.y0 + 2, row.y1 + 2, c, wy), lo, hi);
+    }
+#endif
+};
+
+/**
+ * @brief Sample the pixels and pass them to the `store`
+ * @details The columns out of the sampler's `simd_columns` use the scalar path
+ */
+template <typename Sampler, typename Store>
+void convert_rows(const Sampler& sampler, const Store& store, index_range_t rows) noexcept {
+    const size_t width = sampler.width();
+    const index_range_t simd = sampler.simd_columns();
+    for (auto r = rows.begin; r < rows.end; ++r) {
+        const auto row = sampler.row(r);
+        float rgb[3]{};
+        size_t c = 0;
+        for (; c < simd.begin; ++c) {
+            sampler.sample1(row, c, rgb);
+            store.store1(r, c, rgb);
+        }
+#if defined(KERNEL_AVX2)
+        if constexpr (requires(rgb4_t & px) { sampler.sample8(row, c, px, px); }) {
+            for (; c + 8 <= simd.end; c += 8) {
+                rgb4_t lo{}, hi{};
+                sampler.sample8(row, c, lo, hi);
+                store.store4(r, c, lo);
+                store.store4(r, c + 4, hi);
+            }
+        }
+#endif
+#if defined(KERNEL_SSE4_1) || defined(__ARM_NEON)
+        for (; c + 4 <= simd.end; c += 4) store.store4(r, c, sampler.sample4(row, c));
+#endif
+        for (; c < width; ++c) {
+            sampler.sample1(row, c, rgb);
+            store.store1(r, c, rgb);
+        }
+    }
+}
+
+/**
+ * @brief `convert_rows` of the fixed-point kernels. The pixels are Q7 integers until the `fixed_store_t`
+ * @details The columns out of the sampler's `fixed_columns` use the scalar path, which has the same result
+ */
+template <typename Sampler, typename Store>
+void convert_rows_fixed(const Sampler& sampler, const Store& store, index_range_t rows) noexcept {
+    const size_t width = sampler.width();
+    const index_range_t simd = sampler.fixed_columns();
+    for (auto r = rows.begin; r < rows.end; ++r) {
+        const auto row = sampler.row(r);
+        int32_t rgb[3]{};
+        size_t c = 0;
+        for (; c < simd.begin; ++c) {
+            sampler.sample1q(row, c, rgb);
+            store.store1(r, c, rgb);
+        }
+#if defined(KERNEL_SSE4_1) || defined(__ARM_NEON)
+        for (; c + 8 <= simd.end; c += 8) store.store8(r, c, sampler.sample8q(row, c));
+#endif
+        for (; c < width; ++c) {
+            sampler.sample1q(row, c, rgb);
+            store.store1(r, c, rgb);
+        }
+    }
+}
+
+template <typename Store>
+void convert_rows(const yuv_view_t& src, const yuv_resize_plan_t& plan, const Store& store,
+                  index_range_t rows) noexcept {
+    convert_rows(plan_sampler_t{src, plan}, store, rows);
+}
+
+template <typename Store>
+void convert_rows_reference(const yuv_view_t& src, const yuv_resize_plan_t& plan, const Store& store,
+                            index_range_t rows) noexcept {
+    for (auto r = rows.begin; r < rows.end; ++r) {
+        const row_sources_t row = get_row(src, plan, r);
+        for (size_t c = 0; c < plan.width(); ++c) {
+            float rgb[3]{};
+            sample_rgb(row, plan, c, rgb);
+            store.store1(r, c, rgb);
+        }
+    }
+}
+
+/// @brief Sources of the registry. I420, NV12/NV21, RGBA/RGBX
+constexpr size_t source_count = 3;
+constexpr size_t scale_count = 4;
+constexpr size_t type_count = 4;
+constexpr size_t layout_count = 2;
+
+/// @brief Element types in the order of `get_type_index`
+using element_types_t = std::tuple<float, uint16_t, uint8_t, int8_t>;
+
+constexpr int32_t get_ratio(scale_class_t scale) noexcept {
+    switch (scale) {
+        case scale_class_t::same:
+            return 1;
+        case scale_class_t::half:
+            return 2;
+        case scale_class_t::quarter:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Invoke the `fn` with the sampler of the registry's source and ratio
+ * @tparam Source 0(I420), 1(NV12/NV21), 2(RGBA/RGBX)
+ * @tparam Ratio 0 for `scale_class_t::arbitrary`. @see get_ratio
+ */
+template <size_t Source, int32_t Ratio, typename Fn>
+void visit_sampler(const yuv_view_t& src, const yuv_resize_plan_t& plan, Fn&& fn) noexcept {
+    if constexpr (Source == 2) {
+        if constexpr (Ratio == 0)
+            fn(rgba_plan_sampler_t{src, plan});
+        else
+            fn(rgba_ratio_sampler_t<Ratio>{src, plan.width()});
+    } else {
+        if constexpr (Ratio == 0)
+            fn(plan_sampler_t{src, plan});
+        else
+            fn(yuv_ratio_sampler_t<Ratio, Source + 1>{src, plan.width()});
+    }
+}
+
+/**
+ * @brief Instance of the registry. The index is `((source * 4 + scale) * 4 + type) * 2 + layout`
+ */
+template <size_t I>
+void run_kernel(const yuv_view_t& src, const yuv_resize_plan_t& plan, const tensor_packing_t& dst,
+                const rgb_normalization_t& norm, index_range_t rows) noexcept {
+    constexpr auto layout = static_cast<tensor_layout_t>(I % layout_count);
+    using T = std::tuple_element_t<I / layout_count % type_count, element_types_t>;
+    constexpr int32_t ratio = get_ratio(static_cast<scale_class_t>(I / layout_count / type_count % scale_count));
+    constexpr size_t source = I / layout_count / type_count / scale_count;
+
+    const auto store = make_store<T, layout>(dst, norm);
+    visit_sampler<source, ratio>(src, plan, [&](const auto& sampler) { convert_rows(sampler, store, rows); });
+}
+
+/// @brief Instances of this source's ISA. Use with `std::make_index_sequence<kernel_count>`
+template <size_t... I>
+constexpr auto make_kernel_table(std::index_sequence<I...>) noexcept {
+    return std::array<convert_kernel_t, sizeof...(I)>{&run_kernel<I>...};
+}
+
+constexpr size_t kernel_count = source_count * scale_count * type_count * layout_count;
+
+/// @brief Element types of the fixed-point kernels. `uint8`, `int8`
+using quantized_types_t = std::tuple<uint8_t, int8_t>;
+constexpr size_t quantized_type_count = 2;
+
+/**
+ * @brief Fixed-point instance of the registry. The index is `((source * 4 + scale) * 2 + type) * 2 + layout`
+ * @see quantized_types_t
+ */
+template <size_t I>
+void run_fixed_kernel(const yuv_view_t& src, const yuv_resize_plan_t& plan, const tensor_packing_t& dst,
+                      const rgb_normalization_t& norm, index_range_t rows) noexcept {
+    constexpr auto layout = static_cast<tensor_layout_t>(I % layout_count);
+    using T = std::tuple_element_t<I / layout_count % quantized_type_count, quantized_types_t>;
+    constexpr int32_t ratio =
+        get_ratio(static_cast<scale_class_t>(I / layout_count / quantized_type_count % scale_count));
+    constexpr size_t source = I / layout_count / quantized_type_count / scale_count;
+
+    const auto store = make_fixed_store<T, layout>(dst, norm);
+    visit_sampler<source, ratio>(src, plan, [&](const auto& sampler) { convert_rows_fixed(sampler, store, rows); });
+}
+
+/// @brief Use with `std::make_index_sequence<fixed_kernel_count>`
+template <size_t... I>
+constexpr auto make_fixed_kernel_table(std::index_sequence<I...>) noexcept {
+    return std::array<convert_kernel_t, sizeof...(I)>{&run_fixed_kernel<I>...};
+}
+
+constexpr size_t fixed_kernel_count = source_count * scale_count * quantized_type_count * layout_count;
+
+}  // namespace
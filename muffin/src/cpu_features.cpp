@@ -0,0 +1,165 @@
+#include "cpu_features.hpp"
+
+#include <utility>
+
+#if defined(__aarch64__) || defined(__arm__)
+#include <sys/auxv.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+void add(cpu_features_t& features, cpu_feature_t feature, bool supported) noexcept {
+    if (supported) features.bits |= static_cast<uint32_t>(feature);
+}
+
+#if defined(__aarch64__)
+
+/// @see linux/arch/arm64/include/uapi/asm/hwcap.h
+constexpr unsigned long hwcap_asimd = 1ul << 1;
+constexpr unsigned long hwcap_asimdhp = 1ul << 10;
+constexpr unsigned long hwcap_asimddp = 1ul << 20;
+constexpr unsigned long hwcap_sve = 1ul << 22;
+constexpr unsigned long hwcap2_sve2 = 1ul << 1;
+constexpr unsigned long hwcap2_i8mm = 1ul << 13;
+
+void probe(cpu_features_t& features) noexcept {
+    const unsigned long hwcap = getauxval(AT_HWCAP), hwcap2 = getauxval(AT_HWCAP2);
+    add(features, cpu_feature_t::neon, hwcap & hwcap_asimd);
+    add(features, cpu_feature_t::fp16, hwcap & hwcap_asimdhp);
+    add(features, cpu_feature_t::dotprod, hwcap & hwcap_asimddp);
+    add(features, cpu_feature_t::sve, hwcap & hwcap_sve);
+    add(features, cpu_feature_t::sve2, hwcap2 & hwcap2_sve2);
+    add(features, cpu_feature_t::i8mm, hwcap2 & hwcap2_i8mm);
+}
+
+#elif defined(__arm__)
+
+/// @see linux/arch/arm/include/uapi/asm/hwcap.h
+constexpr unsigned long hwcap_neon = 1ul << 12;
+constexpr unsigned long hwcap_asimdhp = 1ul << 23;
+constexpr unsigned long hwcap_asimddp = 1ul << 24;
+constexpr unsigned long hwcap_i8mm = 1ul << 27;
+
+void probe(cpu_features_t& features) noexcept {
+    const unsigned long hwcap = getauxval(AT_HWCAP);
+    add(features, cpu_feature_t::neon, hwcap & hwcap_neon);
+    add(features, cpu_feature_t::fp16, hwcap & hwcap_asimdhp);
+    add(features, cpu_feature_t::dotprod, hwcap & hwcap_asimddp);
+    add(features, cpu_feature_t::i8mm, hwcap & hwcap_i8mm);
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+/// @brief XCR0. Which register states the OS saves
+uint64_t get_xcr0() noexcept {
+    uint32_t eax = 0, edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+}
+
+void probe(cpu_features_t& features) noexcept {
+    uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) return;
+    add(features, cpu_feature_t::sse4_2, ecx & bit_SSE4_2);
+    const bool osxsave = ecx & bit_OSXSAVE;
+    const uint64_t xcr0 = osxsave ? get_xcr0() : 0;
+    const bool ymm = (xcr0 & 0x6) == 0x6;     // XMM, YMM
+    const bool zmm = (xcr0 & 0xE6) == 0xE6;  // + opmask, ZMM
+    add(features, cpu_feature_t::avx, ymm && (ecx & bit_AVX));
+    add(features, cpu_feature_t::fma, ymm && (ecx & bit_FMA));
+    add(features, cpu_feature_t::f16c, ymm && (ecx & bit_F16C));
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0) return;
+    add(features, cpu_feature_t::avx2, ymm && (ebx & bit_AVX2));
+    add(features, cpu_feature_t::avx512f, zmm && (ebx & bit_AVX512F));
+    add(features, cpu_feature_t::avx512bw, zmm && (ebx & bit_AVX512BW));
+    add(features, cpu_feature_t::avx512vnni, zmm && (ecx & bit_AVX512VNNI));
+}
+
+#else
+
+void probe(cpu_features_t&) noexcept {
+}
+
+#endif
+
+constexpr std::pair<cpu_feature_t, const char*> feature_names[]{
+    {cpu_feature_t::neon, "neon"},
+    {cpu_feature_t::fp16, "fp16"},
+    {cpu_feature_t::dotprod, "dotprod"},
+    {cpu_feature_t::i8mm, "i8mm"},
+    {cpu_feature_t::sve, "sve"},
+    {cpu_feature_t::sve2, "sve2"},
+    {cpu_feature_t::sse4_2, "sse4.2"},
+    {cpu_feature_t::avx, "avx"},
+    {cpu_feature_t::avx2, "avx2"},
+    {cpu_feature_t::fma, "fma"},
+    {cpu_feature_t::f16c, "f16c"},
+    {cpu_feature_t::avx512f, "avx512f"},
+    {cpu_feature_t::avx512bw, "avx512bw"},
+    {cpu_feature_t::avx512vnni, "avx512vnni"},
+};
+
+kernel_isa_t select_kernel_isa(const cpu_features_t& features) noexcept {
+    for (auto isa : {kernel_isa_t::x86_avx2})
+        if (is_supported(isa, features)) return isa;
+    return kernel_isa_t::baseline;
+}
+
+}  // namespace
+
+bool cpu_features_t::has(cpu_feature_t feature) const noexcept {
+    return (bits & static_cast<uint32_t>(feature)) != 0;
+}
+
+std::string cpu_features_t::describe() const noexcept(false) {
+    std::string text{};
+    for (const auto& [feature, name] : feature_names) {
+        if (has(feature) == false) continue;
+        if (text.empty() == false) text += ' ';
+        text += name;
+    }
+    return text;
+}
+
+cpu_features_t probe_cpu_features() noexcept {
+    cpu_features_t features{};
+    probe(features);
+    return features;
+}
+
+const cpu_features_t& get_cpu_features() noexcept {
+    static const cpu_features_t features = probe_cpu_features();
+    return features;
+}
+
+bool is_supported(kernel_isa_t isa, const cpu_features_t& features) noexcept {
+    switch (isa) {
+        case kernel_isa_t::baseline:
+            return true;
+        case kernel_isa_t::x86_avx2:
+#if defined(__x86_64__)
+            return features.has(cpu_feature_t::avx2) && features.has(cpu_feature_t::fma) &&
+                   features.has(cpu_feature_t::f16c);
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+kernel_isa_t get_kernel_isa() noexcept {
+    static const kernel_isa_t isa = select_kernel_isa(get_cpu_features());
+    return isa;
+}
+
+const char* get_name(kernel_isa_t isa) noexcept {
+    switch (isa) {
+        case kernel_isa_t::baseline:
+            return "baseline";
+        case kernel_isa_t::x86_avx2:
+            return "x86_avx2";
+    }
+    return "unknown";
+}
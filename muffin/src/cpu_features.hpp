@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief ISA extensions for the kernel variants
+ */
+enum class cpu_feature_t : uint32_t {
+    // ARM
+    neon = 1u << 0,      // ASIMD
+    fp16 = 1u << 1,      // half precision arithmetic(ASIMDHP)
+    dotprod = 1u << 2,   // SDOT/UDOT
+    i8mm = 1u << 3,      // SMMLA/UMMLA
+    sve = 1u << 4,
+    sve2 = 1u << 5,
+    // x86
+    sse4_2 = 1u << 16,
+    avx = 1u << 17,
+    avx2 = 1u << 18,
+    fma = 1u << 19,
+    f16c = 1u << 20,
+    avx512f = 1u << 21,
+    avx512bw = 1u << 22,
+    avx512vnni = 1u << 23,
+};
+
+/**
+ * @brief Features of the CPU which the OS supports
+ */
+struct cpu_features_t final {
+    uint32_t bits;
+
+   public:
+    bool has(cpu_feature_t feature) const noexcept;
+    /// @return names of the features. For example, "neon fp16 dotprod"
+    std::string describe() const noexcept(false);
+};
+
+/**
+ * @brief Probe the features. `getauxval(AT_HWCAP/AT_HWCAP2)` for ARM, `cpuid` and `xgetbv` for x86
+ * @note For x86, the AVX features are reported only if the OS saves the registers
+ */
+cpu_features_t probe_cpu_features() noexcept;
+
+/// @brief `probe_cpu_features` of the first call
+const cpu_features_t& get_cpu_features() noexcept;
+
+/**
+ * @brief ISA of the kernel variants. Each variant is built for its ISA in the same library
+ * @details The variants are built with the target attributes, not the compiler flags of the files. So the inline
+ *  functions of the other headers(STL, for example) are not emitted with the instructions of the variant's ISA.
+ */
+enum class kernel_isa_t : uint32_t {
+    baseline = 0,  // the ABI's requirement. NEON for ARM, SSE4.2 for x86_64
+    x86_avx2 = 1,  // AVX2, FMA, F16C
+};
+
+bool is_supported(kernel_isa_t isa, const cpu_features_t& features) noexcept;
+
+/**
+ * @brief The best ISA of the CPU. Selected once, and the kernel tables are resolved with it
+ */
+kernel_isa_t get_kernel_isa() noexcept;
+
+const char* get_name(kernel_isa_t isa) noexcept;
@@ -0,0 +1,65 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+frame_arena_t::frame_arena_t(size_t capacity, pmr::memory_resource* upstream) noexcept(false)
+    : upstream{upstream}, slab_size{capacity + sizeof(slab_t)} {
+    if (capacity == 0) throw std::invalid_argument{"capacity must be greater than 0"};
+    if (upstream == nullptr) throw std::invalid_argument{"upstream is null"};
+    head = current = new (upstream->allocate(slab_size, cache_line)) slab_t{nullptr, slab_size};
+    offset = sizeof(slab_t);
+    counters.capacity = slab_size;
+}
+
+frame_arena_t::~frame_arena_t() noexcept {
+    while (head) {
+        slab_t* next = head->next;
+        upstream->deallocate(head, head->size, cache_line);
+        head = next;
+    }
+}
+
+void* frame_arena_t::bump(slab_t* slab, size_t& offset, size_t bytes, size_t alignment) noexcept {
+    void* ptr = reinterpret_cast<std::byte*>(slab) + offset;
+    size_t space = slab->size - offset;
+    if (std::align(alignment, bytes, ptr, space) == nullptr) return nullptr;
+    offset = slab->size - space + bytes;
+    return ptr;
+}
+
+void* frame_arena_t::do_allocate(size_t bytes, size_t alignment) noexcept(false) {
+    if (bytes >= large_size) alignment = std::max(alignment, cache_line);
+    if (alignment > cache_line) throw std::bad_alloc{};  // the slabs are aligned to the cache line
+    bytes = std::max<size_t>(bytes, 1);
+    void* ptr = bump(current, offset, bytes, alignment);
+    while (ptr == nullptr) {
+        used += current->size - sizeof(slab_t);  // the rest of the slab is wasted for this frame
+        if (current->next == nullptr) {
+            // spill. the slab must fit the block after its header
+            const size_t size = std::max(slab_size, sizeof(slab_t) + cache_line + bytes);
+            current->next = new (upstream->allocate(size, cache_line)) slab_t{nullptr, size};
+            counters.spills += 1;
+            counters.capacity += size;
+        }
+        current = current->next;
+        offset = sizeof(slab_t);
+        ptr = bump(current, offset, bytes, alignment);
+    }
+    counters.allocations += 1;
+    counters.bytes = used + offset - sizeof(slab_t);
+    counters.peak = std::max(counters.peak, counters.bytes);
+    return ptr;
+}
+
+void frame_arena_t::reset() noexcept {
+    current = head;
+    offset = sizeof(slab_t);
+    used = 0;
+    counters.bytes = 0;
+    counters.resets += 1;
+}
+
+frame_arena_stats_t frame_arena_t::stats() const noexcept { return counters; }
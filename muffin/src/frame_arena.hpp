@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+namespace pmr = std::pmr;
+#else
+#include <experimental/memory_resource>  // libc++ before 16
+namespace pmr = std::experimental::pmr;
+#endif
+
+/**
+ * @brief Counters of the `frame_arena_t`
+ */
+struct frame_arena_stats_t final {
+    uint64_t allocations;  // since the construction
+    uint64_t resets;
+    uint64_t spills;       // slabs allocated from the upstream after the construction
+    size_t bytes;          // used in the current frame. including the alignment padding
+    size_t peak;           // max of the `bytes`
+    size_t capacity;       // sum of the slabs
+};
+
+/**
+ * @brief Monotonic scratch memory of a frame. `reset` reclaims all the allocations at once
+ * @details The allocation bumps a pointer in the current slab. When the slab is full, the next slab is used, and
+ *  a new slab is allocated from the upstream only when there is no more. The slabs are kept after the `reset`,
+ *  so once the arena has seen its largest frame, the next frames don't touch the upstream.
+ *  The blocks of `large_size` or more are aligned to the `cache_line`, so the stages don't share the lines.
+ *
+ *  `deallocate` does nothing. The arena is not thread-safe. Use one for each frame in processing.
+ *
+ * ```cpp
+ * frame_arena_t arena{64 << 10};
+ * pmr::vector<box_t> candidates{&arena};
+ * // ... post-processing of the frame
+ * arena.reset(); // after the containers are destroyed
+ * ```
+ */
+class frame_arena_t final : public pmr::memory_resource {
+   public:
+    static constexpr size_t cache_line = 64;
+    static constexpr size_t large_size = 256;
+
+   private:
+    struct slab_t final {
+        slab_t* next;
+        size_t size;  // including this header
+    };
+
+    pmr::memory_resource* upstream;
+    size_t slab_size;
+    slab_t* head = nullptr;
+    slab_t* current = nullptr;
+    size_t offset = 0;  // in the `current`
+    size_t used = 0;    // in the previous slabs of this frame
+    frame_arena_stats_t counters{};
+
+   public:
+    /**
+     * @param capacity size of the first slab. The spilled slabs are same or larger
+     * @param upstream source of the slabs
+     * @throw invalid_argument if the `capacity` is zero or the `upstream` is null
+     * @throw bad_alloc
+     */
+    explicit frame_arena_t(size_t capacity,
+                           pmr::memory_resource* upstream = pmr::new_delete_resource()) noexcept(false);
+    /// @brief Return the slabs to the upstream
+    ~frame_arena_t() noexcept;
+    frame_arena_t(const frame_arena_t&) = delete;
+    frame_arena_t(frame_arena_t&&) = delete;
+    frame_arena_t& operator=(const frame_arena_t&) = delete;
+    frame_arena_t& operator=(frame_arena_t&&) = delete;
+
+   private:
+    void* do_allocate(size_t bytes, size_t alignment) noexcept(false) override;
+    void do_deallocate(void*, size_t, size_t) noexcept override {}
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    /// @return null if the `slab` doesn't fit
+    static void* bump(slab_t* slab, size_t& offset, size_t bytes, size_t alignment) noexcept;
+
+   public:
+    /**
+     * @brief Reclaim all the allocations of the frame. The slabs are kept for the next frame
+     * @note The objects in the arena are not destroyed
+     */
+    void reset() noexcept;
+
+    frame_arena_stats_t stats() const noexcept;
+};
@@ -0,0 +1,157 @@
+#include <jni.h>
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "frame_arena.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+
+namespace {
+
+/**
+ * @brief Upstream which counts the allocations. For the tests of the steady state
+ */
+class counting_resource_t final : public pmr::memory_resource {
+    pmr::memory_resource* upstream = pmr::new_delete_resource();
+
+   public:
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+
+   private:
+    void* do_allocate(size_t bytes, size_t alignment) noexcept(false) override {
+        allocations += 1;
+        return upstream->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) noexcept override {
+        deallocations += 1;
+        upstream->deallocate(ptr, bytes, alignment);
+    }
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+struct box_t final {
+    float x, y, w, h;
+    float score;
+    uint32_t label;
+};
+
+/**
+ * @brief Post-processing of a detector. Anchors, candidates, landmarks and a log line
+ * @return number of the kept boxes
+ */
+size_t post_process(pmr::memory_resource* resource, uint32_t frame) noexcept(false) {
+    pmr::vector<float> anchors{resource};
+    anchors.reserve(896 * 4);
+    for (uint32_t i = 0; i < 896; ++i) anchors.insert(anchors.end(), {i / 896.0f, i / 448.0f, 1.0f, 1.0f});
+
+    pmr::vector<box_t> candidates{resource};  // grows without `reserve`
+    for (uint32_t i = 0; i < 896; ++i) {
+        const float score = static_cast<float>((i * 7919 + frame) % 1000) / 1000;
+        if (score > 0.9f) candidates.emplace_back(box_t{anchors[i * 4], anchors[i * 4 + 1], 0.1f, 0.1f, score, 0});
+    }
+    pmr::vector<box_t> kept{resource};
+    for (const box_t& box : candidates)
+        if (kept.empty() || kept.back().x + 0.05f < box.x) kept.emplace_back(box);
+
+    pmr::vector<float> landmarks(468 * 3, 0.0f, resource);
+    for (size_t i = 0; i < kept.size() && i < 468; ++i) landmarks[i * 3] = kept[i].x;
+    pmr::string line{resource};
+    char buf[64]{};
+    for (const box_t& box : kept) {
+        std::snprintf(buf, sizeof(buf), "%.3f %.3f %.2f;", box.x, box.y, box.score);
+        line += buf;
+    }
+    return kept.size();
+}
+
+}  // namespace
+
+extern "C" {
+
+/**
+ * @brief Run `frames` of post-processing with the arena which is smaller than a frame
+ * @return number of the upstream allocations after the first frame. Must be 0
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_FrameArenaTest_countUpstream(  //
+    JNIEnv* env, jclass, jint capacity, jint frames) {
+    try {
+        counting_resource_t upstream{};
+        uint64_t warm = 0;
+        {
+            frame_arena_t arena{static_cast<size_t>(capacity), &upstream};
+            for (int i = 0; i < frames; ++i) {
+                post_process(&arena, i);
+                arena.reset();
+                if (i == 0) warm = upstream.allocations;
+            }
+            const frame_arena_stats_t stats = arena.stats();
+            spdlog::info("{}: spills {} peak {} capacity {}", __func__, stats.spills, stats.peak, stats.capacity);
+            if (stats.resets != static_cast<uint64_t>(frames)) throw std::runtime_error{"resets != frames"};
+        }
+        if (upstream.allocations != upstream.deallocations) throw std::runtime_error{"the arena leaked a slab"};
+        return static_cast<jint>(upstream.allocations - warm);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+/**
+ * @return true if the large blocks are aligned to the cache line, and `reset` reuses the same memory
+ */
+JNIEXPORT jboolean Java_dev_luncliff_muffin_FrameArenaTest_alignLargeBlocks(  //
+    JNIEnv* env, jclass) {
+    try {
+        frame_arena_t arena{4096};
+        void* first = arena.allocate(3, 1);
+        for (int i = 0; i < 8; ++i) {
+            void* large = arena.allocate(frame_arena_t::large_size + i, alignof(float));
+            if (reinterpret_cast<uintptr_t>(large) % frame_arena_t::cache_line != 0) return false;
+        }
+        // spill
+        void* huge = arena.allocate(8192, alignof(double));
+        if (reinterpret_cast<uintptr_t>(huge) % frame_arena_t::cache_line != 0) return false;
+        if (arena.stats().spills != 1) return false;
+        arena.reset();
+        if (arena.stats().bytes != 0) return false;
+        return arena.allocate(3, 1) == first;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return false;
+    }
+}
+
+/**
+ * @return average nanoseconds of the post-processing. With the heap if not `use_arena`
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_FrameArenaTest_measurePostProcess(  //
+    JNIEnv* env, jclass, jboolean use_arena, jint frames) {
+    using namespace std::chrono;
+    try {
+        frame_arena_t arena{64 << 10};
+        pmr::memory_resource* resource = use_arena ? static_cast<pmr::memory_resource*>(&arena)
+                                                   : pmr::new_delete_resource();
+        const auto start = steady_clock::now();
+        for (int i = 0; i < frames; ++i) {
+            post_process(resource, i);
+            arena.reset();
+        }
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+        spdlog::info("{}: {} {} ns", __func__, use_arena ? "arena" : "heap", elapsed.count() / frames);
+        return static_cast<jlong>(elapsed.count() / frames);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+}  // extern "C"
@@ -0,0 +1,234 @@
+#include "frame_bus.hpp"
+
+#include <poll.h>
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+enum class bus_message_type_t : uint32_t {
+    attach = 1,   // the next message is the buffer of `buffer_allocator_t::send`
+    frame = 2,    // the `metadata` for the buffer of the `slot`
+    detach = 3,   // the buffer of the `slot` is forgotten
+    release = 4,  // from the client. acknowledgement of the frame
+};
+
+struct bus_message_t final {
+    bus_message_type_t type;
+    uint32_t slot;
+    frame_metadata_t metadata;
+};
+
+void send_message(int socket, const bus_message_t& message) noexcept(false) {
+    if (send(socket, &message, sizeof(message), MSG_NOSIGNAL) == -1)
+        throw std::system_error{errno, std::system_category(), "send"};
+}
+
+/// @return false if there is no message. `EAGAIN`
+bool receive_message(int socket, bus_message_t& message, int flags) noexcept(false) {
+    const ssize_t length = recv(socket, &message, sizeof(message), flags);
+    if (length == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+        throw std::system_error{errno, std::system_category(), "recv"};
+    }
+    if (length == 0) throw std::system_error{ECONNRESET, std::generic_category(), "recv"};
+    if (length != sizeof(message)) throw std::system_error{EBADMSG, std::generic_category(), "recv"};
+    return true;
+}
+
+}  // namespace
+
+frame_bus_server_t::frame_bus_server_t(buffer_allocator_t& allocator, uint32_t credits) noexcept(false)
+    : allocator{allocator}, max_credits{credits} {
+    if (credits == 0) throw std::invalid_argument{"credits must be greater than 0"};
+}
+
+frame_bus_server_t::~frame_bus_server_t() noexcept {
+    for (subscriber_t& subscriber : subscribers)
+        if (subscriber.socket != -1) close(subscriber.socket);
+}
+
+uint32_t frame_bus_server_t::subscribe(int socket) noexcept {
+    subscriber_t& subscriber = subscribers.emplace_back();
+    subscriber.socket = socket;
+    subscriber.attached.resize(slots.size());
+    subscriber.holds.resize(slots.size());
+    subscriber.stats.credits = max_credits;
+    subscriber.stats.connected = true;
+    return static_cast<uint32_t>(subscribers.size() - 1);
+}
+
+uint32_t frame_bus_server_t::find_slot(buffer_handle_t buffer) const noexcept {
+    for (uint32_t i = 0; i < slots.size(); ++i)
+        if (slots[i].buffer == buffer) return i;
+    return UINT32_MAX;
+}
+
+void frame_bus_server_t::disconnect(subscriber_t& subscriber) noexcept {
+    if (subscriber.socket == -1) return;
+    close(subscriber.socket);
+    subscriber.socket = -1;
+    subscriber.stats.connected = false;
+    for (uint32_t i = 0; i < subscriber.holds.size(); ++i) {
+        slots[i].pending -= subscriber.holds[i];
+        subscriber.holds[i] = 0;
+    }
+}
+
+void frame_bus_server_t::send_frame(subscriber_t& subscriber, uint32_t slot,
+                                    const frame_metadata_t& metadata) noexcept(false) {
+    if (subscriber.attached[slot] == false) {
+        send_message(subscriber.socket, bus_message_t{bus_message_type_t::attach, slot, metadata});
+        allocator.send(slots[slot].buffer, subscriber.socket);
+        subscriber.attached[slot] = true;
+        subscriber.stats.attached += 1;
+    }
+    send_message(subscriber.socket, bus_message_t{bus_message_type_t::frame, slot, metadata});
+}
+
+uint32_t frame_bus_server_t::publish(buffer_handle_t buffer, frame_metadata_t metadata) noexcept {
+    if (buffer == nullptr) return 0;
+    uint32_t slot = find_slot(buffer);
+    if (slot == UINT32_MAX) {
+        // reuse the forgotten slot
+        slot = find_slot(nullptr);
+        if (slot == UINT32_MAX) {
+            slot = static_cast<uint32_t>(slots.size());
+            slots.emplace_back();
+            for (subscriber_t& subscriber : subscribers) {
+                subscriber.attached.resize(slots.size());
+                subscriber.holds.resize(slots.size());
+            }
+        }
+        slots[slot].buffer = buffer;
+    }
+    metadata.sequence = sequence++;
+    uint32_t count = 0;
+    for (subscriber_t& subscriber : subscribers) {
+        if (subscriber.socket == -1) continue;
+        if (subscriber.stats.credits == 0) {
+            subscriber.stats.dropped += 1;
+            continue;
+        }
+        try {
+            send_frame(subscriber, slot, metadata);
+        } catch (const std::system_error& ex) {
+            spdlog::warn("{}: {}", "frame_bus_server_t", ex.what());
+            disconnect(subscriber);
+            continue;
+        }
+        subscriber.stats.credits -= 1;
+        subscriber.stats.sent += 1;
+        subscriber.holds[slot] += 1;
+        slots[slot].pending += 1;
+        count += 1;
+    }
+    return count;
+}
+
+uint32_t frame_bus_server_t::collect() noexcept {
+    uint32_t count = 0;
+    for (subscriber_t& subscriber : subscribers) {
+        try {
+            bus_message_t message{};
+            while (subscriber.socket != -1 && receive_message(subscriber.socket, message, MSG_DONTWAIT)) {
+                const uint32_t slot = message.slot;
+                if (message.type != bus_message_type_t::release || slot >= subscriber.holds.size() ||
+                    subscriber.holds[slot] == 0)
+                    throw std::system_error{EBADMSG, std::generic_category(), "unexpected acknowledgement"};
+                subscriber.holds[slot] -= 1;
+                slots[slot].pending -= 1;
+                subscriber.stats.credits += 1;
+                subscriber.stats.released += 1;
+                count += 1;
+            }
+        } catch (const std::system_error& ex) {
+            spdlog::warn("{}: {}", "frame_bus_server_t", ex.what());
+            disconnect(subscriber);
+        }
+    }
+    return count;
+}
+
+uint32_t frame_bus_server_t::pending(buffer_handle_t buffer) const noexcept {
+    const uint32_t slot = find_slot(buffer);
+    return slot == UINT32_MAX ? 0 : slots[slot].pending;
+}
+
+bool frame_bus_server_t::forget(buffer_handle_t buffer) noexcept {
+    const uint32_t slot = find_slot(buffer);
+    if (slot == UINT32_MAX) return true;
+    if (slots[slot].pending != 0) return false;
+    for (subscriber_t& subscriber : subscribers) {
+        if (subscriber.socket == -1 || subscriber.attached[slot] == false) continue;
+        try {
+            send_message(subscriber.socket, bus_message_t{bus_message_type_t::detach, slot, {}});
+        } catch (const std::system_error& ex) {
+            spdlog::warn("{}: {}", "frame_bus_server_t", ex.what());
+            disconnect(subscriber);
+        }
+        subscriber.attached[slot] = false;
+    }
+    slots[slot].buffer = nullptr;
+    return true;
+}
+
+frame_bus_stats_t frame_bus_server_t::stats(uint32_t subscriber) const noexcept(false) {
+    return subscribers.at(subscriber).stats;
+}
+
+frame_bus_client_t::frame_bus_client_t(buffer_allocator_t& allocator, int socket) noexcept
+    : allocator{allocator}, socket{socket} {}
+
+frame_bus_client_t::~frame_bus_client_t() noexcept {
+    for (slot_t& slot : slots)
+        if (slot.buffer) allocator.release(slot.buffer);
+    close(socket);
+}
+
+int frame_bus_client_t::fd() const noexcept { return socket; }
+
+bus_frame_t frame_bus_client_t::receive(uint32_t wait_ms) noexcept(false) {
+    bus_message_t message{};
+    while (true) {
+        pollfd req{socket, POLLIN, 0};
+        const int count = poll(&req, 1, static_cast<int>(wait_ms));
+        if (count == -1) throw std::system_error{errno, std::system_category(), "poll"};
+        if (count == 0) return {};
+        if (receive_message(socket, message, 0) == false) continue;
+
+        const uint32_t index = message.slot;
+        if (index >= slots.size()) {
+            if (message.type != bus_message_type_t::attach)
+                throw std::system_error{EBADMSG, std::generic_category(), "unknown slot"};
+            slots.resize(index + 1);
+        }
+        slot_t& slot = slots[index];
+        switch (message.type) {
+            case bus_message_type_t::attach:
+                if (slot.buffer) allocator.release(slot.buffer);
+                slot.buffer = nullptr;  // in case of the exception
+                slot.buffer = allocator.receive(socket, slot.desc);
+                continue;
+            case bus_message_type_t::detach:
+                if (slot.buffer) allocator.release(slot.buffer);
+                slot = slot_t{};
+                continue;
+            case bus_message_type_t::frame:
+                if (slot.buffer == nullptr) throw std::system_error{EBADMSG, std::generic_category(), "detached slot"};
+                return bus_frame_t{slot.buffer, slot.desc, index, message.metadata};
+            default:
+                throw std::system_error{EBADMSG, std::generic_category(), "unexpected message"};
+        }
+    }
+}
+
+void frame_bus_client_t::release(bus_frame_t& frame) noexcept(false) {
+    if (frame.buffer == nullptr) return;
+    send_message(socket, bus_message_t{bus_message_type_t::release, frame.slot, frame.metadata});
+    frame = bus_frame_t{};
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include <android/hardware_buffer.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "buffer_pool.hpp"
+
+/**
+ * @brief Per-frame information which is sent with the slot of the buffer
+ */
+struct frame_metadata_t final {
+    int64_t timestamp;  // nanoseconds. @see AImage_getTimestamp
+    uint64_t sequence;  // set by `frame_bus_server_t::publish`
+    int32_t rotation;   // degrees to rotate the buffer clockwise for the display
+    uint32_t flags;     // for the application
+};
+
+/**
+ * @brief Counters of a subscriber of the `frame_bus_server_t`
+ */
+struct frame_bus_stats_t final {
+    uint64_t attached;  // buffers sent to the subscriber. once for each buffer
+    uint64_t sent;      // frames sent
+    uint64_t dropped;   // frames skipped because the subscriber had no credit
+    uint64_t released;  // acknowledgements from the subscriber
+    uint32_t credits;   // frames the subscriber can receive more
+    bool connected;
+};
+
+/**
+ * @brief Publish the frame buffers to the subscriber processes over `AF_UNIX` sockets without copying the pixels
+ * @details A buffer is sent with `buffer_allocator_t::send` when it is published to a subscriber for the first time.
+ *  After that, only its slot and `frame_metadata_t` are sent. The subscriber acknowledges each frame when it is
+ *  done with the buffer.
+ *
+ *  Each subscriber has `credits`. A frame consumes one, and its acknowledgement returns it.
+ *  When a subscriber has no credit, the frame is dropped only for it, so a slow process doesn't stall the others.
+ *  The publisher must not write to a buffer while `pending` is not zero.
+ *
+ *  The sockets must be `SOCK_SEQPACKET`. The server is not thread-safe.
+ *
+ * ```cpp
+ * ndk_buffer_allocator_t allocator{};
+ * frame_bus_server_t server{allocator, 2};
+ * server.subscribe(socket); // from `accept`
+ * // for each frame
+ * server.collect();
+ * if (server.pending(buffer) == 0) {
+ *     // ... write to the buffer
+ *     server.publish(buffer, metadata);
+ * }
+ * ```
+ */
+class frame_bus_server_t final {
+    struct slot_t final {
+        buffer_handle_t buffer = nullptr;  // null if the slot is forgotten
+        uint32_t pending = 0;              // subscribers holding the buffer
+    };
+
+    struct subscriber_t final {
+        int socket = -1;  // -1 if disconnected
+        std::vector<bool> attached{};
+        std::vector<uint32_t> holds{};  // frames of each slot not acknowledged yet
+        frame_bus_stats_t stats{};
+    };
+
+    buffer_allocator_t& allocator;
+    uint32_t max_credits;
+    uint64_t sequence = 0;
+    std::vector<slot_t> slots{};
+    std::vector<subscriber_t> subscribers{};
+
+   public:
+    /**
+     * @param credits frames in flight for each subscriber
+     * @throw invalid_argument if `credits` is zero
+     */
+    frame_bus_server_t(buffer_allocator_t& allocator, uint32_t credits) noexcept(false);
+    /// @brief Close the subscribers' sockets
+    ~frame_bus_server_t() noexcept;
+    frame_bus_server_t(const frame_bus_server_t&) = delete;
+    frame_bus_server_t(frame_bus_server_t&&) = delete;
+    frame_bus_server_t& operator=(const frame_bus_server_t&) = delete;
+    frame_bus_server_t& operator=(frame_bus_server_t&&) = delete;
+
+   private:
+    uint32_t find_slot(buffer_handle_t buffer) const noexcept;
+    void send_frame(subscriber_t& subscriber, uint32_t slot, const frame_metadata_t& metadata) noexcept(false);
+    /// @brief Close the socket and return its holds
+    void disconnect(subscriber_t& subscriber) noexcept;
+
+   public:
+    /**
+     * @param socket connected `SOCK_SEQPACKET` socket. The server closes it
+     * @return id of the subscriber for `stats`
+     */
+    uint32_t subscribe(int socket) noexcept;
+
+    /**
+     * @brief Send the frame to the subscribers which have credit. The disconnected ones are skipped
+     * @param buffer it must be alive until `forget`
+     * @return number of the subscribers which received the frame
+     */
+    uint32_t publish(buffer_handle_t buffer, frame_metadata_t metadata) noexcept;
+
+    /**
+     * @brief Receive the acknowledgements without blocking
+     * @return number of the received acknowledgements
+     */
+    uint32_t collect() noexcept;
+
+    /// @return number of the subscribers holding the buffer. 0 for the unknown buffer
+    uint32_t pending(buffer_handle_t buffer) const noexcept;
+
+    /**
+     * @brief Make the subscribers release their reference of the buffer, before the buffer is freed
+     * @return false if a subscriber still holds the buffer
+     */
+    bool forget(buffer_handle_t buffer) noexcept;
+
+    /// @throw out_of_range
+    frame_bus_stats_t stats(uint32_t subscriber) const noexcept(false);
+};
+
+/**
+ * @brief Frame from the `frame_bus_client_t`. It must be released to the client
+ */
+struct bus_frame_t final {
+    buffer_handle_t buffer = nullptr;  // owned by the client
+    AHardwareBuffer_Desc desc{};
+    uint32_t slot = UINT32_MAX;
+    frame_metadata_t metadata{};
+
+    explicit operator bool() const noexcept { return buffer != nullptr; }
+};
+
+/**
+ * @brief Subscriber of the `frame_bus_server_t`
+ * @details The received buffers are kept for their slots, and released with the `allocator`
+ *  when the server forgets them or the client is destroyed.
+ *
+ * ```cpp
+ * ndk_buffer_allocator_t allocator{};
+ * frame_bus_client_t client{allocator, socket};
+ * while (auto frame = client.receive(100)) {
+ *     // ... lock the `frame.buffer` and run the inference
+ *     client.release(frame);
+ * }
+ * ```
+ */
+class frame_bus_client_t final {
+    struct slot_t final {
+        buffer_handle_t buffer = nullptr;
+        AHardwareBuffer_Desc desc{};
+    };
+
+    buffer_allocator_t& allocator;
+    int socket;
+    std::vector<slot_t> slots{};
+
+   public:
+    /// @param socket connected `SOCK_SEQPACKET` socket. The client closes it
+    frame_bus_client_t(buffer_allocator_t& allocator, int socket) noexcept;
+    ~frame_bus_client_t() noexcept;
+    frame_bus_client_t(const frame_bus_client_t&) = delete;
+    frame_bus_client_t(frame_bus_client_t&&) = delete;
+    frame_bus_client_t& operator=(const frame_bus_client_t&) = delete;
+    frame_bus_client_t& operator=(frame_bus_client_t&&) = delete;
+
+    int fd() const noexcept;
+
+    /**
+     * @brief Wait for the next frame. The buffers and the detachments before it are handled together
+     * @return empty frame if timeout
+     * @throw system_error if the connection is closed or the message is broken
+     */
+    bus_frame_t receive(uint32_t wait_ms) noexcept(false);
+
+    /**
+     * @brief Acknowledge the frame and reset it
+     * @throw system_error
+     */
+    void release(bus_frame_t& frame) noexcept(false);
+};
@@ -0,0 +1,227 @@
+#include <jni.h>
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "frame_bus.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+
+namespace {
+
+std::unique_ptr<buffer_allocator_t> make_allocator(bool memfd) noexcept(false) {
+    if (memfd) return std::make_unique<memfd_buffer_allocator_t>();
+    return std::make_unique<ndk_buffer_allocator_t>();
+}
+
+/// @return [server, client]
+std::array<int, 2> make_socket_pair() noexcept(false) {
+    std::array<int, 2> sockets{};
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets.data()) == -1)
+        throw std::system_error{errno, std::system_category(), "socketpair"};
+    return sockets;
+}
+
+AHardwareBuffer_Desc make_frame_desc() noexcept {
+    AHardwareBuffer_Desc desc{};
+    desc.width = 640;
+    desc.height = 480;
+    desc.layers = 1;
+    desc.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+    desc.usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN;
+    return desc;
+}
+
+/**
+ * @brief Receive `count` frames in order and release them
+ * @param check_pixels the first byte of the frame must be its sequence
+ */
+void consume_frames(buffer_allocator_t& allocator, int socket, uint32_t count, bool check_pixels,
+                    std::atomic<uint32_t>& mismatch) noexcept {
+    try {
+        frame_bus_client_t client{allocator, socket};
+        for (uint32_t i = 0; i < count; ++i) {
+            bus_frame_t frame = client.receive(1000);
+            if (!frame) throw std::runtime_error{"timeout"};
+            if (frame.metadata.sequence != i) mismatch += 1;
+            if (check_pixels) {
+                const auto* pixels = static_cast<const uint8_t*>(allocator.lock(frame.buffer, frame.desc.usage));
+                if (pixels[0] != static_cast<uint8_t>(i)) mismatch += 1;
+                allocator.unlock(frame.buffer);
+            }
+            client.release(frame);
+        }
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        mismatch += 1;
+    }
+}
+
+/// @brief Wait until the subscribers release the `buffer` and have credit
+void wait_subscribers(frame_bus_server_t& server, buffer_handle_t buffer, uint32_t subscribers) noexcept(false) {
+    using namespace std::chrono;
+    const auto until = steady_clock::now() + seconds{1};
+    while (true) {
+        server.collect();
+        bool ready = server.pending(buffer) == 0;
+        for (uint32_t i = 0; i < subscribers; ++i) ready = ready && server.stats(i).credits != 0;
+        if (ready) return;
+        if (steady_clock::now() > until) throw std::runtime_error{"subscribers are not responding"};
+        std::this_thread::sleep_for(microseconds{100});
+    }
+}
+
+}  // namespace
+
+extern "C" {
+
+/**
+ * @brief Publish `frames` over `buffers` to the subscriber threads. Each frame's first byte is its sequence
+ * @return number of the buffers sent to the subscribers. Must be `buffers * subscribers`
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_FrameBusTest_publishFrames(  //
+    JNIEnv* env, jclass, jboolean memfd, jint subscribers, jint frames, jint buffers) {
+    try {
+        auto allocator = make_allocator(memfd);
+        frame_bus_server_t server{*allocator, 2};
+        std::atomic<uint32_t> mismatch{};
+        std::vector<std::thread> threads{};
+        for (int i = 0; i < subscribers; ++i) {
+            auto [server_socket, client_socket] = make_socket_pair();
+            server.subscribe(server_socket);
+            threads.emplace_back(consume_frames, std::ref(*allocator), client_socket, frames, true, std::ref(mismatch));
+        }
+        std::vector<buffer_handle_t> pool{};
+        for (int i = 0; i < buffers; ++i) {
+            AHardwareBuffer_Desc desc = make_frame_desc();
+            pool.emplace_back(allocator->allocate(desc));
+        }
+        for (int i = 0; i < frames; ++i) {
+            buffer_handle_t buffer = pool[i % buffers];
+            wait_subscribers(server, buffer, subscribers);
+            auto* pixels = static_cast<uint8_t*>(allocator->lock(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN));
+            pixels[0] = static_cast<uint8_t>(i);  // same with the `sequence`
+            allocator->unlock(buffer);
+            frame_metadata_t metadata{};
+            metadata.timestamp = i * 33'000'000LL;
+            if (server.publish(buffer, metadata) != static_cast<uint32_t>(subscribers))
+                throw std::runtime_error{"a subscriber missed the frame"};
+        }
+        for (std::thread& thread : threads) thread.join();
+        server.collect();
+
+        uint64_t attached = 0;
+        for (int i = 0; i < subscribers; ++i) {
+            const frame_bus_stats_t stats = server.stats(i);
+            if (stats.released != static_cast<uint64_t>(frames) || stats.dropped != 0)
+                throw std::runtime_error{"unexpected acknowledgement"};
+            attached += stats.attached;
+        }
+        for (buffer_handle_t buffer : pool) {
+            server.forget(buffer);
+            allocator->release(buffer);
+        }
+        if (mismatch != 0) throw std::runtime_error{"the subscriber read a wrong frame"};
+        return static_cast<jint>(attached);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief A subscriber which doesn't acknowledge must not stall the other one
+ * @return number of the frames sent to the slow subscriber. Must be `credits`
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_FrameBusTest_dropForSlowSubscriber(  //
+    JNIEnv* env, jclass, jboolean memfd, jint credits, jint frames) {
+    try {
+        auto allocator = make_allocator(memfd);
+        frame_bus_server_t server{*allocator, static_cast<uint32_t>(credits)};
+        auto [slow_server, slow_client] = make_socket_pair();
+        auto [fast_server, fast_client] = make_socket_pair();
+        const uint32_t slow = server.subscribe(slow_server), fast = server.subscribe(fast_server);
+        std::atomic<uint32_t> mismatch{};
+        std::thread consumer{consume_frames, std::ref(*allocator), fast_client, frames, false,
+                             std::ref(mismatch)};
+
+        AHardwareBuffer_Desc desc = make_frame_desc();
+        buffer_handle_t buffer = allocator->allocate(desc);
+        for (int i = 0; i < frames; ++i) {
+            // the slow one holds the buffer. wait for the fast one only
+            const auto until = std::chrono::steady_clock::now() + std::chrono::seconds{1};
+            while (server.stats(fast).credits == 0 && std::chrono::steady_clock::now() < until) server.collect();
+            server.publish(buffer, frame_metadata_t{});
+        }
+        consumer.join();
+        server.collect();
+        const frame_bus_stats_t stats = server.stats(slow);
+        if (server.stats(fast).sent != static_cast<uint64_t>(frames)) throw std::runtime_error{"fast one is stalled"};
+        if (stats.dropped != static_cast<uint64_t>(frames - credits)) throw std::runtime_error{"unexpected drop"};
+        {
+            frame_bus_client_t client{*allocator, slow_client};  // release the slow one's buffers
+        }
+        server.collect();  // disconnected
+        if (server.pending(buffer) != 0 || server.stats(slow).connected) throw std::runtime_error{"still pending"};
+        server.forget(buffer);
+        allocator->release(buffer);
+        if (mismatch != 0) throw std::runtime_error{"the subscriber read a wrong frame"};
+        return static_cast<jint>(stats.sent);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief `forget` must fail while the buffer is held, and detach the subscriber's buffer after the release
+ * @return true if the subscriber released the buffer and the slot is reused for the next buffer
+ */
+JNIEXPORT jboolean Java_dev_luncliff_muffin_FrameBusTest_detachForgotten(  //
+    JNIEnv* env, jclass, jboolean memfd) {
+    try {
+        auto allocator = make_allocator(memfd);
+        frame_bus_server_t server{*allocator, 2};
+        auto [server_socket, client_socket] = make_socket_pair();
+        server.subscribe(server_socket);
+        frame_bus_client_t client{*allocator, client_socket};
+
+        AHardwareBuffer_Desc desc = make_frame_desc();
+        buffer_handle_t first = allocator->allocate(desc);
+        server.publish(first, frame_metadata_t{});
+        bus_frame_t frame = client.receive(1000);
+        if (!frame || server.forget(first)) return false;
+        client.release(frame);
+        while (server.pending(first) != 0) server.collect();
+        if (server.forget(first) == false) return false;
+        allocator->release(first);
+        if (client.receive(10)) return false;  // only the detach
+
+        buffer_handle_t second = allocator->allocate(desc);
+        server.publish(second, frame_metadata_t{});
+        frame = client.receive(1000);
+        const bool reused = frame.slot == 0 && server.stats(0).attached == 2;
+        client.release(frame);
+        while (server.pending(second) != 0) server.collect();
+        server.forget(second);
+        allocator->release(second);
+        return reused;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return false;
+    }
+}
+
+}  // extern "C"
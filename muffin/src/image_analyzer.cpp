@@ -1,28 +1,18 @@
 #include "image_analyzer.hpp"
 
 #include <spdlog/spdlog.h>
+#include <unistd.h>
 
-#include <memory>
+#include <stdexcept>
 #include <system_error>
 
-#include "ndk_buffer.hpp"
-
-using ndk_image_owner = std::unique_ptr<AImage, void (*)(AImage*)>;
-
-ndk_image_owner acquire_latest(AImageReader* reader) noexcept(false) {
-    AImage* image = nullptr;
-    auto ec = AImageReader_acquireLatestImage(reader, &image);
-    if (ec != 0) throw std::system_error{ec, std::generic_category(), "AImageReader_acquireLatestImage"};
-    return {image, &AImage_delete};
-}
-
 void image_analyzer_t::on_image(image_analyzer_t& self, AImageReader* reader) noexcept(false) {
     try {
-        auto image = acquire_latest(reader);
-        ndk_hardware_buffer_t ahwb{image.get()};
-        AHardwareBuffer_Desc desc{};
-        ahwb.get(desc);
+        auto lease = self.leases.acquire_latest(reader);
+        if (lease.image == nullptr) return;
+        const AHardwareBuffer_Desc& desc = lease.layout->desc;
         spdlog::debug("{}: {:x} {} {}", "on_image", desc.format, desc.width, desc.height);
+        self.leases.release(lease);
     } catch (const std::exception& ex) {
         spdlog::error("{}: {}", "on_image", ex.what());
     }
@@ -34,3 +24,176 @@ AImageReader_ImageListener image_analyzer_t::make_listener() noexcept {
     output.onImageAvailable = reinterpret_cast<AImageReader_ImageCallback>(&on_image);
     return output;
 }
+
+constexpr uint64_t image_available = 1;
+constexpr uint64_t image_completed = 1ULL << 32;
+
+async_image_analyzer_t::async_image_analyzer_t(AImageReader* reader, uint32_t max_inflight, void* context,
+                                               handler_t handler) noexcept(false)
+    : reader{reader}, efd{-1}, max_inflight{max_inflight}, context{context}, handler{handler} {
+    int32_t max_images = 0;
+    if (auto ec = AImageReader_getMaxImages(reader, &max_images); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImageReader_getMaxImages"};
+    if (max_inflight == 0 || static_cast<int32_t>(max_inflight) + 1 >= max_images)
+        throw std::invalid_argument{"max_inflight must be less than AImageReader's maxImages - 1"};
+    if (max_inflight > image_lease_pool_t::capacity)
+        throw std::invalid_argument{"max_inflight must be less than image_lease_pool_t::capacity"};
+    if (handler == nullptr) throw std::invalid_argument{"handler is null"};
+    efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (efd == -1) throw std::system_error{errno, std::system_category(), "eventfd"};
+}
+
+async_image_analyzer_t::~async_image_analyzer_t() noexcept {
+    if (is_running()) spdlog::error("{}: {}", "async_image_analyzer_t", "destroyed while running");
+    close(efd);
+}
+
+void async_image_analyzer_t::notify(uint64_t value) noexcept {
+    if (write(efd, &value, sizeof(value)) == -1) spdlog::error("{}: {} {}", "async_image_analyzer_t", "write", errno);
+}
+
+void async_image_analyzer_t::on_image(async_image_analyzer_t& self, AImageReader*) noexcept {
+    self.received.fetch_add(1, std::memory_order_relaxed);
+    self.notify(image_available);
+}
+
+AImageReader_ImageListener async_image_analyzer_t::make_listener() noexcept {
+    AImageReader_ImageListener output{};
+    output.context = this;
+    output.onImageAvailable = reinterpret_cast<AImageReader_ImageCallback>(&on_image);
+    return output;
+}
+
+void async_image_analyzer_t::use_pyramid(uint32_t count, float scale) noexcept(false) {
+    int32_t format = 0, width = 0, height = 0;
+    if (auto ec = AImageReader_getFormat(reader, &format); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImageReader_getFormat"};
+    if (format != AIMAGE_FORMAT_YUV_420_888) throw std::invalid_argument{"reader's format is not YUV_420_888"};
+    if (auto ec = AImageReader_getWidth(reader, &width); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImageReader_getWidth"};
+    if (auto ec = AImageReader_getHeight(reader, &height); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImageReader_getHeight"};
+    // `image_lease_pool_t` uses the lowest free slot, so the slots are less than `max_inflight`
+    pyramids.clear();
+    for (uint32_t i = 0; i < max_inflight; ++i)
+        pyramids.emplace_back(std::make_unique<image_pyramid_t>(width, height, count, scale));
+}
+
+void async_image_analyzer_t::use_arena(size_t capacity) noexcept(false) {
+    arenas.clear();
+    for (uint32_t i = 0; i < max_inflight; ++i) arenas.emplace_back(std::make_unique<frame_arena_t>(capacity));
+}
+
+void async_image_analyzer_t::use_motion_gate(const motion_gate_config_t& config) noexcept(false) {
+    int32_t format = 0;
+    if (auto ec = AImageReader_getFormat(reader, &format); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImageReader_getFormat"};
+    if (format != AIMAGE_FORMAT_YUV_420_888) throw std::invalid_argument{"reader's format is not YUV_420_888"};
+    gate = std::make_unique<motion_gate_t>(config);
+    gate_width = config.max_width;
+}
+
+void async_image_analyzer_t::use_budget(const memory_budget_t& budget) noexcept(false) {
+    budgets.emplace_back(&budget);
+}
+
+bool async_image_analyzer_t::is_under_pressure() const noexcept {
+    for (const memory_budget_t* budget : budgets)
+        if (budget->is_exceeded()) return true;
+    return false;
+}
+
+bool async_image_analyzer_t::pass_gate(const image_lease_t& lease, const image_pyramid_t* pyramid) noexcept(false) {
+    if (gate == nullptr) return true;
+    const plane_view_t<const uint8_t> luma = pyramid ? pyramid->select(gate_width, 0).y : make_yuv_view(lease).y;
+    std::lock_guard lock{gate_mutex};
+    return gate->update(luma);
+}
+
+forget_frame_t async_image_analyzer_t::start(epoll_owner_t& ep, thread_pool_t& pool) noexcept {
+    looping = true;
+    uint32_t pending = 0;  // images in the reader which are not acquired yet
+    req.events = EPOLLIN | EPOLLONESHOT;
+    req.data.ptr = nullptr;
+    try {
+        while (stopping == false) {
+            co_await ep.submit(efd, req);
+            uint64_t value = 0;
+            if (read(efd, &value, sizeof(value)) == -1) continue;  // EAGAIN
+            pending += static_cast<uint32_t>(value & UINT32_MAX);
+            if (pending == 0 || stopping) continue;
+            // the completion will signal again
+            if (acquired.load() >= max_inflight) continue;
+
+            image_lease_t lease{};
+            try {
+                lease = leases.acquire_latest(reader);
+            } catch (const std::system_error& ex) {
+                spdlog::warn("{}: {}", "async_image_analyzer_t", ex.what());
+                continue;
+            }
+            if (lease.image == nullptr) {
+                pending = 0;
+                continue;
+            }
+            // all images before the latest are released by the reader
+            dropped.fetch_add(pending - 1, std::memory_order_relaxed);
+            pending = 0;
+            if (is_under_pressure()) {
+                leases.release(lease);
+                shed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            acquired.fetch_add(1);
+            inflight.fetch_add(1);
+            process(pool, lease);
+        }
+        ep.remove(efd);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", "async_image_analyzer_t", ex.what());
+    }
+    looping = false;
+}
+
+forget_frame_t async_image_analyzer_t::process(thread_pool_t& pool, image_lease_t lease) noexcept {
+    co_await pool.schedule();
+    frame_arena_t* arena = arenas.empty() ? nullptr : arenas.at(lease.slot).get();
+    try {
+        const image_pyramid_t* pyramid = nullptr;
+        if (pyramids.empty() == false) {
+            image_pyramid_t& target = *pyramids.at(lease.slot);
+            target.build(pool, make_yuv_view(lease));
+            pyramid = &target;
+        }
+        if (pass_gate(lease, pyramid)) {
+            handler(context, lease, pyramid, arena);
+            processed.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            skipped.fetch_add(1, std::memory_order_relaxed);
+        }
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", "async_image_analyzer_t", ex.what());
+    }
+    if (arena) arena->reset();  // before the slot is released for the next image
+    leases.release(lease);
+    acquired.fetch_sub(1);
+    notify(image_completed);
+    inflight.fetch_sub(1);  // `this` must not be used after this line
+}
+
+void async_image_analyzer_t::stop() noexcept {
+    stopping = true;
+    notify(image_completed);
+}
+
+bool async_image_analyzer_t::is_running() const noexcept { return looping || inflight > 0; }
+
+image_analyzer_stats_t async_image_analyzer_t::stats() const noexcept {
+    image_analyzer_stats_t output{};
+    output.received = received.load(std::memory_order_relaxed);
+    output.processed = processed.load(std::memory_order_relaxed);
+    output.dropped = dropped.load(std::memory_order_relaxed);
+    output.skipped = skipped.load(std::memory_order_relaxed);
+    output.shed = shed.load(std::memory_order_relaxed);
+    return output;
+}
@@ -4,9 +4,24 @@
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "egl_context.hpp"
+#include "frame_arena.hpp"
+#include "image_lease.hpp"
+#include "image_pyramid.hpp"
+#include "image_view.hpp"
+#include "memory_budget.hpp"
+#include "motion_gate.hpp"
+#include "muffin.hpp"
+#include "thread_pool.hpp"
 
 class image_analyzer_t final {
+    image_lease_pool_t leases{};
+
    private:
     static void on_image(image_analyzer_t& self, AImageReader* reader) noexcept(false);
 
@@ -14,7 +29,148 @@ class image_analyzer_t final {
     AImageReader_ImageListener make_listener() noexcept;
 };
 
+/**
+ * @brief Counters of the `async_image_analyzer_t`
+ */
+struct image_analyzer_stats_t final {
+    uint64_t received;   // `onImageAvailable` from the `AImageReader`
+    uint64_t processed;  // images given to the handler
+    uint64_t dropped;    // stale images released without processing
+    uint64_t skipped;    // images released by the `motion_gate_t`. The last result of the handler is still valid
+    uint64_t shed;       // images released because a `memory_budget_t` of `use_budget` was exceeded
+};
+
+/**
+ * @brief Analyze the latest image of `AImageReader` out of its callback thread
+ * @details The listener only signals an `eventfd`. The coroutine on `epoll_owner_t` acquires the latest image,
+ *  processes it in the `thread_pool_t`, and releases it. The images which became stale while the analysis is busy
+ *  are dropped by `AImageReader_acquireLatestImage`.
+ *
+ * ```cpp
+ * async_image_analyzer_t analyzer{reader, 1, context, &on_image};
+ * auto listener = analyzer.make_listener();
+ * AImageReader_setImageListener(reader, &listener);
+ * analyzer.use_pyramid(4); // optional. for the multi-scale detection
+ * analyzer.use_motion_gate(); // optional. skip the static scenes
+ * analyzer.use_arena(64 << 10); // optional. scratch memory of the handler
+ * analyzer.use_budget(get_memory_budget("buffers")); // optional. shed the frames under the memory pressure
+ * analyzer.start(ep, get_default_pool());
+ * // ...
+ * analyzer.stop();
+ * while (analyzer.is_running())
+ *     resume_ready(ep, 100);
+ * ```
+ */
 class async_image_analyzer_t final {
-    int epfd = 0;
-    int events[3]{};
+   public:
+    /**
+     * @param pyramid levels of the `lease`'s image. null if `use_pyramid` is not invoked
+     * @param arena scratch memory for the `lease`. It is reset when the lease is released. null if `use_arena` is not
+     *  invoked
+     * @note The `lease` is released after the handler returns
+     */
+    using handler_t = void (*)(void* context, const image_lease_t& lease, const image_pyramid_t* pyramid,
+                               pmr::memory_resource* arena);
+
+   private:
+    AImageReader* reader;
+    image_lease_pool_t leases{};
+    int efd;  // low 32 bit counts the available images, high 32 bit counts the completions
+    uint32_t max_inflight;
+    void* context;
+    handler_t handler;
+    epoll_event req{};
+    std::atomic<uint32_t> acquired{};  // images in processing
+    std::atomic<uint32_t> inflight{};  // coroutines in processing
+    std::atomic<bool> looping{};
+    std::atomic<bool> stopping{};
+    std::atomic<uint64_t> received{};
+    std::atomic<uint64_t> processed{};
+    std::atomic<uint64_t> dropped{};
+    std::atomic<uint64_t> skipped{};
+    std::atomic<uint64_t> shed{};
+    std::vector<std::unique_ptr<image_pyramid_t>> pyramids{};  // for each slot of the `leases`
+    std::vector<std::unique_ptr<frame_arena_t>> arenas{};      // for each slot of the `leases`
+    std::unique_ptr<motion_gate_t> gate{};
+    std::mutex gate_mutex{};  // the workers may run the gate together if `max_inflight` is greater than 1
+    uint32_t gate_width = 0;  // `motion_gate_config_t::max_width`. to select the level of the pyramid
+    std::vector<const memory_budget_t*> budgets{};
+
+   public:
+    /**
+     * @param max_inflight limit of the images in processing. `AImageReader_acquireLatestImage` needs 1 more image,
+     *  so this must be less than `AImageReader_getMaxImages - 1`. Also limited by `image_lease_pool_t::capacity`
+     * @throw invalid_argument
+     * @throw system_error
+     */
+    async_image_analyzer_t(AImageReader* reader, uint32_t max_inflight, void* context,
+                           handler_t handler) noexcept(false);
+    /// @note `is_running` must be false before the destruction
+    ~async_image_analyzer_t() noexcept;
+    async_image_analyzer_t(const async_image_analyzer_t&) = delete;
+    async_image_analyzer_t(async_image_analyzer_t&&) = delete;
+    async_image_analyzer_t& operator=(const async_image_analyzer_t&) = delete;
+    async_image_analyzer_t& operator=(async_image_analyzer_t&&) = delete;
+
+   private:
+    static void on_image(async_image_analyzer_t& self, AImageReader* reader) noexcept;
+    void notify(uint64_t value) noexcept;
+    /// @return true if any of the `budgets` is exceeded
+    bool is_under_pressure() const noexcept;
+    forget_frame_t process(thread_pool_t& pool, image_lease_t lease) noexcept;
+    /// @return true if the handler must be invoked for the `lease`
+    bool pass_gate(const image_lease_t& lease, const image_pyramid_t* pyramid) noexcept(false);
+
+   public:
+    AImageReader_ImageListener make_listener() noexcept;
+
+    /**
+     * @brief Build the `image_pyramid_t` of each image before the handler. Invoke before `start`
+     * @details The pyramids are allocated here for `max_inflight` images, and reused for the next images.
+     *  They are built in the pool's worker which runs the handler. @see image_pyramid_t::build
+     * @throw invalid_argument if the reader's format is not `AIMAGE_FORMAT_YUV_420_888`
+     * @throw system_error
+     */
+    void use_pyramid(uint32_t count, float scale = 0.5f) noexcept(false);
+
+    /**
+     * @brief Give a `frame_arena_t` to the handler. Invoke before `start`
+     * @details The arenas are allocated here for `max_inflight` images. An arena is reset in O(1) before its lease
+     *  is released, so the allocations of the handler must not be used after it returns.
+     *  The arena spills to a new slab when the frame needs more than the `capacity`, and reuses it for the next
+     *  frames. @see frame_arena_stats_t
+     * @throw invalid_argument if the `capacity` is zero
+     */
+    void use_arena(size_t capacity) noexcept(false);
+
+    /**
+     * @brief Skip the handler while the scene is static. Invoke before `start`
+     * @details The gate runs in the pool's worker before the handler. If the pyramid is used, its level is
+     *  compared instead of the image. The skipped images are counted in `image_analyzer_stats_t::skipped`.
+     * @throw invalid_argument if the reader's format is not `AIMAGE_FORMAT_YUV_420_888`, or the `config` is invalid
+     * @throw system_error
+     * @see motion_gate_t
+     */
+    void use_motion_gate(const motion_gate_config_t& config = {}) noexcept(false);
+
+    /**
+     * @brief Shed the frames while the `budget` is exceeded. Invoke before `start`
+     * @details The latest image is released without processing, so the memory of the handler's outputs doesn't grow
+     *  until the owners release theirs. The shed images are counted in `image_analyzer_stats_t::shed`.
+     * @throw bad_alloc
+     */
+    void use_budget(const memory_budget_t& budget) noexcept(false);
+
+    /**
+     * @brief Start the analysis loop. The thread which runs `resume_ready` with the `ep` will acquire the images
+     */
+    forget_frame_t start(epoll_owner_t& ep, thread_pool_t& pool) noexcept;
+    /**
+     * @brief Request the loop to stop. The images in processing will be released later
+     */
+    void stop() noexcept;
+    /// @return true if the loop or processing of the image is not finished
+    bool is_running() const noexcept;
+
+    image_analyzer_stats_t stats() const noexcept;
 };
@@ -0,0 +1,125 @@
+#include <android/native_window.h>
+#include <jni.h>
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include "image_analyzer.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+
+namespace {
+
+using image_reader_ptr = std::unique_ptr<AImageReader, void (*)(AImageReader*)>;
+
+struct analysis_context_t final {
+    std::chrono::milliseconds delay;
+    std::atomic<int32_t> last{-1};  // 1st byte of the latest processed frame
+};
+
+void on_analysis(void* context, const image_lease_t& lease, const image_pyramid_t*, pmr::memory_resource*) {
+    auto* self = static_cast<analysis_context_t*>(context);
+    uint8_t* data = nullptr;
+    int32_t length = 0;
+    if (auto ec = AImage_getPlaneData(lease.image, 0, &data, &length); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImage_getPlaneData"};
+    self->last = data[0];
+    std::this_thread::sleep_for(self->delay);
+}
+
+/// @brief Queue the frames with the `interval`. The frame `i` is filled with `i`
+void post_frames(ANativeWindow* window, int32_t count, std::chrono::milliseconds interval) noexcept(false) {
+    for (int32_t i = 0; i < count; ++i) {
+        ANativeWindow_Buffer buffer{};
+        if (auto ec = ANativeWindow_lock(window, &buffer, nullptr); ec != 0)
+            throw std::system_error{-ec, std::system_category(), "ANativeWindow_lock"};
+        std::memset(buffer.bits, i, static_cast<size_t>(buffer.stride) * 4);
+        ANativeWindow_unlockAndPost(window);
+        std::this_thread::sleep_for(interval);
+    }
+}
+
+}  // namespace
+
+extern "C" {
+
+/**
+ * @brief Post `count` frames to a reader while the analyzer's handler takes `delay` milliseconds for each image.
+ *  If `pressure`, the analyzer uses a `memory_budget_t` which is exceeded
+ * @return received, processed, dropped, skipped, shed, and the index of the last processed frame. -1 if none
+ */
+JNIEXPORT jlongArray Java_dev_luncliff_muffin_ImageAnalyzerTest_runAnalyzer(  //
+    JNIEnv* env, jclass, jint count, jint interval, jint delay, jboolean pressure) {
+    using namespace std::chrono;
+    try {
+        if (count <= 0 || count > 255) throw std::invalid_argument{"count must be in [1, 255]"};
+        AImageReader* reader = nullptr;
+        if (auto ec = AImageReader_new(64, 64, AIMAGE_FORMAT_RGBA_8888, 4, &reader); ec != AMEDIA_OK)
+            throw std::system_error{ec, std::generic_category(), "AImageReader_new"};
+        image_reader_ptr owner{reader, AImageReader_delete};
+        ANativeWindow* window = nullptr;
+        if (auto ec = AImageReader_getWindow(reader, &window); ec != AMEDIA_OK)
+            throw std::system_error{ec, std::generic_category(), "AImageReader_getWindow"};
+
+        thread_pool_t pool{2};
+        epoll_owner_t ep{};
+        memory_budget_t budget{};
+        budget.set_limit(1);
+        if (pressure) budget.charge(2);
+        analysis_context_t context{milliseconds{delay}};
+        async_image_analyzer_t analyzer{reader, 1, &context, &on_analysis};
+        analyzer.use_budget(budget);
+        auto listener = analyzer.make_listener();
+        AImageReader_setImageListener(reader, &listener);
+        analyzer.start(ep, pool);
+
+        // the producer may wait for the buffers, so it can't run on the thread of `resume_ready`
+        std::atomic<bool> posted{};
+        std::exception_ptr error{};
+        std::thread producer{[&]() {
+            try {
+                post_frames(window, count, milliseconds{interval});
+            } catch (...) {
+                error = std::current_exception();
+            }
+            posted = true;
+        }};
+        const auto until = steady_clock::now() + seconds{5};
+        while (posted == false || analyzer.stats().received < static_cast<uint64_t>(count)) {
+            resume_ready(ep, 5);
+            if (steady_clock::now() > until) break;
+        }
+        // the last image and its processing
+        const auto idle = steady_clock::now() + milliseconds{delay + 100};
+        while (steady_clock::now() < idle) resume_ready(ep, 5);
+        analyzer.stop();
+        while (analyzer.is_running() && steady_clock::now() < until + seconds{1}) resume_ready(ep, 5);
+        producer.join();
+        AImageReader_setImageListener(reader, nullptr);
+        if (pressure) budget.release(2);
+        if (error) std::rethrow_exception(error);
+        if (analyzer.is_running()) throw std::runtime_error{"the analyzer is not stopped"};
+
+        const image_analyzer_stats_t stats = analyzer.stats();
+        const jlong values[6]{static_cast<jlong>(stats.received), static_cast<jlong>(stats.processed),
+                              static_cast<jlong>(stats.dropped),  static_cast<jlong>(stats.skipped),
+                              static_cast<jlong>(stats.shed),     static_cast<jlong>(context.last.load())};
+        jlongArray result = env->NewLongArray(6);
+        if (result == nullptr) return nullptr;
+        env->SetLongArrayRegion(result, 0, 6, values);
+        return result;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return nullptr;
+    }
+}
+
+}  // extern "C"
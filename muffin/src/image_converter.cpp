@@ -0,0 +1,171 @@
+#include "image_converter.hpp"
+
+#include "convert_kernels.hpp"
+
+#if defined(__x86_64__)
+/// @see image_converter_avx2.cpp
+convert_kernel_t get_avx2_kernel(size_t index) noexcept;
+#endif
+
+namespace {
+
+constexpr auto kernel_table = make_kernel_table(std::make_index_sequence<kernel_count>{});
+constexpr auto fixed_kernel_table = make_fixed_kernel_table(std::make_index_sequence<fixed_kernel_count>{});
+
+size_t get_type_index(tensor_type_t type) noexcept(false) {
+    switch (type) {
+        case tensor_type_t::float32:
+            return 0;
+        case tensor_type_t::float16:
+            return 1;
+        case tensor_type_t::uint8:
+            return 2;
+        case tensor_type_t::int8:
+            return 3;
+    }
+    throw std::invalid_argument{"get_convert_kernel: unexpected tensor type"};
+}
+
+size_t get_source_index(const kernel_desc_t& desc) noexcept(false) {
+    switch (desc.format) {
+        case pixel_format_t::yuv_420_888:
+            if (desc.pixel_stride == 1 || desc.pixel_stride == 2) return static_cast<size_t>(desc.pixel_stride - 1);
+            // the plan handles any stride
+            if (desc.scale == scale_class_t::arbitrary) return 0;
+            break;
+        case pixel_format_t::rgba_8888:
+        case pixel_format_t::rgbx_8888:
+            if (desc.pixel_stride == 4) return 2;
+            break;
+        default:
+            throw std::invalid_argument{"get_convert_kernel: unexpected pixel format"};
+    }
+    throw std::invalid_argument{"get_convert_kernel: unexpected pixel stride"};
+}
+
+scale_class_t get_ratio_class(uint32_t src_width, uint32_t src_height, uint32_t width, uint32_t height,
+                              orientation_t orientation) noexcept {
+    if (orientation.degrees != 0 || orientation.mirror) return scale_class_t::arbitrary;
+    for (auto scale : {scale_class_t::same, scale_class_t::half, scale_class_t::quarter}) {
+        const auto ratio = static_cast<uint32_t>(get_ratio(scale));
+        if (src_width == width * ratio && src_height == height * ratio) return scale;
+    }
+    return scale_class_t::arbitrary;
+}
+
+/// @brief RGBA in the `y`. The plan made with this view walks the RGBA pixels with the luma tables
+yuv_view_t make_source(const rgba_view_t& src) noexcept { return yuv_view_t{src.plane, src.plane, src.plane}; }
+
+}  // namespace
+
+scale_class_t get_scale_class(const yuv_view_t& layout, uint32_t width, uint32_t height,
+                              orientation_t orientation) noexcept {
+    const plane_view_t<const uint8_t>&luma = layout.y, &chroma = layout.u;
+    if (luma.pixel_stride != 1 || chroma.pixel_stride != layout.v.pixel_stride) return scale_class_t::arbitrary;
+    if (chroma.pixel_stride != 1 && chroma.pixel_stride != 2) return scale_class_t::arbitrary;
+    // odd sizes have the chroma taps out of the ratio
+    if (chroma.width * 2 != luma.width || chroma.height * 2 != luma.height) return scale_class_t::arbitrary;
+    return get_ratio_class(luma.width, luma.height, width, height, orientation);
+}
+
+scale_class_t get_scale_class(const rgba_view_t& layout, uint32_t width, uint32_t height,
+                              orientation_t orientation) noexcept {
+    if (layout.plane.pixel_stride != 4) return scale_class_t::arbitrary;
+    return get_ratio_class(layout.width(), layout.height(), width, height, orientation);
+}
+
+kernel_arithmetic_t get_kernel_arithmetic(tensor_type_t type) noexcept {
+    if (type == tensor_type_t::uint8 || type == tensor_type_t::int8) return kernel_arithmetic_t::fixed;
+    return kernel_arithmetic_t::floating;
+}
+
+convert_kernel_t get_convert_kernel(const kernel_desc_t& desc) noexcept(false) {
+    const auto scale = static_cast<size_t>(desc.scale);
+    const auto layout = static_cast<size_t>(desc.layout);
+    if (scale >= scale_count || layout >= layout_count)
+        throw std::invalid_argument{"get_convert_kernel: unexpected descriptor"};
+    const size_t source = get_source_index(desc);
+    const size_t type = get_type_index(desc.type);
+    if (is_supported(desc.isa, get_cpu_features()) == false)
+        throw std::invalid_argument{"get_convert_kernel: the CPU doesn't support the ISA"};
+    if (desc.arithmetic == kernel_arithmetic_t::fixed) {
+        // `uint8`, `int8` are the last ones of `get_type_index`
+        constexpr size_t first = type_count - quantized_type_count;
+        if (type < first) throw std::invalid_argument{"get_convert_kernel: fixed-point needs the quantized tensor"};
+        const size_t quantized = (source * scale_count + scale) * quantized_type_count + type - first;
+        return fixed_kernel_table[quantized * layout_count + layout];
+    }
+    const size_t index = ((source * scale_count + scale) * type_count + type) * layout_count + layout;
+#if defined(__x86_64__)
+    if (desc.isa == kernel_isa_t::x86_avx2) return get_avx2_kernel(index);
+#endif
+    return kernel_table[index];
+}
+
+image_converter_t::image_converter_t(const yuv_view_t& layout, const tensor_packing_t& dst,
+                                     const rgb_normalization_t& norm, orientation_t orientation,
+                                     bool specialize) noexcept(false)
+    : desc{pixel_format_t::yuv_420_888, layout.u.pixel_stride,
+           specialize ? get_scale_class(layout, dst.width, dst.height, orientation) : scale_class_t::arbitrary,
+           dst.type, dst.layout, get_kernel_isa(), get_kernel_arithmetic(dst.type)},
+      kernel{get_convert_kernel(desc)},
+      plan{layout, dst.width, dst.height, orientation},
+      dst{dst},
+      norm{norm},
+      src_width{layout.width()},
+      src_height{layout.height()} {
+}
+
+image_converter_t::image_converter_t(const rgba_view_t& layout, const tensor_packing_t& dst,
+                                     const rgb_normalization_t& norm, orientation_t orientation,
+                                     bool specialize) noexcept(false)
+    : desc{pixel_format_t::rgba_8888, layout.plane.pixel_stride,
+           specialize ? get_scale_class(layout, dst.width, dst.height, orientation) : scale_class_t::arbitrary,
+           dst.type, dst.layout, get_kernel_isa(), get_kernel_arithmetic(dst.type)},
+      kernel{get_convert_kernel(desc)},
+      plan{make_source(layout), dst.width, dst.height, orientation},
+      dst{dst},
+      norm{norm},
+      src_width{layout.width()},
+      src_height{layout.height()} {
+}
+
+const kernel_desc_t& image_converter_t::descriptor() const noexcept { return desc; }
+
+void image_converter_t::set_isa(kernel_isa_t isa) noexcept(false) {
+    kernel_desc_t next = desc;
+    next.isa = isa;
+    kernel = get_convert_kernel(next);
+    desc = next;
+}
+
+void image_converter_t::set_arithmetic(kernel_arithmetic_t arithmetic) noexcept(false) {
+    kernel_desc_t next = desc;
+    next.arithmetic = arithmetic;
+    kernel = get_convert_kernel(next);
+    desc = next;
+}
+
+void image_converter_t::convert(const yuv_view_t& src, index_range_t rows) const noexcept {
+    kernel(src, plan, dst, norm, rows);
+}
+
+void image_converter_t::convert(const rgba_view_t& src, index_range_t rows) const noexcept {
+    kernel(make_source(src), plan, dst, norm, rows);
+}
+
+void image_converter_t::convert(thread_pool_t& pool, const yuv_view_t& src) const noexcept(false) {
+    if (desc.format != pixel_format_t::yuv_420_888 || src.width() != src_width || src.height() != src_height ||
+        src.u.pixel_stride != desc.pixel_stride)
+        throw std::invalid_argument{"image_converter_t: source is different from the layout"};
+    const tile_t tile = make_cache_tile(plan.width(), plan.height(), 3 * get_element_size(dst.type));
+    pool.parallel_for({0, plan.height()}, tile.height, [&](index_range_t rows) { convert(src, rows); });
+}
+
+void image_converter_t::convert(thread_pool_t& pool, const rgba_view_t& src) const noexcept(false) {
+    if (desc.format == pixel_format_t::yuv_420_888 || src.width() != src_width || src.height() != src_height ||
+        src.plane.pixel_stride != desc.pixel_stride)
+        throw std::invalid_argument{"image_converter_t: source is different from the layout"};
+    const tile_t tile = make_cache_tile(plan.width(), plan.height(), 3 * get_element_size(dst.type));
+    pool.parallel_for({0, plan.height()}, tile.height, [&](index_range_t rows) { convert(src, rows); });
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+
+#include "cpu_features.hpp"
+#include "image_view.hpp"
+#include "tensor_packing.hpp"
+#include "thread_pool.hpp"
+#include "yuv_convert.hpp"
+
+/**
+ * @brief Ratio between the source and the output. The exact ratios have the kernels without the offset tables
+ */
+enum class scale_class_t : uint32_t {
+    arbitrary = 0,  // any size and orientation. `yuv_resize_plan_t` is used
+    same = 1,       // 1:1
+    half = 2,       // 2:1
+    quarter = 3,    // 4:1
+};
+
+/**
+ * @brief Number format of the kernel's pixels
+ */
+enum class kernel_arithmetic_t : uint32_t {
+    floating = 0,  // float32. Normalized, and then quantized for the quantized tensors
+    fixed = 1,     // int16 in Q7 with Q15 weights. Only for `tensor_type_t::uint8` and `tensor_type_t::int8`
+};
+
+/**
+ * @brief `kernel_arithmetic_t::fixed` for the quantized tensors
+ */
+kernel_arithmetic_t get_kernel_arithmetic(tensor_type_t type) noexcept;
+
+/**
+ * @brief Key of the conversion kernel registry
+ */
+struct kernel_desc_t final {
+    pixel_format_t format;  // `yuv_420_888`, `rgba_8888`, `rgbx_8888`
+    int32_t pixel_stride;   // of the chroma planes. 1(I420) or 2(NV12/NV21). 4 for RGBA/RGBX
+    scale_class_t scale;
+    tensor_type_t type;
+    tensor_layout_t layout;
+    kernel_isa_t isa;
+    kernel_arithmetic_t arithmetic;
+};
+
+/**
+ * @brief Instance of the kernel registry. Converts, resizes, normalizes, and packs the `rows` of the output
+ * @param src RGBA/RGBX source is passed in the `y`
+ * @param plan used by the `scale_class_t::arbitrary` kernels
+ */
+using convert_kernel_t = void (*)(const yuv_view_t& src, const yuv_resize_plan_t& plan, const tensor_packing_t& dst,
+                                  const rgb_normalization_t& norm, index_range_t rows) noexcept;
+
+/**
+ * @return `scale_class_t::arbitrary` if the ratio is not exact, the image is rotated or mirrored, or the
+ *  strides are not supported by the specialized kernels
+ */
+scale_class_t get_scale_class(const yuv_view_t& layout, uint32_t width, uint32_t height,
+                              orientation_t orientation = {}) noexcept;
+scale_class_t get_scale_class(const rgba_view_t& layout, uint32_t width, uint32_t height,
+                              orientation_t orientation = {}) noexcept;
+
+/**
+ * @brief Find the kernel in the registry. RGBX shares the RGBA kernels
+ * @note The `kernel_arithmetic_t::fixed` kernels are 128-bit SIMD. All ISAs share the baseline instances
+ * @throw invalid_argument if the registry has no kernel for the `desc`, or the CPU doesn't support the `desc.isa`
+ */
+convert_kernel_t get_convert_kernel(const kernel_desc_t& desc) noexcept(false);
+
+/**
+ * @brief Conversion of a stream into the model's input. The kernel is selected once in the constructor
+ * @details The source format, the ratio class, and the tensor's type/layout select an instance of the kernel
+ *  registry. Each instance is compiled with its own sampler and store, so the inner loop doesn't branch on them.
+ *  The instance is from the variant of `get_kernel_isa`. The quantized tensors use the fixed-point instances,
+ *  which quantize the pixels without the float conversion. @see get_kernel_arithmetic
+ *
+ * ```cpp
+ * image_converter_t converter{make_yuv_view(lease), make_tensor_packing(input), norm,
+ *                             make_orientation(sensor_orientation, front_facing)};
+ * // for each frame of the stream
+ * converter.convert(pool, make_yuv_view(lease));
+ * ```
+ */
+class image_converter_t final {
+    kernel_desc_t desc;
+    convert_kernel_t kernel;
+    yuv_resize_plan_t plan;
+    tensor_packing_t dst;
+    rgb_normalization_t norm;
+    uint32_t src_width;
+    uint32_t src_height;
+
+   public:
+    /**
+     * @param layout only the size and the strides are used. The frames of the stream must have same layout
+     * @param specialize false to use the `scale_class_t::arbitrary` kernel for the comparison
+     * @throw invalid_argument if the layout or the packing is not supported
+     */
+    image_converter_t(const yuv_view_t& layout, const tensor_packing_t& dst, const rgb_normalization_t& norm,
+                      orientation_t orientation = {}, bool specialize = true) noexcept(false);
+    image_converter_t(const rgba_view_t& layout, const tensor_packing_t& dst, const rgb_normalization_t& norm,
+                      orientation_t orientation = {}, bool specialize = true) noexcept(false);
+
+    const kernel_desc_t& descriptor() const noexcept;
+
+    /**
+     * @brief Use the kernel of the other ISA. For the comparison and the benchmark
+     * @throw invalid_argument if the CPU doesn't support the `isa`
+     */
+    void set_isa(kernel_isa_t isa) noexcept(false);
+
+    /**
+     * @brief Use the kernel of the other arithmetic. For the comparison and the benchmark
+     * @throw invalid_argument if the tensor type doesn't support the `arithmetic`
+     */
+    void set_arithmetic(kernel_arithmetic_t arithmetic) noexcept(false);
+
+    void convert(const yuv_view_t& src, index_range_t rows) const noexcept;
+    void convert(const rgba_view_t& src, index_range_t rows) const noexcept;
+
+    /**
+     * @brief Run `convert` for all rows with the `pool`
+     * @throw invalid_argument if the `src` has different size or format with the layout
+     */
+    void convert(thread_pool_t& pool, const yuv_view_t& src) const noexcept(false);
+    void convert(thread_pool_t& pool, const rgba_view_t& src) const noexcept(false);
+};
@@ -0,0 +1,46 @@
+/**
+ * @file image_converter_avx2.cpp
+ * @brief `kernel_isa_t::x86_avx2` variant of the conversion kernel registry
+ * @note This file is not built with `-mavx2`. The headers are included before the target region, so only the
+ *  kernels in `convert_kernels.hpp` get AVX2. The inline functions of the STL and the other headers stay in the
+ *  baseline ISA, and the linker can't pick an AVX2 copy of them for the baseline code.
+ */
+#include "image_converter.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#define KERNEL_TARGET_AVX2
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma,f16c"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma,f16c")
+#endif
+
+#include "convert_kernels.hpp"
+
+namespace {
+
+constexpr auto avx2_kernel_table = make_kernel_table(std::make_index_sequence<kernel_count>{});
+
+}  // namespace
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+convert_kernel_t get_avx2_kernel(size_t index) noexcept { return avx2_kernel_table[index]; }
+
+#endif  // __x86_64__
@@ -0,0 +1,1083 @@
+#include <jni.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "image_converter.hpp"
+#include "image_pyramid.hpp"
+#include "image_view.hpp"
+#include "mask_compositor.hpp"
+#include "motion_gate.hpp"
+#include "roi_warp.hpp"
+#include "yuv_convert.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+
+/// @brief Layouts of `AIMAGE_FORMAT_YUV_420_888` in the tests. Same values with `ImageKernelTest`
+enum yuv_layout_t : int32_t {
+    layout_i420 = 0,
+    layout_nv12 = 1,
+    layout_nv21 = 2,
+    layout_rgba = 3,
+};
+
+/// @brief Host memory for the tests. Random pixels with padding in the rows
+struct synthetic_yuv_t final {
+    std::vector<uint8_t> luma{};
+    std::vector<uint8_t> chroma{};
+    yuv_view_t view{};
+
+   public:
+    synthetic_yuv_t(yuv_layout_t layout, uint32_t width, uint32_t height) noexcept(false) {
+        std::mt19937 gen{static_cast<uint32_t>(width * height)};
+        std::uniform_int_distribution<uint32_t> dist{0, 255};
+        const uint32_t cw = (width + 1) / 2, ch = (height + 1) / 2;
+        const int32_t y_stride = static_cast<int32_t>(width + 16);
+        const int32_t uv_stride = static_cast<int32_t>(layout == layout_i420 ? cw + 8 : cw * 2 + 16);
+        luma.resize(y_stride * height);
+        chroma.resize(uv_stride * ch * 2);
+        for (auto& v : luma) v = static_cast<uint8_t>(dist(gen));
+        for (auto& v : chroma) v = static_cast<uint8_t>(dist(gen));
+        view.y = plane_view_t<const uint8_t>{luma.data(), width, height, y_stride, 1};
+        const int32_t pixel_stride = layout == layout_i420 ? 1 : 2;
+        view.u = plane_view_t<const uint8_t>{chroma.data(), cw, ch, uv_stride, pixel_stride};
+        view.v = view.u;
+        switch (layout) {
+            case layout_i420:
+                view.v.data = chroma.data() + uv_stride * ch;
+                break;
+            case layout_nv12:
+                view.v.data = chroma.data() + 1;
+                break;
+            case layout_nv21:
+                view.u.data = chroma.data() + 1;
+                break;
+            default:
+                throw std::invalid_argument{"synthetic_yuv_t: unexpected layout"};
+        }
+    }
+};
+
+/// @brief Random RGBA pixels with padding in the rows
+struct synthetic_rgba_t final {
+    std::vector<uint8_t> pixels{};
+    rgba_view_t view{};
+
+   public:
+    synthetic_rgba_t(uint32_t width, uint32_t height) noexcept(false) {
+        std::mt19937 gen{static_cast<uint32_t>(width * height)};
+        std::uniform_int_distribution<uint32_t> dist{0, 255};
+        const int32_t row_stride = static_cast<int32_t>(width * 4 + 64);
+        pixels.resize(row_stride * height);
+        for (auto& v : pixels) v = static_cast<uint8_t>(dist(gen));
+        view = make_rgba_view(pixels.data(), width, height, row_stride);
+    }
+};
+
+/// @brief Input of the `image_converter_t` tests. `layout_rgba` or one of the YUV layouts
+struct synthetic_image_t final {
+    std::optional<synthetic_yuv_t> yuv{};
+    std::optional<synthetic_rgba_t> rgba{};
+
+   public:
+    synthetic_image_t(yuv_layout_t layout, uint32_t width, uint32_t height) noexcept(false) {
+        if (layout == layout_rgba)
+            rgba.emplace(width, height);
+        else
+            yuv.emplace(layout, width, height);
+    }
+
+    image_converter_t make_converter(const tensor_packing_t& dst, const rgb_normalization_t& norm,
+                                     bool specialize) const noexcept(false) {
+        if (rgba) return image_converter_t{rgba->view, dst, norm, {}, specialize};
+        return image_converter_t{yuv->view, dst, norm, {}, specialize};
+    }
+
+    void convert(const image_converter_t& converter, thread_pool_t& pool) const noexcept(false) {
+        if (rgba) return converter.convert(pool, rgba->view);
+        converter.convert(pool, yuv->view);
+    }
+
+    void convert(const image_converter_t& converter, index_range_t rows) const noexcept {
+        if (rgba) return converter.convert(rgba->view, rows);
+        converter.convert(yuv->view, rows);
+    }
+};
+
+/// @brief Output of the `mask_compositor_t` tests. Same layout with the `image`, but the planes are writable
+struct composite_target_t final {
+    std::vector<uint8_t> luma{};
+    std::vector<uint8_t> chroma{};
+    std::vector<uint8_t> pixels{};
+    yuv_target_t yuv{};
+    plane_view_t<uint8_t> rgba{};
+
+   public:
+    explicit composite_target_t(const synthetic_image_t& image) noexcept(false) {
+        if (image.rgba) {
+            pixels.resize(image.rgba->pixels.size());
+            rgba = rebase(image.rgba->view.plane, image.rgba->pixels.data(), pixels.data());
+            return;
+        }
+        luma.resize(image.yuv->luma.size());
+        chroma.resize(image.yuv->chroma.size());
+        yuv.y = rebase(image.yuv->view.y, image.yuv->luma.data(), luma.data());
+        yuv.u = rebase(image.yuv->view.u, image.yuv->chroma.data(), chroma.data());
+        yuv.v = rebase(image.yuv->view.v, image.yuv->chroma.data(), chroma.data());
+    }
+
+    static plane_view_t<uint8_t> rebase(plane_view_t<const uint8_t> plane, const uint8_t* base,
+                                        uint8_t* target) noexcept {
+        return plane_view_t<uint8_t>{target + (plane.data - base), plane.width, plane.height, plane.row_stride,
+                                     plane.pixel_stride};
+    }
+};
+
+/// @brief Bilinear alpha of the 8-bit mask at the pixel of the `width * height` plane, in [0, 255]
+float sample_alpha(const std::vector<uint8_t>& mask, uint32_t mask_width, uint32_t mask_height, uint32_t x,
+                   uint32_t y, uint32_t width, uint32_t height) noexcept {
+    const float sx = std::clamp((x + 0.5f) * mask_width / width - 0.5f, 0.0f, mask_width - 1.0f);
+    const float sy = std::clamp((y + 0.5f) * mask_height / height - 0.5f, 0.0f, mask_height - 1.0f);
+    const auto x0 = static_cast<uint32_t>(sx), y0 = static_cast<uint32_t>(sy);
+    const uint32_t x1 = std::min(x0 + 1, mask_width - 1), y1 = std::min(y0 + 1, mask_height - 1);
+    const float wx = sx - x0, wy = sy - y0;
+    auto at = [&](uint32_t i, uint32_t j) -> float { return mask[j * mask_width + i]; };
+    const float top = at(x0, y0) * (1 - wx) + at(x1, y0) * wx;
+    const float bottom = at(x0, y1) * (1 - wx) + at(x1, y1) * wx;
+    return top * (1 - wy) + bottom * wy;
+}
+
+/// @return max difference between the `actual` and the float blend of the `src` and the `background`
+float compare_blend(plane_view_t<const uint8_t> src, plane_view_t<const uint8_t> background,
+                    plane_view_t<uint8_t> actual, uint32_t channels, const std::vector<uint8_t>& mask,
+                    uint32_t mask_width, uint32_t mask_height) noexcept {
+    float diff = 0;
+    for (uint32_t y = 0; y < src.height; ++y)
+        for (uint32_t x = 0; x < src.width; ++x) {
+            const float a = sample_alpha(mask, mask_width, mask_height, x, y, src.width, src.height) / 255;
+            for (uint32_t k = 0; k < channels; ++k) {
+                const float expected = (&src.at(x, y))[k] * a + (&background.at(x, y))[k] * (1 - a);
+                diff = std::max(diff, std::abs(expected - (&actual.at(x, y))[k]));
+            }
+        }
+    return diff;
+}
+
+/**
+ * @brief Bilinear sample at the source index. The taps out of the plane are `fill`, or the edges are repeated if the
+ *  `fill` is negative
+ * @param coverage weight of the taps in the plane
+ */
+double sample_bilinear(plane_view_t<const uint8_t> plane, const uint8_t* data, double x, double y, double fill,
+                       double& coverage) noexcept {
+    const auto w = static_cast<int32_t>(plane.width), h = static_cast<int32_t>(plane.height);
+    if (fill < 0) {
+        x = std::clamp(x, 0.0, w - 1.0);
+        y = std::clamp(y, 0.0, h - 1.0);
+    }
+    const double fx = std::floor(x), fy = std::floor(y), wx = x - fx, wy = y - fy;
+    double value = 0;
+    coverage = 0;
+    for (int k = 0; k < 4; ++k) {
+        const int32_t tx = static_cast<int32_t>(fx) + (k & 1), ty = static_cast<int32_t>(fy) + (k >> 1);
+        const double weight = ((k & 1) ? wx : 1 - wx) * ((k >> 1) ? wy : 1 - wy);
+        if (fill >= 0 && (tx < 0 || tx >= w || ty < 0 || ty >= h)) {
+            value += weight * fill;
+            continue;
+        }
+        const int32_t offset =
+            std::clamp(ty, 0, h - 1) * plane.row_stride + std::clamp(tx, 0, w - 1) * plane.pixel_stride;
+        value += weight * data[offset];
+        coverage += weight;
+    }
+    return value;
+}
+
+/**
+ * @brief Double precision `warp_affine` of the `image` into the NHWC floats
+ * @see warp_affine for the border of the YUV
+ */
+std::vector<float> warp_reference(const synthetic_image_t& image, const warp_target_t& target) noexcept(false) {
+    const uint32_t width = target.dst.width, height = target.dst.height;
+    const bool constant = target.border == border_mode_t::constant;
+    const double r = target.fill[0], g = target.fill[1], b = target.fill[2];
+    const double luma = 0.299 * r + 0.587 * g + 0.114 * b;
+    const double fill[3]{luma, (b - luma) / 1.772 + 128, (r - luma) / 1.402 + 128};
+    std::vector<float> pixels(static_cast<size_t>(width) * height * 3);
+    for (uint32_t row = 0; row < height; ++row)
+        for (uint32_t column = 0; column < width; ++column) {
+            const auto [tx, ty] = target.transform.map(column + 0.5f, row + 0.5f);
+            const double x = tx - 0.5, y = ty - 0.5;
+            double rgb[3]{}, coverage = 0, unused = 0;
+            if (image.rgba) {
+                for (int k = 0; k < 3; ++k) {
+                    const double value = constant ? target.fill[k] : -1;
+                    rgb[k] = sample_bilinear(image.rgba->view.plane, image.rgba->view.plane.data + k, x, y, value,
+                                             unused);
+                }
+            } else {
+                const yuv_view_t& src = image.yuv->view;
+                const double yy = sample_bilinear(src.y, src.y.data, x, y, constant ? fill[0] : -1, coverage);
+                double u = sample_bilinear(src.u, src.u.data, (x - 0.5) / 2, (y - 0.5) / 2, -1, unused);
+                double v = sample_bilinear(src.v, src.v.data, (x - 0.5) / 2, (y - 0.5) / 2, -1, unused);
+                if (constant) {
+                    u = fill[1] + (u - fill[1]) * coverage;
+                    v = fill[2] + (v - fill[2]) * coverage;
+                }
+                rgb[0] = std::clamp(yy + 1.402 * (v - 128), 0.0, 255.0);
+                rgb[1] = std::clamp(yy - 0.344136 * (u - 128) - 0.714136 * (v - 128), 0.0, 255.0);
+                rgb[2] = std::clamp(yy + 1.772 * (u - 128), 0.0, 255.0);
+            }
+            for (int k = 0; k < 3; ++k)
+                pixels[(static_cast<size_t>(row) * width + column) * 3 + k] =
+                    static_cast<float>((rgb[k] / 255 - target.norm.mean[k]) / target.norm.stddev[k]);
+        }
+    return pixels;
+}
+
+/// @brief Packing of the host memory with the quantization parameters of the tests
+tensor_packing_t make_test_packing(std::vector<uint8_t>& buffer, tensor_type_t type, tensor_layout_t layout,
+                                   uint32_t width, uint32_t height) noexcept(false) {
+    tensor_packing_t packing{};
+    packing.type = type;
+    packing.layout = layout;
+    packing.width = width;
+    packing.height = height;
+    if (type == tensor_type_t::uint8) {
+        packing.scale = 0.02f;
+        packing.zero_point = 110;
+    } else if (type == tensor_type_t::int8) {
+        packing.scale = 0.02f;
+        packing.zero_point = -18;
+    }
+    buffer.assign(static_cast<size_t>(width) * height * 3 * get_element_size(type), 0);
+    packing.data = buffer.data();
+    return packing;
+}
+
+/**
+ * @brief Luma of a static scene with the sensor noise, and a bright square which moves in some frames
+ */
+struct synthetic_scene_t final {
+    std::vector<uint8_t> luma{};
+    plane_view_t<const uint8_t> view{};
+    uint32_t seed = 1;
+
+   public:
+    synthetic_scene_t(uint32_t width, uint32_t height) noexcept(false) {
+        luma.resize(static_cast<size_t>(width) * height);
+        view = plane_view_t<const uint8_t>{luma.data(), width, height, static_cast<int32_t>(width), 1};
+    }
+
+    /// @param position left of the square. The square is hidden if negative
+    void render(int32_t position, int32_t noise) noexcept {
+        const uint32_t size = view.height / 4, top = view.height / 3;
+        for (uint32_t y = 0; y < view.height; ++y) {
+            uint8_t* row = luma.data() + static_cast<size_t>(y) * view.width;
+            for (uint32_t x = 0; x < view.width; ++x) {
+                seed = seed * 1664525u + 1013904223u;  // LCG. cheap enough for the full HD frames
+                const int32_t pattern = ((x / 64 + y / 64) % 2) ? 96 : 64;
+                const bool inside = position >= 0 && x - static_cast<uint32_t>(position) < size && y - top < size;
+                const auto jitter = static_cast<int32_t>(seed >> 24) % (2 * noise + 1) - noise;
+                row[x] = static_cast<uint8_t>(std::clamp((inside ? 224 : pattern) + jitter, 0, 255));
+            }
+        }
+    }
+};
+
+extern "C" {
+
+/**
+ * @return max difference between `convert_yuv_to_rgb` and `convert_yuv_to_rgb_reference`
+ */
+JNIEXPORT jfloat Java_dev_luncliff_muffin_ImageKernelTest_compareReference(  //
+    JNIEnv* env, jclass, jint layout, jint src_width, jint src_height, jint dst_width, jint dst_height) {
+    try {
+        synthetic_yuv_t image{static_cast<yuv_layout_t>(layout), static_cast<uint32_t>(src_width),
+                              static_cast<uint32_t>(src_height)};
+        yuv_resize_plan_t plan{image.view, static_cast<uint32_t>(dst_width), static_cast<uint32_t>(dst_height)};
+        const rgb_normalization_t norm{{0.485f, 0.456f, 0.406f}, {0.229f, 0.224f, 0.225f}};
+        const size_t count = static_cast<size_t>(dst_width) * dst_height * 3;
+        const index_range_t rows{0, plan.height()};
+
+        std::vector<float> expected(count), actual(count);
+        convert_yuv_to_rgb_reference(image.view, plan, norm, expected.data(), rows);
+        convert_yuv_to_rgb(image.view, plan, norm, actual.data(), rows);
+        float diff = 0;
+        for (size_t i = 0; i < count; ++i) diff = std::max(diff, std::abs(expected[i] - actual[i]));
+
+        std::vector<uint8_t> expected8(count), actual8(count);
+        convert_yuv_to_rgb_reference(image.view, plan, expected8.data(), rows);
+        convert_yuv_to_rgb(get_default_pool(), image.view, plan, actual8.data());
+        for (size_t i = 0; i < count; ++i)
+            diff = std::max<float>(diff, std::abs(expected8[i] - actual8[i]) / 255.0f);
+        return diff;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return INFINITY;
+    }
+}
+
+/**
+ * @return max difference between the fused orientation and the conversion of `rotate_plane`d image
+ */
+JNIEXPORT jfloat Java_dev_luncliff_muffin_ImageKernelTest_compareRotation(  //
+    JNIEnv* env, jclass, jint layout, jint src_width, jint src_height, jint degrees, jboolean mirror) {
+    try {
+        synthetic_yuv_t image{static_cast<yuv_layout_t>(layout), static_cast<uint32_t>(src_width),
+                              static_cast<uint32_t>(src_height)};
+        const yuv_view_t& src = image.view;
+        const orientation_t orientation{static_cast<uint16_t>(degrees), static_cast<bool>(mirror)};
+        const bool transpose = degrees == 90 || degrees == 270;
+        // rotated I420
+        const uint32_t width = transpose ? src.height() : src.width();
+        const uint32_t height = transpose ? src.width() : src.height();
+        std::vector<uint8_t> buffer(width * height + src.u.width * src.u.height * 2);
+        const yuv_view_t rotated = make_i420_view(buffer.data(), width, height);
+        auto writable = [&buffer](plane_view_t<const uint8_t> plane) {
+            uint8_t* data = buffer.data() + (plane.data - buffer.data());
+            return plane_view_t<uint8_t>{data, plane.width, plane.height, plane.row_stride, plane.pixel_stride};
+        };
+        rotate_plane(src.y, orientation, writable(rotated.y));
+        rotate_plane(src.u, orientation, writable(rotated.u));
+        rotate_plane(src.v, orientation, writable(rotated.v));
+
+        const rgb_normalization_t norm{{0.5f, 0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}};
+        const uint32_t out_width = 224, out_height = 224;
+        yuv_resize_plan_t fused{src, out_width, out_height, orientation};
+        yuv_resize_plan_t plan{rotated, out_width, out_height};
+        std::vector<float> expected(out_width * out_height * 3), actual(out_width * out_height * 3);
+        convert_yuv_to_rgb(rotated, plan, norm, expected.data(), {0, out_height});
+        convert_yuv_to_rgb(src, fused, norm, actual.data(), {0, out_height});
+        float diff = 0;
+        for (size_t i = 0; i < expected.size(); ++i) diff = std::max(diff, std::abs(expected[i] - actual[i]));
+        return diff;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return INFINITY;
+    }
+}
+
+/// @brief Decode IEEE half for the comparison
+float get_float(uint16_t half) noexcept {
+    const int32_t exponent = (half >> 10) & 0x1F, mantissa = half & 0x3FF;
+    const float sign = (half & 0x8000) ? -1.0f : 1.0f;
+    if (exponent == 0) return sign * std::ldexp(static_cast<float>(mantissa), -24);
+    if (exponent == 31) return mantissa ? NAN : sign * INFINITY;
+    return sign * std::ldexp(static_cast<float>(mantissa | 0x400), exponent - 25);
+}
+
+/**
+ * @return max difference between the packed tensor and the float NHWC reference. In the quantization steps for
+ *  `uint8`/`int8`
+ */
+JNIEXPORT jfloat Java_dev_luncliff_muffin_ImageKernelTest_comparePacking(  //
+    JNIEnv* env, jclass, jint layout, jint type, jint tensor_layout, jint dst_width, jint dst_height) {
+    try {
+        synthetic_yuv_t image{static_cast<yuv_layout_t>(layout), 640, 480};
+        yuv_resize_plan_t plan{image.view, static_cast<uint32_t>(dst_width), static_cast<uint32_t>(dst_height)};
+        const rgb_normalization_t norm{{0.485f, 0.456f, 0.406f}, {0.229f, 0.224f, 0.225f}};
+        const size_t count = static_cast<size_t>(dst_width) * dst_height * 3;
+        std::vector<float> expected(count);
+        convert_yuv_to_rgb_reference(image.view, plan, norm, expected.data(), {0, plan.height()});
+
+        tensor_packing_t packing{};
+        packing.type = static_cast<tensor_type_t>(type);
+        packing.layout = static_cast<tensor_layout_t>(tensor_layout);
+        packing.width = plan.width();
+        packing.height = plan.height();
+        if (packing.type == tensor_type_t::uint8) {
+            packing.scale = 0.02f;
+            packing.zero_point = 110;
+        } else if (packing.type == tensor_type_t::int8) {
+            packing.scale = 0.02f;
+            packing.zero_point = -18;
+        }
+        std::vector<uint8_t> buffer(count * get_element_size(packing.type));
+        packing.data = buffer.data();
+        convert_yuv_to_rgb(get_default_pool(), image.view, plan, norm, packing);
+
+        float diff = 0;
+        const size_t plane = static_cast<size_t>(dst_width) * dst_height;
+        for (size_t i = 0; i < count; ++i) {
+            // NHWC index to the packed index
+            const size_t index = packing.layout == tensor_layout_t::nhwc ? i : (i % 3) * plane + i / 3;
+            const float value = expected[i];
+            float error = 0;
+            switch (packing.type) {
+                case tensor_type_t::float32:
+                    error = std::abs(reinterpret_cast<const float*>(buffer.data())[index] - value);
+                    break;
+                case tensor_type_t::float16: {
+                    // in the unit of the half's mantissa. 0.5 for the exact rounding
+                    const float actual = get_float(reinterpret_cast<const uint16_t*>(buffer.data())[index]);
+                    error = std::abs(actual - value) / std::max(std::abs(value), 1.0f) * 1024;
+                    break;
+                }
+                case tensor_type_t::uint8: {
+                    const float q = std::clamp(std::round(value / packing.scale) + packing.zero_point, 0.0f, 255.0f);
+                    error = std::abs(reinterpret_cast<const uint8_t*>(buffer.data())[index] - q);
+                    break;
+                }
+                case tensor_type_t::int8: {
+                    const float q = std::clamp(std::round(value / packing.scale) + packing.zero_point, -128.0f, 127.0f);
+                    error = std::abs(reinterpret_cast<const int8_t*>(buffer.data())[index] - q);
+                    break;
+                }
+            }
+            diff = std::max(diff, error);
+        }
+        return diff;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return INFINITY;
+    }
+}
+
+/**
+ * @brief Compare the outputs of `image_converter_t`
+ * @return max difference of the elements. For `float16`, in the unit of the half's mantissa. For `uint8`/`int8`,
+ *  in the quantization steps
+ */
+float compare_elements(tensor_type_t type, const std::vector<uint8_t>& expected,
+                       const std::vector<uint8_t>& actual) noexcept {
+    float diff = 0;
+    const size_t count = expected.size() / get_element_size(type);
+    for (size_t i = 0; i < count; ++i) {
+        float error = 0;
+        switch (type) {
+            case tensor_type_t::float32:
+                error = std::abs(reinterpret_cast<const float*>(actual.data())[i] -
+                                 reinterpret_cast<const float*>(expected.data())[i]);
+                break;
+            case tensor_type_t::float16: {
+                const float value = get_float(reinterpret_cast<const uint16_t*>(expected.data())[i]);
+                const float half = get_float(reinterpret_cast<const uint16_t*>(actual.data())[i]);
+                error = std::abs(half - value) / std::max(std::abs(value), 1.0f) * 1024;
+                break;
+            }
+            case tensor_type_t::uint8:
+                error = std::abs(actual[i] - expected[i]);
+                break;
+            case tensor_type_t::int8:
+                error = std::abs(static_cast<int8_t>(actual[i]) - static_cast<int8_t>(expected[i]));
+                break;
+        }
+        diff = std::max(diff, error);
+    }
+    return diff;
+}
+
+/**
+ * @brief Compare the specialized kernel of the `image_converter_t` with the `scale_class_t::arbitrary` one
+ * @param scale expected `scale_class_t` of the specialized converter
+ * @return max difference of the elements. @see compare_elements
+ * @throw runtime_error if the converter selected other `scale_class_t`
+ */
+JNIEXPORT jfloat Java_dev_luncliff_muffin_ImageKernelTest_compareKernel(  //
+    JNIEnv* env, jclass, jint layout, jint src_width, jint src_height, jint dst_width, jint dst_height, jint type,
+    jint tensor_layout, jint scale) {
+    try {
+        synthetic_image_t image{static_cast<yuv_layout_t>(layout), static_cast<uint32_t>(src_width),
+                                static_cast<uint32_t>(src_height)};
+        const rgb_normalization_t norm{{0.485f, 0.456f, 0.406f}, {0.229f, 0.224f, 0.225f}};
+        std::vector<uint8_t> expected{}, actual{};
+        const auto width = static_cast<uint32_t>(dst_width), height = static_cast<uint32_t>(dst_height);
+        const auto element = static_cast<tensor_type_t>(type);
+        const auto order = static_cast<tensor_layout_t>(tensor_layout);
+        const image_converter_t generic =
+            image.make_converter(make_test_packing(expected, element, order, width, height), norm, false);
+        const image_converter_t specialized =
+            image.make_converter(make_test_packing(actual, element, order, width, height), norm, true);
+        if (specialized.descriptor().scale != static_cast<scale_class_t>(scale))
+            throw std::runtime_error{"unexpected scale class"};
+        image.convert(generic, get_default_pool());
+        image.convert(specialized, get_default_pool());
+
+        return compare_elements(element, expected, actual);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return INFINITY;
+    }
+}
+
+/**
+ * @brief Compare the kernel of `get_kernel_isa` with the baseline one
+ * @return max difference of the elements. @see compare_elements
+ */
+JNIEXPORT jfloat Java_dev_luncliff_muffin_ImageKernelTest_compareVariant(  //
+    JNIEnv* env, jclass, jint layout, jint src_width, jint src_height, jint dst_width, jint dst_height, jint type) {
+    try {
+        synthetic_image_t image{static_cast<yuv_layout_t>(layout), static_cast<uint32_t>(src_width),
+                                static_cast<uint32_t>(src_height)};
+        const rgb_normalization_t norm{{0.485f, 0.456f, 0.406f}, {0.229f, 0.224f, 0.225f}};
+        std::vector<uint8_t> expected{}, actual{};
+        const auto width = static_cast<uint32_t>(dst_width), height = static_cast<uint32_t>(dst_height);
+        const auto element = static_cast<tensor_type_t>(type);
+        image_converter_t baseline = image.make_converter(
+            make_test_packing(expected, element, tensor_layout_t::nhwc, width, height), norm, true);
+        baseline.set_isa(kernel_isa_t::baseline);
+        const image_converter_t variant = image.make_converter(
+            make_test_packing(actual, element, tensor_layout_t::nhwc, width, height), norm, true);
+        spdlog::info("{}: cpu [{}] isa {}", __func__, get_cpu_features().describe(),
+                     get_name(variant.descriptor().isa));
+        image.convert(baseline, get_default_pool());
+        image.convert(variant, get_default_pool());
+        return compare_elements(element, expected, actual);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return INFINITY;
+    }
+}
+
+/**
+ * @return average nanoseconds of the single thread conversion with the `image_converter_t`
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_ImageKernelTest_measureKernel(  //
+    JNIEnv* env, jclass, jint layout, jint src_width, jint src_height, jint dst_width, jint dst_height, jint type,
+    jint repeat, jboolean specialize, jboolean baseline) {
+    using namespace std::chrono;
+    try {
+        synthetic_image_t image{static_cast<yuv_layout_t>(layout), static_cast<uint32_t>(src_width),
+                                static_cast<uint32_t>(src_height)};
+        const rgb_normalization_t norm{{0.5f, 0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}};
+        std::vector<uint8_t> buffer{};
+        image_converter_t converter = image.make_converter(
+            make_test_packing(buffer, static_cast<tensor_type_t>(type), tensor_layout_t::nhwc,
+                              static_cast<uint32_t>(dst_width), static_cast<uint32_t>(dst_height)),
+            norm, specialize);
+        if (baseline) converter.set_isa(kernel_isa_t::baseline);
+        const index_range_t rows{0, static_cast<size_t>(dst_height)};
+
+        const auto start = steady_clock::now();
+        for (int i = 0; i < repeat; ++i) image.convert(converter, rows);
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count() / repeat;
+        const kernel_desc_t& desc = converter.descriptor();
+        spdlog::info("{}: layout {} {}x{} -> {}x{} type {} scale {} {} {} ns", __func__, layout, src_width,
+                     src_height, dst_width, dst_height, type, static_cast<uint32_t>(desc.scale), get_name(desc.isa),
+                     elapsed);
+        return static_cast<jlong>(elapsed);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Compare the fixed-point kernel of the quantized tensor with the float one
+ * @return max difference in the quantization steps. @see compare_elements
+ * @throw runtime_error if the converter didn't select `kernel_arithmetic_t::fixed`
+ */
+JNIEXPORT jfloat Java_dev_luncliff_muffin_ImageKernelTest_compareFixedPoint(  //
+    JNIEnv* env, jclass, jint layout, jint src_width, jint src_height, jint dst_width, jint dst_height, jint type,
+    jint tensor_layout) {
+    try {
+        synthetic_image_t image{static_cast<yuv_layout_t>(layout), static_cast<uint32_t>(src_width),
+                                static_cast<uint32_t>(src_height)};
+        const rgb_normalization_t norm{{0.485f, 0.456f, 0.406f}, {0.229f, 0.224f, 0.225f}};
+        std::vector<uint8_t> expected{}, actual{};
+        const auto width = static_cast<uint32_t>(dst_width), height = static_cast<uint32_t>(dst_height);
+        const auto element = static_cast<tensor_type_t>(type);
+        const auto order = static_cast<tensor_layout_t>(tensor_layout);
+        image_converter_t floating =
+            image.make_converter(make_test_packing(expected, element, order, width, height), norm, true);
+        floating.set_arithmetic(kernel_arithmetic_t::floating);
+        const image_converter_t fixed =
+            image.make_converter(make_test_packing(actual, element, order, width, height), norm, true);
+        if (fixed.descriptor().arithmetic != kernel_arithmetic_t::fixed)
+            throw std::runtime_error{"unexpected kernel arithmetic"};
+        image.convert(floating, get_default_pool());
+        image.convert(fixed, get_default_pool());
+        return compare_elements(element, expected, actual);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return INFINITY;
+    }
+}
+
+/**
+ * @return average nanoseconds of the single thread conversion into the `uint8` tensor
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_ImageKernelTest_measureFixedPoint(  //
+    JNIEnv* env, jclass, jint layout, jint src_width, jint src_height, jint dst_width, jint dst_height, jint repeat,
+    jboolean fixed) {
+    using namespace std::chrono;
+    try {
+        synthetic_image_t image{static_cast<yuv_layout_t>(layout), static_cast<uint32_t>(src_width),
+                                static_cast<uint32_t>(src_height)};
+        const rgb_normalization_t norm{{0.5f, 0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}};
+        std::vector<uint8_t> buffer{};
+        image_converter_t converter = image.make_converter(
+            make_test_packing(buffer, tensor_type_t::uint8, tensor_layout_t::nhwc, static_cast<uint32_t>(dst_width),
+                              static_cast<uint32_t>(dst_height)),
+            norm, true);
+        if (fixed == false) converter.set_arithmetic(kernel_arithmetic_t::floating);
+        const index_range_t rows{0, static_cast<size_t>(dst_height)};
+
+        const auto start = steady_clock::now();
+        for (int i = 0; i < repeat; ++i) image.convert(converter, rows);
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count() / repeat;
+        const kernel_desc_t& desc = converter.descriptor();
+        spdlog::info("{}: layout {} {}x{} -> {}x{} scale {} {} {} ns", __func__, layout, src_width, src_height,
+                     dst_width, dst_height, static_cast<uint32_t>(desc.scale), fixed ? "fixed" : "float", elapsed);
+        return static_cast<jlong>(elapsed);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @return number of different rows between the banded `image_pyramid_t` and the level-by-level 2x downscale
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_ImageKernelTest_comparePyramid(  //
+    JNIEnv* env, jclass, jint layout, jint src_width, jint src_height, jint count) {
+    try {
+        synthetic_yuv_t image{static_cast<yuv_layout_t>(layout), static_cast<uint32_t>(src_width),
+                              static_cast<uint32_t>(src_height)};
+        image_pyramid_t pyramid{static_cast<uint32_t>(src_width), static_cast<uint32_t>(src_height),
+                                static_cast<uint32_t>(count)};
+        pyramid.build(get_default_pool(), image.view);
+        jint diff = 0;
+        yuv_view_t prev = image.view;
+        std::vector<uint8_t> expected{};
+        for (uint32_t i = 0; i < pyramid.count(); ++i) {
+            const pyramid_level_t& level = pyramid.level(i);
+            for (auto [from, actual] : {std::make_pair(prev.y, level.y), std::make_pair(prev.u, level.u),
+                                        std::make_pair(prev.v, level.v)}) {
+                expected.assign(actual.row_stride * actual.height, 0);
+                plane_view_t<uint8_t> target = actual;
+                target.data = expected.data();
+                downscale_plane_2x(from, target, {0, actual.height});
+                for (uint32_t r = 0; r < actual.height; ++r)
+                    diff += std::equal(target.row(r), target.row(r) + actual.width, actual.row(r)) ? 0 : 1;
+            }
+            prev = level.view();
+        }
+        return diff;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+/**
+ * @return average nanoseconds to build the pyramid
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_ImageKernelTest_measurePyramid(  //
+    JNIEnv* env, jclass, jint src_width, jint src_height, jint count, jfloat scale, jint repeat) {
+    using namespace std::chrono;
+    try {
+        synthetic_yuv_t image{layout_nv21, static_cast<uint32_t>(src_width), static_cast<uint32_t>(src_height)};
+        image_pyramid_t pyramid{static_cast<uint32_t>(src_width), static_cast<uint32_t>(src_height),
+                                static_cast<uint32_t>(count), scale};
+        thread_pool_t& pool = get_default_pool();
+        const auto start = steady_clock::now();
+        for (int i = 0; i < repeat; ++i) pyramid.build(pool, image.view);
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count() / repeat;
+        spdlog::info("{}: {}x{} levels {} scale {} {} ns", __func__, src_width, src_height, count, scale, elapsed);
+        return static_cast<jlong>(elapsed);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @return average nanoseconds of the single thread conversion
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_ImageKernelTest_measureConversion(  //
+    JNIEnv* env, jclass, jint src_width, jint src_height, jint dst_width, jint dst_height, jint repeat,
+    jboolean reference) {
+    using namespace std::chrono;
+    try {
+        synthetic_yuv_t image{layout_nv21, static_cast<uint32_t>(src_width), static_cast<uint32_t>(src_height)};
+        yuv_resize_plan_t plan{image.view, static_cast<uint32_t>(dst_width), static_cast<uint32_t>(dst_height)};
+        const rgb_normalization_t norm{{0.5f, 0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}};
+        std::vector<float> output(static_cast<size_t>(dst_width) * dst_height * 3);
+        const index_range_t rows{0, plan.height()};
+
+        const auto start = steady_clock::now();
+        for (int i = 0; i < repeat; ++i) {
+            if (reference)
+                convert_yuv_to_rgb_reference(image.view, plan, norm, output.data(), rows);
+            else
+                convert_yuv_to_rgb(image.view, plan, norm, output.data(), rows);
+        }
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count() / repeat;
+        spdlog::info("{}: {}x{} -> {}x{} reference {} {} ns", __func__, src_width, src_height, dst_width, dst_height,
+                     reference, elapsed);
+        return static_cast<jlong>(elapsed);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @return number of different blocks between `add_block_sad` and the scalar sum
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_ImageKernelTest_compareBlockSad(  //
+    JNIEnv* env, jclass, jint width, jint height) {
+    try {
+        synthetic_yuv_t lhs{layout_i420, static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+        // other seed for the different pixels
+        synthetic_yuv_t rhs{layout_i420, static_cast<uint32_t>(width + 1), static_cast<uint32_t>(height)};
+        const plane_view_t<const uint8_t> p0 = lhs.view.y;
+        const plane_view_t<const uint8_t> p1 = rhs.view.y.crop({0, 0, p0.width, p0.height});
+        const uint32_t columns = (p0.width + 7) / 8;
+        std::vector<uint32_t> expected(columns), actual(columns);
+        jint diff = 0;
+        for (uint32_t r = 0; r < p0.height; r += 8) {
+            const index_range_t rows{r, std::min<size_t>(r + 8, p0.height)};
+            std::fill(expected.begin(), expected.end(), 0);
+            std::fill(actual.begin(), actual.end(), 0);
+            for (auto y = rows.begin; y < rows.end; ++y)
+                for (uint32_t x = 0; x < p0.width; ++x) expected[x / 8] += std::abs(p0.row(y)[x] - p1.row(y)[x]);
+            add_block_sad(p0, p1, rows, actual.data());
+            for (uint32_t b = 0; b < columns; ++b) diff += expected[b] == actual[b] ? 0 : 1;
+        }
+        return diff;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+/**
+ * @brief Run the `motion_gate_t` for the frames of `synthetic_scene_t`
+ * @param moving the square moves in the last `moving` frames
+ * @return ratio of the skipped frames
+ */
+JNIEXPORT jfloat Java_dev_luncliff_muffin_ImageKernelTest_simulateMotionGate(  //
+    JNIEnv* env, jclass, jint width, jint height, jint frames, jint moving) {
+    try {
+        synthetic_scene_t scene{static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+        motion_gate_t gate{};
+        jint skipped = 0;
+        for (jint i = 0; i < frames; ++i) {
+            const jint step = i - (frames - moving);
+            scene.render(step < 0 ? -1 : (step * width / 32) % width, 6);
+            skipped += gate.update(scene.view) ? 0 : 1;
+        }
+        const motion_t& motion = gate.motion();
+        spdlog::info("{}: {}x{} frames {} moving {} skipped {} (last sad {} blocks {}/{})", __func__, width, height,
+                     frames, moving, skipped, motion.sad, motion.changed_blocks, motion.blocks);
+        return static_cast<jfloat>(skipped) / frames;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+/**
+ * @return average nanoseconds of `motion_gate_t::update` for the static frame
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_ImageKernelTest_measureMotionGate(  //
+    JNIEnv* env, jclass, jint width, jint height, jint repeat) {
+    using namespace std::chrono;
+    try {
+        synthetic_scene_t scene{static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+        scene.render(-1, 6);
+        motion_gate_t gate{};
+        const auto start = steady_clock::now();
+        for (int i = 0; i < repeat; ++i) gate.update(scene.view);
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count() / repeat;
+        spdlog::info("{}: {}x{} {} ns", __func__, width, height, elapsed);
+        return static_cast<jlong>(elapsed);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Replace the background with the `mask_compositor_t`, and compare with the float blend
+ * @return max difference of the bytes
+ */
+JNIEXPORT jfloat Java_dev_luncliff_muffin_ImageKernelTest_compareComposite(  //
+    JNIEnv* env, jclass, jint layout, jint width, jint height, jint mask_width, jint mask_height) {
+    try {
+        const auto w = static_cast<uint32_t>(width), h = static_cast<uint32_t>(height);
+        const auto mw = static_cast<uint32_t>(mask_width), mh = static_cast<uint32_t>(mask_height);
+        synthetic_image_t image{static_cast<yuv_layout_t>(layout), w, h};
+        synthetic_image_t background{static_cast<yuv_layout_t>(layout), w, h};
+        // same seed. invert for the different pixels
+        auto invert = [](std::vector<uint8_t>& pixels) {
+            for (auto& v : pixels) v = static_cast<uint8_t>(255 - v);
+        };
+        if (background.rgba) {
+            invert(background.rgba->pixels);
+        } else {
+            invert(background.yuv->luma);
+            invert(background.yuv->chroma);
+        }
+
+        std::mt19937 gen{mw * mh};
+        std::uniform_real_distribution<float> dist{-0.2f, 1.2f};
+        std::vector<float> confidence(static_cast<size_t>(mw) * mh);
+        for (auto& v : confidence) v = dist(gen);
+        std::vector<uint8_t> mask(confidence.size());
+        for (size_t i = 0; i < mask.size(); ++i)
+            mask[i] = static_cast<uint8_t>(std::clamp(confidence[i], 0.0f, 1.0f) * 255 + 0.5f);
+
+        composite_target_t target{image};
+        thread_pool_t& pool = get_default_pool();
+        if (image.rgba) {
+            mask_compositor_t compositor{w, h, pixel_format_t::rgba_8888};
+            compositor.set_mask(confidence.data(), mw, mh);
+            compositor.composite(pool, image.rgba->view, background.rgba->view, target.rgba);
+            return compare_blend(image.rgba->view.plane, background.rgba->view.plane, target.rgba, 4, mask, mw, mh);
+        }
+        mask_compositor_t compositor{w, h, pixel_format_t::yuv_420_888};
+        compositor.set_mask(confidence.data(), mw, mh);
+        compositor.composite(pool, image.yuv->view, background.yuv->view, target.yuv);
+        const yuv_view_t &src = image.yuv->view, &bg = background.yuv->view;
+        return std::max({compare_blend(src.y, bg.y, target.yuv.y, 1, mask, mw, mh),
+                         compare_blend(src.u, bg.u, target.yuv.u, 1, mask, mw, mh),
+                         compare_blend(src.v, bg.v, target.yuv.v, 1, mask, mw, mh)});
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return INFINITY;
+    }
+}
+
+/**
+ * @brief Blur the background with the `mask_compositor_t`. The foreground(1) must be same with the frame, and the
+ *  background(0) of the flat frame must be same with the frame
+ * @return max difference of the bytes
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_ImageKernelTest_compareBlur(  //
+    JNIEnv* env, jclass, jint layout, jint width, jint height) {
+    try {
+        const auto w = static_cast<uint32_t>(width), h = static_cast<uint32_t>(height);
+        synthetic_image_t image{static_cast<yuv_layout_t>(layout), w, h};
+        composite_target_t target{image};
+        thread_pool_t& pool = get_default_pool();
+        const auto format = image.rgba ? pixel_format_t::rgba_8888 : pixel_format_t::yuv_420_888;
+        mask_compositor_t compositor{w, h, format};
+        auto run = [&]() {
+            if (image.rgba) return compositor.composite(pool, image.rgba->view, target.rgba);
+            compositor.composite(pool, image.yuv->view, target.yuv);
+        };
+        // compare the visible bytes of the planes
+        auto compare = [&](auto&& expected) {
+            int diff = 0;
+            auto each = [&](plane_view_t<const uint8_t> src, plane_view_t<uint8_t> dst, uint32_t channels) {
+                for (uint32_t y = 0; y < src.height; ++y)
+                    for (uint32_t x = 0; x < src.width; ++x)
+                        for (uint32_t k = 0; k < channels; ++k)
+                            diff = std::max(diff, std::abs(expected((&src.at(x, y))[k]) - (&dst.at(x, y))[k]));
+            };
+            if (image.rgba) return each(image.rgba->view.plane, target.rgba, 4), diff;
+            each(image.yuv->view.y, target.yuv.y, 1);
+            each(image.yuv->view.u, target.yuv.u, 1);
+            each(image.yuv->view.v, target.yuv.v, 1);
+            return diff;
+        };
+        const std::vector<float> foreground(64 * 64, 1.0f), background(64 * 64, 0.0f);
+        compositor.set_mask(foreground.data(), 64, 64);
+        run();
+        const int identity = compare([](int v) { return v; });
+        compositor.set_mask(background.data(), 64, 64);
+        if (image.rgba) {
+            std::fill(image.rgba->pixels.begin(), image.rgba->pixels.end(), 77);
+        } else {
+            std::fill(image.yuv->luma.begin(), image.yuv->luma.end(), 77);
+            std::fill(image.yuv->chroma.begin(), image.yuv->chroma.end(), 77);
+        }
+        run();
+        const int flat = compare([](int) { return 77; });
+        return std::max(identity, flat);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+/**
+ * @param blur false to replace the background
+ * @return average nanoseconds of the composite in the default pool
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_ImageKernelTest_measureComposite(  //
+    JNIEnv* env, jclass, jint layout, jint width, jint height, jboolean blur, jint repeat) {
+    using namespace std::chrono;
+    try {
+        const auto w = static_cast<uint32_t>(width), h = static_cast<uint32_t>(height);
+        synthetic_image_t image{static_cast<yuv_layout_t>(layout), w, h};
+        synthetic_image_t background{static_cast<yuv_layout_t>(layout), w, h};
+        composite_target_t target{image};
+        thread_pool_t& pool = get_default_pool();
+        mask_compositor_t compositor{w, h, image.rgba ? pixel_format_t::rgba_8888 : pixel_format_t::yuv_420_888};
+        std::vector<float> confidence(256 * 256);
+        for (size_t i = 0; i < confidence.size(); ++i) confidence[i] = (i % 256) / 255.0f;
+        compositor.set_mask(confidence.data(), 256, 256);
+
+        const auto start = steady_clock::now();
+        for (int i = 0; i < repeat; ++i) {
+            if (image.rgba && blur)
+                compositor.composite(pool, image.rgba->view, target.rgba);
+            else if (image.rgba)
+                compositor.composite(pool, image.rgba->view, background.rgba->view, target.rgba);
+            else if (blur)
+                compositor.composite(pool, image.yuv->view, target.yuv);
+            else
+                compositor.composite(pool, image.yuv->view, background.yuv->view, target.yuv);
+        }
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count() / repeat;
+        spdlog::info("{}: layout {} {}x{} blur {} threads {} {} ns", __func__, layout, width, height, blur,
+                     pool.concurrency(), elapsed);
+        return static_cast<jlong>(elapsed);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief `warp_affine` with the identity transform must be same with the 1:1 kernel of the `image_converter_t`
+ * @return max difference of the elements. @see compare_elements
+ */
+JNIEXPORT jfloat Java_dev_luncliff_muffin_ImageKernelTest_compareWarpIdentity(  //
+    JNIEnv* env, jclass, jint layout, jint width, jint height, jint type) {
+    try {
+        const auto w = static_cast<uint32_t>(width), h = static_cast<uint32_t>(height);
+        synthetic_image_t image{static_cast<yuv_layout_t>(layout), w, h};
+        const rgb_normalization_t norm{{0.485f, 0.456f, 0.406f}, {0.229f, 0.224f, 0.225f}};
+        const auto element = static_cast<tensor_type_t>(type);
+        std::vector<uint8_t> expected{}, actual{};
+        const image_converter_t converter =
+            image.make_converter(make_test_packing(expected, element, tensor_layout_t::nhwc, w, h), norm, true);
+        image.convert(converter, get_default_pool());
+
+        const warp_target_t target{affine_transform_t{{1, 0, 0, 0, 1, 0}},
+                                   make_test_packing(actual, element, tensor_layout_t::nhwc, w, h), norm};
+        if (image.rgba)
+            warp_affine(get_default_pool(), image.rgba->view, &target, 1);
+        else
+            warp_affine(get_default_pool(), image.yuv->view, &target, 1);
+        return compare_elements(element, expected, actual);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return INFINITY;
+    }
+}
+
+/**
+ * @brief Warp a rotated ROI which is partially out of the 640x480 image, with a face and 2 eyes in one batch
+ * @param border `border_mode_t`
+ * @return max difference between the float outputs and `warp_reference`, in the normalized value
+ */
+JNIEXPORT jfloat Java_dev_luncliff_muffin_ImageKernelTest_compareWarp(  //
+    JNIEnv* env, jclass, jint layout, jint border) {
+    try {
+        synthetic_image_t image{static_cast<yuv_layout_t>(layout), 640, 480};
+        const rgb_normalization_t norm{{0.485f, 0.456f, 0.406f}, {0.229f, 0.224f, 0.225f}};
+        const roi_t rois[3]{{90.0f, 70.0f, 260.0f, 240.0f, 0.6f},     // over the top-left corner
+                            {320.5f, 240.25f, 37.0f, 37.0f, -2.1f},  // magnified
+                            {600.0f, 400.0f, 150.0f, 90.0f, 3.3f}};
+        const uint32_t sizes[3]{192, 64, 67};
+        std::vector<uint8_t> buffers[3]{};
+        std::vector<warp_target_t> targets{};
+        for (int i = 0; i < 3; ++i) {
+            warp_target_t& target = targets.emplace_back(warp_target_t{
+                make_affine_transform(rois[i], sizes[i], sizes[i]),
+                make_test_packing(buffers[i], tensor_type_t::float32, tensor_layout_t::nhwc, sizes[i], sizes[i]),
+                norm});
+            target.border = static_cast<border_mode_t>(border);
+            target.fill = {30, 200, 90};
+        }
+        if (image.rgba)
+            warp_affine(get_default_pool(), image.rgba->view, targets.data(), targets.size());
+        else
+            warp_affine(get_default_pool(), image.yuv->view, targets.data(), targets.size());
+
+        float diff = 0;
+        for (int i = 0; i < 3; ++i) {
+            const std::vector<float> expected = warp_reference(image, targets[i]);
+            const auto* actual = reinterpret_cast<const float*>(buffers[i].data());
+            for (size_t k = 0; k < expected.size(); ++k) diff = std::max(diff, std::abs(expected[k] - actual[k]));
+        }
+        return diff;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return INFINITY;
+    }
+}
+
+/**
+ * @brief Crop a face(192x192) and 2 eyes(64x64) of the frame in one batch. The full frame conversion to RGB, which
+ *  the crop replaces, is logged for the comparison
+ * @return average nanoseconds of `warp_affine` in the default pool
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_ImageKernelTest_measureWarp(  //
+    JNIEnv* env, jclass, jint layout, jint width, jint height, jint repeat) {
+    using namespace std::chrono;
+    try {
+        const auto w = static_cast<uint32_t>(width), h = static_cast<uint32_t>(height);
+        synthetic_image_t image{static_cast<yuv_layout_t>(layout), w, h};
+        thread_pool_t& pool = get_default_pool();
+        const rgb_normalization_t norm{{0.5f, 0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}};
+        const float face = 0.3f * static_cast<float>(std::min(w, h));
+        const float cx = 0.5f * static_cast<float>(w), cy = 0.5f * static_cast<float>(h);
+        const roi_t rois[3]{{cx, cy, face, face, 0.2f},
+                            {cx - 0.2f * face, cy - 0.1f * face, 0.25f * face, 0.25f * face, 0.2f},
+                            {cx + 0.2f * face, cy - 0.1f * face, 0.25f * face, 0.25f * face, 0.2f}};
+        const uint32_t sizes[3]{192, 64, 64};
+        std::vector<uint8_t> buffers[3]{};
+        std::vector<warp_target_t> targets{};
+        for (int i = 0; i < 3; ++i)
+            targets.emplace_back(warp_target_t{
+                make_affine_transform(rois[i], sizes[i], sizes[i]),
+                make_test_packing(buffers[i], tensor_type_t::float32, tensor_layout_t::nhwc, sizes[i], sizes[i]),
+                norm});
+
+        auto warp = [&]() {
+            if (image.rgba) return warp_affine(pool, image.rgba->view, targets.data(), targets.size());
+            warp_affine(pool, image.yuv->view, targets.data(), targets.size());
+        };
+        auto start = steady_clock::now();
+        for (int i = 0; i < repeat; ++i) warp();
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count() / repeat;
+
+        std::vector<uint8_t> frame{};
+        const image_converter_t converter = image.make_converter(
+            make_test_packing(frame, tensor_type_t::uint8, tensor_layout_t::nhwc, w, h), norm, true);
+        start = steady_clock::now();
+        for (int i = 0; i < repeat; ++i) image.convert(converter, pool);
+        const auto full = duration_cast<nanoseconds>(steady_clock::now() - start).count() / repeat;
+        spdlog::info("{}: layout {} {}x{} threads {} warp {} ns, full frame RGB {} ns", __func__, layout, width,
+                     height, pool.concurrency(), elapsed, full);
+        return static_cast<jlong>(elapsed);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+}  // extern "C"
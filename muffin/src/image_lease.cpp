@@ -0,0 +1,116 @@
+#include "image_lease.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <bit>
+#include <system_error>
+
+image_lease_pool_t::~image_lease_pool_t() noexcept {
+    if (auto remain = count(); remain != 0)
+        spdlog::error("{}: {} leases outlived the reader", "image_lease_pool_t", remain);
+}
+
+uint32_t image_lease_pool_t::count() const noexcept { return std::popcount(outstanding.load()); }
+
+void describe(AImage* image, image_layout_t& layout) noexcept(false) {
+    AImage_getFormat(image, &layout.format);
+    AImage_getWidth(image, &layout.width);
+    AImage_getHeight(image, &layout.height);
+    if (auto ec = AImage_getNumberOfPlanes(image, &layout.plane_count); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImage_getNumberOfPlanes"};
+    layout.plane_count = std::min<int32_t>(layout.plane_count, layout.row_strides.size());
+    for (int i = 0; i < layout.plane_count; ++i) {
+        AImage_getPlaneRowStride(image, i, &layout.row_strides[i]);
+        AImage_getPlanePixelStride(image, i, &layout.pixel_strides[i]);
+    }
+}
+
+/// @brief The same address can be reused for another buffer after the reader frees one
+bool is_same_buffer(const AHardwareBuffer_Desc& lhs, const AHardwareBuffer_Desc& rhs) noexcept {
+    return lhs.width == rhs.width && lhs.height == rhs.height && lhs.format == rhs.format &&
+           lhs.stride == rhs.stride && lhs.layers == rhs.layers && lhs.usage == rhs.usage;
+}
+
+const image_layout_t* image_lease_pool_t::find_layout(AImage* image, uint32_t slot) noexcept(false) {
+    image_layout_t& layout = layouts[slot];
+    AHardwareBuffer* buffer = nullptr;
+    if (AImage_getHardwareBuffer(image, &buffer) != AMEDIA_OK || buffer == nullptr) {
+        layout = image_layout_t{};
+        describe(image, layout);
+        return &layout;
+    }
+    AHardwareBuffer_Desc desc{};
+    AHardwareBuffer_describe(buffer, &desc);  // the image owns the buffer. no acquire/release
+    for (const cache_t& cache : caches) {
+        if (cache.buffer != buffer || is_same_buffer(cache.layout.desc, desc) == false) continue;
+        layout = cache.layout;
+        return &layout;
+    }
+    // first sight of the buffer, or its address is reused. replace the entries in turn
+    cache_t& cache = caches[victim++ % capacity];
+    cache.buffer = buffer;
+    cache.layout = image_layout_t{};
+    cache.layout.desc = desc;
+    describe(image, cache.layout);
+    layout = cache.layout;
+    return &layout;
+}
+
+image_lease_t image_lease_pool_t::lease(AImage* image) noexcept(false) {
+    // find an empty slot. only the acquiring thread sets the bits
+    const uint32_t used = outstanding.load();
+    const uint32_t slot = std::countr_one(used);
+    if (slot >= capacity) {
+        AImage_delete(image);
+        throw std::system_error{ENOBUFS, std::generic_category(), "image_lease_pool_t"};
+    }
+    image_lease_t output{};
+    try {
+        output.layout = find_layout(image, slot);
+    } catch (...) {
+        AImage_delete(image);
+        throw;
+    }
+    AImage_getTimestamp(image, &output.timestamp);
+    output.image = image;
+    output.slot = slot;
+    images[slot] = image;
+    outstanding.fetch_or(1u << slot);
+    return output;
+}
+
+image_lease_t image_lease_pool_t::acquire_latest(AImageReader* reader) noexcept(false) {
+    AImage* image = nullptr;
+    switch (auto ec = AImageReader_acquireLatestImage(reader, &image)) {
+        case AMEDIA_OK:
+            return lease(image);
+        case AMEDIA_IMGREADER_NO_BUFFER_AVAILABLE:
+            return {};
+        default:
+            throw std::system_error{ec, std::generic_category(), "AImageReader_acquireLatestImage"};
+    }
+}
+
+image_lease_t image_lease_pool_t::acquire_next(AImageReader* reader) noexcept(false) {
+    AImage* image = nullptr;
+    switch (auto ec = AImageReader_acquireNextImage(reader, &image)) {
+        case AMEDIA_OK:
+            return lease(image);
+        case AMEDIA_IMGREADER_NO_BUFFER_AVAILABLE:
+            return {};
+        default:
+            throw std::system_error{ec, std::generic_category(), "AImageReader_acquireNextImage"};
+    }
+}
+
+void image_lease_pool_t::release(image_lease_t& lease) noexcept {
+    if (lease.image == nullptr) return;
+    if (lease.slot >= capacity || images[lease.slot] != lease.image) {
+        spdlog::error("{}: {} {}", "image_lease_pool_t", "unknown lease", lease.slot);
+        return;
+    }
+    images[lease.slot] = nullptr;
+    AImage_delete(lease.image);
+    outstanding.fetch_and(~(1u << lease.slot));
+    lease = image_lease_t{};
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <android/hardware_buffer.h>
+#include <media/NdkImage.h>
+#include <media/NdkImageReader.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Layout of the `AImage`. It doesn't change while the reader reuses the same `AHardwareBuffer`
+ */
+struct image_layout_t final {
+    AHardwareBuffer_Desc desc;  // zero if the image doesn't have `AHardwareBuffer`
+    int32_t format;
+    int32_t width;
+    int32_t height;
+    int32_t plane_count;
+    std::array<int32_t, 3> row_strides;
+    std::array<int32_t, 3> pixel_strides;
+};
+
+/**
+ * @brief Non-owning handle of the `AImage` from `image_lease_pool_t`. It must be released to the pool
+ */
+struct image_lease_t final {
+    AImage* image = nullptr;
+    const image_layout_t* layout = nullptr;
+    int64_t timestamp = 0;
+    uint32_t slot = UINT32_MAX;
+
+    explicit operator bool() const noexcept { return image != nullptr; }
+};
+
+/**
+ * @brief Fixed-capacity tracker of the `AImage`s acquired from one `AImageReader`
+ * @details The reader recycles a few `AHardwareBuffer`s, so their descriptions and plane layouts are cached
+ *  when they are seen first. After that, acquiring an image doesn't allocate or touch the buffer's reference count.
+ *  The layout is copied to the lease's slot, so replacing a cache entry doesn't affect the outstanding leases.
+ *  The reader can cycle through more buffers than `capacity`. Then the entries are replaced in turn.
+ *
+ * Acquire from one thread, and release from any thread.
+ * The destructor reports the leases which are not released. The pool must not outlive its reader.
+ */
+class image_lease_pool_t final {
+   public:
+    static constexpr uint32_t capacity = 8;
+
+   private:
+    struct cache_t final {
+        AHardwareBuffer* buffer = nullptr;
+        image_layout_t layout{};
+    };
+
+    std::array<AImage*, capacity> images{};
+    std::array<image_layout_t, capacity> layouts{};  // of `images`. `image_lease_t::layout` points here
+    std::array<cache_t, capacity> caches{};          // accessed only by the acquiring thread
+    std::atomic<uint32_t> outstanding{};             // bitmask of `images`
+    uint32_t victim = 0;                             // next cache entry to replace
+
+   public:
+    image_lease_pool_t() noexcept = default;
+    ~image_lease_pool_t() noexcept;
+    image_lease_pool_t(const image_lease_pool_t&) = delete;
+    image_lease_pool_t(image_lease_pool_t&&) = delete;
+    image_lease_pool_t& operator=(const image_lease_pool_t&) = delete;
+    image_lease_pool_t& operator=(image_lease_pool_t&&) = delete;
+
+   private:
+    /// @brief Fill the `layouts[slot]` from the cache. Describe the image if there is no valid entry
+    const image_layout_t* find_layout(AImage* image, uint32_t slot) noexcept(false);
+    image_lease_t lease(AImage* image) noexcept(false);
+
+   public:
+    /**
+     * @return empty lease if there is no image in the reader
+     * @throw system_error
+     * @see AImageReader_acquireLatestImage
+     */
+    image_lease_t acquire_latest(AImageReader* reader) noexcept(false);
+    /**
+     * @return empty lease if there is no image in the reader
+     * @throw system_error
+     * @see AImageReader_acquireNextImage
+     */
+    image_lease_t acquire_next(AImageReader* reader) noexcept(false);
+
+    /// @brief Delete the image and reset the `lease`
+    void release(image_lease_t& lease) noexcept;
+
+    /// @return number of the leases which are not released
+    uint32_t count() const noexcept;
+};
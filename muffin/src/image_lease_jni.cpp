@@ -0,0 +1,164 @@
+#include <android/native_window.h>
+#include <jni.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include "image_lease.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+
+namespace {
+
+using image_reader_ptr = std::unique_ptr<AImageReader, void (*)(AImageReader*)>;
+
+/// @note The window is owned by the reader
+image_reader_ptr make_reader(int32_t width, int32_t height, int32_t max_images,
+                             ANativeWindow*& window) noexcept(false) {
+    AImageReader* reader = nullptr;
+    if (auto ec = AImageReader_new(width, height, AIMAGE_FORMAT_RGBA_8888, max_images, &reader); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImageReader_new"};
+    image_reader_ptr owner{reader, AImageReader_delete};
+    if (auto ec = AImageReader_getWindow(reader, &window); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImageReader_getWindow"};
+    return owner;
+}
+
+/// @brief Queue the frames. The reader uses a buffer for each frame which is not acquired yet
+void post_frames(ANativeWindow* window, int32_t count) noexcept(false) {
+    for (int32_t i = 0; i < count; ++i) {
+        ANativeWindow_Buffer buffer{};
+        if (auto ec = ANativeWindow_lock(window, &buffer, nullptr); ec != 0)
+            throw std::system_error{-ec, std::system_category(), "ANativeWindow_lock"};
+        std::memset(buffer.bits, i, static_cast<size_t>(buffer.stride) * 4);
+        ANativeWindow_unlockAndPost(window);
+    }
+}
+
+/// @brief The lease's layout must be the same with the one of its image, queried now
+void check_layout(const image_lease_t& lease) noexcept(false) {
+    AHardwareBuffer* buffer = nullptr;
+    if (auto ec = AImage_getHardwareBuffer(lease.image, &buffer); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImage_getHardwareBuffer"};
+    image_layout_t expected{};
+    AHardwareBuffer_describe(buffer, &expected.desc);
+    AImage_getFormat(lease.image, &expected.format);
+    AImage_getWidth(lease.image, &expected.width);
+    AImage_getHeight(lease.image, &expected.height);
+    AImage_getNumberOfPlanes(lease.image, &expected.plane_count);
+    const image_layout_t& layout = *lease.layout;
+    bool same = layout.desc.width == expected.desc.width && layout.desc.height == expected.desc.height &&
+                layout.desc.format == expected.desc.format && layout.desc.stride == expected.desc.stride &&
+                layout.format == expected.format && layout.width == expected.width &&
+                layout.height == expected.height && layout.plane_count == expected.plane_count;
+    for (int32_t i = 0; same && i < layout.plane_count; ++i) {
+        AImage_getPlaneRowStride(lease.image, i, &expected.row_strides[i]);
+        AImage_getPlanePixelStride(lease.image, i, &expected.pixel_strides[i]);
+        same = layout.row_strides[i] == expected.row_strides[i] && layout.pixel_strides[i] == expected.pixel_strides[i];
+    }
+    if (same == false) throw std::runtime_error{"the layout of the lease is not the one of its image"};
+}
+
+}  // namespace
+
+extern "C" {
+
+/**
+ * @brief Queue `count` frames to a reader, and then acquire them while `hold` leases are outstanding
+ * @return number of the distinct `AHardwareBuffer`s. Must be larger than the pool's capacity
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_ImageLeaseTest_cycleBuffers(JNIEnv* env, jclass, jint count, jint hold) {
+    try {
+        ANativeWindow* window = nullptr;
+        image_reader_ptr reader = make_reader(64, 64, count + 2, window);
+        // all frames are queued before the acquire, so the reader uses a buffer for each
+        post_frames(window, count);
+
+        image_lease_pool_t pool{};
+        std::deque<image_lease_t> leases{};
+        std::vector<AHardwareBuffer*> buffers{};
+        for (jint i = 0; i < count; ++i) {
+            image_lease_t lease = pool.acquire_next(reader.get());
+            if (!lease) throw std::runtime_error{"the reader has no image"};
+            AHardwareBuffer* buffer = nullptr;
+            AImage_getHardwareBuffer(lease.image, &buffer);
+            if (std::find(buffers.begin(), buffers.end(), buffer) == buffers.end()) buffers.emplace_back(buffer);
+            check_layout(lease);
+            leases.emplace_back(lease);
+            if (leases.size() <= static_cast<size_t>(hold)) continue;
+            // the cache entries may be replaced after the lease is acquired
+            check_layout(leases.front());
+            pool.release(leases.front());
+            leases.pop_front();
+        }
+        for (image_lease_t& lease : leases) {
+            check_layout(lease);
+            pool.release(lease);
+        }
+        return static_cast<jint>(buffers.size());
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+/**
+ * @brief Fill the pool's cache with the buffers of 2 readers of the different sizes. Then keep a lease of the 1st
+ *  reader while a new buffer of the 2nd reader replaces a cache entry
+ * @return false if the 1st reader didn't reuse its buffer. The case doesn't replace the lease's entry
+ */
+JNIEXPORT jboolean Java_dev_luncliff_muffin_ImageLeaseTest_replaceCachedEntry(JNIEnv* env, jclass) {
+    try {
+        ANativeWindow* window0 = nullptr;
+        ANativeWindow* window1 = nullptr;
+        image_reader_ptr reader0 = make_reader(64, 64, 2, window0);
+        image_reader_ptr reader1 = make_reader(96, 48, image_lease_pool_t::capacity + 2, window1);
+        image_lease_pool_t pool{};
+        auto acquire = [&pool](AImageReader* reader) {
+            image_lease_t lease = pool.acquire_next(reader);
+            if (!lease) throw std::runtime_error{"the reader has no image"};
+            check_layout(lease);
+            return lease;
+        };
+        auto get_buffer = [](const image_lease_t& lease) {
+            AHardwareBuffer* buffer = nullptr;
+            AImage_getHardwareBuffer(lease.image, &buffer);
+            return buffer;
+        };
+        // the 1st entry
+        post_frames(window0, 1);
+        image_lease_t lease0 = acquire(reader0.get());
+        AHardwareBuffer* first = get_buffer(lease0);
+        pool.release(lease0);
+        // the other entries
+        post_frames(window1, image_lease_pool_t::capacity);
+        for (uint32_t i = 0; i < image_lease_pool_t::capacity - 1; ++i) {
+            image_lease_t lease = acquire(reader1.get());
+            pool.release(lease);
+        }
+        // the 1st reader reuses its free buffer. the lease uses the 1st entry
+        post_frames(window0, 1);
+        lease0 = acquire(reader0.get());
+        const bool reused = get_buffer(lease0) == first;
+        // the next new buffer replaces the 1st entry
+        image_lease_t lease1 = acquire(reader1.get());
+        check_layout(lease0);
+        check_layout(lease1);
+        pool.release(lease1);
+        pool.release(lease0);
+        return reused;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return false;
+    }
+}
+
+}  // extern "C"
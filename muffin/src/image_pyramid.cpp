@@ -0,0 +1,270 @@
+#include "image_pyramid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+yuv_view_t pyramid_level_t::view() const noexcept { return yuv_view_t{y, u, v}; }
+
+namespace {
+
+constexpr size_t arena_alignment = 64;
+
+size_t align_up(size_t value, size_t alignment) noexcept { return (value + alignment - 1) / alignment * alignment; }
+
+/// @brief Fixed point bilinear resize of a 8-bit plane
+void resample_plane(plane_view_t<const uint8_t> src, const image_pyramid_t::axis_t& rows,
+                    const image_pyramid_t::axis_t& columns, plane_view_t<uint8_t> dst, index_range_t range) noexcept {
+    for (auto r = range.begin; r < range.end; ++r) {
+        const uint8_t* s0 = src.row(rows.index0[r]);
+        const uint8_t* s1 = src.row(rows.index1[r]);
+        const uint32_t wy = rows.weight[r];
+        uint8_t* out = dst.row(r);
+        for (size_t c = 0; c < dst.width; ++c) {
+            const uint32_t x0 = columns.index0[c] * src.pixel_stride;
+            const uint32_t x1 = columns.index1[c] * src.pixel_stride;
+            const uint32_t wx = columns.weight[c];
+            const uint32_t top = s0[x0] * (256 - wx) + s0[x1] * wx;
+            const uint32_t bottom = s1[x0] * (256 - wx) + s1[x1] * wx;
+            out[c] = static_cast<uint8_t>((top * (256 - wy) + bottom * wy + 32768) >> 16);
+        }
+    }
+}
+
+/// @brief Chroma rows for the luma rows. `rows.begin` must be even
+index_range_t get_chroma_rows(index_range_t rows, uint32_t height) noexcept {
+    const size_t end = rows.end >= height ? (height + 1) / 2 : rows.end / 2;
+    return index_range_t{rows.begin / 2, end};
+}
+
+#if defined(__SSE4_1__)
+
+/// @return 8 averages of the 2x2 pixels in `row0` and `row1`
+__m128i box8(__m128i row0, __m128i row1) noexcept {
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i sum = _mm_add_epi16(_mm_maddubs_epi16(row0, ones), _mm_maddubs_epi16(row1, ones));
+    const __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+    return _mm_packus_epi16(average, average);
+}
+
+__m128i load16(const uint8_t* src) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)); }
+
+/// @return 16 even bytes of 32 bytes
+__m128i load16_even(const uint8_t* src) noexcept {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    return _mm_packus_epi16(_mm_and_si128(load16(src), mask), _mm_and_si128(load16(src + 16), mask));
+}
+
+void store8(uint8_t* dst, __m128i value) noexcept { _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), value); }
+
+/// @return 2 pixels. 2x2 averages of the 4 RGBA pixels in `row0` and `row1`
+__m128i box_rgba2(__m128i row0, __m128i row1) noexcept {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(row0, zero), _mm_unpacklo_epi8(row1, zero));
+    const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(row0, zero), _mm_unpackhi_epi8(row1, zero));
+    const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+/// @brief 4 RGBA pixels from 8 pixels of 2 rows
+void downscale_rgba4(const uint8_t* s0, const uint8_t* s1, uint8_t* dst) noexcept {
+    const __m128i first = box_rgba2(load16(s0), load16(s1));
+    const __m128i second = box_rgba2(load16(s0 + 16), load16(s1 + 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(first, second));
+}
+
+#elif defined(__ARM_NEON)
+
+uint8x8_t box8(uint8x16_t row0, uint8x16_t row1) noexcept {
+    return vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(row0), row1), 2);
+}
+
+uint8x16_t load16(const uint8_t* src) noexcept { return vld1q_u8(src); }
+
+uint8x16_t load16_even(const uint8_t* src) noexcept { return vld2q_u8(src).val[0]; }
+
+void store8(uint8_t* dst, uint8x8_t value) noexcept { vst1_u8(dst, value); }
+
+void downscale_rgba4(const uint8_t* s0, const uint8_t* s1, uint8_t* dst) noexcept {
+    // even and odd pixels
+    const uint32x4x2_t p0 = vld2q_u32(reinterpret_cast<const uint32_t*>(s0));
+    const uint32x4x2_t p1 = vld2q_u32(reinterpret_cast<const uint32_t*>(s1));
+    const uint8x16_t e0 = vreinterpretq_u8_u32(p0.val[0]), o0 = vreinterpretq_u8_u32(p0.val[1]);
+    const uint8x16_t e1 = vreinterpretq_u8_u32(p1.val[0]), o1 = vreinterpretq_u8_u32(p1.val[1]);
+    const uint16x8_t lo =
+        vaddq_u16(vaddl_u8(vget_low_u8(e0), vget_low_u8(o0)), vaddl_u8(vget_low_u8(e1), vget_low_u8(o1)));
+    const uint16x8_t hi =
+        vaddq_u16(vaddl_u8(vget_high_u8(e0), vget_high_u8(o0)), vaddl_u8(vget_high_u8(e1), vget_high_u8(o1)));
+    vst1q_u8(dst, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+}
+
+#endif
+
+}  // namespace
+
+void make_resize_axis(image_pyramid_t::axis_t& axis, uint32_t src_size, uint32_t dst_size) noexcept(false) {
+    axis.index0.resize(dst_size);
+    axis.index1.resize(dst_size);
+    axis.weight.resize(dst_size);
+    const float scale = static_cast<float>(src_size) / static_cast<float>(dst_size);
+    const float limit = static_cast<float>(src_size - 1);
+    for (uint32_t i = 0; i < dst_size; ++i) {
+        const float s = std::clamp((static_cast<float>(i) + 0.5f) * scale - 0.5f, 0.0f, limit);
+        const auto i0 = static_cast<uint32_t>(s);
+        axis.index0[i] = i0;
+        axis.index1[i] = std::min(i0 + 1, src_size - 1);
+        axis.weight[i] = static_cast<uint16_t>(std::lround((s - static_cast<float>(i0)) * 256));
+    }
+}
+
+void downscale_plane_2x(plane_view_t<const uint8_t> src, plane_view_t<uint8_t> dst, index_range_t rows) noexcept {
+    const int32_t src_pixel_stride = src.pixel_stride;
+    const uint32_t src_width = src.width, dst_width = dst.width;
+    for (auto r = rows.begin; r < rows.end; ++r) {
+        const uint8_t* s0 = src.row(2 * r);
+        const uint8_t* s1 = src.row(std::min<size_t>(2 * r + 1, src.height - 1));
+        uint8_t* out = dst.row(r);
+        uint32_t c = 0;
+#if defined(__SSE4_1__) || defined(__ARM_NEON)
+        if (src_pixel_stride == 1) {
+            for (; 2 * c + 16 <= src_width && c + 8 <= dst_width; c += 8)
+                store8(out + c, box8(load16(s0 + 2 * c), load16(s1 + 2 * c)));
+        } else if (src_pixel_stride == 2) {
+            // the last 32 bytes end at the other channel of the next pixel
+            for (; 2 * c + 17 <= src_width && c + 8 <= dst_width; c += 8)
+                store8(out + c, box8(load16_even(s0 + 4 * c), load16_even(s1 + 4 * c)));
+        }
+#endif
+        for (; c < dst_width; ++c) {
+            const uint32_t x0 = 2 * c * src_pixel_stride;
+            const uint32_t x1 = std::min(2 * c + 1, src_width - 1) * src_pixel_stride;
+            out[c] = static_cast<uint8_t>((s0[x0] + s0[x1] + s1[x0] + s1[x1] + 2) >> 2);
+        }
+    }
+}
+
+void downscale_rgba_2x(plane_view_t<const uint8_t> src, plane_view_t<uint8_t> dst, index_range_t rows) noexcept {
+    const uint32_t src_width = src.width, dst_width = dst.width;
+    for (auto r = rows.begin; r < rows.end; ++r) {
+        const uint8_t* s0 = src.row(2 * r);
+        const uint8_t* s1 = src.row(std::min<size_t>(2 * r + 1, src.height - 1));
+        uint8_t* out = dst.row(r);
+        uint32_t c = 0;
+#if defined(__SSE4_1__) || defined(__ARM_NEON)
+        for (; 2 * c + 8 <= src_width && c + 4 <= dst_width; c += 4)
+            downscale_rgba4(s0 + 8 * c, s1 + 8 * c, out + 4 * c);
+#endif
+        for (; c < dst_width; ++c) {
+            const uint32_t x0 = 2 * c * 4;
+            const uint32_t x1 = std::min(2 * c + 1, src_width - 1) * 4;
+            for (uint32_t k = 0; k < 4; ++k)
+                out[4 * c + k] = static_cast<uint8_t>((s0[x0 + k] + s0[x1 + k] + s1[x0 + k] + s1[x1 + k] + 2) >> 2);
+        }
+    }
+}
+
+image_pyramid_t::image_pyramid_t(uint32_t width, uint32_t height, uint32_t count, float scale) noexcept(false)
+    : width{width}, height{height} {
+    if (count == 0) throw std::invalid_argument{"image_pyramid_t: no level"};
+    if (!(scale > 0 && scale < 1)) throw std::invalid_argument{"image_pyramid_t: scale must be in (0, 1)"};
+    const bool halve = scale == 0.5f;
+    levels.resize(count);
+    size_t total = 0;
+    uint32_t w = width, h = height;
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t next_w = halve ? w / 2 : static_cast<uint32_t>(std::lround(w * scale));
+        const uint32_t next_h = halve ? h / 2 : static_cast<uint32_t>(std::lround(h * scale));
+        if (next_w == 0 || next_h == 0) throw std::invalid_argument{"image_pyramid_t: too many levels"};
+        if (halve == false) {
+            make_resize_axis(rows.emplace_back(), h, next_h);
+            make_resize_axis(rows.emplace_back(), (h + 1) / 2, (next_h + 1) / 2);
+            make_resize_axis(columns.emplace_back(), w, next_w);
+            make_resize_axis(columns.emplace_back(), (w + 1) / 2, (next_w + 1) / 2);
+        }
+        w = next_w;
+        h = next_h;
+        const uint32_t cw = (w + 1) / 2, ch = (h + 1) / 2;
+        const auto y_stride = static_cast<int32_t>(align_up(w, 16));
+        const auto uv_stride = static_cast<int32_t>(align_up(cw, 16));
+        // keep the offsets until the arena is allocated
+        pyramid_level_t& level = levels[i];
+        level.y = plane_view_t<uint8_t>{reinterpret_cast<uint8_t*>(total), w, h, y_stride, 1};
+        total = align_up(total + y_stride * h, arena_alignment);
+        level.u = plane_view_t<uint8_t>{reinterpret_cast<uint8_t*>(total), cw, ch, uv_stride, 1};
+        total = align_up(total + uv_stride * ch, arena_alignment);
+        level.v = plane_view_t<uint8_t>{reinterpret_cast<uint8_t*>(total), cw, ch, uv_stride, 1};
+        total = align_up(total + uv_stride * ch, arena_alignment);
+    }
+    large_buffer_options_t options{};
+    options.alignment = arena_alignment;
+    options.budget = &get_memory_budget("images");
+    arena = large_buffer_t{total, options};
+    const auto base = reinterpret_cast<uintptr_t>(arena.data());
+    for (pyramid_level_t& level : levels)
+        for (plane_view_t<uint8_t>* plane : {&level.y, &level.u, &level.v})
+            plane->data = reinterpret_cast<uint8_t*>(base + reinterpret_cast<uintptr_t>(plane->data));
+    if (halve) {
+        // each band of the last level must have even rows for its chroma
+        const uint32_t unit = 1u << count;
+        const size_t rows_in_cache = 64 * 1024 / levels[0].y.row_stride;
+        band = static_cast<uint32_t>(std::max<size_t>(align_up(rows_in_cache, unit), unit));
+    }
+}
+
+void image_pyramid_t::build_band(const yuv_view_t& src, uint32_t index) noexcept {
+    yuv_view_t prev = src;
+    for (uint32_t i = 0; i < levels.size(); ++i) {
+        const pyramid_level_t& level = levels[i];
+        const size_t begin = (static_cast<size_t>(index) * band) >> i;
+        const size_t end = std::min<size_t>((static_cast<size_t>(index + 1) * band) >> i, level.y.height);
+        if (begin >= end) break;
+        const index_range_t luma{begin, end};
+        const index_range_t chroma = get_chroma_rows(luma, level.y.height);
+        downscale_plane_2x(prev.y, level.y, luma);
+        downscale_plane_2x(prev.u, level.u, chroma);
+        downscale_plane_2x(prev.v, level.v, chroma);
+        prev = level.view();
+    }
+}
+
+void image_pyramid_t::build_level(const yuv_view_t& src, uint32_t index, index_range_t range) noexcept {
+    const pyramid_level_t& level = levels[index];
+    const index_range_t chroma = get_chroma_rows(range, level.y.height);
+    resample_plane(src.y, rows[2 * index], columns[2 * index], level.y, range);
+    resample_plane(src.u, rows[2 * index + 1], columns[2 * index + 1], level.u, chroma);
+    resample_plane(src.v, rows[2 * index + 1], columns[2 * index + 1], level.v, chroma);
+}
+
+void image_pyramid_t::build(thread_pool_t& pool, const yuv_view_t& src) noexcept(false) {
+    if (src.width() != width || src.height() != height)
+        throw std::invalid_argument{"image_pyramid_t: frame size is different"};
+    if (band) {
+        const size_t bands = (levels[0].y.height + band - 1) / band;
+        return pool.parallel_for({0, bands}, 1, [&](index_range_t chunk) {
+            for (auto i = chunk.begin; i < chunk.end; ++i) build_band(src, static_cast<uint32_t>(i));
+        });
+    }
+    yuv_view_t prev = src;
+    for (uint32_t i = 0; i < levels.size(); ++i) {
+        // even grain for the chroma rows
+        pool.parallel_for({0, levels[i].y.height}, 16, [&](index_range_t chunk) { build_level(prev, i, chunk); });
+        prev = levels[i].view();
+    }
+}
+
+uint32_t image_pyramid_t::count() const noexcept { return static_cast<uint32_t>(levels.size()); }
+
+const pyramid_level_t& image_pyramid_t::level(uint32_t index) const noexcept { return levels[index]; }
+
+const pyramid_level_t& image_pyramid_t::select(uint32_t width, uint32_t height) const noexcept {
+    for (auto it = levels.rbegin(); it != levels.rend(); ++it)
+        if (it->y.width >= width && it->y.height >= height) return *it;
+    return levels.front();
+}
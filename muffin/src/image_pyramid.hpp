@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "image_view.hpp"
+#include "large_buffer.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief I420 image in the `image_pyramid_t`'s arena
+ */
+struct pyramid_level_t final {
+    plane_view_t<uint8_t> y;
+    plane_view_t<uint8_t> u;
+    plane_view_t<uint8_t> v;
+
+    /// @brief The level can be the source of `convert_yuv_to_rgb`
+    yuv_view_t view() const noexcept;
+};
+
+/**
+ * @brief Downscaled levels of a camera frame for the multi-scale detection
+ * @details The frame is read only once. Each level is made from the previous level, not from the frame.
+ *
+ * With the 2x scale, each level is a 2x2 box filter of the previous one. The frame is split into row bands, and
+ * all levels of a band are made while the band is in the cache. The bands run in parallel on the `thread_pool_t`.
+ * With other scales, each level is a bilinear resize of the previous one, and the levels are made one by one.
+ *
+ * All levels are in one arena allocated in the constructor. Build again for the next frame of the same size.
+ *
+ * ```cpp
+ * image_pyramid_t pyramid{1920, 1080, 4};
+ * pyramid.build(pool, make_yuv_view(lease));
+ * const yuv_view_t level = pyramid.select(128, 128).view();
+ * yuv_resize_plan_t plan{level, 128, 128};
+ * convert_yuv_to_rgb(pool, level, plan, norm, input);
+ * ```
+ */
+class image_pyramid_t final {
+   public:
+    /// @brief Source index(in pixels) of 2 taps and the weight of the second one in 1/256
+    struct axis_t final {
+        std::vector<uint32_t> index0;
+        std::vector<uint32_t> index1;
+        std::vector<uint16_t> weight;
+    };
+
+   private:
+    large_buffer_t arena{};
+    std::vector<pyramid_level_t> levels{};
+    std::vector<axis_t> rows{};     // for the arbitrary scale. 2 for each level(luma, chroma)
+    std::vector<axis_t> columns{};  // for the arbitrary scale. 2 for each level(luma, chroma)
+    uint32_t width;
+    uint32_t height;
+    uint32_t band = 0;  // rows of the first level in each band. 0 if the scale is not 2x
+
+   public:
+    /**
+     * @param width width of the frame
+     * @param count number of the levels. The frame itself is not a level
+     * @param scale ratio of the sizes between the levels. 0.5 for the 2x pyramid
+     * @throw invalid_argument if a level becomes empty or the `scale` is not in (0, 1)
+     */
+    image_pyramid_t(uint32_t width, uint32_t height, uint32_t count, float scale = 0.5f) noexcept(false);
+    ~image_pyramid_t() noexcept = default;
+    image_pyramid_t(const image_pyramid_t&) = delete;
+    image_pyramid_t(image_pyramid_t&&) = delete;
+    image_pyramid_t& operator=(const image_pyramid_t&) = delete;
+    image_pyramid_t& operator=(image_pyramid_t&&) = delete;
+
+   private:
+    void build_band(const yuv_view_t& src, uint32_t index) noexcept;
+    void build_level(const yuv_view_t& src, uint32_t index, index_range_t rows) noexcept;
+
+   public:
+    /**
+     * @param src frame with the same size with the constructor
+     * @throw invalid_argument if the `src` has different size
+     * @note If it's invoked in the pool's worker, it runs in the thread. @see thread_pool_t
+     */
+    void build(thread_pool_t& pool, const yuv_view_t& src) noexcept(false);
+
+    uint32_t count() const noexcept;
+    const pyramid_level_t& level(uint32_t index) const noexcept;
+
+    /**
+     * @return the smallest level which is not smaller than the size. The first level if there is no such level
+     */
+    const pyramid_level_t& select(uint32_t width, uint32_t height) const noexcept;
+};
+
+/**
+ * @brief 2x2 box filter of a 8-bit plane. The last row/column of the odd size is repeated
+ * @param src SIMD is used if its `pixel_stride` is 1 or 2(U/V of NV12/NV21)
+ * @param dst its `pixel_stride` must be 1
+ * @param rows rows of the `dst`
+ */
+void downscale_plane_2x(plane_view_t<const uint8_t> src, plane_view_t<uint8_t> dst, index_range_t rows) noexcept;
+
+/**
+ * @brief 2x2 box filter of RGBA/RGBX pixels. The last row/column of the odd size is repeated
+ * @param src its `pixel_stride` must be 4
+ * @param dst its `pixel_stride` must be 4
+ * @param rows rows of the `dst`
+ */
+void downscale_rgba_2x(plane_view_t<const uint8_t> src, plane_view_t<uint8_t> dst, index_range_t rows) noexcept;
+
+/**
+ * @brief Bilinear taps of the center-aligned resize. The weight is in 1/256
+ * @throw bad_alloc
+ */
+void make_resize_axis(image_pyramid_t::axis_t& axis, uint32_t src_size, uint32_t dst_size) noexcept(false);
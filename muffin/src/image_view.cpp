@@ -0,0 +1,150 @@
+#include "image_view.hpp"
+
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+yuv_view_t make_semi_planar_view(const uint8_t* data, uint32_t width, uint32_t height, bool nv21) noexcept {
+    const uint32_t cw = (width + 1) / 2, ch = (height + 1) / 2;
+    const uint8_t* chroma = data + static_cast<size_t>(width) * height;
+    const int32_t chroma_stride = static_cast<int32_t>(cw * 2);
+    yuv_view_t view{};
+    view.y = plane_view_t<const uint8_t>{data, width, height, static_cast<int32_t>(width), 1};
+    view.u = plane_view_t<const uint8_t>{chroma + (nv21 ? 1 : 0), cw, ch, chroma_stride, 2};
+    view.v = plane_view_t<const uint8_t>{chroma + (nv21 ? 0 : 1), cw, ch, chroma_stride, 2};
+    return view;
+}
+
+}  // namespace
+
+yuv_view_t make_i420_view(const uint8_t* data, uint32_t width, uint32_t height) noexcept {
+    const uint32_t cw = (width + 1) / 2, ch = (height + 1) / 2;
+    const uint8_t* u = data + static_cast<size_t>(width) * height;
+    yuv_view_t view{};
+    view.y = plane_view_t<const uint8_t>{data, width, height, static_cast<int32_t>(width), 1};
+    view.u = plane_view_t<const uint8_t>{u, cw, ch, static_cast<int32_t>(cw), 1};
+    view.v = plane_view_t<const uint8_t>{u + cw * ch, cw, ch, static_cast<int32_t>(cw), 1};
+    return view;
+}
+
+yuv_view_t make_nv12_view(const uint8_t* data, uint32_t width, uint32_t height) noexcept {
+    return make_semi_planar_view(data, width, height, false);
+}
+
+yuv_view_t make_nv21_view(const uint8_t* data, uint32_t width, uint32_t height) noexcept {
+    return make_semi_planar_view(data, width, height, true);
+}
+
+rgba_view_t make_rgba_view(const uint8_t* data, uint32_t width, uint32_t height, int32_t row_stride) noexcept {
+    if (row_stride == 0) row_stride = static_cast<int32_t>(width * 4);
+    return rgba_view_t{plane_view_t<const uint8_t>{data, width, height, row_stride, 4}};
+}
+
+#if defined(__ANDROID__)
+
+namespace {
+
+const uint8_t* get_plane_data(AImage* image, int index) noexcept(false) {
+    uint8_t* data = nullptr;
+    int length = 0;
+    if (auto ec = AImage_getPlaneData(image, index, &data, &length); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImage_getPlaneData"};
+    return data;
+}
+
+int32_t get_format(AImage* image) noexcept(false) {
+    int32_t format = 0;
+    if (auto ec = AImage_getFormat(image, &format); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImage_getFormat"};
+    return format;
+}
+
+tile_t get_crop(AImage* image, uint32_t width, uint32_t height) noexcept(false) {
+    AImageCropRect rect{};
+    if (auto ec = AImage_getCropRect(image, &rect); ec != AMEDIA_OK)
+        throw std::system_error{ec, std::generic_category(), "AImage_getCropRect"};
+    if (rect.right <= rect.left || rect.bottom <= rect.top) return tile_t{0, 0, width, height};
+    return tile_t{static_cast<uint32_t>(rect.left), static_cast<uint32_t>(rect.top),
+                  static_cast<uint32_t>(rect.right - rect.left), static_cast<uint32_t>(rect.bottom - rect.top)};
+}
+
+yuv_view_t make_yuv_view(AImage* image, const image_layout_t& layout) noexcept(false) {
+    if (layout.format != AIMAGE_FORMAT_YUV_420_888) throw std::invalid_argument{"image is not YUV_420_888"};
+    const auto width = static_cast<uint32_t>(layout.width), height = static_cast<uint32_t>(layout.height);
+    const uint32_t cw = (width + 1) / 2, ch = (height + 1) / 2;
+    yuv_view_t view{};
+    view.y = plane_view_t<const uint8_t>{get_plane_data(image, 0), width, height, layout.row_strides[0],
+                                         layout.pixel_strides[0]};
+    view.u = plane_view_t<const uint8_t>{get_plane_data(image, 1), cw, ch, layout.row_strides[1],
+                                         layout.pixel_strides[1]};
+    view.v = plane_view_t<const uint8_t>{get_plane_data(image, 2), cw, ch, layout.row_strides[2],
+                                         layout.pixel_strides[2]};
+    return view;
+}
+
+}  // namespace
+
+yuv_view_t make_yuv_view(AImage* image) noexcept(false) {
+    image_layout_t layout{};
+    layout.format = get_format(image);
+    AImage_getWidth(image, &layout.width);
+    AImage_getHeight(image, &layout.height);
+    for (int i = 0; i < 3; ++i) {
+        AImage_getPlaneRowStride(image, i, &layout.row_strides[i]);
+        AImage_getPlanePixelStride(image, i, &layout.pixel_strides[i]);
+    }
+    const yuv_view_t view = make_yuv_view(image, layout);
+    return view.crop(get_crop(image, view.width(), view.height()));
+}
+
+yuv_view_t make_yuv_view(const image_lease_t& lease) noexcept(false) {
+    return make_yuv_view(lease.image, *lease.layout);
+}
+
+rgba_view_t make_rgba_view(AImage* image) noexcept(false) {
+    const int32_t format = get_format(image);
+    if (format != AIMAGE_FORMAT_RGBA_8888 && format != AIMAGE_FORMAT_RGBX_8888)
+        throw std::invalid_argument{"image is not RGBA_8888"};
+    int32_t width = 0, height = 0, row_stride = 0;
+    AImage_getWidth(image, &width);
+    AImage_getHeight(image, &height);
+    AImage_getPlaneRowStride(image, 0, &row_stride);
+    const rgba_view_t view = make_rgba_view(get_plane_data(image, 0), static_cast<uint32_t>(width),
+                                            static_cast<uint32_t>(height), row_stride);
+    return view.crop(get_crop(image, view.width(), view.height()));
+}
+
+rgba_view_t make_rgba_view(const ndk_hardware_buffer_t& buffer, const void* mapping) noexcept(false) {
+    AHardwareBuffer_Desc desc{};
+    buffer.get(desc);
+    if (desc.format != AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM && desc.format != AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM)
+        throw std::invalid_argument{"buffer is not R8G8B8A8"};
+    // `stride` is in pixels
+    return make_rgba_view(static_cast<const uint8_t*>(mapping), desc.width, desc.height,
+                          static_cast<int32_t>(desc.stride * 4));
+}
+
+yuv_view_t make_yuv_view(const ndk_hardware_buffer_t::scoped_lock_t& mapping) noexcept(false) {
+    const AHardwareBuffer_Desc& desc = mapping.describe();
+    if (desc.format != AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420 || mapping.plane_count() < 3)
+        throw std::invalid_argument{"buffer is not Y8Cb8Cr8_420"};
+    auto make_plane = [&mapping](uint32_t index, uint32_t width, uint32_t height) {
+        const ndk_hardware_buffer_t::plane_t& plane = mapping.plane(index);
+        return plane_view_t<const uint8_t>{plane.data, width, height, static_cast<int32_t>(plane.row_stride),
+                                           static_cast<int32_t>(plane.pixel_stride)};
+    };
+    const uint32_t width = (desc.width + 1) / 2, height = (desc.height + 1) / 2;
+    return yuv_view_t{make_plane(0, desc.width, desc.height), make_plane(1, width, height),
+                      make_plane(2, width, height)};
+}
+
+rgba_view_t make_rgba_view(const ndk_hardware_buffer_t::scoped_lock_t& mapping) noexcept(false) {
+    const AHardwareBuffer_Desc& desc = mapping.describe();
+    if (desc.format != AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM && desc.format != AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM)
+        throw std::invalid_argument{"buffer is not R8G8B8A8"};
+    const ndk_hardware_buffer_t::plane_t& plane = mapping.plane(0);
+    return make_rgba_view(plane.data, desc.width, desc.height, static_cast<int32_t>(plane.row_stride));
+}
+
+#endif
@@ -0,0 +1,163 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+#include "thread_pool.hpp"
+
+#if defined(__ANDROID__)
+#include <media/NdkImage.h>
+
+#include "image_lease.hpp"
+#include "ndk_buffer.hpp"
+#endif
+
+/**
+ * @brief Formats of the `image_view_t`. Same values with `AIMAGE_FORMAT_*`
+ */
+enum class pixel_format_t : int32_t {
+    rgba_8888 = 0x1,
+    rgbx_8888 = 0x2,
+    rgb_888 = 0x3,
+    y8 = 0x20203859,
+    yuv_420_888 = 0x23,
+};
+
+constexpr int32_t get_bytes_per_pixel(pixel_format_t format) noexcept {
+    switch (format) {
+        case pixel_format_t::rgba_8888:
+        case pixel_format_t::rgbx_8888:
+            return 4;
+        case pixel_format_t::rgb_888:
+            return 3;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * @brief Non-owning view of a 8-bit plane. `row_stride` and `pixel_stride` are in bytes
+ * @tparam T `const uint8_t` for the source, `uint8_t` for the destination
+ */
+template <typename T>
+struct plane_view_t final {
+    static_assert(sizeof(T) == 1);
+
+    T* data;
+    uint32_t width;
+    uint32_t height;
+    int32_t row_stride;
+    int32_t pixel_stride;
+
+   public:
+    T* row(size_t y) const noexcept { return data + y * row_stride; }
+    T& at(size_t x, size_t y) const noexcept { return data[y * row_stride + x * pixel_stride]; }
+
+    /// @brief Zero-copy subregion. The `area` must be in the plane
+    plane_view_t crop(tile_t area) const noexcept {
+        return plane_view_t{&at(area.x, area.y), area.width, area.height, row_stride, pixel_stride};
+    }
+
+    /// @note `plane_view_t<uint8_t>` can be used as `plane_view_t<const uint8_t>`
+    template <typename U = T, typename = std::enable_if_t<!std::is_const_v<U>>>
+    operator plane_view_t<const U>() const noexcept {
+        return plane_view_t<const U>{data, width, height, row_stride, pixel_stride};
+    }
+};
+
+/**
+ * @brief Non-owning view of the interleaved image. RGBA, RGBX, RGB, and Y8
+ */
+template <pixel_format_t F>
+struct image_view_t final {
+    static constexpr pixel_format_t format = F;
+    static constexpr int32_t bytes_per_pixel = get_bytes_per_pixel(F);
+
+    plane_view_t<const uint8_t> plane;
+
+   public:
+    uint32_t width() const noexcept { return plane.width; }
+    uint32_t height() const noexcept { return plane.height; }
+    image_view_t crop(tile_t area) const noexcept { return image_view_t{plane.crop(area)}; }
+};
+
+/**
+ * @brief Non-owning view of `AIMAGE_FORMAT_YUV_420_888`
+ * @details I420, NV12 and NV21 are described with the strides and the U/V pointers.
+ *  - I420: `pixel_stride` of U/V is 1
+ *  - NV12: `pixel_stride` of U/V is 2 and `v.data == u.data + 1`
+ *  - NV21: `pixel_stride` of U/V is 2 and `u.data == v.data + 1`
+ */
+template <>
+struct image_view_t<pixel_format_t::yuv_420_888> final {
+    static constexpr pixel_format_t format = pixel_format_t::yuv_420_888;
+
+    plane_view_t<const uint8_t> y;
+    plane_view_t<const uint8_t> u;
+    plane_view_t<const uint8_t> v;
+
+   public:
+    uint32_t width() const noexcept { return y.width; }
+    uint32_t height() const noexcept { return y.height; }
+
+    /**
+     * @brief Zero-copy subregion. The offset is rounded down to even to keep the chroma aligned
+     * @note The size is extended to cover the `area` after the rounding
+     */
+    image_view_t crop(tile_t area) const noexcept {
+        const uint32_t x = area.x & ~1u, y0 = area.y & ~1u;
+        const tile_t luma{x, y0, area.width + (area.x - x), area.height + (area.y - y0)};
+        const tile_t chroma{x / 2, y0 / 2, (luma.width + 1) / 2, (luma.height + 1) / 2};
+        return image_view_t{y.crop(luma), u.crop(chroma), v.crop(chroma)};
+    }
+};
+
+using yuv_view_t = image_view_t<pixel_format_t::yuv_420_888>;
+using rgba_view_t = image_view_t<pixel_format_t::rgba_8888>;
+
+/// @brief Views of the host memory. The chroma rows are `(width + 1) / 2` pixels right after the luma
+yuv_view_t make_i420_view(const uint8_t* data, uint32_t width, uint32_t height) noexcept;
+yuv_view_t make_nv12_view(const uint8_t* data, uint32_t width, uint32_t height) noexcept;
+yuv_view_t make_nv21_view(const uint8_t* data, uint32_t width, uint32_t height) noexcept;
+
+/// @param row_stride bytes of each row. 0 for `width * 4`
+rgba_view_t make_rgba_view(const uint8_t* data, uint32_t width, uint32_t height, int32_t row_stride = 0) noexcept;
+
+#if defined(__ANDROID__)
+/**
+ * @brief View of the image's planes. The crop rectangle of the image is applied
+ * @throw invalid_argument if the image's format is not `AIMAGE_FORMAT_YUV_420_888`
+ * @throw system_error
+ */
+yuv_view_t make_yuv_view(AImage* image) noexcept(false);
+
+/**
+ * @brief View with the layout cached in the `image_lease_pool_t`. Only the plane addresses are queried
+ * @note The crop rectangle is not applied
+ * @see make_yuv_view(AImage*)
+ */
+yuv_view_t make_yuv_view(const image_lease_t& lease) noexcept(false);
+
+/**
+ * @throw invalid_argument if the image's format is not `AIMAGE_FORMAT_RGBA_8888` or `AIMAGE_FORMAT_RGBX_8888`
+ * @throw system_error
+ */
+rgba_view_t make_rgba_view(AImage* image) noexcept(false);
+
+/**
+ * @param mapping address from `ndk_hardware_buffer_t::lock`
+ * @throw invalid_argument if the buffer's format is not `AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM` or
+ *  `AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM`
+ */
+rgba_view_t make_rgba_view(const ndk_hardware_buffer_t& buffer, const void* mapping) noexcept(false);
+
+/**
+ * @brief Views of the locked planes
+ * @throw invalid_argument if the buffer's format is not `AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420`
+ */
+yuv_view_t make_yuv_view(const ndk_hardware_buffer_t::scoped_lock_t& mapping) noexcept(false);
+/**
+ * @throw invalid_argument if the buffer's format is not `AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM` or
+ *  `AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM`
+ */
+rgba_view_t make_rgba_view(const ndk_hardware_buffer_t::scoped_lock_t& mapping) noexcept(false);
+#endif
@@ -0,0 +1,174 @@
+#include "large_buffer.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+constexpr size_t huge_page_size = 2 << 20;
+
+std::atomic<uint64_t> allocations{};
+std::atomic<uint64_t> fallbacks{};
+std::atomic<size_t> live_bytes{};
+std::atomic<size_t> hugetlb_bytes{};
+std::atomic<size_t> advised_bytes{};
+
+size_t align_up(size_t value, size_t alignment) noexcept { return (value + alignment - 1) / alignment * alignment; }
+
+size_t get_page_size() noexcept {
+    static const auto size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+/// @brief Fault the pages in now. `MADV_POPULATE_WRITE` requires Linux 5.14
+void prefault_pages(uint8_t* ptr, size_t size) noexcept {
+#if defined(MADV_POPULATE_WRITE)
+    if (madvise(ptr, size, MADV_POPULATE_WRITE) == 0) return;
+#endif
+    const size_t page = get_page_size();
+    for (size_t offset = 0; offset < size; offset += page) static_cast<volatile uint8_t*>(ptr)[offset] = 0;
+}
+
+/// @return null if there is no huge page reserved for the system
+uint8_t* map_hugetlb(size_t size, bool prefault) noexcept {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+    if (prefault) flags |= MAP_POPULATE;
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : static_cast<uint8_t*>(ptr);
+}
+
+/// @brief Map `size` bytes at the `boundary`. The slack around the mapping is returned
+uint8_t* map_aligned(size_t size, size_t boundary) noexcept(false) {
+    const size_t reserved = size + boundary;
+    void* ptr = mmap(nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) throw std::system_error{errno, std::system_category(), "mmap"};
+    const auto begin = reinterpret_cast<uintptr_t>(ptr);
+    const uintptr_t aligned = align_up(begin, boundary), end = begin + reserved, tail = aligned + size;
+    if (aligned > begin) munmap(ptr, aligned - begin);
+    if (end > tail) munmap(reinterpret_cast<void*>(tail), end - tail);
+    return reinterpret_cast<uint8_t*>(aligned);
+}
+
+/// @return `AnonHugePages` of the mapping which contains the `ptr`. 0 if not found
+size_t read_anon_huge_pages(const void* ptr) noexcept {
+    FILE* fp = std::fopen("/proc/self/smaps", "r");
+    if (fp == nullptr) return 0;
+    const auto address = reinterpret_cast<uintptr_t>(ptr);
+    bool found = false;
+    size_t kilobytes = 0;
+    char line[256]{};
+    while (std::fgets(line, sizeof(line), fp)) {
+        uintptr_t begin = 0, end = 0;
+        if (std::sscanf(line, "%" SCNxPTR "-%" SCNxPTR " ", &begin, &end) == 2) {
+            if (found) break;  // next mapping
+            found = begin <= address && address < end;
+            continue;
+        }
+        if (found && std::sscanf(line, "AnonHugePages: %zu kB", &kilobytes) == 1) break;
+    }
+    std::fclose(fp);
+    return kilobytes * 1024;
+}
+
+}  // namespace
+
+large_buffer_t::large_buffer_t(size_t size, const large_buffer_options_t& options) noexcept(false) {
+    if (size == 0) throw std::invalid_argument{"large_buffer_t: size is zero"};
+    if (options.alignment == 0 || (options.alignment & (options.alignment - 1)) != 0)
+        throw std::invalid_argument{"large_buffer_t: alignment must be a power of 2"};
+    if (size < options.mapping_size) {
+        ptr = static_cast<uint8_t*>(::operator new(size, std::align_val_t{options.alignment}));
+        std::memset(ptr, 0, size);
+        alignment = options.alignment;
+    } else {
+        const bool huge = options.huge_pages && size >= huge_page_size;
+        if (huge && options.alignment <= huge_page_size) {
+            mapped = align_up(size, huge_page_size);
+            ptr = map_hugetlb(mapped, options.prefault);
+            if (ptr) backing = page_backing_t::hugetlb;
+        }
+        if (ptr == nullptr) {
+            // the full 2 MB chunks can be the huge pages. The tail uses the base pages
+            mapped = align_up(size, get_page_size());
+            ptr = map_aligned(mapped, std::max(options.alignment, huge ? huge_page_size : get_page_size()));
+            backing = page_backing_t::normal;
+            if (huge && madvise(ptr, mapped, MADV_HUGEPAGE) == 0) backing = page_backing_t::transparent_huge;
+            if (huge && backing == page_backing_t::normal) fallbacks += 1;
+            if (options.prefault) prefault_pages(ptr, mapped);
+        }
+    }
+    length = size;
+    if (options.budget) charge = memory_charge_t{*options.budget, size};
+    allocations += 1;
+    live_bytes += length;
+    if (backing == page_backing_t::hugetlb) hugetlb_bytes += length;
+    if (backing == page_backing_t::transparent_huge) advised_bytes += length;
+}
+
+large_buffer_t::~large_buffer_t() noexcept { reset(); }
+
+void large_buffer_t::reset() noexcept {
+    if (ptr == nullptr) return;
+    live_bytes -= length;
+    if (backing == page_backing_t::hugetlb) hugetlb_bytes -= length;
+    if (backing == page_backing_t::transparent_huge) advised_bytes -= length;
+    if (backing == page_backing_t::heap)
+        ::operator delete(ptr, std::align_val_t{alignment});
+    else
+        munmap(ptr, mapped);
+    ptr = nullptr;
+    length = mapped = 0;
+    charge.reset();
+}
+
+large_buffer_t::large_buffer_t(large_buffer_t&& rhs) noexcept
+    : ptr{std::exchange(rhs.ptr, nullptr)},
+      length{std::exchange(rhs.length, 0)},
+      mapped{std::exchange(rhs.mapped, 0)},
+      alignment{rhs.alignment},
+      backing{rhs.backing},
+      charge{std::move(rhs.charge)} {}
+
+large_buffer_t& large_buffer_t::operator=(large_buffer_t&& rhs) noexcept {
+    if (this == &rhs) return *this;
+    reset();
+    ptr = std::exchange(rhs.ptr, nullptr);
+    length = std::exchange(rhs.length, 0);
+    mapped = std::exchange(rhs.mapped, 0);
+    alignment = rhs.alignment;
+    backing = rhs.backing;
+    charge = std::move(rhs.charge);
+    return *this;
+}
+
+size_t large_buffer_t::huge_bytes() const noexcept {
+    switch (backing) {
+        case page_backing_t::hugetlb:
+            return length;
+        case page_backing_t::transparent_huge:
+            // the adjacent mappings with the same flags may be merged into one
+            return std::min(read_anon_huge_pages(ptr), length);
+        default:
+            return 0;
+    }
+}
+
+large_buffer_stats_t get_large_buffer_stats() noexcept {
+    large_buffer_stats_t stats{};
+    stats.allocations = allocations.load();
+    stats.fallbacks = fallbacks.load();
+    stats.bytes = live_bytes.load();
+    stats.hugetlb_bytes = hugetlb_bytes.load();
+    stats.advised_bytes = advised_bytes.load();
+    return stats;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "memory_budget.hpp"
+
+/**
+ * @brief Pages behind the `large_buffer_t`
+ */
+enum class page_backing_t : uint32_t {
+    heap = 0,              // small buffer. `operator new` with the alignment
+    normal = 1,            // anonymous mapping of the base pages
+    transparent_huge = 2,  // anonymous mapping with `MADV_HUGEPAGE`. The kernel may still use the base pages
+    hugetlb = 3,           // `MAP_HUGETLB`. Requires the reserved huge pages of the system
+};
+
+/**
+ * @brief Options of the `large_buffer_t`
+ */
+struct large_buffer_options_t final {
+    size_t alignment = 64;              // power of 2. SIMD kernels and XNNPACK prefer the cache line
+    size_t mapping_size = 256 << 10;    // buffers of this size or larger are mapped. Smaller ones are from the heap
+    bool huge_pages = true;             // try `MAP_HUGETLB`, and then `MADV_HUGEPAGE`. For 2 MB or larger ones
+    bool prefault = true;               // touch the pages in the constructor, not in the first frame
+    memory_budget_t* budget = nullptr;  // charged while the buffer is alive. null to skip
+};
+
+/**
+ * @brief Process-wide counters of the `large_buffer_t`
+ */
+struct large_buffer_stats_t final {
+    uint64_t allocations;  // since the process start
+    uint64_t fallbacks;    // `huge_pages` was requested but the buffer is `normal`
+    size_t bytes;          // alive buffers
+    size_t hugetlb_bytes;  // alive buffers with `page_backing_t::hugetlb`
+    size_t advised_bytes;  // alive buffers with `page_backing_t::transparent_huge`
+};
+
+/**
+ * @brief Aligned buffer for the tensors and the scratch images
+ * @details Large buffers are mapped at the 2 MB boundary, so the kernel can back them with the huge pages and
+ *  the TLB covers the whole image with a few entries. The pages are faulted in the constructor, so the first
+ *  frame doesn't pay for the page faults. The contents are zero.
+ *
+ * ```cpp
+ * large_buffer_t rgb{1920 * 1080 * 3};
+ * spdlog::info("{} huge bytes", rgb.huge_bytes());
+ * ```
+ */
+class large_buffer_t final {
+    uint8_t* ptr = nullptr;
+    size_t length = 0;     // requested size
+    size_t mapped = 0;     // 0 for the `heap`
+    size_t alignment = 0;  // for the `heap`
+    page_backing_t backing = page_backing_t::heap;
+    memory_charge_t charge{};
+
+   public:
+    large_buffer_t() noexcept = default;
+    /**
+     * @throw invalid_argument if the `size` is zero or the `alignment` is not a power of 2
+     * @throw system_error if the mapping failed
+     * @throw bad_alloc
+     */
+    explicit large_buffer_t(size_t size, const large_buffer_options_t& options = {}) noexcept(false);
+    ~large_buffer_t() noexcept;
+    large_buffer_t(const large_buffer_t&) = delete;
+    large_buffer_t(large_buffer_t&& rhs) noexcept;
+    large_buffer_t& operator=(const large_buffer_t&) = delete;
+    large_buffer_t& operator=(large_buffer_t&& rhs) noexcept;
+
+   private:
+    void reset() noexcept;
+
+   public:
+    explicit operator bool() const noexcept { return ptr != nullptr; }
+    uint8_t* data() const noexcept { return ptr; }
+    size_t size() const noexcept { return length; }
+    page_backing_t pages() const noexcept { return backing; }
+
+    /**
+     * @brief Bytes backed by the huge pages now. The transparent ones are read from `/proc/self/smaps`
+     * @note Reading the `smaps` is slow. Don't use it for each frame
+     */
+    size_t huge_bytes() const noexcept;
+};
+
+large_buffer_stats_t get_large_buffer_stats() noexcept;
@@ -0,0 +1,156 @@
+#include <jni.h>
+#include <linux/perf_event.h>
+#include <spdlog/spdlog.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+#include "large_buffer.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+
+namespace {
+
+/**
+ * @brief dTLB read misses of the current thread. The devices may forbid it with `perf_event_paranoid`
+ */
+class tlb_miss_counter_t final {
+    int fd;
+
+   public:
+    tlb_miss_counter_t() noexcept {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~tlb_miss_counter_t() noexcept {
+        if (fd != -1) close(fd);
+    }
+    tlb_miss_counter_t(const tlb_miss_counter_t&) = delete;
+    tlb_miss_counter_t(tlb_miss_counter_t&&) = delete;
+    tlb_miss_counter_t& operator=(const tlb_miss_counter_t&) = delete;
+    tlb_miss_counter_t& operator=(tlb_miss_counter_t&&) = delete;
+
+    explicit operator bool() const noexcept { return fd != -1; }
+    void start() noexcept {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    /// @return -1 if the counter is not available
+    int64_t stop() noexcept {
+        int64_t count = -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+        return count;
+    }
+};
+
+/**
+ * @brief Read the cache lines of the buffer in a scattered order. Most of them are on the different pages
+ * @details Each index depends on the last read, so the latency of the TLB walks is not hidden
+ */
+uint64_t scatter_read(const large_buffer_t& buffer, uint32_t count) noexcept {
+    const size_t lines = buffer.size() / 64;
+    uint64_t sum = 0;
+    size_t index = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint8_t value = buffer.data()[index * 64];  // zero
+        sum += value;
+        index = (index + 40503 * 64 + 1 + value) % lines;  // stride over the pages
+    }
+    return sum;
+}
+
+large_buffer_t make_buffer(bool huge, uint32_t megabytes) noexcept(false) {
+    large_buffer_options_t options{};
+    options.huge_pages = huge;
+    return large_buffer_t{static_cast<size_t>(megabytes) << 20, options};
+}
+
+}  // namespace
+
+extern "C" {
+
+/**
+ * @return true if the buffer is aligned and zero, and the stats count it until the destruction
+ */
+JNIEXPORT jboolean Java_dev_luncliff_muffin_LargeBufferTest_allocateAligned(  //
+    JNIEnv* env, jclass, jint size, jint alignment) {
+    try {
+        const large_buffer_stats_t before = get_large_buffer_stats();
+        {
+            large_buffer_options_t options{};
+            options.alignment = static_cast<size_t>(alignment);
+            large_buffer_t buffer{static_cast<size_t>(size), options};
+            if (reinterpret_cast<uintptr_t>(buffer.data()) % alignment != 0) return false;
+            for (jint i = 0; i < size; i += 97)
+                if (buffer.data()[i] != 0) return false;
+            large_buffer_t moved = std::move(buffer);
+            if (buffer || moved.size() != static_cast<size_t>(size)) return false;
+            const large_buffer_stats_t stats = get_large_buffer_stats();
+            spdlog::info("{}: {} {} pages {} huge {}", __func__, size, alignment, static_cast<uint32_t>(moved.pages()),
+                         moved.huge_bytes());
+            if (stats.bytes != before.bytes + size || stats.allocations != before.allocations + 1) return false;
+            if (moved.huge_bytes() > moved.size()) return false;
+        }
+        return get_large_buffer_stats().bytes == before.bytes;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return false;
+    }
+}
+
+/**
+ * @return average nanoseconds of the scattered reads. With the base pages if not `huge`
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_LargeBufferTest_measureScatterRead(  //
+    JNIEnv* env, jclass, jboolean huge, jint megabytes, jint count) {
+    using namespace std::chrono;
+    try {
+        const large_buffer_t buffer = make_buffer(huge, megabytes);
+        scatter_read(buffer, count);  // warm up
+        const auto start = steady_clock::now();
+        const uint64_t sum = scatter_read(buffer, count);
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+        spdlog::info("{}: {} MB {}, {} huge bytes, {} ns (sum {})", __func__, megabytes, huge ? "huge" : "base",
+                     buffer.huge_bytes(), elapsed.count() / count, sum);
+        return static_cast<jlong>(elapsed.count() / count);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @return dTLB read misses of the scattered reads. -1 if the counter is not available
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_LargeBufferTest_countTlbMisses(  //
+    JNIEnv* env, jclass, jboolean huge, jint megabytes, jint count) {
+    try {
+        const large_buffer_t buffer = make_buffer(huge, megabytes);
+        tlb_miss_counter_t counter{};
+        if (!counter) return -1;
+        scatter_read(buffer, count);
+        counter.start();
+        scatter_read(buffer, count);
+        return static_cast<jlong>(counter.stop());
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+}  // extern "C"
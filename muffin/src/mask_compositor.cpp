@@ -0,0 +1,482 @@
+#include "mask_compositor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+namespace {
+
+size_t align_up(size_t value, size_t alignment) noexcept { return (value + alignment - 1) / alignment * alignment; }
+
+/// @brief Horizontal bilinear upsample of a channel. The weight is in 1/256
+void expand_row(const uint8_t* src, int32_t src_stride, const image_pyramid_t::axis_t& columns, uint8_t* dst,
+                uint32_t dst_stride) noexcept {
+    const size_t count = columns.weight.size();
+    for (size_t x = 0; x < count; ++x) {
+        const uint32_t w = columns.weight[x];
+        const uint32_t v0 = src[columns.index0[x] * src_stride], v1 = src[columns.index1[x] * src_stride];
+        dst[x * dst_stride] = static_cast<uint8_t>((v0 * (256 - w) + v1 * w + 128) >> 8);
+    }
+}
+
+/// @brief Horizontal bilinear upsample of the mask. The alpha is repeated for the `channels`
+void expand_alpha(const uint8_t* src, const image_pyramid_t::axis_t& columns, uint8_t* dst,
+                  uint32_t channels) noexcept {
+    const size_t count = columns.weight.size();
+    for (size_t x = 0; x < count; ++x) {
+        const uint32_t w = columns.weight[x];
+        const uint32_t a = (src[columns.index0[x]] * (256 - w) + src[columns.index1[x]] * w + 128) >> 8;
+        if (channels == 4) {
+            const uint32_t pixel = a * 0x01010101u;
+            std::memcpy(dst + 4 * x, &pixel, 4);
+        } else {
+            for (uint32_t k = 0; k < channels; ++k) dst[x * channels + k] = static_cast<uint8_t>(a);
+        }
+    }
+}
+
+/// @brief `(x + 127) / 255` for `x` in [0, 255 * 255]
+uint32_t div255(uint32_t x) noexcept {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+#if defined(__SSE4_1__)
+
+/// @brief 8 lanes of `(x0 * w0 + x1 * w1 + 128) >> 8`
+__m128i lerp8(__m128i x0, __m128i x1, __m128i w0, __m128i w1) noexcept {
+    const __m128i sum = _mm_add_epi16(_mm_mullo_epi16(x0, w0), _mm_mullo_epi16(x1, w1));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+
+/// @brief 8 lanes of `div255(f * a + b * (255 - a))`
+__m128i blend8(__m128i f, __m128i b, __m128i a) noexcept {
+    const __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    const __m128i x = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(f, a), _mm_mullo_epi16(b, inverse)),
+                                    _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/// @brief 16 bytes of `blend_row`. The weights are `{256 - w, w}` in the 16-bit lanes
+void blend16(const uint8_t* fg, const uint8_t* b0, const uint8_t* b1, __m128i wb0, __m128i wb1, const uint8_t* a0,
+             const uint8_t* a1, __m128i wa0, __m128i wa1, uint8_t* out) noexcept {
+    const __m128i zero = _mm_setzero_si128();
+    auto load = [](const uint8_t* src) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)); };
+    const __m128i f = load(fg), x0 = load(b0), x1 = load(b1), y0 = load(a0), y1 = load(a1);
+    const __m128i lo =
+        blend8(_mm_cvtepu8_epi16(f), lerp8(_mm_cvtepu8_epi16(x0), _mm_cvtepu8_epi16(x1), wb0, wb1),
+               lerp8(_mm_cvtepu8_epi16(y0), _mm_cvtepu8_epi16(y1), wa0, wa1));
+    const __m128i hi = blend8(_mm_unpackhi_epi8(f, zero),
+                              lerp8(_mm_unpackhi_epi8(x0, zero), _mm_unpackhi_epi8(x1, zero), wb0, wb1),
+                              lerp8(_mm_unpackhi_epi8(y0, zero), _mm_unpackhi_epi8(y1, zero), wa0, wa1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(lo, hi));
+}
+
+int32_t load_pixel(const uint8_t* src) noexcept {
+    int32_t pixel = 0;
+    std::memcpy(&pixel, src, 4);
+    return pixel;
+}
+
+/// @brief 2 RGBA pixels of `expand_rgba`
+void expand_rgba2(const uint8_t* src, const image_pyramid_t::axis_t& columns, size_t x, uint8_t* dst) noexcept {
+    const __m128i x0 = _mm_cvtepu8_epi16(_mm_setr_epi32(load_pixel(src + 4 * columns.index0[x]),
+                                                        load_pixel(src + 4 * columns.index0[x + 1]), 0, 0));
+    const __m128i x1 = _mm_cvtepu8_epi16(_mm_setr_epi32(load_pixel(src + 4 * columns.index1[x]),
+                                                        load_pixel(src + 4 * columns.index1[x + 1]), 0, 0));
+    const auto w0 = static_cast<int16_t>(columns.weight[x]), w1 = static_cast<int16_t>(columns.weight[x + 1]);
+    const __m128i w = _mm_setr_epi16(w0, w0, w0, w0, w1, w1, w1, w1);
+    const __m128i value = lerp8(x0, x1, _mm_sub_epi16(_mm_set1_epi16(256), w), w);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(value, value));
+}
+
+#elif defined(__ARM_NEON)
+
+uint16x8_t lerp8(uint8x8_t x0, uint8x8_t x1, uint16_t w0, uint16_t w1) noexcept {
+    return vrshrq_n_u16(vmlaq_n_u16(vmulq_n_u16(vmovl_u8(x0), w0), vmovl_u8(x1), w1), 8);
+}
+
+uint8x8_t blend8(uint8x8_t f, uint16x8_t b, uint16x8_t a) noexcept {
+    const uint16x8_t inverse = vsubq_u16(vdupq_n_u16(255), a);
+    const uint16x8_t x = vaddq_u16(vmlaq_u16(vmulq_u16(vmovl_u8(f), a), b, inverse), vdupq_n_u16(128));
+    return vmovn_u16(vshrq_n_u16(vsraq_n_u16(x, x, 8), 8));
+}
+
+void blend16(const uint8_t* fg, const uint8_t* b0, const uint8_t* b1, uint16_t wb0, uint16_t wb1, const uint8_t* a0,
+             const uint8_t* a1, uint16_t wa0, uint16_t wa1, uint8_t* out) noexcept {
+    const uint8x16_t f = vld1q_u8(fg), x0 = vld1q_u8(b0), x1 = vld1q_u8(b1), y0 = vld1q_u8(a0), y1 = vld1q_u8(a1);
+    const uint8x8_t lo = blend8(vget_low_u8(f), lerp8(vget_low_u8(x0), vget_low_u8(x1), wb0, wb1),
+                                lerp8(vget_low_u8(y0), vget_low_u8(y1), wa0, wa1));
+    const uint8x8_t hi = blend8(vget_high_u8(f), lerp8(vget_high_u8(x0), vget_high_u8(x1), wb0, wb1),
+                                lerp8(vget_high_u8(y0), vget_high_u8(y1), wa0, wa1));
+    vst1q_u8(out, vcombine_u8(lo, hi));
+}
+
+void expand_rgba2(const uint8_t* src, const image_pyramid_t::axis_t& columns, size_t x, uint8_t* dst) noexcept {
+    uint32x2_t p0 = vdup_n_u32(0), p1 = vdup_n_u32(0);
+    p0 = vld1_lane_u32(reinterpret_cast<const uint32_t*>(src + 4 * columns.index0[x]), p0, 0);
+    p0 = vld1_lane_u32(reinterpret_cast<const uint32_t*>(src + 4 * columns.index0[x + 1]), p0, 1);
+    p1 = vld1_lane_u32(reinterpret_cast<const uint32_t*>(src + 4 * columns.index1[x]), p1, 0);
+    p1 = vld1_lane_u32(reinterpret_cast<const uint32_t*>(src + 4 * columns.index1[x + 1]), p1, 1);
+    const uint16x8_t w = vcombine_u16(vdup_n_u16(columns.weight[x]), vdup_n_u16(columns.weight[x + 1]));
+    const uint16x8_t value = vmlaq_u16(vmulq_u16(vmovl_u8(vreinterpret_u8_u32(p0)), vsubq_u16(vdupq_n_u16(256), w)),
+                                       vmovl_u8(vreinterpret_u8_u32(p1)), w);
+    vst1_u8(dst, vrshrn_n_u16(value, 8));
+}
+
+#endif
+
+/// @brief Horizontal bilinear upsample of the RGBA pixels
+void expand_rgba(const uint8_t* src, const image_pyramid_t::axis_t& columns, uint8_t* dst) noexcept {
+    const size_t count = columns.weight.size();
+    size_t x = 0;
+#if defined(__SSE4_1__) || defined(__ARM_NEON)
+    for (; x + 2 <= count; x += 2) expand_rgba2(src, columns, x, dst + 4 * x);
+#endif
+    for (; x < count; ++x)
+        for (uint32_t k = 0; k < 4; ++k) {
+            const uint32_t w = columns.weight[x];
+            const uint32_t v0 = src[4 * columns.index0[x] + k], v1 = src[4 * columns.index1[x] + k];
+            dst[4 * x + k] = static_cast<uint8_t>((v0 * (256 - w) + v1 * w + 128) >> 8);
+        }
+}
+
+/**
+ * @brief `out = fg * a + b * (1 - a)` where `b` and `a` are the vertical lerps of 2 rows
+ * @param wb weight of the `b1` in 1/256
+ * @param wa weight of the `a1` in 1/256
+ */
+void blend_row(const uint8_t* fg, const uint8_t* b0, const uint8_t* b1, uint32_t wb, const uint8_t* a0,
+               const uint8_t* a1, uint32_t wa, size_t count, uint8_t* out) noexcept {
+    size_t i = 0;
+#if defined(__SSE4_1__)
+    const __m128i wb0 = _mm_set1_epi16(static_cast<int16_t>(256 - wb)), wb1 = _mm_set1_epi16(static_cast<int16_t>(wb));
+    const __m128i wa0 = _mm_set1_epi16(static_cast<int16_t>(256 - wa)), wa1 = _mm_set1_epi16(static_cast<int16_t>(wa));
+    for (; i + 16 <= count; i += 16)
+        blend16(fg + i, b0 + i, b1 + i, wb0, wb1, a0 + i, a1 + i, wa0, wa1, out + i);
+#elif defined(__ARM_NEON)
+    const auto wb0 = static_cast<uint16_t>(256 - wb), wb1 = static_cast<uint16_t>(wb);
+    const auto wa0 = static_cast<uint16_t>(256 - wa), wa1 = static_cast<uint16_t>(wa);
+    for (; i + 16 <= count; i += 16)
+        blend16(fg + i, b0 + i, b1 + i, wb0, wb1, a0 + i, a1 + i, wa0, wa1, out + i);
+#endif
+    for (; i < count; ++i) {
+        const uint32_t b = (b0[i] * (256 - wb) + b1[i] * wb + 128) >> 8;
+        const uint32_t a = (a0[i] * (256 - wa) + a1[i] * wa + 128) >> 8;
+        out[i] = static_cast<uint8_t>(div255(fg[i] * a + b * (255 - a)));
+    }
+}
+
+/**
+ * @brief Box filter of the rows. Each channel of the interleaved pixels is filtered. The edges are repeated
+ * @tparam C channels. Same with the `pixel_stride`
+ */
+template <int32_t C>
+void box_rows(plane_view_t<const uint8_t> src, plane_view_t<uint8_t> dst, index_range_t rows, uint32_t radius,
+              uint32_t inverse) noexcept {
+    const int32_t last = static_cast<int32_t>(src.width) - 1, r = static_cast<int32_t>(radius);
+    for (auto y = rows.begin; y < rows.end; ++y) {
+        const uint8_t* in = src.row(y);
+        uint8_t* out = dst.row(y);
+        uint32_t sum[C]{};
+        for (int32_t k = 0; k < C; ++k) sum[k] = in[k] * (radius + 1);
+        for (int32_t i = 1; i <= r; ++i)
+            for (int32_t k = 0; k < C; ++k) sum[k] += in[std::min(i, last) * C + k];
+        for (int32_t x = 0; x <= last; ++x) {
+            const uint8_t* next = in + std::min(x + r + 1, last) * C;
+            const uint8_t* prev = in + std::max(x - r, 0) * C;
+            for (int32_t k = 0; k < C; ++k) {
+                out[x * C + k] = static_cast<uint8_t>((sum[k] * inverse + 32768) >> 16);
+                sum[k] += next[k] - prev[k];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Box filter of the columns. The edges are repeated
+ * @param bytes range of the bytes in the rows. The sums are kept for 64 bytes
+ */
+void box_columns(plane_view_t<const uint8_t> src, plane_view_t<uint8_t> dst, index_range_t bytes, uint32_t radius,
+                 uint32_t inverse) noexcept {
+    const int32_t last = static_cast<int32_t>(src.height) - 1, r = static_cast<int32_t>(radius);
+    uint32_t sums[64]{};
+    for (auto begin = bytes.begin; begin < bytes.end; begin += 64) {
+        const size_t count = std::min<size_t>(64, bytes.end - begin);
+        const uint8_t* first = src.row(0) + begin;
+        for (size_t j = 0; j < count; ++j) sums[j] = first[j] * (radius + 1);
+        for (int32_t i = 1; i <= r; ++i) {
+            const uint8_t* row = src.row(std::min(i, last)) + begin;
+            for (size_t j = 0; j < count; ++j) sums[j] += row[j];
+        }
+        for (int32_t y = 0; y <= last; ++y) {
+            uint8_t* out = dst.row(y) + begin;
+            const uint8_t* next = src.row(std::min(y + r + 1, last)) + begin;
+            const uint8_t* prev = src.row(std::max(y - r, 0)) + begin;
+            for (size_t j = 0; j < count; ++j) {
+                out[j] = static_cast<uint8_t>((sums[j] * inverse + 32768) >> 16);
+                sums[j] += next[j] - prev[j];
+            }
+        }
+    }
+}
+
+/// @return U/V as one plane if they are interleaved. null `data` if they are not
+plane_view_t<const uint8_t> get_interleaved(plane_view_t<const uint8_t> u,
+                                            plane_view_t<const uint8_t> v) noexcept {
+    if (u.pixel_stride != 2 || v.pixel_stride != 2 || std::abs(u.data - v.data) != 1) return {};
+    plane_view_t<const uint8_t> plane = u;
+    plane.data = std::min(u.data, v.data);
+    return plane;
+}
+
+bool is_same_layout(plane_view_t<const uint8_t> lhs, plane_view_t<const uint8_t> rhs) noexcept {
+    return lhs.width == rhs.width && lhs.height == rhs.height && lhs.pixel_stride == rhs.pixel_stride;
+}
+
+}  // namespace
+
+mask_compositor_t::mask_compositor_t(uint32_t width, uint32_t height, pixel_format_t format,
+                                     const composite_config_t& config) noexcept(false)
+    : config{config}, format{format}, width{width}, height{height} {
+    if (config.downscale == 0 || config.radius == 0 || config.passes == 0)
+        throw std::invalid_argument{"mask_compositor_t: downscale, radius, and passes must be positive"};
+    if (!(config.low < config.high)) throw std::invalid_argument{"mask_compositor_t: low must be less than high"};
+    const uint32_t w = width >> config.downscale, h = height >> config.downscale;
+    if (w == 0 || h == 0) throw std::invalid_argument{"mask_compositor_t: too small for the downscale"};
+    switch (format) {
+        case pixel_format_t::rgba_8888:
+        case pixel_format_t::rgbx_8888: {
+            uint32_t level_w = width, level_h = height;
+            for (uint32_t i = 0; i < config.downscale; ++i) {
+                level_w /= 2;
+                level_h /= 2;
+                levels.emplace_back(allocate(level_w, level_h, 4));
+            }
+            planes.emplace_back(allocate(w, h, 4));
+            temporary.emplace_back(allocate(w, h, 4));
+            break;
+        }
+        case pixel_format_t::yuv_420_888: {
+            pyramid = std::make_unique<image_pyramid_t>(width, height, config.downscale);
+            const pyramid_level_t& level = pyramid->level(config.downscale - 1);
+            for (const plane_view_t<uint8_t>& plane : {level.y, level.u, level.v}) {
+                planes.emplace_back(allocate(plane.width, plane.height, 1));
+                temporary.emplace_back(allocate(plane.width, plane.height, 1));
+            }
+            make_resize_axis(blurred_rows[1], level.u.height, (height + 1) / 2);
+            make_resize_axis(blurred_columns[1], level.u.width, (width + 1) / 2);
+            break;
+        }
+        default:
+            throw std::invalid_argument{"mask_compositor_t: unexpected pixel format"};
+    }
+    make_resize_axis(blurred_rows[0], h, height);
+    make_resize_axis(blurred_columns[0], w, width);
+}
+
+plane_view_t<uint8_t> mask_compositor_t::allocate(uint32_t w, uint32_t h, int32_t pixel_stride) noexcept(false) {
+    const auto row_stride = static_cast<int32_t>(align_up(static_cast<size_t>(w) * pixel_stride, 64));
+    large_buffer_options_t options{};
+    options.budget = &get_memory_budget("images");
+    auto& buffer = buffers.emplace_back(static_cast<size_t>(row_stride) * h, options);
+    return plane_view_t<uint8_t>{buffer.data(), w, h, row_stride, pixel_stride};
+}
+
+void mask_compositor_t::set_mask(const float* confidence, uint32_t w, uint32_t h) noexcept(false) {
+    if (w == 0 || h == 0) throw std::invalid_argument{"mask_compositor_t: empty mask"};
+    if (w != mask_width || h != mask_height) {
+        mask.resize(static_cast<size_t>(w) * h);
+        make_resize_axis(mask_rows[0], h, height);
+        make_resize_axis(mask_columns[0], w, width);
+        make_resize_axis(mask_rows[1], h, (height + 1) / 2);
+        make_resize_axis(mask_columns[1], w, (width + 1) / 2);
+        mask_width = w;
+        mask_height = h;
+    }
+    const float scale = 255.0f / (config.high - config.low);
+    for (size_t i = 0; i < mask.size(); ++i) {
+        const float alpha = (confidence[i] - config.low) * scale;
+        // NaN is the background
+        mask[i] = alpha > 0 ? static_cast<uint8_t>(std::min(alpha, 255.0f) + 0.5f) : 0;
+    }
+}
+
+void mask_compositor_t::downscale(thread_pool_t& pool, const rgba_view_t& src) noexcept(false) {
+    plane_view_t<const uint8_t> prev = src.plane;
+    for (const plane_view_t<uint8_t>& level : levels) {
+        pool.parallel_for({0, level.height}, 16, [&](index_range_t rows) { downscale_rgba_2x(prev, level, rows); });
+        prev = level;
+    }
+}
+
+void mask_compositor_t::blur(thread_pool_t& pool, const plane_view_t<const uint8_t>* sources) noexcept(false) {
+    const uint32_t radius = config.radius;
+    const uint32_t inverse = (65536 + radius) / (2 * radius + 1);
+    for (size_t i = 0; i < planes.size(); ++i) {
+        plane_view_t<const uint8_t> src = sources[i];
+        const plane_view_t<uint8_t>&dst = planes[i], &middle = temporary[i];
+        const size_t bytes = static_cast<size_t>(dst.width) * dst.pixel_stride;
+        for (uint32_t pass = 0; pass < config.passes; ++pass) {
+            pool.parallel_for({0, dst.height}, 16, [&](index_range_t rows) {
+                if (dst.pixel_stride == 4) return box_rows<4>(src, middle, rows, radius, inverse);
+                box_rows<1>(src, middle, rows, radius, inverse);
+            });
+            pool.parallel_for({0, bytes}, 64,
+                              [&](index_range_t range) { box_columns(middle, dst, range, radius, inverse); });
+            src = dst;
+        }
+    }
+}
+
+void mask_compositor_t::blend(thread_pool_t& pool, const layer_t& layer) noexcept(false) {
+    const uint32_t channels = layer.src.pixel_stride;
+    const uint32_t w = layer.dst.width, h = layer.dst.height;
+    const size_t bytes = static_cast<size_t>(w) * channels;
+    const image_pyramid_t::axis_t &rows_a = mask_rows[layer.scale], &columns_a = mask_columns[layer.scale];
+    const image_pyramid_t::axis_t &rows_b = blurred_rows[layer.scale], &columns_b = blurred_columns[layer.scale];
+    const bool replace = layer.background.data != nullptr;
+
+    // source rows of a tile are not more than `(tile - 1) * ratio + 3`
+    const uint32_t tile = std::max(make_cache_tile(w, h, 3 * channels).height, 1u);
+    const size_t mask_span = (tile - 1) * static_cast<size_t>(mask_height) / h + 3;
+    const size_t blurred_span = replace ? 0 : (tile - 1) * static_cast<size_t>(layer.blurred[0].height) / h + 3;
+    const size_t bands = std::min<size_t>(h, pool.concurrency() * 2);
+    const size_t band_bytes = (mask_span + blurred_span) * bytes;
+    if (scratch.size() < bands * band_bytes) scratch.resize(bands * band_bytes);
+
+    pool.parallel_for({0, bands}, 1, [&](index_range_t chunk) {
+        for (auto band = chunk.begin; band < chunk.end; ++band) {
+            // ring buffers of the upsampled source rows. Each row is upsampled once in the band
+            uint8_t* alpha = scratch.data() + band * band_bytes;
+            uint8_t* background = alpha + mask_span * bytes;
+            auto alpha_row = [&](uint32_t m) { return alpha + (m % mask_span) * bytes; };
+            auto background_row = [&](uint32_t b) { return background + (b % blurred_span) * bytes; };
+            uint32_t alpha_end = 0, background_end = 0;
+            const size_t end = h * (band + 1) / bands;
+            for (size_t y0 = h * band / bands; y0 < end; y0 += tile) {
+                const size_t y1 = std::min<size_t>(y0 + tile, end);
+                for (uint32_t m = std::max(rows_a.index0[y0], alpha_end); m <= rows_a.index1[y1 - 1]; ++m)
+                    expand_alpha(mask.data() + static_cast<size_t>(m) * mask_width, columns_a, alpha_row(m), channels);
+                alpha_end = rows_a.index1[y1 - 1] + 1;
+                if (replace == false) {
+                    for (uint32_t b = std::max(rows_b.index0[y0], background_end); b <= rows_b.index1[y1 - 1]; ++b) {
+                        if (channels == 4) {
+                            expand_rgba(layer.blurred[0].row(b), columns_b, background_row(b));
+                            continue;
+                        }
+                        for (uint32_t k = 0; k < channels; ++k)
+                            expand_row(layer.blurred[k].row(b), layer.blurred[k].pixel_stride, columns_b,
+                                       background_row(b) + k, channels);
+                    }
+                    background_end = rows_b.index1[y1 - 1] + 1;
+                }
+                // vertical lerp and blend
+                for (size_t y = y0; y < y1; ++y) {
+                    const uint8_t* a0 = alpha_row(rows_a.index0[y]);
+                    const uint8_t* a1 = alpha_row(rows_a.index1[y]);
+                    if (replace) {
+                        const uint8_t* row = layer.background.row(y);
+                        blend_row(layer.src.row(y), row, row, 0, a0, a1, rows_a.weight[y], bytes, layer.dst.row(y));
+                    } else {
+                        blend_row(layer.src.row(y), background_row(rows_b.index0[y]),
+                                  background_row(rows_b.index1[y]), rows_b.weight[y], a0, a1, rows_a.weight[y], bytes,
+                                  layer.dst.row(y));
+                    }
+                }
+            }
+        }
+    });
+}
+
+void mask_compositor_t::composite_rgba(thread_pool_t& pool, const rgba_view_t& src, const rgba_view_t* background,
+                                       plane_view_t<uint8_t> dst) noexcept(false) {
+    if (format == pixel_format_t::yuv_420_888) throw std::invalid_argument{"mask_compositor_t: format is YUV"};
+    if (mask.empty()) throw std::invalid_argument{"mask_compositor_t: no mask"};
+    layer_t layer{src.plane, dst, {}, {}, 0};
+    if (src.plane.pixel_stride != 4 || src.width() != width || src.height() != height ||
+        is_same_layout(src.plane, dst) == false)
+        throw std::invalid_argument{"mask_compositor_t: different layout"};
+    if (background) {
+        if (is_same_layout(src.plane, background->plane) == false)
+            throw std::invalid_argument{"mask_compositor_t: different background layout"};
+        layer.background = background->plane;
+    } else {
+        downscale(pool, src);
+        const plane_view_t<const uint8_t> source = levels.back();
+        blur(pool, &source);
+        for (uint32_t k = 0; k < 4; ++k) {
+            layer.blurred[k] = planes[0];
+            layer.blurred[k].data += k;
+        }
+    }
+    blend(pool, layer);
+}
+
+void mask_compositor_t::composite_yuv(thread_pool_t& pool, const yuv_view_t& src, const yuv_view_t* background,
+                                      const yuv_target_t& dst) noexcept(false) {
+    if (format != pixel_format_t::yuv_420_888) throw std::invalid_argument{"mask_compositor_t: format is not YUV"};
+    if (mask.empty()) throw std::invalid_argument{"mask_compositor_t: no mask"};
+    if (src.y.pixel_stride != 1 || src.width() != width || src.height() != height ||
+        is_same_layout(src.y, dst.y) == false)
+        throw std::invalid_argument{"mask_compositor_t: different layout"};
+    const plane_view_t<const uint8_t> chroma = get_interleaved(src.u, src.v);
+    const plane_view_t<const uint8_t> target = get_interleaved(dst.u, dst.v);
+    const bool interleaved = chroma.data != nullptr;
+    if (interleaved != (target.data != nullptr) || is_same_layout(src.u, dst.u) == false ||
+        (interleaved && (src.u.data < src.v.data) != (dst.u.data < dst.v.data)) ||
+        (interleaved == false && src.u.pixel_stride != 1))
+        throw std::invalid_argument{"mask_compositor_t: unsupported chroma layout"};
+    const bool u_first = src.u.data < src.v.data;
+    if (background && (is_same_layout(src.y, background->y) == false || is_same_layout(src.u, background->u) == false ||
+                       (get_interleaved(background->u, background->v).data != nullptr) != interleaved ||
+                       (interleaved && (background->u.data < background->v.data) != u_first)))
+        throw std::invalid_argument{"mask_compositor_t: different background layout"};
+    const yuv_view_t replacement = background ? *background : yuv_view_t{};  // null planes for the blur
+    layer_t layers[3]{};
+    size_t count = 0;
+    layers[count++] = layer_t{src.y, dst.y, replacement.y, {planes[0]}, 0};
+    if (interleaved) {
+        layer_t& layer = layers[count++];
+        layer = layer_t{chroma, dst.u, get_interleaved(replacement.u, replacement.v),
+                        {planes[u_first ? 1 : 2], planes[u_first ? 2 : 1]}, 1};
+        layer.dst.data = std::min(dst.u.data, dst.v.data);
+    } else {
+        layers[count++] = layer_t{src.u, dst.u, replacement.u, {planes[1]}, 1};
+        layers[count++] = layer_t{src.v, dst.v, replacement.v, {planes[2]}, 1};
+    }
+    if (background == nullptr) {
+        pyramid->build(pool, src);
+        const pyramid_level_t& level = pyramid->level(config.downscale - 1);
+        const plane_view_t<const uint8_t> sources[3]{level.y, level.u, level.v};
+        blur(pool, sources);
+    }
+    for (size_t i = 0; i < count; ++i) blend(pool, layers[i]);
+}
+
+void mask_compositor_t::composite(thread_pool_t& pool, const rgba_view_t& src,
+                                  plane_view_t<uint8_t> dst) noexcept(false) {
+    composite_rgba(pool, src, nullptr, dst);
+}
+
+void mask_compositor_t::composite(thread_pool_t& pool, const rgba_view_t& src, const rgba_view_t& background,
+                                  plane_view_t<uint8_t> dst) noexcept(false) {
+    composite_rgba(pool, src, &background, dst);
+}
+
+void mask_compositor_t::composite(thread_pool_t& pool, const yuv_view_t& src, const yuv_target_t& dst) noexcept(false) {
+    composite_yuv(pool, src, nullptr, dst);
+}
+
+void mask_compositor_t::composite(thread_pool_t& pool, const yuv_view_t& src, const yuv_view_t& background,
+                                  const yuv_target_t& dst) noexcept(false) {
+    composite_yuv(pool, src, &background, dst);
+}
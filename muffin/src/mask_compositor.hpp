@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "image_pyramid.hpp"
+#include "image_view.hpp"
+#include "large_buffer.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief Options of the `mask_compositor_t`
+ */
+struct composite_config_t final {
+    uint32_t downscale = 2;  // 2x downscales of the frame before the blur. 2 for the 1/4 size
+    uint32_t radius = 3;     // of the box filter, in the downscaled pixels
+    uint32_t passes = 2;     // of the box filter. 3 passes are close to the Gaussian
+    float low = 0.0f;        // confidence of the background. The alpha is 0 under this
+    float high = 1.0f;       // confidence of the foreground. The alpha is 255 over this
+};
+
+/**
+ * @brief Writable planes of `AIMAGE_FORMAT_YUV_420_888`. Same layouts with `yuv_view_t`
+ */
+struct yuv_target_t final {
+    plane_view_t<uint8_t> y;
+    plane_view_t<uint8_t> u;
+    plane_view_t<uint8_t> v;
+};
+
+/**
+ * @brief Composite of the segmentation mask. Background blur or replacement
+ * @details The confidence mask of the model is quantized to 8-bit in `set_mask`. Then `composite` blends the
+ *  frame and the background with the mask upsampled to the frame.
+ *
+ *  For the blur, the frame is downscaled with the 2x2 box filter (`image_pyramid_t` for YUV), and blurred with
+ *  the separable box filter. The replacement background is used as is.
+ *
+ *  The blend is one pass of the row bands in the `thread_pool_t`. Each band is processed in cache-sized tiles.
+ *  The source rows of the mask and the blurred background are upsampled horizontally into the band's ring buffers,
+ *  once for each row. Then each row of the tile is a vertical lerp and a blend of 16 bytes per SIMD iteration.
+ *  The chroma planes use the mask at their size. Interleaved U/V (NV12/NV21) is blended as one plane.
+ *
+ * ```cpp
+ * mask_compositor_t compositor{1920, 1080, pixel_format_t::yuv_420_888};
+ * // for each frame
+ * compositor.set_mask(output->data.f, 256, 256);
+ * compositor.composite(pool, make_yuv_view(lease), target);
+ * ```
+ */
+class mask_compositor_t final {
+    /// @brief One plane of the source and the output. `pixel_stride` is the bytes of the interleaved channels
+    struct layer_t final {
+        plane_view_t<const uint8_t> src;
+        plane_view_t<uint8_t> dst;
+        plane_view_t<const uint8_t> background;  // replacement. null `data` for the blur
+        plane_view_t<const uint8_t> blurred[4];  // for each channel
+        uint32_t scale;                          // 0 for the luma/RGBA, 1 for the chroma
+    };
+
+    composite_config_t config;
+    pixel_format_t format;
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> mask{};  // 8-bit alpha of the foreground
+    uint32_t mask_width = 0;
+    uint32_t mask_height = 0;
+    image_pyramid_t::axis_t mask_rows[2]{};  // 0 for the frame, 1 for the chroma
+    image_pyramid_t::axis_t mask_columns[2]{};
+    std::unique_ptr<image_pyramid_t> pyramid{};  // for YUV
+    std::vector<large_buffer_t> buffers{};
+    std::vector<plane_view_t<uint8_t>> levels{};  // downscaled RGBA
+    std::vector<plane_view_t<uint8_t>> planes{};  // blurred. RGBA or Y/U/V
+    std::vector<plane_view_t<uint8_t>> temporary{};
+    image_pyramid_t::axis_t blurred_rows[2]{};
+    image_pyramid_t::axis_t blurred_columns[2]{};
+    std::vector<uint8_t> scratch{};  // for each band
+
+   public:
+    /**
+     * @param format `yuv_420_888`, `rgba_8888`, or `rgbx_8888`
+     * @throw invalid_argument if the size is too small for the `downscale`, or the options are out of range
+     */
+    mask_compositor_t(uint32_t width, uint32_t height, pixel_format_t format,
+                      const composite_config_t& config = {}) noexcept(false);
+    ~mask_compositor_t() noexcept = default;
+    mask_compositor_t(const mask_compositor_t&) = delete;
+    mask_compositor_t(mask_compositor_t&&) = delete;
+    mask_compositor_t& operator=(const mask_compositor_t&) = delete;
+    mask_compositor_t& operator=(mask_compositor_t&&) = delete;
+
+   private:
+    plane_view_t<uint8_t> allocate(uint32_t width, uint32_t height, int32_t pixel_stride) noexcept(false);
+    void downscale(thread_pool_t& pool, const rgba_view_t& src) noexcept(false);
+    void blur(thread_pool_t& pool, const plane_view_t<const uint8_t>* sources) noexcept(false);
+    void blend(thread_pool_t& pool, const layer_t& layer) noexcept(false);
+    /// @param background null for the blur
+    void composite_rgba(thread_pool_t& pool, const rgba_view_t& src, const rgba_view_t* background,
+                        plane_view_t<uint8_t> dst) noexcept(false);
+    void composite_yuv(thread_pool_t& pool, const yuv_view_t& src, const yuv_view_t* background,
+                       const yuv_target_t& dst) noexcept(false);
+
+   public:
+    /**
+     * @brief Quantize the confidence of the foreground. The mask is used until the next `set_mask`
+     * @param confidence row-major `width * height` floats. The output of the segmentation model
+     * @throw invalid_argument if the size is zero
+     */
+    void set_mask(const float* confidence, uint32_t width, uint32_t height) noexcept(false);
+
+    /**
+     * @brief Blend the `src` with its blurred background
+     * @param dst same size with the `src`. Its `pixel_stride` must be 4
+     * @throw invalid_argument if the size or format is different, or `set_mask` is not invoked
+     */
+    void composite(thread_pool_t& pool, const rgba_view_t& src, plane_view_t<uint8_t> dst) noexcept(false);
+    /// @param background replacement with the same size with the `src`
+    void composite(thread_pool_t& pool, const rgba_view_t& src, const rgba_view_t& background,
+                   plane_view_t<uint8_t> dst) noexcept(false);
+    /// @param dst same size and chroma layout with the `src`
+    void composite(thread_pool_t& pool, const yuv_view_t& src, const yuv_target_t& dst) noexcept(false);
+    /// @param background replacement with the same size and chroma layout with the `src`
+    void composite(thread_pool_t& pool, const yuv_view_t& src, const yuv_view_t& background,
+                   const yuv_target_t& dst) noexcept(false);
+};
@@ -0,0 +1,105 @@
+#include "memory_budget.hpp"
+
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+struct named_budget_t final {
+    std::string name;
+    memory_budget_t budget{};
+};
+
+std::mutex budgets_mutex{};
+std::deque<named_budget_t> budgets{};  // the references must be stable
+
+}  // namespace
+
+void memory_budget_t::update_peak(size_t value) noexcept {
+    size_t current = peak.load(std::memory_order_relaxed);
+    while (current < value && peak.compare_exchange_weak(current, value, std::memory_order_relaxed) == false) {
+    }
+}
+
+void memory_budget_t::set_limit(size_t value) noexcept { limit = value; }
+
+bool memory_budget_t::try_reserve(size_t size) noexcept {
+    const size_t max = limit.load();
+    size_t current = bytes.load();
+    do {
+        if (max != 0 && current + size > max) {
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (bytes.compare_exchange_weak(current, current + size) == false);
+    update_peak(current + size);
+    return true;
+}
+
+void memory_budget_t::charge(size_t size) noexcept { update_peak(bytes.fetch_add(size) + size); }
+
+void memory_budget_t::release(size_t size) noexcept { bytes.fetch_sub(size); }
+
+bool memory_budget_t::is_exceeded() const noexcept {
+    const size_t max = limit.load();
+    return max != 0 && bytes.load() > max;
+}
+
+memory_usage_t memory_budget_t::usage() const noexcept {
+    memory_usage_t output{};
+    output.limit = limit.load();
+    output.bytes = bytes.load();
+    output.peak = peak.load(std::memory_order_relaxed);
+    output.rejected = rejected.load(std::memory_order_relaxed);
+    return output;
+}
+
+void memory_budget_t::reset_peak() noexcept { peak = bytes.load(); }
+
+memory_budget_t& get_memory_budget(std::string_view name) noexcept(false) {
+    std::lock_guard lock{budgets_mutex};
+    for (named_budget_t& item : budgets)
+        if (item.name == name) return item.budget;
+    named_budget_t& item = budgets.emplace_back();
+    item.name = name;
+    return item.budget;
+}
+
+std::vector<std::string> get_memory_budget_names() noexcept(false) {
+    std::vector<std::string> names{};
+    std::lock_guard lock{budgets_mutex};
+    for (const named_budget_t& item : budgets) names.emplace_back(item.name);
+    return names;
+}
+
+memory_charge_t::memory_charge_t(memory_budget_t& budget, size_t bytes) noexcept : budget{&budget}, bytes{bytes} {
+    budget.charge(bytes);
+}
+
+memory_charge_t::~memory_charge_t() noexcept { reset(); }
+
+memory_charge_t memory_charge_t::try_reserve(memory_budget_t& budget, size_t bytes) noexcept {
+    memory_charge_t output{};
+    if (budget.try_reserve(bytes) == false) return output;
+    output.budget = &budget;
+    output.bytes = bytes;
+    return output;
+}
+
+memory_charge_t::memory_charge_t(memory_charge_t&& rhs) noexcept
+    : budget{std::exchange(rhs.budget, nullptr)}, bytes{std::exchange(rhs.bytes, 0)} {}
+
+memory_charge_t& memory_charge_t::operator=(memory_charge_t&& rhs) noexcept {
+    if (this == &rhs) return *this;
+    reset();
+    budget = std::exchange(rhs.budget, nullptr);
+    bytes = std::exchange(rhs.bytes, 0);
+    return *this;
+}
+
+void memory_charge_t::reset() noexcept {
+    if (budget) budget->release(bytes);
+    budget = nullptr;
+    bytes = 0;
+}
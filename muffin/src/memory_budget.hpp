@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Snapshot of a `memory_budget_t`
+ */
+struct memory_usage_t final {
+    size_t limit;       // 0 if unlimited
+    size_t bytes;       // charged now
+    size_t peak;        // high-water mark of the `bytes`
+    uint64_t rejected;  // `try_reserve` which didn't fit
+};
+
+/**
+ * @brief Named account of the bytes held by a kind of the memory. For example, "buffers" or "images"
+ * @details The owners charge their allocations, and the pipeline checks `is_exceeded` to shed the load.
+ *  `try_reserve` is for the allocations which can fail, and `charge` is for the ones which can't.
+ *  All the functions are lock-free. The budgets live until the process exits.
+ *
+ * ```cpp
+ * memory_budget_t& budget = get_memory_budget("snapshots");
+ * budget.set_limit(32 << 20);
+ * if (budget.try_reserve(size) == false)
+ *     return false; // drop the frame rather than growing
+ * // ...
+ * budget.release(size);
+ * ```
+ */
+class memory_budget_t final {
+    std::atomic<size_t> limit{};
+    std::atomic<size_t> bytes{};
+    std::atomic<size_t> peak{};
+    std::atomic<uint64_t> rejected{};
+
+   public:
+    memory_budget_t() noexcept = default;
+    ~memory_budget_t() noexcept = default;
+    memory_budget_t(const memory_budget_t&) = delete;
+    memory_budget_t(memory_budget_t&&) = delete;
+    memory_budget_t& operator=(const memory_budget_t&) = delete;
+    memory_budget_t& operator=(memory_budget_t&&) = delete;
+
+   private:
+    void update_peak(size_t value) noexcept;
+
+   public:
+    /// @param limit 0 to make it unlimited. The bytes over the new limit are not released
+    void set_limit(size_t limit) noexcept;
+
+    /// @return false if the `size` doesn't fit in the limit. Nothing is charged then
+    bool try_reserve(size_t size) noexcept;
+    /// @brief Charge the `size` even if it exceeds the limit
+    void charge(size_t size) noexcept;
+    void release(size_t size) noexcept;
+
+    /// @return true if the charged bytes are over the limit
+    bool is_exceeded() const noexcept;
+
+    memory_usage_t usage() const noexcept;
+    /// @brief Start the high-water mark again from the current bytes
+    void reset_peak() noexcept;
+};
+
+/**
+ * @brief Find the budget of the `name`. It's created with no limit if not found
+ * @throw bad_alloc
+ */
+memory_budget_t& get_memory_budget(std::string_view name) noexcept(false);
+
+/// @return names of the budgets in the order of the creation
+std::vector<std::string> get_memory_budget_names() noexcept(false);
+
+/**
+ * @brief RAII of the `memory_budget_t::charge`/`memory_budget_t::release` pair
+ */
+class memory_charge_t final {
+    memory_budget_t* budget = nullptr;
+    size_t bytes = 0;
+
+   public:
+    memory_charge_t() noexcept = default;
+    /// @brief Charge the `bytes` even if it exceeds the limit
+    memory_charge_t(memory_budget_t& budget, size_t bytes) noexcept;
+    ~memory_charge_t() noexcept;
+    memory_charge_t(const memory_charge_t&) = delete;
+    memory_charge_t(memory_charge_t&& rhs) noexcept;
+    memory_charge_t& operator=(const memory_charge_t&) = delete;
+    memory_charge_t& operator=(memory_charge_t&& rhs) noexcept;
+
+    /**
+     * @brief `memory_budget_t::try_reserve` with RAII
+     * @return empty charge if the `bytes` doesn't fit
+     */
+    static memory_charge_t try_reserve(memory_budget_t& budget, size_t bytes) noexcept;
+
+    /// @return false if nothing is charged
+    explicit operator bool() const noexcept { return budget != nullptr; }
+
+    /// @brief Release the charge
+    void reset() noexcept;
+    size_t size() const noexcept { return bytes; }
+};
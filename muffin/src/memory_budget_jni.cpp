@@ -0,0 +1,200 @@
+#include <jni.h>
+#include <spdlog/spdlog.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.hpp"
+#include "large_buffer.hpp"
+#include "memory_budget.hpp"
+#include "snapshot_writer.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+std::string make_string(JNIEnv* env, jstring str) noexcept(false);
+
+namespace {
+
+AHardwareBuffer_Desc make_rgba_desc(uint32_t width, uint32_t height) noexcept {
+    AHardwareBuffer_Desc desc{};
+    desc.width = width;
+    desc.height = height;
+    desc.layers = 1;
+    desc.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+    desc.usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN;
+    return desc;
+}
+
+}  // namespace
+
+extern "C" {
+
+/**
+ * @return names of the budgets which are used in the process
+ */
+JNIEXPORT jobjectArray Java_dev_luncliff_muffin_Environment_GetMemoryBudgets(JNIEnv* env, jclass) {
+    try {
+        const std::vector<std::string> names = get_memory_budget_names();
+        jobjectArray result = env->NewObjectArray(static_cast<jsize>(names.size()), env->FindClass("java/lang/String"),
+                                                  nullptr);
+        if (result == nullptr) return nullptr;
+        for (size_t i = 0; i < names.size(); ++i) {
+            jstring name = env->NewStringUTF(names[i].c_str());
+            env->SetObjectArrayElement(result, static_cast<jsize>(i), name);
+            env->DeleteLocalRef(name);
+        }
+        return result;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return nullptr;
+    }
+}
+
+/**
+ * @return limit, bytes, peak, rejected
+ */
+JNIEXPORT jlongArray Java_dev_luncliff_muffin_Environment_GetMemoryUsage(JNIEnv* env, jclass, jstring name) {
+    try {
+        const memory_usage_t usage = get_memory_budget(make_string(env, name)).usage();
+        const jlong values[4]{static_cast<jlong>(usage.limit), static_cast<jlong>(usage.bytes),
+                              static_cast<jlong>(usage.peak), static_cast<jlong>(usage.rejected)};
+        jlongArray result = env->NewLongArray(4);
+        if (result == nullptr) return nullptr;
+        env->SetLongArrayRegion(result, 0, 4, values);
+        return result;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return nullptr;
+    }
+}
+
+JNIEXPORT void Java_dev_luncliff_muffin_Environment_SetMemoryBudget(JNIEnv* env, jclass, jstring name, jlong limit) {
+    try {
+        if (limit < 0) throw std::invalid_argument{"limit must be 0 or positive"};
+        get_memory_budget(make_string(env, name)).set_limit(static_cast<size_t>(limit));
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+    }
+}
+
+/**
+ * @brief Reserve, charge over the limit, and release with `memory_charge_t`
+ * @return true if the usage and the high-water mark are correct
+ */
+JNIEXPORT jboolean Java_dev_luncliff_muffin_MemoryBudgetTest_reserveOverLimit(  //
+    JNIEnv* env, jclass) {
+    try {
+        memory_budget_t budget{};
+        budget.set_limit(1000);
+        {
+            memory_charge_t first = memory_charge_t::try_reserve(budget, 600);
+            if (!first) return false;
+            if (memory_charge_t::try_reserve(budget, 600)) return false;  // 1200 > 1000
+            memory_charge_t forced{budget, 600};                          // can't fail
+            if (budget.is_exceeded() == false) return false;
+            memory_charge_t moved = std::move(forced);
+            if (forced || moved.size() != 600) return false;
+        }
+        const memory_usage_t usage = budget.usage();
+        spdlog::info("{}: bytes {} peak {} rejected {}", __func__, usage.bytes, usage.peak, usage.rejected);
+        return usage.bytes == 0 && usage.peak == 1200 && usage.rejected == 1 && budget.is_exceeded() == false;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return false;
+    }
+}
+
+/**
+ * @brief 2 pools and a large buffer share a budget of 4 frames. The free buffers of a pool are evicted for the other
+ * @return number of the buffers evicted by the budget. -1 if the ENOMEM is not thrown
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_MemoryBudgetTest_evictForSharedBudget(  //
+    JNIEnv* env, jclass, jint width, jint height) {
+    try {
+        const AHardwareBuffer_Desc desc = make_rgba_desc(width, height);
+        const size_t frame = get_buffer_size(desc);
+        memory_budget_t budget{};
+        budget.set_limit(frame * 4);
+        buffer_pool_config_t config{};
+        config.budget = frame * 16;  // the pools alone would keep all buffers
+        config.memory = &budget;
+        memfd_buffer_allocator_t allocator{};
+        hardware_buffer_pool_t preview{allocator, config};
+        hardware_buffer_pool_t analysis{allocator, config};
+
+        large_buffer_options_t options{};
+        options.budget = &budget;
+        large_buffer_t scratch{frame, options};  // 1 frame
+        // 3 free buffers in the preview pool
+        buffer_lease_t leases[3]{};
+        for (auto& lease : leases) lease = preview.acquire(desc);
+        for (auto& lease : leases) preview.release(lease);
+        if (budget.usage().bytes != frame * 4) throw std::runtime_error{"the pool or the buffer is not charged"};
+
+        // the analysis pool can't evict the preview's buffers. but its own free buffers can be evicted
+        buffer_lease_t first{};
+        try {
+            first = analysis.acquire(desc);
+            spdlog::error("{}: {}", __func__, "acquired over the budget");
+            analysis.release(first);
+            return -1;
+        } catch (const std::system_error& ex) {
+            if (ex.code().value() != ENOMEM) throw;
+        }
+        preview.clear();
+        first = analysis.acquire(desc);
+        buffer_lease_t second = analysis.acquire(desc);
+        buffer_lease_t third = analysis.acquire(desc);
+        analysis.release(first);
+        // the other description can't be recycled. the released one is evicted for it
+        buffer_lease_t rotated = analysis.acquire(make_rgba_desc(height, width));
+        analysis.release(second);
+        analysis.release(third);
+        analysis.release(rotated);
+        if (budget.usage().bytes > frame * 4) throw std::runtime_error{"the budget is exceeded"};
+        return static_cast<jint>(analysis.stats().evicted);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -2;
+    }
+}
+
+/**
+ * @brief Write `count` frames while the I/O thread is busy, with the budget of `frames` copies
+ * @return number of the dropped frames
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_MemoryBudgetTest_dropSnapshots(  //
+    JNIEnv* env, jclass, jstring directory, jint width, jint height, jint frames, jint count) {
+    try {
+        const auto w = static_cast<uint32_t>(width), h = static_cast<uint32_t>(height);
+        std::vector<uint8_t> pixels(static_cast<size_t>(w) * h * 4, 0x7F);
+        const rgba_view_t src{plane_view_t<const uint8_t>{pixels.data(), w, h, static_cast<int32_t>(w * 4), 4}};
+        memory_budget_t budget{};
+        budget.set_limit(pixels.size() * frames);
+        const std::string folder = make_string(env, directory);
+        uint64_t dropped = 0;
+        {
+            snapshot_writer_t writer{get_default_pool(), static_cast<uint32_t>(count), &budget};
+            for (int i = 0; i < count; ++i) writer.write_png(src, folder + "/budget_" + std::to_string(i) + ".png");
+            if (budget.is_exceeded()) throw std::runtime_error{"the copies exceeded the budget"};
+            writer.flush();
+            dropped = writer.dropped();
+        }
+        const memory_usage_t usage = budget.usage();
+        spdlog::info("{}: dropped {} peak {} rejected {}", __func__, dropped, usage.peak, usage.rejected);
+        if (usage.bytes != 0) throw std::runtime_error{"the copies are not released"};
+        if (usage.rejected != dropped) throw std::runtime_error{"rejected != dropped"};
+        return static_cast<jint>(dropped);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+}  // extern "C"
@@ -0,0 +1,124 @@
+#include "motion_gate.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "image_pyramid.hpp"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+namespace {
+
+constexpr uint32_t block_size = 8;
+
+size_t align_up(size_t value, size_t alignment) noexcept { return (value + alignment - 1) / alignment * alignment; }
+
+#if defined(__SSE4_1__)
+
+/// @brief Add the SADs of 2 blocks in 16 pixels
+void add_sad16(const uint8_t* lhs, const uint8_t* rhs, uint32_t* sums) noexcept {
+    const __m128i sad = _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs)));
+    sums[0] += static_cast<uint32_t>(_mm_cvtsi128_si32(sad));
+    sums[1] += static_cast<uint32_t>(_mm_extract_epi16(sad, 4));
+}
+
+#elif defined(__ARM_NEON)
+
+void add_sad16(const uint8_t* lhs, const uint8_t* rhs, uint32_t* sums) noexcept {
+    const uint8x16_t diff = vabdq_u8(vld1q_u8(lhs), vld1q_u8(rhs));
+    const uint64x2_t sad = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(diff)));
+    sums[0] += static_cast<uint32_t>(vgetq_lane_u64(sad, 0));
+    sums[1] += static_cast<uint32_t>(vgetq_lane_u64(sad, 1));
+}
+
+#endif
+
+}  // namespace
+
+void add_block_sad(plane_view_t<const uint8_t> lhs, plane_view_t<const uint8_t> rhs, index_range_t rows,
+                   uint32_t* sums) noexcept {
+    const uint32_t width = std::min(lhs.width, rhs.width);
+    for (auto r = rows.begin; r < rows.end; ++r) {
+        const uint8_t* s0 = lhs.row(r);
+        const uint8_t* s1 = rhs.row(r);
+        uint32_t c = 0;
+#if defined(__SSE4_1__) || defined(__ARM_NEON)
+        for (; c + 16 <= width; c += 16) add_sad16(s0 + c, s1 + c, sums + c / block_size);
+#endif
+        for (; c < width; ++c) sums[c / block_size] += static_cast<uint32_t>(std::abs(s0[c] - s1[c]));
+    }
+}
+
+motion_gate_t::motion_gate_t(const motion_gate_config_t& config) noexcept(false) : config{config} {
+    if (config.max_width == 0) throw std::invalid_argument{"motion_gate_t: max_width must be positive"};
+    if (config.block_threshold > 255) throw std::invalid_argument{"motion_gate_t: block_threshold must be in [0, 255]"};
+    if (!(config.change_ratio >= 0 && config.change_ratio <= 1))
+        throw std::invalid_argument{"motion_gate_t: change_ratio must be in [0, 1]"};
+}
+
+void motion_gate_t::resize(uint32_t src_width, uint32_t src_height) noexcept(false) {
+    levels.clear();
+    views.clear();
+    uint32_t w = src_width, h = src_height;
+    while (w > config.max_width && w / 2 > 0 && h / 2 > 0) {
+        w /= 2;
+        h /= 2;
+        const auto row_stride = static_cast<int32_t>(align_up(w, 16));
+        auto& buffer = levels.emplace_back(static_cast<size_t>(row_stride) * h);
+        views.emplace_back(plane_view_t<uint8_t>{buffer.data(), w, h, row_stride, 1});
+    }
+    // the frame itself is compared if it's small enough
+    reference.assign(static_cast<size_t>(align_up(w, 16)) * h, 0);
+    block_sums.assign((w + block_size - 1) / block_size, 0);
+    width = src_width;
+    height = src_height;
+    has_reference = false;
+}
+
+bool motion_gate_t::update(plane_view_t<const uint8_t> luma) noexcept(false) {
+    if (luma.width == 0 || luma.height == 0) throw std::invalid_argument{"motion_gate_t: empty luma"};
+    if (luma.width != width || luma.height != height) resize(luma.width, luma.height);
+    plane_view_t<const uint8_t> current = luma;
+    for (const plane_view_t<uint8_t>& level : views) {
+        downscale_plane_2x(current, level, {0, level.height});
+        current = level;
+    }
+    const auto row_stride = static_cast<int32_t>(align_up(current.width, 16));
+    plane_view_t<uint8_t> previous{reference.data(), current.width, current.height, row_stride, 1};
+
+    last = motion_t{};
+    if (has_reference) {
+        for (uint32_t r = 0; r < current.height; r += block_size) {
+            std::fill(block_sums.begin(), block_sums.end(), 0);
+            const uint32_t rows = std::min(block_size, current.height - r);
+            add_block_sad(current, previous, {r, r + rows}, block_sums.data());
+            for (uint32_t b = 0; b < block_sums.size(); ++b) {
+                const uint32_t columns = std::min(block_size, current.width - b * block_size);
+                last.sad += block_sums[b];
+                if (block_sums[b] > config.block_threshold * columns * rows) ++last.changed_blocks;
+                ++last.blocks;
+            }
+        }
+        const bool changed = static_cast<float>(last.changed_blocks) >= config.change_ratio * last.blocks;
+        if (changed == false && (config.max_skip == 0 || skipped < config.max_skip)) {
+            ++skipped;
+            return false;
+        }
+    }
+    for (uint32_t r = 0; r < current.height; ++r)
+        std::copy_n(current.row(r), current.width, previous.row(r));
+    has_reference = true;
+    skipped = 0;
+    return true;
+}
+
+void motion_gate_t::reset() noexcept { has_reference = false; }
+
+const motion_t& motion_gate_t::motion() const noexcept { return last; }
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "image_view.hpp"
+
+/**
+ * @brief Thresholds of the `motion_gate_t`
+ */
+struct motion_gate_config_t final {
+    uint32_t max_width = 160;      // of the downsampled luma. The frame is halved until it fits
+    uint32_t block_threshold = 8;  // mean absolute difference of a 8x8 block to count it as changed
+    float change_ratio = 0.02f;    // ratio of the changed blocks to analyze the frame
+    uint32_t max_skip = 30;        // consecutive frames to skip at most. 0 for no limit
+};
+
+/**
+ * @brief Difference between the frame and the last analyzed frame, in the downsampled luma
+ */
+struct motion_t final {
+    uint64_t sad;             // sum of absolute differences
+    uint32_t changed_blocks;  // blocks over the `motion_gate_config_t::block_threshold`
+    uint32_t blocks;
+};
+
+/**
+ * @brief Frame-difference gate to skip the inference of the static scenes
+ * @details Each frame's luma is downsampled with the 2x2 box filter(`downscale_plane_2x`) until its width is not
+ *  greater than `max_width`. The result is compared with the one of the last analyzed frame in 8x8 blocks.
+ *  The frame is analyzed if enough blocks are changed, or `max_skip` frames are skipped in a row. Otherwise the
+ *  caller can reuse the last result.
+ *
+ *  The reference is not updated for the skipped frames, so a slow change accumulates until it passes the gate.
+ *
+ * ```cpp
+ * motion_gate_t gate{};
+ * // for each frame
+ * if (gate.update(make_yuv_view(lease).y))
+ *     run_inference(lease);
+ * ```
+ * @note Not thread-safe. The frames must be given in order
+ */
+class motion_gate_t final {
+    motion_gate_config_t config;
+    std::vector<std::vector<uint8_t>> levels{};  // downsampled luma. The last one is compared
+    std::vector<plane_view_t<uint8_t>> views{};
+    std::vector<uint8_t> reference{};  // last level of the last analyzed frame
+    std::vector<uint32_t> block_sums{};
+    uint32_t width = 0;  // of the source luma
+    uint32_t height = 0;
+    uint32_t skipped = 0;  // frames since the last analyzed one
+    bool has_reference = false;
+    motion_t last{};
+
+   public:
+    /// @throw invalid_argument if the thresholds are out of range
+    explicit motion_gate_t(const motion_gate_config_t& config = {}) noexcept(false);
+
+   private:
+    void resize(uint32_t width, uint32_t height) noexcept(false);
+
+   public:
+    /**
+     * @brief Downsample the `luma` and compare it with the reference
+     * @details The buffers are allocated again if the size is changed. Then the frame is analyzed.
+     * @return true if the frame must be analyzed. The frame becomes the reference
+     * @throw invalid_argument if the `luma` is empty
+     */
+    bool update(plane_view_t<const uint8_t> luma) noexcept(false);
+
+    /// @brief Analyze the next frame regardless of the difference
+    void reset() noexcept;
+
+    /// @brief The metric of the last `update`
+    const motion_t& motion() const noexcept;
+};
+
+/**
+ * @brief SAD of 2 planes in 8x8 blocks
+ * @param sums block sums of `(width + 7) / 8` columns. The differences of `rows` are added
+ * @note The planes must have `pixel_stride` 1
+ */
+void add_block_sad(plane_view_t<const uint8_t> lhs, plane_view_t<const uint8_t> rhs, index_range_t rows,
+                   uint32_t* sums) noexcept;
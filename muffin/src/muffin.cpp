@@ -5,6 +5,7 @@
 #include <android/native_window_jni.h>
 #include <dlfcn.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <spdlog/sinks/android_sink.h>
 #include <spdlog/spdlog.h>
 #include <sys/epoll.h>
@@ -15,11 +16,14 @@
 
 #include <chrono>
 
+static JavaVM* java_vm = nullptr;
+
 extern "C" jint JNI_OnLoad(JavaVM* vm, void*) {
     constexpr auto version = JNI_VERSION_1_6;
     JNIEnv* env{};
     jint result = -1;
     if (vm->GetEnv((void**)&env, version) != JNI_OK) return result;
+    java_vm = vm;
 
     auto stream = spdlog::android_logger_st("android", "muffin");
     stream->set_pattern("%v");                // Logcat will report time, thread, and level.
@@ -54,6 +58,67 @@ void store_runtime_exception(JNIEnv* env, const char* message) noexcept {
 
 static_assert(sizeof(void*) <= sizeof(jlong), "`jlong` must be able to contain `void*` pointer");
 
+JavaVM* get_java_vm() noexcept { return java_vm; }
+
+/**
+ * @brief Per-thread `JNIEnv` cache. Detach in its destructor only when the thread was attached by it
+ * @note Java threads already have their `JNIEnv`. They must not be detached by us
+ */
+class jni_thread_env_t final {
+    JNIEnv* env = nullptr;
+    bool attached = false;
+
+   public:
+    ~jni_thread_env_t() noexcept {
+        if (attached) java_vm->DetachCurrentThread();
+    }
+
+    JNIEnv* get() noexcept(false) {
+        if (env) return env;
+        if (java_vm == nullptr) throw std::runtime_error{"JavaVM is not retained"};
+        switch (auto ec = java_vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6)) {
+            case JNI_OK:
+                return env;
+            case JNI_EDETACHED:
+                break;
+            default:
+                throw std::runtime_error{fmt::format("{}: {}", "GetEnv", ec)};
+        }
+        char name[16]{};  // Linux limits the name to 16 bytes
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        JavaVMAttachArgs args{JNI_VERSION_1_6, name, nullptr};
+        if (auto ec = java_vm->AttachCurrentThread(&env, &args); ec != JNI_OK) {
+            env = nullptr;
+            throw std::runtime_error{fmt::format("{}: {}", "AttachCurrentThread", ec)};
+        }
+        attached = true;
+        spdlog::debug("{}: {}", "AttachCurrentThread", name);
+        return env;
+    }
+};
+
+JNIEnv* get_jni_env() noexcept(false) {
+    thread_local jni_thread_env_t cache{};
+    return cache.get();
+}
+
+jni_local_frame_t::jni_local_frame_t(JNIEnv* env, jint capacity) noexcept(false) : handle{env}, capacity{capacity} {
+    if (handle->PushLocalFrame(capacity) != JNI_OK) throw std::runtime_error{"PushLocalFrame"};
+    pushed = true;
+}
+
+jni_local_frame_t::~jni_local_frame_t() noexcept {
+    if (pushed) handle->PopLocalFrame(nullptr);
+}
+
+JNIEnv* jni_local_frame_t::env() const noexcept { return handle; }
+
+void jni_local_frame_t::recycle() noexcept(false) {
+    if (pushed) handle->PopLocalFrame(nullptr);
+    pushed = handle->PushLocalFrame(capacity) == JNI_OK;
+    if (pushed == false) throw std::runtime_error{"PushLocalFrame"};
+}
+
 native_loader_t::native_loader_t(const char* libname) noexcept(false) : native_loader_t{} { load(libname); }
 
 native_loader_t::~native_loader_t() noexcept {
@@ -100,6 +165,14 @@ ptrdiff_t epoll_owner_t::wait(uint32_t wait_ms, epoll_event* ptr, int count) noe
     return static_cast<ptrdiff_t>(count);
 }
 
+ptrdiff_t resume_ready(epoll_owner_t& ep, uint32_t wait_ms) noexcept(false) {
+    epoll_event events[16]{};
+    const auto count = ep.wait(wait_ms, events, 16);
+    for (ptrdiff_t i = 0; i < count; ++i)
+        if (void* ptr = events[i].data.ptr) std::experimental::coroutine_handle<void>::from_address(ptr).resume();
+    return count;
+}
+
 //
 //  We are going to combine file descriptor and state bit
 //
@@ -8,15 +8,71 @@ static_assert(__cplusplus >= 201703L, "requires C++ 17 or later");
 #include <GLES3/gl31.h>
 #include <android/api-level.h>
 #include <android/hardware_buffer.h>
+#include <jni.h>
 #include <sys/epoll.h>
 
 #include <cerrno>
+#include <exception>
 #include <experimental/coroutine>
 #include <system_error>
 
 #include "egl_context.hpp"
 #include "egl_surface.hpp"
 
+/**
+ * @brief `JavaVM` retained in `JNI_OnLoad`
+ * @return nullptr if the library is not loaded with `System.loadLibrary`
+ * @ingroup JNI
+ */
+JavaVM* get_java_vm() noexcept;
+
+/**
+ * @brief `JNIEnv` of the current thread. Native threads are attached to the `JavaVM` on their first call
+ * @details The `JNIEnv` is cached in thread-local storage and the thread is detached when it exits.
+ *  Callbacks from native workers can use this instead of `AttachCurrentThread`/`DetachCurrentThread` pair.
+ * @throw runtime_error if there is no `JavaVM` or the attach failed
+ * @ingroup JNI
+ */
+JNIEnv* get_jni_env() noexcept(false);
+
+/**
+ * @brief RAII for `PushLocalFrame`/`PopLocalFrame`
+ * @ingroup JNI
+ *
+ * Local references are recycled per batch so a long-living native thread doesn't leak them.
+ *
+ * ```cpp
+ * jni_local_frame_t frame{get_jni_env(), 8};
+ * for (auto& result : batch) {
+ *     deliver(frame.env(), result);  // creates some local references
+ *     frame.recycle();               // release them before the next one
+ * }
+ * ```
+ */
+class jni_local_frame_t final {
+    JNIEnv* handle;
+    jint capacity;
+    bool pushed = false;
+
+   public:
+    /**
+     * @throw runtime_error if `PushLocalFrame` failed
+     */
+    jni_local_frame_t(JNIEnv* env, jint capacity) noexcept(false);
+    ~jni_local_frame_t() noexcept;
+    jni_local_frame_t(const jni_local_frame_t&) = delete;
+    jni_local_frame_t(jni_local_frame_t&&) = delete;
+    jni_local_frame_t& operator=(const jni_local_frame_t&) = delete;
+    jni_local_frame_t& operator=(jni_local_frame_t&&) = delete;
+
+    JNIEnv* env() const noexcept;
+    /**
+     * @brief Pop the current frame and push a new one with same capacity
+     * @throw runtime_error if `PushLocalFrame` failed
+     */
+    void recycle() noexcept(false);
+};
+
 class native_loader_t final {
     void* handle;
 
@@ -29,6 +85,20 @@ class native_loader_t final {
     void* get_proc_address(const char* proc) const noexcept;
 };
 
+/**
+ * @brief Return type for the coroutines which nobody awaits. Its frame is destroyed when the coroutine returns
+ * @ingroup Coroutine
+ */
+struct forget_frame_t final {
+    struct promise_type final {
+        std::experimental::suspend_never initial_suspend() noexcept { return {}; }
+        std::experimental::suspend_never final_suspend() noexcept { return {}; }
+        void unhandled_exception() noexcept { std::terminate(); }
+        void return_void() noexcept {}
+        forget_frame_t get_return_object() noexcept { return {}; }
+    };
+};
+
 /**
  * @brief RAII wrapping for epoll file descriptor
  * @ingroup Linux
@@ -119,6 +189,15 @@ class epoll_owner_t final {
     }
 };
 
+/**
+ * @brief Wait for the events of `epoll_owner_t` and resume the coroutines in their `epoll_event::data.ptr`
+ * @return number of the received events. 0 if timeout
+ * @see epoll_owner_t::submit
+ * @throw system_error
+ * @ingroup Linux
+ */
+ptrdiff_t resume_ready(epoll_owner_t& ep, uint32_t wait_ms) noexcept(false);
+
 /**
  * @brief RAII + stateful `eventfd`
  * @see https://github.com/grpc/grpc/blob/master/src/core/lib/iomgr/is_epollexclusive_available.cc
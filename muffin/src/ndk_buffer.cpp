@@ -1,6 +1,15 @@
 #include "ndk_buffer.hpp"
 
+#include <dlfcn.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "muffin.hpp"
 
 ndk_hardware_buffer_t::ndk_hardware_buffer_t(AImage* image) noexcept(false) {
     if (AImage_getHardwareBuffer(image, &ptr) != 0) throw std::runtime_error{"AImage_getHardwareBuffer"};
@@ -8,9 +17,9 @@ ndk_hardware_buffer_t::ndk_hardware_buffer_t(AImage* image) noexcept(false) {
 }
 
 ndk_hardware_buffer_t::ndk_hardware_buffer_t(int socket) noexcept(false) {
+    // the received buffer is already acquired for the caller
     if (AHardwareBuffer_recvHandleFromUnixSocket(socket, &ptr) != 0)
         throw std::runtime_error{"AHardwareBuffer_recvHandleFromUnixSocket"};
-    AHardwareBuffer_acquire(ptr);
 }
 
 ndk_hardware_buffer_t::ndk_hardware_buffer_t(const AHardwareBuffer_Desc& desc) noexcept(false) {
@@ -23,33 +32,35 @@ ndk_hardware_buffer_t::ndk_hardware_buffer_t(JNIEnv* env, jobject object) noexce
     AHardwareBuffer_acquire(ptr);
 }
 
-ndk_hardware_buffer_t::~ndk_hardware_buffer_t() noexcept { AHardwareBuffer_release(ptr); }
+ndk_hardware_buffer_t::~ndk_hardware_buffer_t() noexcept { reset(); }
 
-ndk_hardware_buffer_t::ndk_hardware_buffer_t(const ndk_hardware_buffer_t& rhs) noexcept(false) {
-    ptr = rhs.ptr;
-    AHardwareBuffer_acquire(ptr);
+ndk_hardware_buffer_t::ndk_hardware_buffer_t(const ndk_hardware_buffer_t& rhs) noexcept : ptr{rhs.ptr} {
+    if (ptr) AHardwareBuffer_acquire(ptr);
 }
 
-ndk_hardware_buffer_t::ndk_hardware_buffer_t(ndk_hardware_buffer_t&& rhs) noexcept(false) {
-    AHardwareBuffer_acquire(rhs.ptr);
-    AHardwareBuffer_release(ptr);
-    ptr = rhs.ptr;
-}
+ndk_hardware_buffer_t::ndk_hardware_buffer_t(ndk_hardware_buffer_t&& rhs) noexcept
+    : ptr{std::exchange(rhs.ptr, nullptr)} {}
 
-ndk_hardware_buffer_t& ndk_hardware_buffer_t::operator=(const ndk_hardware_buffer_t& rhs) noexcept(false) {
-    AHardwareBuffer_acquire(rhs.ptr);
-    AHardwareBuffer_release(ptr);
+ndk_hardware_buffer_t& ndk_hardware_buffer_t::operator=(const ndk_hardware_buffer_t& rhs) noexcept {
+    // acquire first. `rhs` may be `*this`
+    if (rhs.ptr) AHardwareBuffer_acquire(rhs.ptr);
+    reset();
     ptr = rhs.ptr;
     return *this;
 }
 
-ndk_hardware_buffer_t& ndk_hardware_buffer_t::operator=(ndk_hardware_buffer_t&& rhs) noexcept(false) {
-    AHardwareBuffer_acquire(rhs.ptr);
-    AHardwareBuffer_release(ptr);
-    ptr = rhs.ptr;
+ndk_hardware_buffer_t& ndk_hardware_buffer_t::operator=(ndk_hardware_buffer_t&& rhs) noexcept {
+    if (this == &rhs) return *this;
+    reset();
+    ptr = std::exchange(rhs.ptr, nullptr);
     return *this;
 }
 
+void ndk_hardware_buffer_t::reset() noexcept {
+    if (ptr) AHardwareBuffer_release(ptr);
+    ptr = nullptr;
+}
+
 jobject ndk_hardware_buffer_t::object(JNIEnv* env) const noexcept { return AHardwareBuffer_toHardwareBuffer(env, ptr); }
 
 void ndk_hardware_buffer_t::send_to(int socket) noexcept(false) {
@@ -58,7 +69,11 @@ void ndk_hardware_buffer_t::send_to(int socket) noexcept(false) {
 }
 
 void ndk_hardware_buffer_t::get(AHardwareBuffer_Desc& desc) const noexcept {
-    AHardwareBuffer_describe(ptr, &desc);  // ...
+    if (ptr == nullptr) {
+        desc = AHardwareBuffer_Desc{};
+        return;
+    }
+    AHardwareBuffer_describe(ptr, &desc);
 }
 
 void* ndk_hardware_buffer_t::lock(uint64_t usage, int32_t fence) noexcept(false) {
@@ -68,6 +83,150 @@ void* ndk_hardware_buffer_t::lock(uint64_t usage, int32_t fence) noexcept(false)
     return mapping;
 }
 
-void ndk_hardware_buffer_t::unlock(int32_t* fence) noexcept(false) {
-    if (AHardwareBuffer_unlock(ptr, fence) != 0) throw std::runtime_error{"AHardwareBuffer_unlock"};
+int32_t ndk_hardware_buffer_t::unlock() noexcept(false) {
+    int32_t fence = -1;
+    if (AHardwareBuffer_unlock(ptr, &fence) != 0) throw std::runtime_error{"AHardwareBuffer_unlock"};
+    return fence;
+}
+
+ndk_hardware_buffer_t::scoped_lock_t ndk_hardware_buffer_t::lock_planes(uint64_t usage, int32_t fence) noexcept(false) {
+    if (ptr == nullptr) {
+        if (fence >= 0) close(fence);
+        throw std::runtime_error{"ndk_hardware_buffer_t is empty"};
+    }
+    return scoped_lock_t{ptr, usage, fence};
+}
+
+ndk_hardware_buffer_t::lock_awaiter_t ndk_hardware_buffer_t::lock_async(epoll_owner_t& ep, uint64_t usage,
+                                                                        int32_t fence) noexcept(false) {
+    if (ptr == nullptr) {
+        if (fence >= 0) close(fence);
+        throw std::runtime_error{"ndk_hardware_buffer_t is empty"};
+    }
+    return lock_awaiter_t{ep, ptr, usage, fence};
+}
+
+ndk_hardware_buffer_t::lock_awaiter_t::lock_awaiter_t(epoll_owner_t& ep, AHardwareBuffer* buffer, uint64_t usage,
+                                                      int32_t fence) noexcept
+    : ep{ep}, ptr{buffer}, usage{usage}, fence{fence} {}
+
+ndk_hardware_buffer_t::lock_awaiter_t::~lock_awaiter_t() noexcept {
+    if (fence >= 0) close(fence);
+}
+
+bool ndk_hardware_buffer_t::lock_awaiter_t::await_ready() const noexcept {
+    if (fence < 0) return true;
+    pollfd req{fence, POLLIN, 0};
+    return poll(&req, 1, 0) > 0;  // signaled. or broken, and `await_resume` will report it
+}
+
+void ndk_hardware_buffer_t::lock_awaiter_t::await_suspend(  //
+    std::experimental::coroutine_handle<void> coro) noexcept(false) {
+    req.events = EPOLLIN | EPOLLONESHOT;
+    req.data.ptr = coro.address();
+    ep.try_add(fence, req);
+}
+
+ndk_hardware_buffer_t::scoped_lock_t ndk_hardware_buffer_t::lock_awaiter_t::await_resume() noexcept(false) {
+    if (fence >= 0) {
+        if (req.data.ptr) ep.remove(fence);
+        pollfd status{fence, POLLIN, 0};
+        if (poll(&status, 1, 0) == -1) throw std::system_error{errno, std::system_category(), "poll"};
+        if (status.revents & (POLLERR | POLLNVAL)) throw std::runtime_error{"the acquire fence is broken"};
+        // the fence is signaled. the lock doesn't have to wait for it again
+        close(std::exchange(fence, -1));
+    }
+    return scoped_lock_t{ptr, usage, -1};
+}
+
+using lock_planes_t = int (*)(AHardwareBuffer*, uint64_t, int32_t, const ARect*, AHardwareBuffer_Planes*);
+
+/// @return null before API 29
+lock_planes_t get_lock_planes() noexcept {
+    static const auto fn = reinterpret_cast<lock_planes_t>(dlsym(RTLD_DEFAULT, "AHardwareBuffer_lockPlanes"));
+    return fn;
+}
+
+/// @return 0 if the format has multiple planes
+uint32_t get_bytes_per_pixel(const AHardwareBuffer_Desc& desc) noexcept {
+    switch (desc.format) {
+        case AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420:
+            return 0;
+        case AHARDWAREBUFFER_FORMAT_BLOB:
+            return 1;
+        case AHARDWAREBUFFER_FORMAT_R5G6B5_UNORM:
+            return 2;
+        case AHARDWAREBUFFER_FORMAT_R8G8B8_UNORM:
+            return 3;
+        case AHARDWAREBUFFER_FORMAT_R16G16B16A16_FLOAT:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+ndk_hardware_buffer_t::scoped_lock_t::scoped_lock_t(AHardwareBuffer* buffer, uint64_t usage,
+                                                    int32_t fence) noexcept(false) {
+    AHardwareBuffer_describe(buffer, &desc);
+    if (auto lock_planes = get_lock_planes()) {
+        AHardwareBuffer_Planes output{};
+        if (lock_planes(buffer, usage, fence, nullptr, &output) != 0)
+            throw std::runtime_error{"AHardwareBuffer_lockPlanes"};
+        count = std::min<uint32_t>(output.planeCount, planes.size());
+        for (uint32_t i = 0; i < count; ++i) {
+            const AHardwareBuffer_Plane& plane = output.planes[i];
+            planes[i] = plane_t{static_cast<uint8_t*>(plane.data), plane.rowStride, plane.pixelStride};
+        }
+        ptr = buffer;
+        return;
+    }
+    const uint32_t bytes_per_pixel = get_bytes_per_pixel(desc);
+    if (bytes_per_pixel == 0) {
+        if (fence >= 0) close(fence);
+        throw std::runtime_error{"AHardwareBuffer_lockPlanes requires API 29"};
+    }
+    void* mapping = nullptr;
+    if (AHardwareBuffer_lock(buffer, usage, fence, nullptr, &mapping) != 0)
+        throw std::runtime_error{"AHardwareBuffer_lock"};
+    // `stride` is in pixels
+    planes[0] = plane_t{static_cast<uint8_t*>(mapping), desc.stride * bytes_per_pixel, bytes_per_pixel};
+    count = 1;
+    ptr = buffer;
+}
+
+ndk_hardware_buffer_t::scoped_lock_t::~scoped_lock_t() noexcept { reset(); }
+
+void ndk_hardware_buffer_t::scoped_lock_t::reset() noexcept {
+    if (ptr == nullptr) return;
+    int32_t fence = -1;
+    AHardwareBuffer_unlock(std::exchange(ptr, nullptr), &fence);
+    if (fence >= 0) close(fence);
+}
+
+ndk_hardware_buffer_t::scoped_lock_t::scoped_lock_t(scoped_lock_t&& rhs) noexcept
+    : ptr{std::exchange(rhs.ptr, nullptr)}, desc{rhs.desc}, count{rhs.count}, planes{rhs.planes} {}
+
+ndk_hardware_buffer_t::scoped_lock_t& ndk_hardware_buffer_t::scoped_lock_t::operator=(scoped_lock_t&& rhs) noexcept {
+    if (this == &rhs) return *this;
+    reset();
+    ptr = std::exchange(rhs.ptr, nullptr);
+    desc = rhs.desc;
+    count = rhs.count;
+    planes = rhs.planes;
+    return *this;
+}
+
+const ndk_hardware_buffer_t::plane_t& ndk_hardware_buffer_t::scoped_lock_t::plane(uint32_t index) const
+    noexcept(false) {
+    if (index >= count) throw std::out_of_range{"scoped_lock_t::plane"};
+    return planes[index];
+}
+
+int32_t ndk_hardware_buffer_t::scoped_lock_t::unlock() noexcept(false) {
+    int32_t fence = -1;
+    if (ptr == nullptr) return fence;
+    const int ec = AHardwareBuffer_unlock(std::exchange(ptr, nullptr), &fence);
+    count = 0;
+    if (ec != 0) throw std::runtime_error{"AHardwareBuffer_unlock"};
+    return fence;
 }
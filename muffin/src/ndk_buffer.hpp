@@ -2,27 +2,163 @@
 #include <android/hardware_buffer_jni.h>
 #include <media/NdkImage.h>
 
+#include <sys/epoll.h>
+
+#include <array>
+#include <cstdint>
+#include <experimental/coroutine>
+
+class epoll_owner_t;
+
+/**
+ * @brief Reference of `AHardwareBuffer`
+ * @details The copy acquires the buffer. The move steals the pointer without touching the reference count,
+ *  so the handles can be moved through the queues for free. The moved-from handle is empty.
+ */
 class ndk_hardware_buffer_t final {
     AHardwareBuffer* ptr = nullptr;
 
    public:
+    /**
+     * @brief CPU address of a plane. `row_stride` and `pixel_stride` are in bytes
+     */
+    struct plane_t final {
+        uint8_t* data;
+        uint32_t row_stride;
+        uint32_t pixel_stride;
+    };
+
+    /**
+     * @brief RAII of `AHardwareBuffer_lock`/`AHardwareBuffer_unlock` with the views of the planes
+     * @details `AHardwareBuffer_lockPlanes` is used if the device is API 29 or later.
+     *  Before that, only the single-plane formats can be locked.
+     *
+     * ```cpp
+     * auto mapping = buffer.lock_planes(AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN);
+     * const auto& y = mapping.plane(0);
+     * // ...
+     * int32_t fence = mapping.unlock(); // for the next consumer. or close it
+     * ```
+     */
+    class scoped_lock_t final {
+        AHardwareBuffer* ptr = nullptr;  // not acquired. the buffer must outlive the lock
+        AHardwareBuffer_Desc desc{};
+        uint32_t count = 0;
+        std::array<plane_t, 4> planes{};
+
+       private:
+        /// @brief Unlock and close the release fence
+        void reset() noexcept;
+
+       public:
+        /**
+         * @param fence acquire fence. The function owns it
+         * @throw runtime_error
+         */
+        scoped_lock_t(AHardwareBuffer* buffer, uint64_t usage, int32_t fence) noexcept(false);
+        /// @note The release fence is closed if `unlock` is not invoked
+        ~scoped_lock_t() noexcept;
+        scoped_lock_t(const scoped_lock_t&) = delete;
+        scoped_lock_t(scoped_lock_t&& rhs) noexcept;
+        scoped_lock_t& operator=(const scoped_lock_t&) = delete;
+        scoped_lock_t& operator=(scoped_lock_t&& rhs) noexcept;
+
+        /// @return false if unlocked
+        explicit operator bool() const noexcept { return ptr != nullptr; }
+
+        const AHardwareBuffer_Desc& describe() const noexcept { return desc; }
+        uint32_t plane_count() const noexcept { return count; }
+        /// @throw out_of_range
+        const plane_t& plane(uint32_t index) const noexcept(false);
+
+        /**
+         * @return release fence. -1 if the writes are already done. The caller must close it
+         * @throw runtime_error
+         */
+        int32_t unlock() noexcept(false);
+    };
+
+    /**
+     * @brief Awaiter of `lock_async`. Suspends until the acquire fence is signaled, and locks the planes
+     * @details The sync_file fds are pollable, so the fence is waited through the `epoll_owner_t`
+     *  instead of blocking the thread in `AHardwareBuffer_lock`. The awaiter owns the fence.
+     */
+    class lock_awaiter_t final {
+        epoll_owner_t& ep;
+        AHardwareBuffer* ptr;
+        uint64_t usage;
+        int32_t fence;
+        epoll_event req{};
+
+       public:
+        lock_awaiter_t(epoll_owner_t& ep, AHardwareBuffer* buffer, uint64_t usage, int32_t fence) noexcept;
+        /// @brief Close the fence if it is not awaited
+        ~lock_awaiter_t() noexcept;
+        lock_awaiter_t(const lock_awaiter_t&) = delete;
+        lock_awaiter_t(lock_awaiter_t&&) = delete;
+        lock_awaiter_t& operator=(const lock_awaiter_t&) = delete;
+        lock_awaiter_t& operator=(lock_awaiter_t&&) = delete;
+
+        /// @return true if there is no fence or it is already signaled
+        bool await_ready() const noexcept;
+        /// @throw system_error
+        void await_suspend(std::experimental::coroutine_handle<void> coro) noexcept(false);
+        /// @throw runtime_error if the fence is signaled with an error, or the lock failed
+        scoped_lock_t await_resume() noexcept(false);
+    };
+
+   public:
+    ndk_hardware_buffer_t() noexcept = default;
     explicit ndk_hardware_buffer_t(AImage* image) noexcept(false);
     explicit ndk_hardware_buffer_t(int socket) noexcept(false);
     explicit ndk_hardware_buffer_t(const AHardwareBuffer_Desc& desc) noexcept(false);
     ndk_hardware_buffer_t(JNIEnv* env, jobject object) noexcept(false);
     ~ndk_hardware_buffer_t() noexcept;
-    ndk_hardware_buffer_t(const ndk_hardware_buffer_t&) noexcept(false);
-    ndk_hardware_buffer_t(ndk_hardware_buffer_t&&) noexcept(false);
-    ndk_hardware_buffer_t& operator=(const ndk_hardware_buffer_t&) noexcept(false);
-    ndk_hardware_buffer_t& operator=(ndk_hardware_buffer_t&&) noexcept(false);
+    ndk_hardware_buffer_t(const ndk_hardware_buffer_t& rhs) noexcept;
+    ndk_hardware_buffer_t(ndk_hardware_buffer_t&& rhs) noexcept;
+    ndk_hardware_buffer_t& operator=(const ndk_hardware_buffer_t& rhs) noexcept;
+    ndk_hardware_buffer_t& operator=(ndk_hardware_buffer_t&& rhs) noexcept;
 
     jobject object(JNIEnv* env) const noexcept;
 
     constexpr AHardwareBuffer* operator()() const noexcept { return ptr; }
+    explicit operator bool() const noexcept { return ptr != nullptr; }
+
+    /// @brief Release the reference and make the handle empty
+    void reset() noexcept;
 
     void get(AHardwareBuffer_Desc& desc) const noexcept;
     void send_to(int socket) noexcept(false);
 
+    /**
+     * @param fence acquire fence. The function owns it
+     * @throw runtime_error
+     */
     void* lock(uint64_t usage, int32_t fence = -1) noexcept(false);
-    void unlock(int32_t* fence = nullptr) noexcept(false);
+    /**
+     * @return release fence. -1 if the writes are already done. The caller must close it or pass it to the next lock
+     * @throw runtime_error
+     */
+    int32_t unlock() noexcept(false);
+
+    /**
+     * @param fence acquire fence. The function owns it
+     * @throw runtime_error if the buffer is empty, the lock failed, or the format has multiple planes before API 29
+     */
+    scoped_lock_t lock_planes(uint64_t usage, int32_t fence = -1) noexcept(false);
+
+    /**
+     * @brief Wait for the producer without blocking the thread, and lock the planes
+     * @param fence acquire fence from the producer. The awaiter owns it
+     * @throw runtime_error if the buffer is empty
+     *
+     * ```cpp
+     * auto consume_async(epoll_owner_t& ep, ndk_hardware_buffer_t buffer, int32_t fence) -> forget_frame_t {
+     *     auto mapping = co_await buffer.lock_async(ep, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, fence);
+     *     // ... resumed by `resume_ready(ep, ...)` after the producer is done
+     *     fence = mapping.unlock(); // the next consumer can chain on it
+     * }
+     * ```
+     */
+    lock_awaiter_t lock_async(epoll_owner_t& ep, uint64_t usage, int32_t fence = -1) noexcept(false);
 };
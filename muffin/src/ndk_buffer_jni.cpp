@@ -0,0 +1,214 @@
+#include <jni.h>
+#include <spdlog/spdlog.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <deque>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+
+#include "image_view.hpp"
+#include "muffin.hpp"
+#include "ndk_buffer.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+
+static_assert(std::is_nothrow_move_constructible_v<ndk_hardware_buffer_t>);
+static_assert(std::is_nothrow_move_assignable_v<ndk_hardware_buffer_t>);
+
+namespace {
+
+AHardwareBuffer_Desc make_cpu_desc(uint32_t format, uint32_t width, uint32_t height) noexcept {
+    AHardwareBuffer_Desc desc{};
+    desc.width = width;
+    desc.height = height;
+    desc.layers = 1;
+    desc.format = format;
+    desc.usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN;
+    return desc;
+}
+
+struct fence_lock_result_t final {
+    bool done = false;
+    int32_t fence = -1;  // release fence of the unlock
+    uint8_t value = 0;   // first byte of the buffer
+};
+
+forget_frame_t write_async(epoll_owner_t& ep, ndk_hardware_buffer_t& buffer, int32_t fence, uint8_t value,
+                           fence_lock_result_t& result) noexcept {
+    try {
+        auto mapping = co_await buffer.lock_async(ep, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, fence);
+        mapping.plane(0).data[0] = value;
+        result.value = value;
+        result.fence = mapping.unlock();
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", "write_async", ex.what());
+    }
+    result.done = true;
+}
+
+forget_frame_t read_async(epoll_owner_t& ep, ndk_hardware_buffer_t& buffer, int32_t fence,
+                          fence_lock_result_t& result) noexcept {
+    try {
+        auto mapping = co_await buffer.lock_async(ep, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, fence);
+        result.value = mapping.plane(0).data[0];
+        result.fence = mapping.unlock();
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", "read_async", ex.what());
+    }
+    result.done = true;
+}
+
+}  // namespace
+
+extern "C" {
+
+/**
+ * @brief Move the buffer through a queue for `repeat` times
+ * @return true if the buffer is same after the moves and the moved-from handles are empty
+ */
+JNIEXPORT jboolean Java_dev_luncliff_muffin_HardwareBufferTest_moveThroughQueue(  //
+    JNIEnv* env, jclass, jint repeat) {
+    try {
+        ndk_hardware_buffer_t origin{make_cpu_desc(AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM, 64, 64)};
+        AHardwareBuffer* expected = origin();
+        std::deque<ndk_hardware_buffer_t> queue{};
+        queue.emplace_back(std::move(origin));
+        if (origin) return false;
+        for (int i = 0; i < repeat; ++i) {
+            ndk_hardware_buffer_t item = std::move(queue.front());
+            queue.pop_front();
+            queue.emplace_back(std::move(item));
+            if (item) return false;
+        }
+        // the copy shares the buffer, and the moved-from copy can be reset or assigned again
+        ndk_hardware_buffer_t copy = queue.front();
+        ndk_hardware_buffer_t moved = std::move(copy);
+        copy.reset();
+        copy = moved;
+        return queue.front()() == expected && moved() == expected && copy() == expected;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return false;
+    }
+}
+
+/**
+ * @brief Write each plane with `lock_planes`, and read them again after the unlock
+ * @return number of the planes. 0 if the planes are different
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_HardwareBufferTest_lockPlanes(  //
+    JNIEnv* env, jclass, jint format, jint width, jint height) {
+    try {
+        ndk_hardware_buffer_t buffer{make_cpu_desc(format, width, height)};
+        auto writing = buffer.lock_planes(AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN);
+        const uint32_t count = writing.plane_count();
+        for (uint32_t i = 0; i < count; ++i) {
+            const ndk_hardware_buffer_t::plane_t& plane = writing.plane(i);
+            plane.data[0] = static_cast<uint8_t>(i + 1);
+            plane.data[plane.row_stride + plane.pixel_stride] = static_cast<uint8_t>(i + 11);
+        }
+        if (int32_t fence = writing.unlock(); fence >= 0) close(fence);
+
+        auto reading = buffer.lock_planes(AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN);
+        for (uint32_t i = 0; i < count; ++i) {
+            const ndk_hardware_buffer_t::plane_t& plane = reading.plane(i);
+            if (plane.data[0] != i + 1 || plane.data[plane.row_stride + plane.pixel_stride] != i + 11) return 0;
+        }
+        if (format == AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420) {
+            const yuv_view_t view = make_yuv_view(reading);
+            if (view.y.at(1, 1) != 11 || view.u.at(1, 1) != 12 || view.v.at(1, 1) != 13) return 0;
+        }
+        return static_cast<jint>(count);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Lock with an `eventfd` as the acquire fence, and signal it after `delay` milliseconds on the same thread.
+ *  A blocking lock would never return. The release fence of the writer is chained to the reader
+ * @return number of the `resume_ready` timeouts before the writer is resumed. 0 if it didn't suspend
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_HardwareBufferTest_lockAfterFence(  //
+    JNIEnv* env, jclass, jint delay) {
+    using namespace std::chrono;
+    try {
+        ndk_hardware_buffer_t buffer{make_cpu_desc(AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM, 64, 64)};
+        // sync_file stand-in. both of them are readable when signaled
+        const int fence = eventfd(0, EFD_CLOEXEC);
+        if (fence == -1) throw std::system_error{errno, std::system_category(), "eventfd"};
+        const uint64_t signal = 1;
+        if (delay == 0 && write(fence, &signal, sizeof(signal)) == -1)
+            throw std::system_error{errno, std::system_category(), "write"};
+
+        epoll_owner_t ep{};
+        fence_lock_result_t writer{};
+        write_async(ep, buffer, fence, 7, writer);  // the fence is moved to the awaiter
+        uint32_t timeouts = 0;
+        const auto until = steady_clock::now() + milliseconds{delay};
+        bool signaled = delay == 0;
+        while (writer.done == false) {
+            if (signaled == false && steady_clock::now() >= until) {
+                if (write(fence, &signal, sizeof(signal)) == -1)
+                    throw std::system_error{errno, std::system_category(), "write"};
+                signaled = true;
+            }
+            if (resume_ready(ep, 5) == 0) timeouts += 1;
+            if (steady_clock::now() > until + seconds{1}) throw std::runtime_error{"the writer is not resumed"};
+        }
+        if (writer.value != 7) throw std::runtime_error{"the writer failed"};
+
+        fence_lock_result_t reader{};
+        read_async(ep, buffer, writer.fence, reader);
+        const auto deadline = steady_clock::now() + seconds{1};
+        while (reader.done == false) {
+            resume_ready(ep, 5);
+            if (steady_clock::now() > deadline) throw std::runtime_error{"the reader is not resumed"};
+        }
+        if (reader.fence >= 0) close(reader.fence);
+        if (reader.value != 7) throw std::runtime_error{"the reader failed"};
+        return static_cast<jint>(timeouts);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+/**
+ * @return average nanoseconds to move a buffer through the queue. Copies if not `move`
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_HardwareBufferTest_measureQueue(  //
+    JNIEnv* env, jclass, jboolean move, jint repeat) {
+    using namespace std::chrono;
+    try {
+        std::deque<ndk_hardware_buffer_t> queue{};
+        for (int i = 0; i < 4; ++i)
+            queue.emplace_back(make_cpu_desc(AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM, 64, 64));
+        const auto start = steady_clock::now();
+        for (int i = 0; i < repeat; ++i) {
+            if (move) {
+                queue.emplace_back(std::move(queue.front()));
+            } else {
+                ndk_hardware_buffer_t item = queue.front();
+                queue.emplace_back(item);
+            }
+            queue.pop_front();
+        }
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+        spdlog::info("{}: {} {} ns", __func__, move ? "move" : "copy", elapsed.count() / repeat);
+        return static_cast<jlong>(elapsed.count() / repeat);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+}  // extern "C"
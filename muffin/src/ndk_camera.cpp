@@ -4,6 +4,10 @@
 #include <camera/NdkCameraMetadataTags.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+
 void context_on_device_disconnected([[maybe_unused]] ndk_camera_manager_t& context,  //
                                     ACameraDevice* device) noexcept {
     const char* id = ACameraDevice_getId(device);
@@ -205,6 +209,11 @@ ACameraMetadata* ndk_camera_manager_t::get_metadata(ACameraDevice* device) const
     return metadatas[idx];
 }
 
+ACameraMetadata* ndk_camera_manager_t::get_metadata(uint32_t index) const noexcept {
+    if (index >= metadatas.size()) return nullptr;
+    return metadatas[index];
+}
+
 camera_status_t ndk_camera_manager_t::open_device(uint32_t idx, ndk_camera_session_t& info,
                                                   ACameraDevice_StateCallbacks& callbacks) noexcept {
     return ACameraManager_openCamera(manager, id_list->cameraIds[idx], &callbacks, &info.device);
@@ -400,6 +409,92 @@ camera_status_t ndk_camera_manager_t::start_repeat(ndk_camera_session_t& info, n
     return ACAMERA_OK;
 }
 
+uint32_t ndk_session_builder_t::add_output(ANativeWindow* window, uint32_t usage) noexcept(false) {
+    if (window == nullptr) throw std::invalid_argument{"window is null"};
+    if ((usage & (repeating | still)) == 0 || (usage & ~(repeating | still)) != 0)
+        throw std::invalid_argument{"usage must be repeating, still, or both"};
+    for (const output_t& output : outputs)
+        if (output.window == window) throw std::invalid_argument{"the window is already added"};
+    outputs.emplace_back(output_t{window, usage});
+    return static_cast<uint32_t>(outputs.size() - 1);
+}
+
+void ndk_session_builder_t::set_template(ACameraDevice_request_template value) noexcept { type = value; }
+
+void ndk_session_builder_t::set_configuration(const ndk_capture_configuration_t& value) noexcept { config = value; }
+
+const std::vector<ndk_session_builder_t::output_t>& ndk_session_builder_t::get_outputs() const noexcept {
+    return outputs;
+}
+
+ACameraDevice_request_template ndk_session_builder_t::get_template() const noexcept { return type; }
+
+const ndk_capture_configuration_t& ndk_session_builder_t::get_configuration() const noexcept { return config; }
+
+camera_status_t ndk_camera_manager_t::start_session(
+    ndk_camera_session_t& info, const ndk_session_builder_t& builder,
+    ACameraCaptureSession_stateCallbacks& on_state_change,
+    ACameraCaptureSession_captureCallbacks& on_capture_event) noexcept(false) {
+    const auto& items = builder.get_outputs();
+    if (items.empty()) throw std::invalid_argument{"the builder has no output"};
+    // the previous session's still outputs are released. A device can have only 1 session
+    close_session(info);
+    // the wrappers are not movable. std::deque doesn't relocate them
+    session_output_container_t outputs{};
+    std::deque<session_output_t> session_outputs{};
+    for (const auto& item : items) session_outputs.emplace_back(item.window).bind(outputs.handle);
+    if (auto status = ACameraDevice_createCaptureSession(info.device, outputs.handle, &on_state_change, &info.session);
+        status != ACAMERA_OK) {
+        spdlog::error("{}: {}", "ACameraDevice_createCaptureSession", status);
+        return status;
+    }
+    for (const auto& item : items) {
+        if ((item.usage & ndk_session_builder_t::still) == 0) continue;
+        ANativeWindow_acquire(item.window);
+        info.stills.emplace_back(item.window);
+    }
+    info.repeating = std::any_of(items.begin(), items.end(), [](const auto& item) {
+        return (item.usage & ndk_session_builder_t::repeating) != 0;
+    });
+    if (info.repeating == false) return ACAMERA_OK;
+
+    capture_request_t request{info.device, builder.get_template()};
+    if (const auto& config = builder.get_configuration(); config.handler)
+        config.handler(config.context, request.handle);
+    std::deque<camera_output_target_t> targets{};
+    for (const auto& item : items) {
+        if ((item.usage & ndk_session_builder_t::repeating) == 0) continue;
+        targets.emplace_back(item.window).bind(request.handle);
+    }
+    if (auto status = ACameraCaptureSession_setRepeatingRequest(info.session, &on_capture_event, 1, &request.handle,
+                                                                &info.sequence_id);
+        status != ACAMERA_OK) {
+        spdlog::error("{}: {}", "ACameraCaptureSession_setRepeatingRequest", status);
+        info.repeating = false;
+        return status;
+    }
+    return ACAMERA_OK;
+}
+
+camera_status_t ndk_camera_manager_t::capture(ndk_camera_session_t& info,
+                                              ACameraCaptureSession_captureCallbacks& on_capture_event,
+                                              const ndk_capture_configuration_t* config) noexcept(false) {
+    if (info.session == nullptr || info.stills.empty()) return ACAMERA_ERROR_INVALID_OPERATION;
+    capture_request_t request{info.device, TEMPLATE_STILL_CAPTURE};
+    if (config && config->handler) config->handler(config->context, request.handle);
+    std::deque<camera_output_target_t> targets{};
+    for (ANativeWindow* window : info.stills) targets.emplace_back(window).bind(request.handle);
+    // keep the sequence of the repeating request for `stopRepeating`
+    int sequence_id = CAPTURE_SEQUENCE_ID_NONE;
+    if (auto status = ACameraCaptureSession_capture(info.session, &on_capture_event, 1, &request.handle, &sequence_id);
+        status != ACAMERA_OK) {
+        spdlog::error("{}: {}", "ACameraCaptureSession_capture", status);
+        return status;
+    }
+    if (info.repeating == false) info.sequence_id = sequence_id;
+    return ACAMERA_OK;
+}
+
 void ndk_camera_manager_t::close_session(ndk_camera_session_t& info) noexcept(false) {
     if (info.session == nullptr) return;
     spdlog::warn("ACameraCaptureSession {:p}: aborting...", static_cast<void*>(info.session));
@@ -407,4 +502,6 @@ void ndk_camera_manager_t::close_session(ndk_camera_session_t& info) noexcept(fa
     ACameraCaptureSession_abortCaptures(info.session);
     ACameraCaptureSession_close(info.session);
     info.session = nullptr;
+    for (ANativeWindow* window : info.stills) ANativeWindow_release(window);
+    info.stills.clear();
 }
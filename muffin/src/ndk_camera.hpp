@@ -10,6 +10,7 @@
 #include <media/NdkImageReader.h>
 
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <system_error>
 #include <vector>
@@ -38,6 +39,7 @@ struct ndk_camera_session_t final {
     uint16_t index = UINT16_MAX;
     bool repeating = false;                      // flag to indicate if the session is repeating
     int sequence_id = CAPTURE_SEQUENCE_ID_NONE;  // sequence ID from capture session
+    std::vector<ANativeWindow*> stills{};        // acquired outputs for `capture`. released by `close_session`
 };
 
 struct ndk_capture_configuration_t final {
@@ -46,6 +48,57 @@ struct ndk_capture_configuration_t final {
     handler_t handler;
 };
 
+/**
+ * @brief Outputs of a capture session. Camera2 allows 1 session for a device, so the preview, the analysis, and
+ *  the still capture must be in the same session.
+ * @details Each output has its own size and format, which are given by its window. For example, a preview surface
+ *  of the full resolution, and a `AImageReader` of YUV at the model's resolution. The ISP scales each stream, so the
+ *  analysis doesn't need to resize the full frame. The repeating request targets the outputs of `repeating`.
+ *
+ * ```cpp
+ * ndk_session_builder_t builder{};
+ * builder.add_output(preview, ndk_session_builder_t::repeating);
+ * builder.add_output(analysis, ndk_session_builder_t::repeating);  // AImageReader_getWindow
+ * builder.add_output(jpeg, ndk_session_builder_t::still);
+ * manager.start_session(info, builder, on_state_change, on_capture_event);
+ * // ...
+ * manager.capture(info, on_capture_event);  // to the `jpeg`. The repeating request continues
+ * ```
+ * @note The combination of the sizes and formats must be supported by the device's hardware level
+ * @see https://developer.android.com/reference/android/hardware/camera2/CameraDevice#regular-capture
+ */
+class ndk_session_builder_t final {
+   public:
+    static constexpr uint32_t repeating = 1 << 0;  // target of the repeating request
+    static constexpr uint32_t still = 1 << 1;      // target of `ndk_camera_manager_t::capture`
+
+    struct output_t final {
+        ANativeWindow* window;  // not acquired. It must be alive until the session is started
+        uint32_t usage;         // `repeating`, `still`, or both
+    };
+
+   private:
+    std::vector<output_t> outputs{};
+    ACameraDevice_request_template type = TEMPLATE_PREVIEW;
+    ndk_capture_configuration_t config{};
+
+   public:
+    /**
+     * @param usage `repeating`, `still`, or both
+     * @return index of the output
+     * @throw invalid_argument if the `window` is null, the `usage` is zero, or the window is already added
+     */
+    uint32_t add_output(ANativeWindow* window, uint32_t usage) noexcept(false);
+    /// @param type template of the repeating request. `TEMPLATE_PREVIEW` or `TEMPLATE_RECORD`
+    void set_template(ACameraDevice_request_template type) noexcept;
+    /// @brief The `handler` can set the options of the requests before they are submitted
+    void set_configuration(const ndk_capture_configuration_t& config) noexcept;
+
+    const std::vector<output_t>& get_outputs() const noexcept;
+    ACameraDevice_request_template get_template() const noexcept;
+    const ndk_capture_configuration_t& get_configuration() const noexcept;
+};
+
 /**
  * @brief Wrapper of `ACameraManager`, After the instance is initialized,
  *  All of the members must be non-null.
@@ -98,11 +151,31 @@ class ndk_camera_manager_t final {
                                  ACameraCaptureSession_stateCallbacks& on_state_change,
                                  ACameraCaptureSession_captureCallbacks& on_capture_event,  //
                                  ANativeWindow* window) noexcept(false);
+
+    /**
+     * @brief Create a session with all outputs of the `builder`, and start the repeating request if any
+     * @details The previous session of the `info` is closed
+     * @throw invalid_argument if the `builder` has no output
+     * @throw system_error
+     * @see ndk_session_builder_t
+     */
+    camera_status_t start_session(ndk_camera_session_t& info, const ndk_session_builder_t& builder,
+                                  ACameraCaptureSession_stateCallbacks& on_state_change,
+                                  ACameraCaptureSession_captureCallbacks& on_capture_event) noexcept(false);
+    /**
+     * @brief Capture a still image to the `still` outputs of `start_session`. The repeating request continues
+     * @param config options of the request. null to use the template's
+     * @throw system_error
+     */
+    camera_status_t capture(ndk_camera_session_t& info, ACameraCaptureSession_captureCallbacks& on_capture_event,
+                            const ndk_capture_configuration_t* config = nullptr) noexcept(false);
     void close_session(ndk_camera_session_t& info) noexcept(false);
 
     uint32_t get_index(const char* id) const noexcept;
     uint32_t get_index(ACameraDevice* device) const noexcept;
     ACameraMetadata* get_metadata(ACameraDevice* device) const noexcept;
+    /// @note The device doesn't have to be open
+    ACameraMetadata* get_metadata(uint32_t index) const noexcept;
 };
 
 /**
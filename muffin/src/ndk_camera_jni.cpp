@@ -6,8 +6,10 @@
 #include <spdlog/spdlog.h>
 
 #include <mutex>
+#include <vector>
 
 #include "ndk_camera.hpp"
+#include "yuv_convert.hpp"
 
 void get_field(JNIEnv* env, jclass type, jobject target, const char* field_name, jlong& ref) noexcept;
 void set_field(JNIEnv* env, jclass type, jobject target, const char* field_name, jlong value) noexcept;
@@ -43,6 +45,24 @@ uint16_t get_facing(ACameraMetadata* metadata) noexcept {
     }
 }
 
+/**
+ * @return int32_t ACAMERA_SENSOR_ORIENTATION. 0, 90, 180, 270
+ */
+int32_t get_sensor_orientation(ACameraMetadata* metadata) noexcept {
+    ACameraMetadata_const_entry entry{};
+    if (ACameraMetadata_getConstEntry(metadata, ACAMERA_SENSOR_ORIENTATION, &entry) != ACAMERA_OK) return 0;
+    return *(entry.data.i32);
+}
+
+/**
+ * @brief Orientation for the preprocessing kernels. Read once when the camera is selected
+ * @see make_orientation
+ */
+orientation_t get_orientation(ACameraMetadata* metadata, int32_t device_orientation) noexcept {
+    return make_orientation(get_sensor_orientation(metadata), get_facing(metadata) == ACAMERA_LENS_FACING_FRONT,
+                            device_orientation);
+}
+
 auto get_preferred_size(ACameraMetadata* metadata) noexcept {
     ACameraMetadata_const_entry entry{};
     ACameraMetadata_getConstEntry(metadata, ACAMERA_SCALER_AVAILABLE_STREAM_CONFIGURATIONS, &entry);
@@ -79,6 +99,52 @@ void set_device_handle(JNIEnv* env, jobject self, ndk_camera_session_t* ptr) {
 
 using native_window_ptr = std::unique_ptr<ANativeWindow, void (*)(ANativeWindow*)>;
 
+/**
+ * @brief Check the `ACAMERA_SCALER_AVAILABLE_STREAM_CONFIGURATIONS` for the output stream
+ * @param format AIMAGE_FORMAT_YUV_420_888, AIMAGE_FORMAT_JPEG, AIMAGE_FORMAT_PRIVATE ...
+ */
+bool is_output_supported(ACameraMetadata* metadata, int32_t format, int32_t width, int32_t height) noexcept {
+    ACameraMetadata_const_entry entry{};
+    if (ACameraMetadata_getConstEntry(metadata, ACAMERA_SCALER_AVAILABLE_STREAM_CONFIGURATIONS, &entry) != ACAMERA_OK)
+        return false;
+    // (format, width, height, input)
+    for (uint32_t i = 0; i + 3 < entry.count; i += 4) {
+        if (entry.data.i32[i + 3] != ACAMERA_SCALER_AVAILABLE_STREAM_CONFIGURATIONS_OUTPUT) continue;
+        if (entry.data.i32[i + 0] == format && entry.data.i32[i + 1] == width && entry.data.i32[i + 2] == height)
+            return true;
+    }
+    return false;
+}
+
+ACameraCaptureSession_stateCallbacks make_session_callbacks(ndk_camera_manager_t* context) noexcept {
+    ACameraCaptureSession_stateCallbacks on_state_changed{};
+    on_state_changed.context = context;
+    on_state_changed.onReady = reinterpret_cast<ACameraCaptureSession_stateCallback>(context_on_session_ready);
+    on_state_changed.onClosed = reinterpret_cast<ACameraCaptureSession_stateCallback>(context_on_session_closed);
+    on_state_changed.onActive = reinterpret_cast<ACameraCaptureSession_stateCallback>(context_on_session_active);
+    return on_state_changed;
+}
+
+ACameraCaptureSession_captureCallbacks make_capture_callbacks(ndk_camera_manager_t* context) noexcept {
+    ACameraCaptureSession_captureCallbacks on_capture_event{};
+    on_capture_event.context = context;
+    on_capture_event.onCaptureStarted =
+        reinterpret_cast<ACameraCaptureSession_captureCallback_start>(context_on_capture_started);
+    on_capture_event.onCaptureBufferLost =
+        reinterpret_cast<ACameraCaptureSession_captureCallback_bufferLost>(context_on_capture_buffer_lost);
+    on_capture_event.onCaptureProgressed =
+        reinterpret_cast<ACameraCaptureSession_captureCallback_result>(context_on_capture_progressed);
+    on_capture_event.onCaptureCompleted =
+        reinterpret_cast<ACameraCaptureSession_captureCallback_result>(context_on_capture_completed);
+    on_capture_event.onCaptureFailed =
+        reinterpret_cast<ACameraCaptureSession_captureCallback_failed>(context_on_capture_failed);
+    on_capture_event.onCaptureSequenceAborted =
+        reinterpret_cast<ACameraCaptureSession_captureCallback_sequenceAbort>(context_on_capture_sequence_abort);
+    on_capture_event.onCaptureSequenceCompleted =
+        reinterpret_cast<ACameraCaptureSession_captureCallback_sequenceEnd>(context_on_capture_sequence_complete);
+    return on_capture_event;
+}
+
 extern "C" {
 
 JNIEXPORT void JNICALL Java_dev_luncliff_muffin_CameraManager_Init(JNIEnv* env, jclass clazz) {
@@ -118,6 +184,23 @@ int Java_dev_luncliff_muffin_CameraHandle_facing(JNIEnv* env, jobject self) noex
     return get_facing(metadata);
 }
 
+JNIEXPORT
+int Java_dev_luncliff_muffin_CameraHandle_sensorOrientation(JNIEnv* env, jobject self) noexcept {
+    ndk_camera_session_t* ptr = cast_device_handle(env, self);
+    ACameraMetadata* metadata = camera_manager->get_metadata(ptr->device);
+    if (metadata == nullptr) return 0;
+    return get_sensor_orientation(metadata);
+}
+
+/// @return clockwise degrees of `get_orientation`. The front camera's image is mirrored after the rotation
+JNIEXPORT
+int Java_dev_luncliff_muffin_CameraHandle_orientation(JNIEnv* env, jobject self, jint device_orientation) noexcept {
+    ndk_camera_session_t* ptr = cast_device_handle(env, self);
+    ACameraMetadata* metadata = camera_manager->get_metadata(ptr->device);
+    if (metadata == nullptr) return 0;
+    return get_orientation(metadata, device_orientation).degrees;
+}
+
 JNIEXPORT
 int Java_dev_luncliff_muffin_CameraHandle_maxWidth(JNIEnv* env, jobject self) noexcept {
     ndk_camera_session_t* ptr = cast_device_handle(env, self);
@@ -169,28 +252,8 @@ void Java_dev_luncliff_muffin_CameraHandle_startRepeat(JNIEnv* env, jobject self
     // `ANativeWindow_release` releases it
     auto window = native_window_ptr{ANativeWindow_fromSurface(env, surface), ANativeWindow_release};
 
-    ACameraCaptureSession_stateCallbacks on_state_changed{};
-    on_state_changed.context = camera_manager.get();
-    on_state_changed.onReady = reinterpret_cast<ACameraCaptureSession_stateCallback>(context_on_session_ready);
-    on_state_changed.onClosed = reinterpret_cast<ACameraCaptureSession_stateCallback>(context_on_session_closed);
-    on_state_changed.onActive = reinterpret_cast<ACameraCaptureSession_stateCallback>(context_on_session_active);
-
-    ACameraCaptureSession_captureCallbacks on_capture_event{};
-    on_capture_event.context = camera_manager.get();
-    on_capture_event.onCaptureStarted =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_start>(context_on_capture_started);
-    on_capture_event.onCaptureBufferLost =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_bufferLost>(context_on_capture_buffer_lost);
-    on_capture_event.onCaptureProgressed =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_result>(context_on_capture_progressed);
-    on_capture_event.onCaptureCompleted =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_result>(context_on_capture_completed);
-    on_capture_event.onCaptureFailed =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_failed>(context_on_capture_failed);
-    on_capture_event.onCaptureSequenceAborted =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_sequenceAbort>(context_on_capture_sequence_abort);
-    on_capture_event.onCaptureSequenceCompleted =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_sequenceEnd>(context_on_capture_sequence_complete);
+    auto on_state_changed = make_session_callbacks(camera_manager.get());
+    auto on_capture_event = make_capture_callbacks(camera_manager.get());
 
     try {
         if (auto status = camera_manager->start_repeat(*ptr, on_state_changed, on_capture_event, window.get());
@@ -221,28 +284,8 @@ void Java_dev_luncliff_muffin_CameraHandle_startCapture(JNIEnv* env, jobject sel
     // `ANativeWindow_release` releases it
     auto window = native_window_ptr{ANativeWindow_fromSurface(env, surface), ANativeWindow_release};
 
-    ACameraCaptureSession_stateCallbacks on_state_changed{};
-    on_state_changed.context = camera_manager.get();
-    on_state_changed.onReady = reinterpret_cast<ACameraCaptureSession_stateCallback>(context_on_session_ready);
-    on_state_changed.onClosed = reinterpret_cast<ACameraCaptureSession_stateCallback>(context_on_session_closed);
-    on_state_changed.onActive = reinterpret_cast<ACameraCaptureSession_stateCallback>(context_on_session_active);
-
-    ACameraCaptureSession_captureCallbacks on_capture_event{};
-    on_capture_event.context = camera_manager.get();
-    on_capture_event.onCaptureStarted =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_start>(context_on_capture_started);
-    on_capture_event.onCaptureBufferLost =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_bufferLost>(context_on_capture_buffer_lost);
-    on_capture_event.onCaptureProgressed =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_result>(context_on_capture_progressed);
-    on_capture_event.onCaptureCompleted =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_result>(context_on_capture_completed);
-    on_capture_event.onCaptureFailed =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_failed>(context_on_capture_failed);
-    on_capture_event.onCaptureSequenceAborted =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_sequenceAbort>(context_on_capture_sequence_abort);
-    on_capture_event.onCaptureSequenceCompleted =
-        reinterpret_cast<ACameraCaptureSession_captureCallback_sequenceEnd>(context_on_capture_sequence_complete);
+    auto on_state_changed = make_session_callbacks(camera_manager.get());
+    auto on_capture_event = make_capture_callbacks(camera_manager.get());
 
     try {
         if (auto status = camera_manager->start_capture(*ptr, on_state_changed, on_capture_event, window.get());
@@ -265,4 +308,63 @@ void Java_dev_luncliff_muffin_CameraHandle_stopCapture(JNIEnv* env, jobject self
     }
 }
 
+/**
+ * @param surfaces outputs of the session. Their sizes and formats can be different
+ * @param usages `CameraHandle.OUTPUT_REPEATING`, `CameraHandle.OUTPUT_STILL`, or both for each surface
+ */
+JNIEXPORT
+void Java_dev_luncliff_muffin_CameraHandle_startSession(JNIEnv* env, jobject self, jobjectArray surfaces,
+                                                        jintArray usages) noexcept {
+    try {
+        auto ptr = cast_device_handle(env, self);
+        if (ptr == nullptr) throw std::runtime_error{"the camera is not open"};
+        const jsize count = env->GetArrayLength(surfaces);
+        if (count != env->GetArrayLength(usages)) throw std::invalid_argument{"the lengths of arrays are different"};
+        std::vector<jint> flags(static_cast<size_t>(count));
+        env->GetIntArrayRegion(usages, 0, count, flags.data());
+
+        // the windows must be alive until the session is created. `capture` acquires the still ones again
+        std::vector<native_window_ptr> windows{};
+        ndk_session_builder_t builder{};
+        for (jsize i = 0; i < count; ++i) {
+            jobject surface = env->GetObjectArrayElement(surfaces, i);
+            auto& window = windows.emplace_back(ANativeWindow_fromSurface(env, surface), ANativeWindow_release);
+            env->DeleteLocalRef(surface);
+            builder.add_output(window.get(), static_cast<uint32_t>(flags[i]));
+        }
+        auto on_state_changed = make_session_callbacks(camera_manager.get());
+        auto on_capture_event = make_capture_callbacks(camera_manager.get());
+        if (auto status = camera_manager->start_session(*ptr, builder, on_state_changed, on_capture_event);
+            status != ACAMERA_OK)
+            throw std::system_error(status, get_ndk_camera_errors(), "start_session");
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+    }
+}
+
+JNIEXPORT
+void Java_dev_luncliff_muffin_CameraHandle_captureStill(JNIEnv* env, jobject self) noexcept {
+    try {
+        auto ptr = cast_device_handle(env, self);
+        if (ptr == nullptr) throw std::runtime_error{"the camera is not open"};
+        auto on_capture_event = make_capture_callbacks(camera_manager.get());
+        if (auto status = camera_manager->capture(*ptr, on_capture_event); status != ACAMERA_OK)
+            throw std::system_error(status, get_ndk_camera_errors(), "capture");
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+    }
+}
+
+JNIEXPORT
+jboolean Java_dev_luncliff_muffin_CameraHandle_isOutputSupported(JNIEnv* env, jobject self, jint format, jint width,
+                                                                 jint height) noexcept {
+    auto ptr = cast_device_handle(env, self);
+    if (ptr == nullptr) return false;
+    ACameraMetadata* metadata = camera_manager->get_metadata(ptr->index);
+    if (metadata == nullptr) return false;
+    return is_output_supported(metadata, format, width, height);
+}
+
 }  // extern "C"
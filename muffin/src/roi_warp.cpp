@@ -0,0 +1,469 @@
+#include "roi_warp.hpp"
+
+#include "convert_kernels.hpp"
+
+affine_transform_t make_affine_transform(const roi_t& roi, uint32_t width, uint32_t height) noexcept {
+    const float c = std::cos(roi.rotation), s = std::sin(roi.rotation);
+    const float sx = roi.width / static_cast<float>(width), sy = roi.height / static_cast<float>(height);
+    // the output's center is the ROI's center
+    return affine_transform_t{{c * sx, -s * sy, roi.center_x - 0.5f * (c * roi.width - s * roi.height),  //
+                               s * sx, c * sy, roi.center_y - 0.5f * (s * roi.width + c * roi.height)}};
+}
+
+namespace {
+
+/// @brief Source index of the output pixel centers. `x = dx * c + x_r * r + x0`
+struct warp_map_t final {
+    float dx;
+    float dy;
+    float x_r;
+    float y_r;
+    float x0;
+    float y0;
+};
+
+warp_map_t make_warp_map(const affine_transform_t& transform) noexcept {
+    const auto& m = transform.m;
+    // the center of the output pixel (0, 0) is (0.5, 0.5). The index of the source pixel is its center - 0.5
+    return warp_map_t{m[0], m[3], m[1], m[4], 0.5f * (m[0] + m[1]) + m[2] - 0.5f, 0.5f * (m[3] + m[4]) + m[5] - 0.5f};
+}
+
+/// @brief Source index of the first pixel in the output row
+struct warp_row_t final {
+    float x;
+    float y;
+};
+
+/// @brief Size and strides of the plane for the taps
+struct extent_t final {
+    float width;
+    float height;
+    int32_t row_stride;
+    int32_t pixel_stride;
+};
+
+extent_t make_extent(plane_view_t<const uint8_t> plane) noexcept {
+    return extent_t{static_cast<float>(plane.width), static_cast<float>(plane.height), plane.row_stride,
+                    plane.pixel_stride};
+}
+
+/// @brief Inverse of `to_rgb`. The `fill` of the YUV source
+std::array<float, 3> to_yuv(const std::array<uint8_t, 3>& rgb) noexcept {
+    const float y = 0.299f * rgb[0] + 0.587f * rgb[1] + 0.114f * rgb[2];
+    return {y, (rgb[2] - y) / coef_bu + 128.0f, (rgb[0] - y) / coef_rv + 128.0f};
+}
+
+/// @return `border_mode_t::replicate` if all taps of the `target` are in the `width * height` plane
+border_mode_t get_border(const warp_target_t& target, uint32_t width, uint32_t height) noexcept {
+    if (target.border == border_mode_t::replicate) return border_mode_t::replicate;
+    const warp_map_t map = make_warp_map(target.transform);
+    const float columns[2]{0.0f, static_cast<float>(target.dst.width - 1)};
+    const float rows[2]{0.0f, static_cast<float>(target.dst.height - 1)};
+    for (float c : columns)
+        for (float r : rows) {
+            const float x = map.dx * c + map.x_r * r + map.x0, y = map.dy * c + map.y_r * r + map.y0;
+            if (!(x >= 0 && x <= width - 1.0f && y >= 0 && y <= height - 1.0f)) return border_mode_t::constant;
+        }
+    return border_mode_t::replicate;
+}
+
+/**
+ * @brief Bilinear taps `(x0, y0)`, `(x1, y0)`, `(x0, y1)`, `(x1, y1)` of a point
+ * @details With `border_mode_t::replicate`, the point is clamped into the plane. Same taps with `get_tap`.
+ *  With `border_mode_t::constant`, the taps out of the plane are marked in `inside`. Their offsets are clamped
+ */
+struct tap1_t final {
+    int32_t offsets[4];
+    float wx;
+    float wy;
+    bool inside[4];
+};
+
+template <border_mode_t B>
+tap1_t make_tap1(float x, float y, const extent_t& e) noexcept {
+    if constexpr (B == border_mode_t::replicate) {
+        x = std::clamp(x, 0.0f, e.width - 1);
+        y = std::clamp(y, 0.0f, e.height - 1);
+    } else {
+        // the taps are out of the plane beyond here
+        x = std::clamp(x, -1.0f, e.width);
+        y = std::clamp(y, -1.0f, e.height);
+    }
+    const float fx = std::floor(x), fy = std::floor(y);
+    tap1_t tap{};
+    tap.wx = x - fx;
+    tap.wy = y - fy;
+    const float xs[2]{fx, fx + 1}, ys[2]{fy, fy + 1};
+    for (int k = 0; k < 4; ++k) {
+        const float tx = xs[k & 1], ty = ys[k >> 1];
+        tap.inside[k] = tx >= 0 && tx <= e.width - 1 && ty >= 0 && ty <= e.height - 1;
+        tap.offsets[k] = static_cast<int32_t>(std::clamp(ty, 0.0f, e.height - 1)) * e.row_stride +
+                         static_cast<int32_t>(std::clamp(tx, 0.0f, e.width - 1)) * e.pixel_stride;
+    }
+    return tap;
+}
+
+/// @brief `values` of the taps to the bilinear sample. Same operations with `lerp4`
+float interpolate(const float values[4], const tap1_t& tap) noexcept {
+    const float top = values[0] + (values[1] - values[0]) * tap.wx;
+    const float bottom = values[2] + (values[3] - values[2]) * tap.wx;
+    return top + (bottom - top) * tap.wy;
+}
+
+/// @param fill value of the taps out of the plane
+float sample_taps(const uint8_t* data, const tap1_t& tap, float fill) noexcept {
+    float values[4]{};
+    for (int k = 0; k < 4; ++k) values[k] = tap.inside[k] ? data[tap.offsets[k]] : fill;
+    return interpolate(values, tap);
+}
+
+float sample_taps(const uint8_t* data, const tap1_t& tap) noexcept {
+    float values[4]{};
+    for (int k = 0; k < 4; ++k) values[k] = data[tap.offsets[k]];
+    return interpolate(values, tap);
+}
+
+/// @brief Weight of the taps in the plane
+float get_coverage(const tap1_t& tap) noexcept {
+    float values[4]{};
+    for (int k = 0; k < 4; ++k) values[k] = tap.inside[k] ? 1.0f : 0.0f;
+    return interpolate(values, tap);
+}
+
+#if defined(__SSE4_1__)
+
+using mask4_t = __m128;
+
+vec4_t add4(vec4_t a, vec4_t b) noexcept { return _mm_add_ps(a, b); }
+vec4_t sub4(vec4_t a, vec4_t b) noexcept { return _mm_sub_ps(a, b); }
+vec4_t mul4(vec4_t a, vec4_t b) noexcept { return _mm_mul_ps(a, b); }
+vec4_t floor4(vec4_t v) noexcept { return _mm_floor_ps(v); }
+vec4_t clamp4(vec4_t v, float lower, float upper) noexcept {
+    return _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(lower)), _mm_set1_ps(upper));
+}
+
+/// @brief `0 <= v && v <= upper`
+mask4_t inside4(vec4_t v, float upper) noexcept {
+    return _mm_and_ps(_mm_cmpge_ps(v, _mm_setzero_ps()), _mm_cmple_ps(v, _mm_set1_ps(upper)));
+}
+mask4_t and4(mask4_t a, mask4_t b) noexcept { return _mm_and_ps(a, b); }
+
+/// @brief `mask ? a : b`
+vec4_t select4(mask4_t mask, vec4_t a, vec4_t b) noexcept { return _mm_blendv_ps(b, a, mask); }
+
+/// @brief Byte offsets of the pixels at the indices `x`, `y`. They must be in the plane
+void offset4(vec4_t x, vec4_t y, const extent_t& e, int32_t* dst) noexcept {
+    const __m128i rows = _mm_mullo_epi32(_mm_cvttps_epi32(y), _mm_set1_epi32(e.row_stride));
+    const __m128i columns = _mm_mullo_epi32(_mm_cvttps_epi32(x), _mm_set1_epi32(e.pixel_stride));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_add_epi32(rows, columns));
+}
+
+/// @brief R, G, B of 4 RGBA pixels
+rgb4_t unpack_rgba4(const uint32_t pixels[4]) noexcept {
+    const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    return rgb4_t{_mm_cvtepi32_ps(_mm_and_si128(px, mask)),
+                  _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 8), mask)),
+                  _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 16), mask))};
+}
+
+#elif defined(__ARM_NEON)
+
+using mask4_t = uint32x4_t;
+
+vec4_t add4(vec4_t a, vec4_t b) noexcept { return vaddq_f32(a, b); }
+vec4_t sub4(vec4_t a, vec4_t b) noexcept { return vsubq_f32(a, b); }
+vec4_t mul4(vec4_t a, vec4_t b) noexcept { return vmulq_f32(a, b); }
+vec4_t floor4(vec4_t v) noexcept {
+#if defined(__aarch64__)
+    return vrndmq_f32(v);
+#else
+    // the values are clamped in the range of int32. The truncation goes up for the negative ones
+    const float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(v));
+    return vsubq_f32(t, vbslq_f32(vcgtq_f32(t, v), vdupq_n_f32(1.0f), vdupq_n_f32(0.0f)));
+#endif
+}
+vec4_t clamp4(vec4_t v, float lower, float upper) noexcept {
+    return vminq_f32(vmaxq_f32(v, vdupq_n_f32(lower)), vdupq_n_f32(upper));
+}
+
+mask4_t inside4(vec4_t v, float upper) noexcept {
+    return vandq_u32(vcgeq_f32(v, vdupq_n_f32(0.0f)), vcleq_f32(v, vdupq_n_f32(upper)));
+}
+mask4_t and4(mask4_t a, mask4_t b) noexcept { return vandq_u32(a, b); }
+
+vec4_t select4(mask4_t mask, vec4_t a, vec4_t b) noexcept { return vbslq_f32(mask, a, b); }
+
+void offset4(vec4_t x, vec4_t y, const extent_t& e, int32_t* dst) noexcept {
+    const int32x4_t columns = vmulq_n_s32(vcvtq_s32_f32(x), e.pixel_stride);
+    vst1q_s32(dst, vmlaq_n_s32(columns, vcvtq_s32_f32(y), e.row_stride));
+}
+
+rgb4_t unpack_rgba4(const uint32_t pixels[4]) noexcept {
+    const uint32x4_t px = vld1q_u32(pixels), mask = vdupq_n_u32(0xFF);
+    return rgb4_t{vcvtq_f32_u32(vandq_u32(px, mask)), vcvtq_f32_u32(vandq_u32(vshrq_n_u32(px, 8), mask)),
+                  vcvtq_f32_u32(vandq_u32(vshrq_n_u32(px, 16), mask))};
+}
+
+#endif
+
+#if defined(__SSE4_1__) || defined(__ARM_NEON)
+
+/// @brief `tap1_t` of 4 points. `offsets[k]` holds the tap `k` of each point
+struct taps4_t final {
+    alignas(16) int32_t offsets[4][4];
+    vec4_t wx;
+    vec4_t wy;
+    mask4_t inside[4];  // only for `border_mode_t::constant`
+};
+
+/// @see make_tap1
+template <border_mode_t B>
+taps4_t make_taps4(vec4_t x, vec4_t y, const extent_t& e) noexcept {
+    if constexpr (B == border_mode_t::replicate) {
+        x = clamp4(x, 0.0f, e.width - 1);
+        y = clamp4(y, 0.0f, e.height - 1);
+    } else {
+        x = clamp4(x, -1.0f, e.width);
+        y = clamp4(y, -1.0f, e.height);
+    }
+    const vec4_t fx = floor4(x), fy = floor4(y), one = set4(1.0f);
+    taps4_t taps{};
+    taps.wx = sub4(x, fx);
+    taps.wy = sub4(y, fy);
+    const vec4_t xs[2]{fx, add4(fx, one)}, ys[2]{fy, add4(fy, one)};
+    if constexpr (B == border_mode_t::constant) {
+        const mask4_t mx[2]{inside4(xs[0], e.width - 1), inside4(xs[1], e.width - 1)};
+        const mask4_t my[2]{inside4(ys[0], e.height - 1), inside4(ys[1], e.height - 1)};
+        for (int k = 0; k < 4; ++k) taps.inside[k] = and4(mx[k & 1], my[k >> 1]);
+    }
+    const vec4_t cx[2]{clamp4(xs[0], 0.0f, e.width - 1), clamp4(xs[1], 0.0f, e.width - 1)};
+    const vec4_t cy[2]{clamp4(ys[0], 0.0f, e.height - 1), clamp4(ys[1], 0.0f, e.height - 1)};
+    for (int k = 0; k < 4; ++k) offset4(cx[k & 1], cy[k >> 1], e, taps.offsets[k]);
+    return taps;
+}
+
+vec4_t interpolate4(const vec4_t values[4], const taps4_t& taps) noexcept {
+    return lerp4(lerp4(values[0], values[1], taps.wx), lerp4(values[2], values[3], taps.wx), taps.wy);
+}
+
+vec4_t sample_taps4(const uint8_t* data, const taps4_t& taps, vec4_t fill) noexcept {
+    vec4_t values[4]{};
+    for (int k = 0; k < 4; ++k) values[k] = select4(taps.inside[k], gather4(data, taps.offsets[k]), fill);
+    return interpolate4(values, taps);
+}
+
+vec4_t sample_taps4(const uint8_t* data, const taps4_t& taps) noexcept {
+    vec4_t values[4]{};
+    for (int k = 0; k < 4; ++k) values[k] = gather4(data, taps.offsets[k]);
+    return interpolate4(values, taps);
+}
+
+vec4_t get_coverage4(const taps4_t& taps) noexcept {
+    const vec4_t one = set4(1.0f), zero = set4(0.0f);
+    vec4_t values[4]{};
+    for (int k = 0; k < 4; ++k) values[k] = select4(taps.inside[k], one, zero);
+    return interpolate4(values, taps);
+}
+
+/// @brief Source indices of 4 pixels from the column `c`
+void get_points4(const warp_map_t& map, const warp_row_t& row, size_t c, vec4_t& x, vec4_t& y) noexcept {
+    const auto i = static_cast<float>(c);
+    const vec4_t columns = set4(i, i + 1, i + 2, i + 3);
+    x = add4(mul4(set4(map.dx), columns), set4(row.x));
+    y = add4(mul4(set4(map.dy), columns), set4(row.y));
+}
+
+#endif
+
+/**
+ * @brief Sampler of `convert_rows` for the affine transform of the YUV
+ * @details The luma is sampled with the border `B`. The chroma repeats its edges, and is blended with the `fill`
+ *  by the coverage of the luma taps. The position in the chroma is `(x - 0.5) / 2` of the luma's
+ */
+template <border_mode_t B>
+struct yuv_warp_sampler_t final {
+    using row_t = warp_row_t;
+
+    const yuv_view_t& src;
+    warp_map_t map;
+    uint32_t out_width;
+    extent_t luma;
+    extent_t chroma;
+    std::array<float, 3> fill;  // YUV
+
+   public:
+    size_t width() const noexcept { return out_width; }
+    index_range_t simd_columns() const noexcept { return {0, out_width}; }
+
+    row_t row(size_t r) const noexcept {
+        const auto i = static_cast<float>(r);
+        return row_t{map.x_r * i + map.x0, map.y_r * i + map.y0};
+    }
+
+    void sample1(const row_t& row, size_t c, float rgb[3]) const noexcept {
+        const auto i = static_cast<float>(c);
+        const float x = map.dx * i + row.x, y = map.dy * i + row.y;
+        const tap1_t ty = make_tap1<B>(x, y, luma);
+        const tap1_t tc = make_tap1<border_mode_t::replicate>((x - 0.5f) * 0.5f, (y - 0.5f) * 0.5f, chroma);
+        float u = sample_taps(src.u.data, tc), v = sample_taps(src.v.data, tc);
+        if constexpr (B == border_mode_t::constant) {
+            const float coverage = get_coverage(ty);
+            u = fill[1] + (u - fill[1]) * coverage;
+            v = fill[2] + (v - fill[2]) * coverage;
+            return to_rgb(sample_taps(src.y.data, ty, fill[0]), u, v, rgb);
+        }
+        to_rgb(sample_taps(src.y.data, ty), u, v, rgb);
+    }
+
+#if defined(__SSE4_1__) || defined(__ARM_NEON)
+    rgb4_t sample4(const row_t& row, size_t c) const noexcept {
+        vec4_t x{}, y{};
+        get_points4(map, row, c, x, y);
+        const vec4_t half = set4(0.5f);
+        const taps4_t ty = make_taps4<B>(x, y, luma);
+        const taps4_t tc = make_taps4<border_mode_t::replicate>(mul4(sub4(x, half), half), mul4(sub4(y, half), half),
+                                                                chroma);
+        vec4_t u = sample_taps4(src.u.data, tc), v = sample_taps4(src.v.data, tc);
+        if constexpr (B == border_mode_t::constant) {
+            const vec4_t coverage = get_coverage4(ty);
+            u = lerp4(set4(fill[1]), u, coverage);
+            v = lerp4(set4(fill[2]), v, coverage);
+            return to_rgb4(sample_taps4(src.y.data, ty, set4(fill[0])), u, v);
+        }
+        return to_rgb4(sample_taps4(src.y.data, ty), u, v);
+    }
+#endif
+};
+
+/**
+ * @brief Sampler of `convert_rows` for the affine transform of the RGBA(RGBX). The alpha is ignored
+ */
+template <border_mode_t B>
+struct rgba_warp_sampler_t final {
+    using row_t = warp_row_t;
+
+    const uint8_t* data;
+    warp_map_t map;
+    uint32_t out_width;
+    extent_t extent;
+    std::array<float, 3> fill;  // RGB
+
+   public:
+    size_t width() const noexcept { return out_width; }
+    index_range_t simd_columns() const noexcept { return {0, out_width}; }
+
+    row_t row(size_t r) const noexcept {
+        const auto i = static_cast<float>(r);
+        return row_t{map.x_r * i + map.x0, map.y_r * i + map.y0};
+    }
+
+    void sample1(const row_t& row, size_t c, float rgb[3]) const noexcept {
+        const auto i = static_cast<float>(c);
+        const tap1_t tap = make_tap1<B>(map.dx * i + row.x, map.dy * i + row.y, extent);
+        for (int k = 0; k < 3; ++k) {
+            if constexpr (B == border_mode_t::constant)
+                rgb[k] = sample_taps(data + k, tap, fill[k]);
+            else
+                rgb[k] = sample_taps(data + k, tap);
+        }
+    }
+
+#if defined(__SSE4_1__) || defined(__ARM_NEON)
+    /// @note The RGBA pixels of the taps are loaded in 32-bit, and then split into the channels
+    rgb4_t sample4(const row_t& row, size_t c) const noexcept {
+        vec4_t x{}, y{};
+        get_points4(map, row, c, x, y);
+        const taps4_t taps = make_taps4<B>(x, y, extent);
+        rgb4_t values[4]{};
+        for (int k = 0; k < 4; ++k) {
+            uint32_t pixels[4]{};
+            for (int i = 0; i < 4; ++i) std::memcpy(pixels + i, data + taps.offsets[k][i], 4);
+            values[k] = unpack_rgba4(pixels);
+            if constexpr (B == border_mode_t::constant) {
+                values[k].r = select4(taps.inside[k], values[k].r, set4(fill[0]));
+                values[k].g = select4(taps.inside[k], values[k].g, set4(fill[1]));
+                values[k].b = select4(taps.inside[k], values[k].b, set4(fill[2]));
+            }
+        }
+        const vec4_t r[4]{values[0].r, values[1].r, values[2].r, values[3].r};
+        const vec4_t g[4]{values[0].g, values[1].g, values[2].g, values[3].g};
+        const vec4_t b[4]{values[0].b, values[1].b, values[2].b, values[3].b};
+        return rgb4_t{interpolate4(r, taps), interpolate4(g, taps), interpolate4(b, taps)};
+    }
+#endif
+};
+
+/**
+ * @brief Run `warp_affine` of the `src` for the `targets`. The rows are numbered through the targets
+ */
+template <typename View>
+void warp_targets(thread_pool_t& pool, const View& src, const warp_target_t* targets, size_t count) noexcept(false) {
+    if (src.width() == 0 || src.height() == 0) throw std::invalid_argument{"warp_affine: empty source"};
+    if (count > 0 && targets == nullptr) throw std::invalid_argument{"warp_affine: null targets"};
+    size_t total = 0;
+    uint32_t width = 1, element = 1;
+    for (size_t i = 0; i < count; ++i) {
+        const tensor_packing_t& dst = targets[i].dst;
+        if (dst.data == nullptr || dst.width == 0 || dst.height == 0)
+            throw std::invalid_argument{"warp_affine: empty target"};
+        total += dst.height;
+        width = std::max(width, dst.width);
+        element = std::max(element, get_element_size(dst.type));
+    }
+    if (total == 0) return;
+    // the ROIs are small. Split more than the cache allows, so all threads get the rows
+    const tile_t tile = make_cache_tile(width, static_cast<uint32_t>(total), 3 * element);
+    const size_t grain = std::clamp<size_t>(total / (pool.concurrency() * 4), 1, tile.height);
+    pool.parallel_for({0, total}, grain, [&](index_range_t range) {
+        size_t begin = 0;
+        for (size_t i = 0; i < count && begin < range.end; ++i) {
+            const size_t end = begin + targets[i].dst.height;
+            if (range.begin < end)
+                warp_affine(src, targets[i], {std::max(range.begin, begin) - begin, std::min(range.end, end) - begin});
+            begin = end;
+        }
+    });
+}
+
+}  // namespace
+
+void warp_affine(const yuv_view_t& src, const warp_target_t& target, index_range_t rows) noexcept {
+    const warp_map_t map = make_warp_map(target.transform);
+    const extent_t luma = make_extent(src.y), chroma = make_extent(src.u);
+    const std::array<float, 3> fill = to_yuv(target.fill);
+    const uint32_t width = target.dst.width;
+    const border_mode_t border = get_border(target, src.width(), src.height());
+    visit_store(target.dst, target.norm, [&](const auto& store) {
+        if (border == border_mode_t::constant)
+            return convert_rows(yuv_warp_sampler_t<border_mode_t::constant>{src, map, width, luma, chroma, fill},
+                                store, rows);
+        convert_rows(yuv_warp_sampler_t<border_mode_t::replicate>{src, map, width, luma, chroma, fill}, store, rows);
+    });
+}
+
+void warp_affine(const rgba_view_t& src, const warp_target_t& target, index_range_t rows) noexcept {
+    const warp_map_t map = make_warp_map(target.transform);
+    const extent_t extent = make_extent(src.plane);
+    const std::array<float, 3> fill{static_cast<float>(target.fill[0]), static_cast<float>(target.fill[1]),
+                                    static_cast<float>(target.fill[2])};
+    const uint32_t width = target.dst.width;
+    const border_mode_t border = get_border(target, src.width(), src.height());
+    visit_store(target.dst, target.norm, [&](const auto& store) {
+        if (border == border_mode_t::constant)
+            return convert_rows(rgba_warp_sampler_t<border_mode_t::constant>{src.plane.data, map, width, extent, fill},
+                                store, rows);
+        convert_rows(rgba_warp_sampler_t<border_mode_t::replicate>{src.plane.data, map, width, extent, fill}, store,
+                     rows);
+    });
+}
+
+void warp_affine(thread_pool_t& pool, const yuv_view_t& src, const warp_target_t* targets,
+                 size_t count) noexcept(false) {
+    warp_targets(pool, src, targets, count);
+}
+
+void warp_affine(thread_pool_t& pool, const rgba_view_t& src, const warp_target_t* targets,
+                 size_t count) noexcept(false) {
+    warp_targets(pool, src, targets, count);
+}
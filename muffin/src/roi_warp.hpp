@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "image_view.hpp"
+#include "tensor_packing.hpp"
+#include "thread_pool.hpp"
+#include "yuv_convert.hpp"
+
+/**
+ * @brief Rotated rectangle in the source image, in pixels. MediaPipe's `NormalizedRect` after the denormalization
+ */
+struct roi_t final {
+    float center_x;
+    float center_y;
+    float width;
+    float height;
+    float rotation;  // radians. Clockwise in the image, whose y axis goes down
+};
+
+/**
+ * @brief 2x3 matrix from the output to the source. `x' = m[0] x + m[1] y + m[2]`, `y' = m[3] x + m[4] y + m[5]`
+ * @details The coordinates are continuous. The pixel `i` covers `[i, i + 1)`, so its center is `i + 0.5`.
+ *  The landmarks of the model, which are in the output's pixels, can be mapped back to the source with `map`
+ */
+struct affine_transform_t final {
+    std::array<float, 6> m;
+
+   public:
+    std::array<float, 2> map(float x, float y) const noexcept {
+        return {m[0] * x + m[1] * y + m[2], m[3] * x + m[4] * y + m[5]};
+    }
+};
+
+/**
+ * @brief Transform which crops the `roi` into the `width * height` output
+ * @note The `roi` is stretched if its aspect ratio is different from the output
+ */
+affine_transform_t make_affine_transform(const roi_t& roi, uint32_t width, uint32_t height) noexcept;
+
+/// @brief Samples out of the source image
+enum class border_mode_t : uint32_t {
+    replicate = 0,  // the edge pixels are repeated
+    constant = 1,   // `warp_target_t::fill`
+};
+
+/**
+ * @brief One ROI of `warp_affine`. The output is normalized and packed like `convert_yuv_to_rgb`
+ */
+struct warp_target_t final {
+    affine_transform_t transform;
+    tensor_packing_t dst;
+    rgb_normalization_t norm;
+    border_mode_t border = border_mode_t::replicate;
+    std::array<uint8_t, 3> fill{};  // RGB of `border_mode_t::constant`
+};
+
+/**
+ * @brief Bilinear sampling of the rotated/scaled ROI, YUV to RGB conversion, normalization, and packing in one pass
+ * @details Each output pixel reads the source at its transformed center. Only the pixels under the ROI are read,
+ *  so the frame is not converted to RGB before the crop.
+ *
+ *  For the YUV source, the border is applied in the luma grid. The chroma is sampled at the same point with the
+ *  edges repeated, and blended with the `fill` by the coverage of the luma taps.
+ *  If the ROI is inside of the image, `border_mode_t::constant` runs the kernel of `border_mode_t::replicate`.
+ * @param rows rows of the `target.dst` to write
+ */
+void warp_affine(const yuv_view_t& src, const warp_target_t& target, index_range_t rows) noexcept;
+void warp_affine(const rgba_view_t& src, const warp_target_t& target, index_range_t rows) noexcept;
+
+/**
+ * @brief Run `warp_affine` for the `targets` with the `pool`
+ * @details The rows of all targets are split into one range. So the ROIs of a frame(e.g. a face and its eyes) are
+ *  in one `parallel_for`, and the small ones don't leave the threads idle.
+ * @throw invalid_argument if the source is empty, or one of the `targets` has no memory or zero size
+ */
+void warp_affine(thread_pool_t& pool, const yuv_view_t& src, const warp_target_t* targets,
+                 size_t count) noexcept(false);
+void warp_affine(thread_pool_t& pool, const rgba_view_t& src, const warp_target_t* targets,
+                 size_t count) noexcept(false);
@@ -0,0 +1,348 @@
+#include "snapshot_writer.hpp"
+
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include "yuv_convert.hpp"
+
+namespace {
+
+constexpr size_t band_size = 128 * 1024;
+constexpr size_t window_size = 32 * 1024;
+
+/// @brief Compress a band as a part of the raw deflate stream
+std::vector<uint8_t> deflate_band(const uint8_t* data, size_t begin, size_t end, bool last,
+                                  int level) noexcept(false) {
+    z_stream zs{};
+    if (auto ec = deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY); ec != Z_OK)
+        throw std::runtime_error{"deflateInit2"};
+    std::vector<uint8_t> output{};
+    try {
+        if (begin > 0) {
+            const size_t dictionary = std::min(begin, window_size);
+            if (auto ec = deflateSetDictionary(&zs, data + begin - dictionary, static_cast<uInt>(dictionary));
+                ec != Z_OK)
+                throw std::runtime_error{"deflateSetDictionary"};
+        }
+        zs.next_in = const_cast<Bytef*>(data + begin);
+        zs.avail_in = static_cast<uInt>(end - begin);
+        // margin for the sync marker
+        output.resize(deflateBound(&zs, zs.avail_in) + 16);
+        const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+        while (true) {
+            zs.next_out = output.data() + zs.total_out;
+            zs.avail_out = static_cast<uInt>(output.size() - zs.total_out);
+            const int ec = deflate(&zs, flush);
+            if (ec == Z_STREAM_ERROR) throw std::runtime_error{"deflate"};
+            if (last ? ec == Z_STREAM_END : zs.avail_in == 0 && zs.avail_out != 0) break;
+            output.resize(output.size() * 2);
+        }
+        output.resize(zs.total_out);
+    } catch (...) {
+        deflateEnd(&zs);
+        throw;
+    }
+    deflateEnd(&zs);
+    return output;
+}
+
+void append_u32_be(std::vector<uint8_t>& out, uint32_t value) noexcept(false) {
+    const uint8_t bytes[4]{static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+                           static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)};
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+void append_u32_le(std::vector<uint8_t>& out, uint32_t value) noexcept(false) {
+    const uint8_t bytes[4]{static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+                           static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)};
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+/// @brief PNG chunk with the length and the CRC of the `type` and the `data`
+void append_chunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t length) noexcept(false) {
+    append_u32_be(out, static_cast<uint32_t>(length));
+    const size_t offset = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + length);
+    append_u32_be(out, static_cast<uint32_t>(crc32(0, out.data() + offset, static_cast<uInt>(length + 4))));
+}
+
+/// @brief Copy the plane without the padding and the interleaved channel
+void copy_plane(plane_view_t<const uint8_t> src, uint8_t* dst) noexcept {
+    for (uint32_t y = 0; y < src.height; ++y, dst += src.width) {
+        const uint8_t* row = src.row(y);
+        if (src.pixel_stride == 1) {
+            std::memcpy(dst, row, src.width);
+            continue;
+        }
+        for (uint32_t x = 0; x < src.width; ++x) dst[x] = row[x * src.pixel_stride];
+    }
+}
+
+size_t get_i420_size(const yuv_view_t& src) noexcept {
+    return static_cast<size_t>(src.y.width) * src.y.height + static_cast<size_t>(src.u.width) * src.u.height * 2;
+}
+
+std::vector<uint8_t> make_i420_copy(const yuv_view_t& src) noexcept(false) {
+    const size_t luma = static_cast<size_t>(src.y.width) * src.y.height;
+    const size_t chroma = static_cast<size_t>(src.u.width) * src.u.height;
+    std::vector<uint8_t> pixels(luma + chroma * 2);
+    copy_plane(src.y, pixels.data());
+    copy_plane(src.u, pixels.data() + luma);
+    copy_plane(src.v, pixels.data() + luma + chroma);
+    return pixels;
+}
+
+/// @brief Write to the temporary file and rename it
+void write_file(const std::string& path, const std::vector<uint8_t>& content) noexcept(false) {
+    const std::string temporary = path + ".tmp";
+    const int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) throw std::system_error{errno, std::generic_category(), "open"};
+    size_t offset = 0;
+    while (offset < content.size()) {
+        const ssize_t sz = write(fd, content.data() + offset, content.size() - offset);
+        if (sz < 0 && errno == EINTR) continue;
+        if (sz < 0) {
+            const auto ec = errno;
+            close(fd);
+            unlink(temporary.c_str());
+            throw std::system_error{ec, std::generic_category(), "write"};
+        }
+        offset += static_cast<size_t>(sz);
+    }
+    if (close(fd) < 0) {
+        const auto ec = errno;
+        unlink(temporary.c_str());
+        throw std::system_error{ec, std::generic_category(), "close"};
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) < 0) {
+        const auto ec = errno;
+        unlink(temporary.c_str());
+        throw std::system_error{ec, std::generic_category(), "rename"};
+    }
+}
+
+}  // namespace
+
+deflate_result_t parallel_deflate(thread_pool_t& pool, const uint8_t* data, size_t length,
+                                  int level) noexcept(false) {
+    const size_t count = std::max<size_t>((length + band_size - 1) / band_size, 1);
+    std::vector<std::vector<uint8_t>> streams(count);
+    std::vector<uint32_t> adlers(count), crcs(count);
+    pool.parallel_for({0, count}, 1, [&](index_range_t bands) {
+        for (auto i = bands.begin; i < bands.end; ++i) {
+            const size_t begin = i * band_size;
+            const size_t end = std::min(begin + band_size, length);
+            streams[i] = deflate_band(data, begin, end, i + 1 == count, level);
+            adlers[i] = static_cast<uint32_t>(adler32(adler32(0, nullptr, 0), data + begin, end - begin));
+            crcs[i] = static_cast<uint32_t>(crc32(crc32(0, nullptr, 0), data + begin, end - begin));
+        }
+    });
+    deflate_result_t result{};
+    size_t total = 0;
+    for (const auto& stream : streams) total += stream.size();
+    result.stream.reserve(total);
+    result.adler = adlers[0];
+    result.crc = crcs[0];
+    for (size_t i = 0; i < count; ++i) {
+        result.stream.insert(result.stream.end(), streams[i].begin(), streams[i].end());
+        if (i == 0) continue;
+        const auto size = static_cast<z_off_t>(std::min(band_size, length - i * band_size));
+        result.adler = static_cast<uint32_t>(adler32_combine(result.adler, adlers[i], size));
+        result.crc = static_cast<uint32_t>(crc32_combine(result.crc, crcs[i], size));
+    }
+    return result;
+}
+
+std::vector<uint8_t> encode_png(thread_pool_t& pool, plane_view_t<const uint8_t> pixels, int level) noexcept(false) {
+    const int32_t channels = pixels.pixel_stride;
+    if (channels != 3 && channels != 4) throw std::invalid_argument{"encode_png: pixel_stride must be 3 or 4"};
+    // filter byte + row
+    const size_t row_size = static_cast<size_t>(pixels.width) * channels;
+    const size_t line_size = row_size + 1;
+    std::vector<uint8_t> filtered(line_size * pixels.height);
+    pool.parallel_for({0, pixels.height}, 16, [&](index_range_t rows) {
+        for (auto y = rows.begin; y < rows.end; ++y) {
+            uint8_t* line = filtered.data() + y * line_size;
+            const uint8_t* row = pixels.row(y);
+            if (y == 0) {
+                line[0] = 0;  // None
+                std::memcpy(line + 1, row, row_size);
+                continue;
+            }
+            const uint8_t* above = pixels.row(y - 1);
+            line[0] = 2;  // Up
+            for (size_t x = 0; x < row_size; ++x) line[1 + x] = static_cast<uint8_t>(row[x] - above[x]);
+        }
+    });
+    const deflate_result_t compressed = parallel_deflate(pool, filtered.data(), filtered.size(), level);
+
+    std::vector<uint8_t> png{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    png.reserve(compressed.stream.size() + 128);
+    std::vector<uint8_t> header{};
+    append_u32_be(header, pixels.width);
+    append_u32_be(header, pixels.height);
+    // bit depth, color type(RGB or RGBA), compression, filter, interlace
+    header.insert(header.end(), {8, static_cast<uint8_t>(channels == 4 ? 6 : 2), 0, 0, 0});
+    append_chunk(png, "IHDR", header.data(), header.size());
+    // zlib stream: header for 32KB window, the raw deflate stream, and the Adler-32
+    std::vector<uint8_t> data{0x78, 0x01};
+    data.reserve(compressed.stream.size() + 6);
+    data.insert(data.end(), compressed.stream.begin(), compressed.stream.end());
+    append_u32_be(data, compressed.adler);
+    append_chunk(png, "IDAT", data.data(), data.size());
+    append_chunk(png, "IEND", nullptr, 0);
+    return png;
+}
+
+std::vector<uint8_t> encode_i420_gzip(thread_pool_t& pool, const yuv_view_t& src, int level) noexcept(false) {
+    const std::vector<uint8_t> pixels = make_i420_copy(src);
+    const deflate_result_t compressed = parallel_deflate(pool, pixels.data(), pixels.size(), level);
+    // ID1, ID2, CM(deflate), FLG(FCOMMENT), MTIME, XFL, OS(Unix)
+    std::vector<uint8_t> gzip{0x1F, 0x8B, 8, 0x10, 0, 0, 0, 0, 0, 3};
+    const std::string comment = fmt::format("I420 {}x{}", src.width(), src.height());
+    gzip.insert(gzip.end(), comment.c_str(), comment.c_str() + comment.size() + 1);
+    gzip.insert(gzip.end(), compressed.stream.begin(), compressed.stream.end());
+    append_u32_le(gzip, compressed.crc);
+    append_u32_le(gzip, static_cast<uint32_t>(pixels.size()));
+    return gzip;
+}
+
+snapshot_writer_t::snapshot_writer_t(thread_pool_t& pool, uint32_t max_pending, memory_budget_t* memory) noexcept(false)
+    : pool{pool}, max_pending{std::max(max_pending, 1u)}, memory{memory}, worker{&snapshot_writer_t::run, this} {
+}
+
+snapshot_writer_t::~snapshot_writer_t() noexcept {
+    {
+        std::unique_lock lck{mtx};
+        stopping = true;
+    }
+    wakeup.notify_one();
+    if (worker.joinable()) worker.join();
+}
+
+void snapshot_writer_t::run() noexcept {
+    std::unique_lock lck{mtx};
+    while (true) {
+        wakeup.wait(lck, [this] { return stopping || jobs.empty() == false; });
+        // finish the pending frames before stop
+        if (jobs.empty()) return;
+        job_t job = std::move(jobs.front());
+        jobs.pop_front();
+        busy = true;
+        lck.unlock();
+        bool saved = false;
+        try {
+            save(job);
+            saved = true;
+        } catch (const std::exception& ex) {
+            spdlog::error("{}: {} {}", "snapshot_writer_t", job.path, ex.what());
+        }
+        lck.lock();
+        busy = false;
+        if (saved)
+            ++written_count;
+        else
+            ++failed_count;
+        if (jobs.empty()) idle.notify_all();
+    }
+}
+
+void snapshot_writer_t::save(const job_t& job) noexcept(false) {
+    switch (job.encoding) {
+        case encoding_t::png_yuv: {
+            const yuv_view_t src = make_i420_view(job.pixels.data(), job.width, job.height);
+            const yuv_resize_plan_t plan{src, job.width, job.height};
+            std::vector<uint8_t> rgb(static_cast<size_t>(job.width) * job.height * 3);
+            convert_yuv_to_rgb(pool, src, plan, rgb.data());
+            const plane_view_t<const uint8_t> pixels{rgb.data(), job.width, job.height,
+                                                     static_cast<int32_t>(job.width * 3), 3};
+            return write_file(job.path, encode_png(pool, pixels));
+        }
+        case encoding_t::png_rgba: {
+            const rgba_view_t src = make_rgba_view(job.pixels.data(), job.width, job.height);
+            return write_file(job.path, encode_png(pool, src.plane));
+        }
+        case encoding_t::gzip_i420: {
+            const yuv_view_t src = make_i420_view(job.pixels.data(), job.width, job.height);
+            return write_file(job.path, encode_i420_gzip(pool, src));
+        }
+    }
+}
+
+bool snapshot_writer_t::admit(size_t size, memory_charge_t& charge) noexcept {
+    std::unique_lock lck{mtx};
+    if (jobs.size() < max_pending) {
+        if (memory == nullptr) return true;
+        charge = memory_charge_t::try_reserve(*memory, size);
+        if (charge) return true;
+    }
+    ++dropped_count;
+    return false;
+}
+
+bool snapshot_writer_t::enqueue(job_t&& job) noexcept(false) {
+    {
+        std::unique_lock lck{mtx};
+        if (jobs.size() >= max_pending) {
+            ++dropped_count;
+            return false;
+        }
+        jobs.emplace_back(std::move(job));
+    }
+    wakeup.notify_one();
+    return true;
+}
+
+bool snapshot_writer_t::write_png(const yuv_view_t& src, std::string path) noexcept(false) {
+    memory_charge_t charge{};
+    if (admit(get_i420_size(src), charge) == false) return false;
+    return enqueue(job_t{encoding_t::png_yuv, src.width(), src.height(), make_i420_copy(src), std::move(path),
+                         std::move(charge)});
+}
+
+bool snapshot_writer_t::write_png(const rgba_view_t& src, std::string path) noexcept(false) {
+    memory_charge_t charge{};
+    if (admit(static_cast<size_t>(src.width()) * src.height() * 4, charge) == false) return false;
+    std::vector<uint8_t> pixels(static_cast<size_t>(src.width()) * src.height() * 4);
+    copy_plane(plane_view_t<const uint8_t>{src.plane.data, src.width() * 4, src.height(), src.plane.row_stride, 1},
+               pixels.data());
+    return enqueue(job_t{encoding_t::png_rgba, src.width(), src.height(), std::move(pixels), std::move(path),
+                         std::move(charge)});
+}
+
+bool snapshot_writer_t::write_gzip(const yuv_view_t& src, std::string path) noexcept(false) {
+    memory_charge_t charge{};
+    if (admit(get_i420_size(src), charge) == false) return false;
+    return enqueue(job_t{encoding_t::gzip_i420, src.width(), src.height(), make_i420_copy(src), std::move(path),
+                         std::move(charge)});
+}
+
+void snapshot_writer_t::flush() noexcept {
+    std::unique_lock lck{mtx};
+    idle.wait(lck, [this] { return jobs.empty() && busy == false; });
+}
+
+uint64_t snapshot_writer_t::written() noexcept {
+    std::unique_lock lck{mtx};
+    return written_count;
+}
+
+uint64_t snapshot_writer_t::dropped() noexcept {
+    std::unique_lock lck{mtx};
+    return dropped_count;
+}
+
+uint64_t snapshot_writer_t::failed() noexcept {
+    std::unique_lock lck{mtx};
+    return failed_count;
+}
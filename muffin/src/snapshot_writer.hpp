@@ -0,0 +1,136 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "image_view.hpp"
+#include "memory_budget.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief Raw deflate stream of the data and its checksums
+ */
+struct deflate_result_t final {
+    std::vector<uint8_t> stream{};
+    uint32_t adler = 1;  // `adler32` of the data. For the zlib stream(PNG)
+    uint32_t crc = 0;    // `crc32` of the data. For the gzip member
+};
+
+/**
+ * @brief pigz style deflate. Compress the bands of the data in parallel and concatenate the streams
+ * @details Each band is primed with the last 32KB of the previous band, and ends with `Z_SYNC_FLUSH` so the next
+ *  stream can start at a byte boundary. The checksums of the bands are merged with `adler32_combine`/`crc32_combine`.
+ * @param level compression level of zlib. 1 is enough for the snapshots
+ * @throw runtime_error if zlib failed
+ */
+deflate_result_t parallel_deflate(thread_pool_t& pool, const uint8_t* data, size_t length,
+                                  int level = 1) noexcept(false);
+
+/**
+ * @brief PNG of the interleaved 8-bit pixels. 3 channels for RGB, 4 for RGBA
+ * @details Rows use the Up filter, which is cheap and works well for the camera frames.
+ * @param pixels its `pixel_stride` must be the number of channels
+ * @throw invalid_argument if the `pixel_stride` is not 3 or 4
+ * @throw runtime_error if zlib failed
+ */
+std::vector<uint8_t> encode_png(thread_pool_t& pool, plane_view_t<const uint8_t> pixels,
+                                int level = 1) noexcept(false);
+
+/**
+ * @brief gzip member of the packed I420. `gunzip` gives the raw I420 like the old `.ycc` files
+ * @details The comment field of the gzip header has the size. For example, "I420 640x480"
+ * @throw runtime_error if zlib failed
+ */
+std::vector<uint8_t> encode_i420_gzip(thread_pool_t& pool, const yuv_view_t& src, int level = 1) noexcept(false);
+
+/**
+ * @brief Save the frames to the files in a background I/O thread
+ * @details `write_*` functions copy the frame and return immediately, so the caller can release the image.
+ *  The copy is the only work in the caller's thread. The I/O thread encodes the copy with the `thread_pool_t`
+ *  and writes it to a temporary file, then renames it to the `path`. The readers never see a partial file.
+ *
+ * If `max_pending` copies are waiting, the new frame is dropped instead of blocking the pipeline.
+ * Give the writer its own pool. A loop in the `get_default_pool()` would hold all of its workers while a frame is
+ * compressed, and the pipeline's loops would wait for it.
+ *
+ * ```cpp
+ * thread_pool_t pool{2};
+ * snapshot_writer_t writer{pool};
+ * writer.write_png(make_yuv_view(lease), "/sdcard/Download/frame.png");
+ * ```
+ */
+class snapshot_writer_t final {
+   public:
+    enum class encoding_t : uint32_t {
+        png_yuv = 1,   // I420 copy. converted to RGB in the I/O thread
+        png_rgba = 2,  // RGBA copy
+        gzip_i420 = 3,
+    };
+
+   private:
+    struct job_t final {
+        encoding_t encoding;
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> pixels;  // packed
+        std::string path;
+        memory_charge_t charge{};  // of the `pixels`. released with the job
+    };
+
+    thread_pool_t& pool;
+    uint32_t max_pending;
+    std::mutex mtx{};
+    std::condition_variable wakeup{};
+    std::condition_variable idle{};
+    std::deque<job_t> jobs{};
+    bool busy = false;  // the I/O thread has a job out of the queue
+    bool stopping = false;
+    uint64_t written_count = 0;
+    uint64_t dropped_count = 0;
+    uint64_t failed_count = 0;
+    memory_budget_t* memory;
+    std::thread worker;
+
+   public:
+    /**
+     * @param pool used to convert and compress the frames. Not the one of the pipeline
+     * @param max_pending number of the frames waiting for the I/O thread
+     * @param memory account of the pending copies. The frame is dropped if its copy doesn't fit. null to skip
+     * @throw system_error if `std::thread` failed
+     */
+    explicit snapshot_writer_t(thread_pool_t& pool, uint32_t max_pending = 4,
+                               memory_budget_t* memory = nullptr) noexcept(false);
+    /// @brief Finish the pending frames and join the I/O thread
+    ~snapshot_writer_t() noexcept;
+    snapshot_writer_t(const snapshot_writer_t&) = delete;
+    snapshot_writer_t(snapshot_writer_t&&) = delete;
+    snapshot_writer_t& operator=(const snapshot_writer_t&) = delete;
+    snapshot_writer_t& operator=(snapshot_writer_t&&) = delete;
+
+   private:
+    void run() noexcept;
+    void save(const job_t& job) noexcept(false);
+    /// @return false if the frame must be dropped for the `max_pending` or the `memory`
+    bool admit(size_t size, memory_charge_t& charge) noexcept;
+    bool enqueue(job_t&& job) noexcept(false);
+
+   public:
+    /**
+     * @return false if the frame is dropped because of the pending frames or the memory budget
+     * @throw bad_alloc
+     */
+    bool write_png(const yuv_view_t& src, std::string path) noexcept(false);
+    bool write_png(const rgba_view_t& src, std::string path) noexcept(false);
+    bool write_gzip(const yuv_view_t& src, std::string path) noexcept(false);
+
+    /// @brief Wait until all pending frames are saved or failed
+    void flush() noexcept;
+
+    uint64_t written() noexcept;
+    uint64_t dropped() noexcept;
+    uint64_t failed() noexcept;
+};
@@ -0,0 +1,177 @@
+#include <jni.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "snapshot_writer.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+
+namespace {
+
+/**
+ * @brief View of the direct `ByteBuffer`. Its capacity must cover the last pixel
+ * @throw invalid_argument if the buffer is not direct or too small
+ */
+plane_view_t<const uint8_t> get_plane_view(JNIEnv* env, jobject buffer, uint32_t width, uint32_t height,
+                                           jint row_stride, jint pixel_stride) noexcept(false) {
+    const auto data = static_cast<const uint8_t*>(env->GetDirectBufferAddress(buffer));
+    if (data == nullptr) throw std::invalid_argument{"not a direct ByteBuffer"};
+    if (width == 0 || height == 0 || row_stride <= 0 || pixel_stride <= 0)
+        throw std::invalid_argument{"invalid plane layout"};
+    const auto required = static_cast<jlong>(row_stride) * (height - 1) + static_cast<jlong>(width - 1) * pixel_stride + 1;
+    if (env->GetDirectBufferCapacity(buffer) < required) throw std::invalid_argument{"ByteBuffer is too small"};
+    return plane_view_t<const uint8_t>{data, width, height, row_stride, pixel_stride};
+}
+
+std::string get_path(JNIEnv* env, jstring path) noexcept(false) {
+    const char* chars = env->GetStringUTFChars(path, nullptr);
+    if (chars == nullptr) throw std::runtime_error{"GetStringUTFChars"};
+    std::string result{chars};
+    env->ReleaseStringUTFChars(path, chars);
+    return result;
+}
+
+/**
+ * @brief The writer with its own pool. The compression must not occupy the `get_default_pool()` of the pipeline
+ */
+struct snapshot_writer_owner_t final {
+    thread_pool_t pool;
+    snapshot_writer_t writer;  // destroyed before the `pool`
+
+   public:
+    /// @note `Environment.SetMemoryBudget("snapshots", ...)` limits the pending copies of all writers
+    explicit snapshot_writer_owner_t(uint32_t max_pending) noexcept(false)
+        : pool{std::clamp(std::thread::hardware_concurrency() / 4, 1u, 2u)},
+          writer{pool, max_pending, &get_memory_budget("snapshots")} {}
+};
+
+snapshot_writer_t& get_writer(jlong ptr) noexcept {
+    return reinterpret_cast<snapshot_writer_owner_t*>(ptr)->writer;
+}
+
+}  // namespace
+
+extern "C" {
+
+JNIEXPORT jlong Java_dev_luncliff_muffin_SnapshotWriter_create1(JNIEnv* env, jclass, jint max_pending) {
+    try {
+        auto owner = new snapshot_writer_owner_t{static_cast<uint32_t>(max_pending)};
+        return reinterpret_cast<jlong>(owner);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+JNIEXPORT void Java_dev_luncliff_muffin_SnapshotWriter_destroy1(JNIEnv*, jclass, jlong ptr) {
+    auto owner = reinterpret_cast<snapshot_writer_owner_t*>(ptr);
+    delete owner;
+}
+
+/**
+ * @param png true for PNG, false for the gzip'd I420
+ * @return false if the frame is dropped
+ */
+JNIEXPORT jboolean Java_dev_luncliff_muffin_SnapshotWriter_write1(  //
+    JNIEnv* env, jclass, jlong ptr, jobject y, jobject u, jobject v, jint width, jint height, jint y_row_stride,
+    jint uv_row_stride, jint uv_pixel_stride, jstring path, jboolean png) {
+    snapshot_writer_t& writer = get_writer(ptr);
+    try {
+        const auto w = static_cast<uint32_t>(width), h = static_cast<uint32_t>(height);
+        const uint32_t cw = (w + 1) / 2, ch = (h + 1) / 2;
+        yuv_view_t src{};
+        src.y = get_plane_view(env, y, w, h, y_row_stride, 1);
+        src.u = get_plane_view(env, u, cw, ch, uv_row_stride, uv_pixel_stride);
+        src.v = get_plane_view(env, v, cw, ch, uv_row_stride, uv_pixel_stride);
+        if (png) return writer.write_png(src, get_path(env, path));
+        return writer.write_gzip(src, get_path(env, path));
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return false;
+    }
+}
+
+/**
+ * @return false if the frame is dropped
+ */
+JNIEXPORT jboolean Java_dev_luncliff_muffin_SnapshotWriter_write2(  //
+    JNIEnv* env, jclass, jlong ptr, jobject rgba, jint width, jint height, jint row_stride, jstring path) {
+    snapshot_writer_t& writer = get_writer(ptr);
+    try {
+        const rgba_view_t src{
+            get_plane_view(env, rgba, static_cast<uint32_t>(width), static_cast<uint32_t>(height), row_stride, 4)};
+        return writer.write_png(src, get_path(env, path));
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return false;
+    }
+}
+
+JNIEXPORT void Java_dev_luncliff_muffin_SnapshotWriter_flush1(JNIEnv*, jclass, jlong ptr) {
+    snapshot_writer_t& writer = get_writer(ptr);
+    writer.flush();
+}
+
+/**
+ * @return written, dropped, failed
+ */
+JNIEXPORT jlongArray Java_dev_luncliff_muffin_SnapshotWriter_query1(JNIEnv* env, jclass, jlong ptr) {
+    snapshot_writer_t& writer = get_writer(ptr);
+    const jlong counts[3]{static_cast<jlong>(writer.written()), static_cast<jlong>(writer.dropped()),
+                          static_cast<jlong>(writer.failed())};
+    jlongArray result = env->NewLongArray(3);
+    if (result == nullptr) return nullptr;
+    env->SetLongArrayRegion(result, 0, 3, counts);
+    return result;
+}
+
+/**
+ * @brief Run the loops in the `get_default_pool()` while the writer compresses a noisy RGBA frame
+ * @return microseconds of the save, and the longest loop
+ */
+JNIEXPORT jlongArray Java_dev_luncliff_muffin_SaveImageTest_measurePoolWait(JNIEnv* env, jclass, jstring path) {
+    using namespace std::chrono;
+    try {
+        const uint32_t width = 2048, height = 2048;
+        std::vector<uint8_t> pixels(width * height * 4);
+        uint32_t state = 2463534242;  // xorshift. hard to compress
+        for (uint8_t& value : pixels) {
+            state ^= state << 13, state ^= state >> 17, state ^= state << 5;
+            value = static_cast<uint8_t>(state);
+        }
+        thread_pool_t& pool = get_default_pool();
+        snapshot_writer_owner_t owner{1};
+        const auto start = steady_clock::now();
+        if (owner.writer.write_png(make_rgba_view(pixels.data(), width, height), get_path(env, path)) == false)
+            throw std::runtime_error{"the frame is dropped"};
+        nanoseconds longest{};
+        std::atomic<size_t> sum{};
+        while (owner.writer.written() + owner.writer.failed() == 0) {
+            const auto begin = steady_clock::now();
+            pool.parallel_for({0, 4096}, 64, [&sum](index_range_t range) { sum += range.end - range.begin; });
+            longest = std::max<nanoseconds>(longest, steady_clock::now() - begin);
+        }
+        if (owner.writer.failed() != 0) throw std::runtime_error{"failed to save the frame"};
+        const jlong result[2]{duration_cast<microseconds>(steady_clock::now() - start).count(),
+                              duration_cast<microseconds>(longest).count()};
+        jlongArray output = env->NewLongArray(2);
+        if (output == nullptr) return nullptr;
+        env->SetLongArrayRegion(output, 0, 2, result);
+        return output;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return nullptr;
+    }
+}
+
+}  // extern "C"
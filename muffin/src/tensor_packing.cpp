@@ -0,0 +1,46 @@
+#include "tensor_packing.hpp"
+
+#include <tensorflow/lite/c/c_api.h>
+
+#include <stdexcept>
+
+tensor_packing_t make_tensor_packing(TfLiteTensor* tensor) noexcept(false) {
+    if (TfLiteTensorNumDims(tensor) != 4 || TfLiteTensorDim(tensor, 0) != 1)
+        throw std::invalid_argument{"make_tensor_packing: expect [1, H, W, C] or [1, C, H, W]"};
+    tensor_packing_t packing{};
+    if (TfLiteTensorDim(tensor, 3) == 3) {
+        packing.layout = tensor_layout_t::nhwc;
+        packing.height = static_cast<uint32_t>(TfLiteTensorDim(tensor, 1));
+        packing.width = static_cast<uint32_t>(TfLiteTensorDim(tensor, 2));
+    } else if (TfLiteTensorDim(tensor, 1) == 3) {
+        packing.layout = tensor_layout_t::nchw;
+        packing.height = static_cast<uint32_t>(TfLiteTensorDim(tensor, 2));
+        packing.width = static_cast<uint32_t>(TfLiteTensorDim(tensor, 3));
+    } else {
+        throw std::invalid_argument{"make_tensor_packing: expect 3 channels"};
+    }
+    switch (TfLiteTensorType(tensor)) {
+        case kTfLiteFloat32:
+            packing.type = tensor_type_t::float32;
+            break;
+        case kTfLiteFloat16:
+            packing.type = tensor_type_t::float16;
+            break;
+        case kTfLiteUInt8:
+        case kTfLiteInt8: {
+            packing.type = TfLiteTensorType(tensor) == kTfLiteUInt8 ? tensor_type_t::uint8 : tensor_type_t::int8;
+            const TfLiteQuantizationParams params = TfLiteTensorQuantizationParams(tensor);
+            if (params.scale <= 0) throw std::invalid_argument{"make_tensor_packing: no quantization parameter"};
+            packing.scale = params.scale;
+            packing.zero_point = params.zero_point;
+            break;
+        }
+        default:
+            throw std::invalid_argument{"make_tensor_packing: unsupported tensor type"};
+    }
+    packing.data = TfLiteTensorData(tensor);
+    if (packing.data == nullptr) throw std::invalid_argument{"make_tensor_packing: tensor is not allocated"};
+    const size_t expected = static_cast<size_t>(packing.width) * packing.height * 3 * get_element_size(packing.type);
+    if (TfLiteTensorByteSize(tensor) != expected) throw std::invalid_argument{"make_tensor_packing: unexpected size"};
+    return packing;
+}
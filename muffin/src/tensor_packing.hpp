@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+
+struct TfLiteTensor;
+
+/// @brief Memory order of the image input
+enum class tensor_layout_t : uint32_t {
+    nhwc = 0,  // XNNPACK, NNAPI
+    nchw = 1,  // models converted from PyTorch
+};
+
+/// @brief Element types of the image input. Same values with `TfLiteType`
+enum class tensor_type_t : int32_t {
+    float32 = 1,
+    uint8 = 3,
+    int8 = 9,
+    float16 = 10,  // IEEE half in `uint16_t`
+};
+
+/**
+ * @brief Destination of `convert_yuv_to_rgb` in the model's input layout and type
+ * @details For the quantized types, the normalized value `x` is stored as `round(x / scale) + zero_point`
+ */
+struct tensor_packing_t final {
+    void* data;
+    tensor_type_t type;
+    tensor_layout_t layout;
+    uint32_t width;
+    uint32_t height;
+    float scale = 1;
+    int32_t zero_point = 0;
+};
+
+/// @return bytes of one element
+constexpr uint32_t get_element_size(tensor_type_t type) noexcept {
+    switch (type) {
+        case tensor_type_t::float32:
+            return 4;
+        case tensor_type_t::float16:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * @brief Packing for the model's image input. Use after `TfLiteInterpreterAllocateTensors`
+ * @param tensor `[1, H, W, 3]` for NHWC, `[1, 3, H, W]` for NCHW
+ * @throw invalid_argument if the shape or the type is not supported, or the buffer is not allocated
+ */
+tensor_packing_t make_tensor_packing(TfLiteTensor* tensor) noexcept(false);
@@ -0,0 +1,189 @@
+#include "thread_pool.hpp"
+
+#include <pthread.h>
+#include <spdlog/spdlog.h>
+
+#include <string>
+#include <utility>
+
+/// @brief The pool which owns the current thread. Used to detect nested loops
+static thread_local const thread_pool_t* current_pool = nullptr;
+
+namespace {
+
+/// @brief Mark the caller of `dispatch` as a member of the pool while it runs its lane
+class current_pool_scope_t final {
+    const thread_pool_t* previous;
+
+   public:
+    explicit current_pool_scope_t(const thread_pool_t* pool) noexcept : previous{std::exchange(current_pool, pool)} {}
+    ~current_pool_scope_t() noexcept { current_pool = previous; }
+    current_pool_scope_t(const current_pool_scope_t&) = delete;
+    current_pool_scope_t(current_pool_scope_t&&) = delete;
+    current_pool_scope_t& operator=(const current_pool_scope_t&) = delete;
+    current_pool_scope_t& operator=(current_pool_scope_t&&) = delete;
+};
+
+}  // namespace
+
+tile_t make_cache_tile(uint32_t width, uint32_t height, uint32_t bytes_per_pixel, size_t cache_size) noexcept {
+    constexpr uint32_t cache_line = 64;
+    tile_t tile{0, 0, width, height};
+    if (width == 0 || height == 0 || bytes_per_pixel == 0) return tile;
+    const size_t row_bytes = static_cast<size_t>(width) * bytes_per_pixel;
+    if (row_bytes <= cache_size) {
+        // full-width row band
+        tile.height = std::clamp<uint32_t>(static_cast<uint32_t>(cache_size / row_bytes), 1, height);
+        return tile;
+    }
+    // the row is too long. split the columns with cache line granularity
+    const uint32_t line_pixels = std::max<uint32_t>(cache_line / bytes_per_pixel, 1);
+    const uint32_t columns = static_cast<uint32_t>(cache_size / bytes_per_pixel);
+    tile.width = std::max(columns / line_pixels, 1u) * line_pixels;
+    tile.height = 1;
+    return tile;
+}
+
+thread_pool_t::thread_pool_t(uint32_t count) noexcept(false) : lanes{std::make_unique<lane_t[]>(count + 1)} {
+    workers.reserve(count);
+    try {
+        for (uint32_t i = 0; i < count; ++i) workers.emplace_back(&thread_pool_t::run, this, i + 1);
+    } catch (...) {
+        {
+            std::lock_guard lck{mtx};
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (auto& worker : workers) worker.join();  // the threads already started
+        throw;
+    }
+}
+
+thread_pool_t::~thread_pool_t() noexcept {
+    {
+        std::lock_guard lck{mtx};
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto& worker : workers)
+        if (worker.joinable()) worker.join();
+    workers.clear();
+}
+
+uint32_t thread_pool_t::concurrency() const noexcept { return static_cast<uint32_t>(workers.size() + 1); }
+
+void thread_pool_t::run(uint32_t lane) noexcept {
+    const auto name = fmt::format("muffin-pool-{}", lane);
+    pthread_setname_np(pthread_self(), name.c_str());
+    current_pool = this;
+
+    uint64_t seen = 0;
+    std::unique_lock lck{mtx};
+    while (true) {
+        wakeup.wait(lck, [this, &seen]() { return stopping || (open && generation != seen) || head != tail; });
+        if (open && generation != seen) {
+            seen = generation;
+            if (lane >= lane_count) continue;  // the loop is too small for this worker
+            ++running;
+            lck.unlock();
+            work(lane);
+            lck.lock();
+            if (--running == 0 && open == false) finished.notify_one();
+            continue;
+        }
+        if (head != tail) {
+            const posted_t item = queue[head++ % queue.size()];
+            lck.unlock();
+            item.job(item.context);
+            lck.lock();
+            continue;
+        }
+        if (stopping) return;  // the queue is drained
+    }
+}
+
+void thread_pool_t::post(job_t job, void* context) noexcept(false) {
+    if (workers.empty()) return job(context);
+    {
+        std::unique_lock lck{mtx};
+        if (tail - head == queue.size()) {
+            lck.unlock();
+            return job(context);
+        }
+        queue[tail++ % queue.size()] = posted_t{job, context};
+    }
+    wakeup.notify_one();
+}
+
+void thread_pool_t::work(uint32_t lane) noexcept {
+    // drain the own lane first, and then steal from the others
+    for (uint32_t i = 0; i < lane_count; ++i) {
+        lane_t& victim = lanes[(lane + i) % lane_count];
+        while (true) {
+            const size_t begin = victim.next.fetch_add(grain, std::memory_order_relaxed);
+            if (begin >= victim.end) break;
+            try {
+                task(context, {begin, std::min(begin + grain, victim.end)});
+            } catch (...) {
+                std::lock_guard lck{mtx};
+                if (failure == nullptr) failure = std::current_exception();
+            }
+        }
+    }
+}
+
+void thread_pool_t::dispatch(index_range_t range, size_t _grain, task_t _task, void* _context) noexcept(false) {
+    if (range.end <= range.begin) return;
+    const size_t count = range.end - range.begin;
+    const uint32_t concurrency = this->concurrency();
+    if (_grain == 0) _grain = std::max<size_t>(count / (concurrency * 4), 1);
+
+    const size_t chunks = (count + _grain - 1) / _grain;
+    if (chunks == 1 || concurrency == 1 || current_pool == this) {
+        // nothing to share or nested loop. run inline
+        for (size_t begin = range.begin; begin < range.end; begin += _grain)
+            _task(_context, {begin, std::min(begin + _grain, range.end)});
+        return;
+    }
+
+    std::lock_guard caller{submit};
+    const auto participants = static_cast<uint32_t>(std::min<size_t>(chunks, concurrency));
+    // split the chunks evenly into the lanes
+    const size_t per_lane = chunks / participants, remain = chunks % participants;
+    size_t begin = range.begin;
+    for (uint32_t i = 0; i < participants; ++i) {
+        const size_t end = std::min(begin + (per_lane + (i < remain ? 1 : 0)) * _grain, range.end);
+        lanes[i].next.store(begin, std::memory_order_relaxed);
+        lanes[i].end = end;
+        begin = end;
+    }
+    {
+        std::lock_guard lck{mtx};
+        task = _task;
+        context = _context;
+        grain = _grain;
+        lane_count = participants;
+        failure = nullptr;
+        open = true;
+        ++generation;
+    }
+    wakeup.notify_all();
+    {
+        // the loops requested from the caller's lane run inline, like the workers'. `submit` is not recursive
+        current_pool_scope_t scope{this};
+        work(0);
+    }
+
+    // the lanes are drained. wait for the workers which joined the loop
+    std::unique_lock lck{mtx};
+    open = false;
+    finished.wait(lck, [this]() { return running == 0; });
+    task = nullptr;
+    context = nullptr;
+    if (failure) std::rethrow_exception(std::exchange(failure, nullptr));
+}
+
+thread_pool_t& get_default_pool() noexcept(false) {
+    static thread_pool_t pool{std::max(std::thread::hardware_concurrency(), 2u) - 1};
+    return pool;
+}
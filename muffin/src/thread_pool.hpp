@@ -0,0 +1,183 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <experimental/coroutine>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Half-open range of indices. `[begin, end)`
+ */
+struct index_range_t final {
+    size_t begin;
+    size_t end;
+};
+
+/**
+ * @brief Rectangle of an image. Also used for the size of the tile
+ */
+struct tile_t final {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+/**
+ * @brief Tile which fits in the `cache_size`. Prefers full-width row bands so each row stays contiguous
+ * @param bytes_per_pixel bytes of the largest plane which will be touched in the tile
+ */
+tile_t make_cache_tile(uint32_t width, uint32_t height, uint32_t bytes_per_pixel,
+                       size_t cache_size = 256 * 1024) noexcept;
+
+/**
+ * @brief Fixed set of native worker threads for data-parallel loops
+ * @details The caller thread also works in `parallel_for`. The range is split into lanes(one for each thread),
+ *  and each thread claims `grain` sized chunks from its lane. When its lane is exhausted, it steals chunks from the
+ *  other lanes. Lanes are allocated once in the constructor, so each invocation doesn't allocate.
+ *
+ * Only one loop runs in the pool at a time. Loops requested from the pool's own worker run inline.
+ * Workers which are busy with `post`ed jobs don't join the loop. Their lanes are stolen by the others.
+ *
+ * ```cpp
+ * thread_pool_t& pool = get_default_pool();
+ * pool.parallel_for({0, height}, 16, [&](index_range_t rows) {
+ *     for (auto y = rows.begin; y < rows.end; ++y)
+ *         convert_row(y);
+ * });
+ * ```
+ */
+class thread_pool_t final {
+   public:
+    using task_t = void (*)(void* context, index_range_t range);
+    using job_t = void (*)(void* context);
+
+   private:
+    struct posted_t final {
+        job_t job;
+        void* context;
+    };
+
+    /// @note `next` may go over `end` when the lane is exhausted
+    struct alignas(64) lane_t final {
+        std::atomic<size_t> next{};
+        size_t end = 0;
+    };
+
+    std::vector<std::thread> workers{};
+    std::unique_ptr<lane_t[]> lanes{};  // 1 for the caller + 1 for each worker
+    std::mutex submit{};                // serialize the callers
+    std::mutex mtx{};
+    std::condition_variable wakeup{};
+    std::condition_variable finished{};
+    uint64_t generation = 0;
+    uint32_t running = 0;  // number of workers in the current loop
+    bool open = false;     // workers can join the current loop
+    bool stopping = false;
+    std::exception_ptr failure{};
+    std::array<posted_t, 64> queue{};  // ring buffer for `post`
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    // current loop. valid while `open` or `running`
+    task_t task = nullptr;
+    void* context = nullptr;
+    size_t grain = 1;
+    uint32_t lane_count = 0;
+
+   public:
+    /**
+     * @param count number of worker threads. The pool can be used even if it's 0
+     * @throw system_error if `std::thread` failed
+     */
+    explicit thread_pool_t(uint32_t count) noexcept(false);
+    ~thread_pool_t() noexcept;
+    thread_pool_t(const thread_pool_t&) = delete;
+    thread_pool_t(thread_pool_t&&) = delete;
+    thread_pool_t& operator=(const thread_pool_t&) = delete;
+    thread_pool_t& operator=(thread_pool_t&&) = delete;
+
+   private:
+    void run(uint32_t lane) noexcept;
+    void work(uint32_t lane) noexcept;
+
+   public:
+    /// @return number of threads including the caller
+    uint32_t concurrency() const noexcept;
+
+    /**
+     * @brief Invoke the `task` for each chunk of the `range` and wait for all of them
+     * @param grain size of the chunk. 0 to select automatically
+     * @throw the first exception from the `task`
+     */
+    void dispatch(index_range_t range, size_t grain, task_t task, void* context) noexcept(false);
+
+    /**
+     * @brief Run the `job` in one of the workers. Doesn't wait for it
+     * @note If there is no worker or the queue is full, the `job` runs inline
+     */
+    void post(job_t job, void* context) noexcept(false);
+
+    /**
+     * @brief `co_await pool.schedule()` resumes the coroutine in one of the workers
+     * @see post
+     */
+    [[nodiscard]] auto schedule() noexcept {
+        class awaiter_t final : public std::experimental::suspend_always {
+            thread_pool_t& pool;
+
+           public:
+            explicit awaiter_t(thread_pool_t& _pool) noexcept : pool{_pool} {}
+
+            void await_suspend(std::experimental::coroutine_handle<void> coro) noexcept(false) {
+                auto resume = [](void* ptr) { std::experimental::coroutine_handle<void>::from_address(ptr).resume(); };
+                return pool.post(resume, coro.address());
+            }
+        };
+        return awaiter_t{*this};
+    }
+
+    /**
+     * @param fn `void(index_range_t)`. Invoked with `grain` sized chunk (the last one can be smaller)
+     * @see dispatch
+     */
+    template <typename Fn>
+    void parallel_for(index_range_t range, size_t grain, Fn&& fn) noexcept(false) {
+        using callable_t = std::remove_reference_t<Fn>;
+        auto invoke = [](void* ptr, index_range_t chunk) { (*static_cast<callable_t*>(ptr))(chunk); };
+        return dispatch(range, grain, invoke, const_cast<void*>(static_cast<const void*>(std::addressof(fn))));
+    }
+
+    /**
+     * @param tile size of each tile. @see make_cache_tile
+     * @param fn `void(tile_t)`. The tiles in the last row/column can be smaller than `tile`
+     */
+    template <typename Fn>
+    void parallel_tiles(uint32_t width, uint32_t height, tile_t tile, Fn&& fn) noexcept(false) {
+        if (tile.width == 0 || tile.height == 0) return;
+        const uint32_t columns = (width + tile.width - 1) / tile.width;
+        const uint32_t rows = (height + tile.height - 1) / tile.height;
+        return parallel_for({0, static_cast<size_t>(columns) * rows}, 1, [&](index_range_t chunk) {
+            for (auto i = chunk.begin; i < chunk.end; ++i) {
+                tile_t t{};
+                t.x = static_cast<uint32_t>(i % columns) * tile.width;
+                t.y = static_cast<uint32_t>(i / columns) * tile.height;
+                t.width = std::min(tile.width, width - t.x);
+                t.height = std::min(tile.height, height - t.y);
+                fn(t);
+            }
+        });
+    }
+};
+
+/**
+ * @brief Shared pool for muffin's kernels. Uses `hardware_concurrency() - 1` workers
+ */
+thread_pool_t& get_default_pool() noexcept(false);
@@ -0,0 +1,167 @@
+#include <jni.h>
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "muffin.hpp"
+#include "thread_pool.hpp"
+
+void store_runtime_exception(JNIEnv* env, const char* message) noexcept;
+
+/// @brief Row kernel for the benchmark. Some arithmetic on each pixel, like a color conversion
+void normalize_rows(const uint8_t* src, float* dst, uint32_t width, index_range_t rows) noexcept {
+    for (auto y = rows.begin; y < rows.end; ++y) {
+        const uint8_t* s = src + y * width;
+        float* d = dst + y * width;
+        for (uint32_t x = 0; x < width; ++x) d[x] = std::sqrt(s[x] / 255.0f) * 0.5f - 0.25f;
+    }
+}
+
+namespace {
+
+/// @brief Shared by the jobs of `deliverFromWorkers`
+struct delivery_t final {
+    jobject consumer;
+    jmethodID accept;
+    std::atomic<jlong> next{};
+    std::atomic<jint> failed{};
+    std::mutex mtx{};
+    std::condition_variable finished{};
+    jint done = 0;
+};
+
+/// @brief Invoke the `LongConsumer` from the worker. The worker is attached on its first job
+void deliver(void* context) noexcept {
+    auto& delivery = *static_cast<delivery_t*>(context);
+    try {
+        JNIEnv* env = get_jni_env();
+        jni_local_frame_t frame{env, 4};
+        env->CallVoidMethod(delivery.consumer, delivery.accept, delivery.next++);
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+            delivery.failed += 1;
+        }
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        delivery.failed += 1;
+    }
+    std::lock_guard lock{delivery.mtx};
+    delivery.done += 1;
+    delivery.finished.notify_one();
+}
+
+}  // namespace
+
+extern "C" {
+
+/**
+ * @return sum of the normalized pixels. Must be same regardless of `threads`
+ */
+JNIEXPORT jdouble Java_dev_luncliff_muffin_ThreadPoolTest_sumRows(  //
+    JNIEnv* env, jclass, jint threads, jint width, jint height) {
+    try {
+        std::vector<uint8_t> src(width * height);
+        for (size_t i = 0; i < src.size(); ++i) src[i] = static_cast<uint8_t>(i * 31);
+        std::vector<float> dst(width * height);
+
+        thread_pool_t pool{static_cast<uint32_t>(threads - 1)};
+        pool.parallel_for({0, static_cast<size_t>(height)}, 8, [&](index_range_t rows) {
+            normalize_rows(src.data(), dst.data(), width, rows);
+        });
+        double sum = 0;
+        for (float v : dst) sum += v;
+        return sum;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @return average nanoseconds of `repeat` loops over the rows
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_ThreadPoolTest_measureRows(  //
+    JNIEnv* env, jclass, jint threads, jint width, jint height, jint repeat) {
+    using namespace std::chrono;
+    try {
+        std::vector<uint8_t> src(width * height, 127);
+        std::vector<float> dst(width * height);
+
+        thread_pool_t pool{static_cast<uint32_t>(threads - 1)};
+        const tile_t tile = make_cache_tile(width, height, sizeof(float));
+        const auto start = steady_clock::now();
+        for (int i = 0; i < repeat; ++i)
+            pool.parallel_for({0, static_cast<size_t>(height)}, tile.height, [&](index_range_t rows) {
+                normalize_rows(src.data(), dst.data(), width, rows);
+            });
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+        spdlog::info("{}: threads {} {}x{} {} ns", __func__, threads, width, height, elapsed.count() / repeat);
+        return static_cast<jlong>(elapsed.count() / repeat);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief `parallel_for` in the chunks of the other `parallel_for`. The inner loops must run inline
+ * @return number of the visited items. Must be `outer * inner`
+ */
+JNIEXPORT jlong Java_dev_luncliff_muffin_ThreadPoolTest_countNested(  //
+    JNIEnv* env, jclass, jint threads, jint outer, jint inner) {
+    try {
+        thread_pool_t pool{static_cast<uint32_t>(threads - 1)};
+        std::atomic<size_t> count{};
+        pool.parallel_for({0, static_cast<size_t>(outer)}, 1, [&](index_range_t) {
+            pool.parallel_for({0, static_cast<size_t>(inner)}, 1,
+                              [&count](index_range_t range) { count += range.end - range.begin; });
+        });
+        return static_cast<jlong>(count.load());
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Invoke the `consumer` with [0, `count`) from the pool's workers. They use `get_jni_env`, and are detached
+ *  when the pool is destroyed
+ * @return number of the failed callbacks
+ */
+JNIEXPORT jint Java_dev_luncliff_muffin_ThreadPoolTest_deliverFromWorkers(  //
+    JNIEnv* env, jclass, jint threads, jint count, jobject consumer) {
+    using namespace std::chrono;
+    try {
+        if (get_jni_env() != env) throw std::runtime_error{"the JNIEnv of the Java thread is not used"};
+        jclass type = env->FindClass("java/util/function/LongConsumer");
+        if (type == nullptr) throw std::runtime_error{"No Java class: java/util/function/LongConsumer"};
+        delivery_t delivery{};
+        delivery.accept = env->GetMethodID(type, "accept", "(J)V");
+        if (delivery.accept == nullptr) throw std::runtime_error{"No Java method: LongConsumer accept"};
+        delivery.consumer = env->NewGlobalRef(consumer);
+        bool timeout = false;
+        {
+            thread_pool_t pool{static_cast<uint32_t>(threads - 1)};
+            for (jint i = 0; i < count; ++i) pool.post(&deliver, &delivery);
+            std::unique_lock lock{delivery.mtx};
+            timeout = !delivery.finished.wait_for(lock, seconds{5}, [&]() { return delivery.done == count; });
+        }  // the workers exit and detach
+        env->DeleteGlobalRef(delivery.consumer);
+        if (timeout) throw std::runtime_error{"the jobs are not finished"};
+        return delivery.failed.load();
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        store_runtime_exception(env, ex.what());
+        return -1;
+    }
+}
+
+}  // extern "C"
@@ -0,0 +1,240 @@
+#include "yuv_convert.hpp"
+
+#include "convert_kernels.hpp"
+
+orientation_t make_orientation(int32_t sensor_orientation, bool front_facing, int32_t device_orientation) noexcept {
+    device_orientation = ((device_orientation + 45) / 90 * 90) % 360;
+    if (front_facing) device_orientation = -device_orientation;
+    const auto degrees = static_cast<uint16_t>((sensor_orientation + device_orientation + 360) % 360 / 90 * 90);
+    return orientation_t{degrees, front_facing};
+}
+
+yuv_resize_plan_t::yuv_resize_plan_t(const yuv_view_t& layout, uint32_t out_width, uint32_t out_height,
+                                     orientation_t orientation) noexcept(false)
+    : out_width{out_width}, out_height{out_height} {
+    if (layout.width() == 0 || layout.height() == 0 || out_width == 0 || out_height == 0)
+        throw std::invalid_argument{"yuv_resize_plan_t: zero size"};
+    const orientation_map_t map = get_orientation_map(orientation);
+    const plane_view_t<const uint8_t>& luma = layout.y;
+    const plane_view_t<const uint8_t>& chroma = layout.u;  // U and V have same layout
+    if (map.transpose) {
+        make_axis(luma_rows, luma.width, out_height, luma.pixel_stride);
+        make_axis(luma_columns, luma.height, out_width, luma.row_stride);
+        make_axis(chroma_rows, chroma.width, out_height, chroma.pixel_stride);
+        make_axis(chroma_columns, chroma.height, out_width, chroma.row_stride);
+    } else {
+        make_axis(luma_rows, luma.height, out_height, luma.row_stride);
+        make_axis(luma_columns, luma.width, out_width, luma.pixel_stride);
+        make_axis(chroma_rows, chroma.height, out_height, chroma.row_stride);
+        make_axis(chroma_columns, chroma.width, out_width, chroma.pixel_stride);
+    }
+    if (map.reverse_rows) {
+        reverse_axis(luma_rows);
+        reverse_axis(chroma_rows);
+    }
+    if (map.reverse_columns) {
+        reverse_axis(luma_columns);
+        reverse_axis(chroma_columns);
+    }
+}
+
+uint32_t yuv_resize_plan_t::width() const noexcept { return out_width; }
+
+uint32_t yuv_resize_plan_t::height() const noexcept { return out_height; }
+
+void convert_yuv_to_rgb(const yuv_view_t& src, const yuv_resize_plan_t& plan, const rgb_normalization_t& norm,
+                        float* dst, index_range_t rows) noexcept {
+    const auto store = tensor_store_t<float, tensor_layout_t::nhwc>{dst, plan.width(), 0, make_affine(norm)};
+    convert_rows(src, plan, store, rows);
+}
+
+void convert_yuv_to_rgb(const yuv_view_t& src, const yuv_resize_plan_t& plan, const rgb_normalization_t& norm,
+                        const tensor_packing_t& dst, index_range_t rows) noexcept {
+    visit_store(dst, norm, [&](const auto& store) { convert_rows(src, plan, store, rows); });
+}
+
+void convert_yuv_to_rgb(const yuv_view_t& src, const yuv_resize_plan_t& plan, uint8_t* dst,
+                        index_range_t rows) noexcept {
+    const size_t width = plan.width();
+    for (auto r = rows.begin; r < rows.end; ++r) {
+        const row_sources_t row = get_row(src, plan, r);
+        uint8_t* out = dst + r * width * 3;
+        size_t c = 0;
+#if defined(KERNEL_AVX2)
+        for (; c + 8 <= width; c += 8) {
+            rgb4_t lo{}, hi{};
+            sample_rgb8(row, plan, c, lo, hi);
+            store_pixel4(lo, out + c * 3);
+            store_pixel4(hi, out + c * 3 + 12);
+        }
+#endif
+#if defined(__SSE4_1__)
+        for (; c + 4 <= width; c += 4) store_pixel4(sample_rgb4(row, plan, c), out + c * 3);
+#elif defined(__ARM_NEON)
+        for (; c + 8 <= width; c += 8)
+            store_pixel8(sample_rgb4(row, plan, c), sample_rgb4(row, plan, c + 4), out + c * 3);
+#endif
+        for (; c < width; ++c) {
+            float rgb[3]{};
+            sample_rgb(row, plan, c, rgb);
+            store_pixel(rgb, out + c * 3);
+        }
+    }
+}
+
+void convert_yuv_to_rgb(thread_pool_t& pool, const yuv_view_t& src, const yuv_resize_plan_t& plan,
+                        const rgb_normalization_t& norm, float* dst) noexcept(false) {
+    const tile_t tile = make_cache_tile(plan.width(), plan.height(), 3 * sizeof(float));
+    pool.parallel_for({0, plan.height()}, tile.height,
+                      [&](index_range_t rows) { convert_yuv_to_rgb(src, plan, norm, dst, rows); });
+}
+
+void convert_yuv_to_rgb(thread_pool_t& pool, const yuv_view_t& src, const yuv_resize_plan_t& plan,
+                        uint8_t* dst) noexcept(false) {
+    const tile_t tile = make_cache_tile(plan.width(), plan.height(), 3);
+    pool.parallel_for({0, plan.height()}, tile.height,
+                      [&](index_range_t rows) { convert_yuv_to_rgb(src, plan, dst, rows); });
+}
+
+void convert_yuv_to_rgb(thread_pool_t& pool, const yuv_view_t& src, const yuv_resize_plan_t& plan,
+                        const rgb_normalization_t& norm, const tensor_packing_t& dst) noexcept(false) {
+    if (dst.width != plan.width() || dst.height != plan.height())
+        throw std::invalid_argument{"convert_yuv_to_rgb: tensor size is different from the plan"};
+    const tile_t tile = make_cache_tile(plan.width(), plan.height(), 3 * get_element_size(dst.type));
+    pool.parallel_for({0, plan.height()}, tile.height,
+                      [&](index_range_t rows) { convert_yuv_to_rgb(src, plan, norm, dst, rows); });
+}
+
+void convert_yuv_to_rgb_reference(const yuv_view_t& src, const yuv_resize_plan_t& plan,
+                                  const rgb_normalization_t& norm, float* dst, index_range_t rows) noexcept {
+    const auto store = tensor_store_t<float, tensor_layout_t::nhwc>{dst, plan.width(), 0, make_affine(norm)};
+    convert_rows_reference(src, plan, store, rows);
+}
+
+void convert_yuv_to_rgb_reference(const yuv_view_t& src, const yuv_resize_plan_t& plan,
+                                  const rgb_normalization_t& norm, const tensor_packing_t& dst,
+                                  index_range_t rows) noexcept {
+    visit_store(dst, norm, [&](const auto& store) { convert_rows_reference(src, plan, store, rows); });
+}
+
+void convert_yuv_to_rgb_reference(const yuv_view_t& src, const yuv_resize_plan_t& plan, uint8_t* dst,
+                                  index_range_t rows) noexcept {
+    const size_t width = plan.width();
+    for (auto r = rows.begin; r < rows.end; ++r) {
+        const row_sources_t row = get_row(src, plan, r);
+        for (size_t c = 0; c < width; ++c) {
+            float rgb[3]{};
+            sample_rgb(row, plan, c, rgb);
+            store_pixel(rgb, dst + (r * width + c) * 3);
+        }
+    }
+}
+
+namespace {
+
+#if defined(__SSE4_1__)
+
+/// @brief Transpose 8x8 bytes. `columns[i]` holds the `i`th column of the `rows`
+void transpose8x8(const uint8_t* src, int32_t stride, __m128i columns[4]) noexcept {
+    __m128i r[8]{};
+    for (int i = 0; i < 8; ++i) r[i] = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i * stride));
+    const __m128i a = _mm_unpacklo_epi8(r[0], r[1]), b = _mm_unpacklo_epi8(r[2], r[3]);
+    const __m128i c = _mm_unpacklo_epi8(r[4], r[5]), d = _mm_unpacklo_epi8(r[6], r[7]);
+    const __m128i ab0 = _mm_unpacklo_epi16(a, b), ab1 = _mm_unpackhi_epi16(a, b);
+    const __m128i cd0 = _mm_unpacklo_epi16(c, d), cd1 = _mm_unpackhi_epi16(c, d);
+    columns[0] = _mm_unpacklo_epi32(ab0, cd0);  // column 0, 1
+    columns[1] = _mm_unpackhi_epi32(ab0, cd0);  // column 2, 3
+    columns[2] = _mm_unpacklo_epi32(ab1, cd1);  // column 4, 5
+    columns[3] = _mm_unpackhi_epi32(ab1, cd1);  // column 6, 7
+}
+
+/// @brief Rotate 8x8 block at `src` for the transposed orientation
+void transpose_block(const uint8_t* src, int32_t src_stride, uint8_t* dst[8], bool reverse) noexcept {
+    __m128i columns[4]{};
+    transpose8x8(src, src_stride, columns);
+    const __m128i order = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    for (int i = 0; i < 4; ++i) {
+        const __m128i pair = reverse ? _mm_shuffle_epi8(columns[i], order) : columns[i];
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst[2 * i]), pair);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst[2 * i + 1]), _mm_unpackhi_epi64(pair, pair));
+    }
+}
+
+#elif defined(__ARM_NEON)
+
+void transpose_block(const uint8_t* src, int32_t src_stride, uint8_t* dst[8], bool reverse) noexcept {
+    uint8x8_t r[8]{};
+    for (int i = 0; i < 8; ++i) r[i] = vld1_u8(src + i * src_stride);
+    const uint8x8x2_t t01 = vtrn_u8(r[0], r[1]), t23 = vtrn_u8(r[2], r[3]);
+    const uint8x8x2_t t45 = vtrn_u8(r[4], r[5]), t67 = vtrn_u8(r[6], r[7]);
+    const uint16x4x2_t u02 = vtrn_u16(vreinterpret_u16_u8(t01.val[0]), vreinterpret_u16_u8(t23.val[0]));
+    const uint16x4x2_t u13 = vtrn_u16(vreinterpret_u16_u8(t01.val[1]), vreinterpret_u16_u8(t23.val[1]));
+    const uint16x4x2_t u46 = vtrn_u16(vreinterpret_u16_u8(t45.val[0]), vreinterpret_u16_u8(t67.val[0]));
+    const uint16x4x2_t u57 = vtrn_u16(vreinterpret_u16_u8(t45.val[1]), vreinterpret_u16_u8(t67.val[1]));
+    const uint32x2x2_t v04 = vtrn_u32(vreinterpret_u32_u16(u02.val[0]), vreinterpret_u32_u16(u46.val[0]));
+    const uint32x2x2_t v26 = vtrn_u32(vreinterpret_u32_u16(u02.val[1]), vreinterpret_u32_u16(u46.val[1]));
+    const uint32x2x2_t v15 = vtrn_u32(vreinterpret_u32_u16(u13.val[0]), vreinterpret_u32_u16(u57.val[0]));
+    const uint32x2x2_t v37 = vtrn_u32(vreinterpret_u32_u16(u13.val[1]), vreinterpret_u32_u16(u57.val[1]));
+    const uint32x2_t columns[8]{v04.val[0], v15.val[0], v26.val[0], v37.val[0],
+                                v04.val[1], v15.val[1], v26.val[1], v37.val[1]};
+    for (int i = 0; i < 8; ++i) {
+        const uint8x8_t column = vreinterpret_u8_u32(columns[i]);
+        vst1_u8(dst[i], reverse ? vrev64_u8(column) : column);
+    }
+}
+
+#endif
+
+/// @brief Scalar path for the edges and the interleaved planes
+void rotate_pixels(plane_view_t<const uint8_t> src, orientation_map_t map, plane_view_t<uint8_t> dst,
+                   tile_t block) noexcept {
+    for (uint32_t y = block.y; y < block.y + block.height; ++y) {
+        for (uint32_t x = block.x; x < block.x + block.width; ++x) {
+            uint32_t r = map.transpose ? x : y;
+            uint32_t c = map.transpose ? y : x;
+            if (map.reverse_rows) r = dst.height - 1 - r;
+            if (map.reverse_columns) c = dst.width - 1 - c;
+            dst.row(r)[c] = src.at(x, y);
+        }
+    }
+}
+
+}  // namespace
+
+void rotate_plane(plane_view_t<const uint8_t> src, orientation_t orientation, plane_view_t<uint8_t> dst) noexcept(
+    false) {
+    const orientation_map_t map = get_orientation_map(orientation);
+    const uint32_t width = src.width, height = src.height;
+    if (map.transpose == false) {
+        for (uint32_t y = 0; y < height; ++y) {
+            const uint8_t* row = src.row(y);
+            uint8_t* out = dst.row(map.reverse_rows ? height - 1 - y : y);
+            if (src.pixel_stride == 1 && map.reverse_columns == false)
+                std::memcpy(out, row, width);
+            else if (src.pixel_stride == 1)
+                std::reverse_copy(row, row + width, out);
+            else
+                rotate_pixels(src, map, dst, tile_t{0, y, width, 1});
+        }
+        return;
+    }
+    uint32_t simd_width = 0, simd_height = 0;
+#if defined(__SSE4_1__) || defined(__ARM_NEON)
+    if (src.pixel_stride == 1) {
+        simd_width = width / 8 * 8;
+        simd_height = height / 8 * 8;
+    }
+    for (uint32_t y = 0; y < simd_height; y += 8) {
+        // output columns of the block
+        const uint32_t c = map.reverse_columns ? height - 8 - y : y;
+        for (uint32_t x = 0; x < simd_width; x += 8) {
+            uint8_t* rows[8]{};
+            for (uint32_t i = 0; i < 8; ++i) rows[i] = dst.row(map.reverse_rows ? width - 1 - (x + i) : x + i) + c;
+            transpose_block(src.row(y) + x, src.row_stride, rows, map.reverse_columns);
+        }
+    }
+#endif
+    // right and bottom edges
+    rotate_pixels(src, map, dst, tile_t{simd_width, 0, width - simd_width, simd_height});
+    rotate_pixels(src, map, dst, tile_t{0, simd_height, width, height - simd_height});
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "image_view.hpp"
+#include "tensor_packing.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief `(x / 255 - mean) / stddev` for each RGB channel
+ */
+struct rgb_normalization_t final {
+    std::array<float, 3> mean;
+    std::array<float, 3> stddev;
+};
+
+/**
+ * @brief Clockwise rotation of the source image, and then horizontal flip of the rotated one
+ */
+struct orientation_t final {
+    uint16_t degrees;  // 0, 90, 180, 270
+    bool mirror;
+};
+
+/**
+ * @brief Orientation which makes the camera image upright
+ * @param sensor_orientation `ACAMERA_SENSOR_ORIENTATION`
+ * @param front_facing `ACAMERA_LENS_FACING_FRONT`. The image is mirrored like the selfie preview
+ * @param device_orientation clockwise rotation of the device. Rounded to the multiple of 90
+ * @see https://developer.android.com/reference/android/hardware/camera2/CameraCharacteristics#SENSOR_ORIENTATION
+ */
+orientation_t make_orientation(int32_t sensor_orientation, bool front_facing, int32_t device_orientation = 0) noexcept;
+
+/**
+ * @brief Sampling tables of the fused bilinear resize. Create once for each stream configuration
+ * @details Each output pixel reads the source at `row[r] + column[c]`, so the inner loop doesn't branch on the
+ *  strides or the scale. The tables hold byte offsets, not the coordinates.
+ *
+ * For 90/270 degrees, the row tables walk the source columns and the column tables walk the source rows.
+ * Flips reverse the tables. So the rotation is applied while reading the source, without another pass.
+ */
+class yuv_resize_plan_t final {
+   public:
+    /// @brief Offsets of 2 taps and the weight of the second one
+    struct axis_t final {
+        std::vector<int32_t> offset0;
+        std::vector<int32_t> offset1;
+        std::vector<float> weight;
+        std::vector<int16_t> fraction;  // `weight` in Q15 for the fixed-point kernels
+    };
+
+   private:
+    uint32_t out_width;
+    uint32_t out_height;
+
+   public:
+    axis_t luma_rows{};
+    axis_t luma_columns{};
+    axis_t chroma_rows{};
+    axis_t chroma_columns{};
+
+   public:
+    /**
+     * @param layout only the size and the strides are used
+     * @param out_width width of the output, which is after the rotation
+     * @throw invalid_argument if a size is 0 or the degrees is not a multiple of 90
+     */
+    yuv_resize_plan_t(const yuv_view_t& layout, uint32_t out_width, uint32_t out_height,
+                      orientation_t orientation = {}) noexcept(false);
+
+    uint32_t width() const noexcept;
+    uint32_t height() const noexcept;
+};
+
+/**
+ * @brief YUV to RGB conversion, bilinear resize, and normalization in one pass
+ * @param dst interleaved RGB(NHWC) with `plan.width() * 3` floats for each row
+ * @param rows rows of the output to convert
+ */
+void convert_yuv_to_rgb(const yuv_view_t& src, const yuv_resize_plan_t& plan, const rgb_normalization_t& norm,
+                        float* dst, index_range_t rows) noexcept;
+
+/**
+ * @brief YUV to RGB conversion and bilinear resize in one pass
+ * @param dst interleaved RGB with `plan.width() * 3` bytes for each row
+ */
+void convert_yuv_to_rgb(const yuv_view_t& src, const yuv_resize_plan_t& plan, uint8_t* dst,
+                        index_range_t rows) noexcept;
+
+/**
+ * @brief YUV to RGB conversion, bilinear resize, normalization, and packing in one pass
+ * @details The normalized pixels are written in the tensor's layout and type. No float buffer in between.
+ *  The quantized values are rounded to nearest even and saturated.
+ * @param dst `dst.width` and `dst.height` must be same with the `plan`
+ */
+void convert_yuv_to_rgb(const yuv_view_t& src, const yuv_resize_plan_t& plan, const rgb_normalization_t& norm,
+                        const tensor_packing_t& dst, index_range_t rows) noexcept;
+
+/**
+ * @brief Run `convert_yuv_to_rgb` for all rows with the `pool`
+ */
+void convert_yuv_to_rgb(thread_pool_t& pool, const yuv_view_t& src, const yuv_resize_plan_t& plan,
+                        const rgb_normalization_t& norm, float* dst) noexcept(false);
+void convert_yuv_to_rgb(thread_pool_t& pool, const yuv_view_t& src, const yuv_resize_plan_t& plan,
+                        uint8_t* dst) noexcept(false);
+
+/// @throw invalid_argument if the size of the `dst` is different from the `plan`
+void convert_yuv_to_rgb(thread_pool_t& pool, const yuv_view_t& src, const yuv_resize_plan_t& plan,
+                        const rgb_normalization_t& norm, const tensor_packing_t& dst) noexcept(false);
+
+/**
+ * @brief Scalar implementation of `convert_yuv_to_rgb`. The SIMD paths are tested against this
+ */
+void convert_yuv_to_rgb_reference(const yuv_view_t& src, const yuv_resize_plan_t& plan,
+                                  const rgb_normalization_t& norm, float* dst, index_range_t rows) noexcept;
+void convert_yuv_to_rgb_reference(const yuv_view_t& src, const yuv_resize_plan_t& plan, uint8_t* dst,
+                                  index_range_t rows) noexcept;
+void convert_yuv_to_rgb_reference(const yuv_view_t& src, const yuv_resize_plan_t& plan,
+                                  const rgb_normalization_t& norm, const tensor_packing_t& dst,
+                                  index_range_t rows) noexcept;
+
+/**
+ * @brief Copy a 8-bit plane with the orientation. 90/270 degrees are transposed in 8x8 blocks
+ * @param dst `src.height` columns and `src.width` rows if the orientation is 90/270 degrees.
+ *  Its `pixel_stride` must be 1
+ * @throw invalid_argument if the degrees is not a multiple of 90
+ */
+void rotate_plane(plane_view_t<const uint8_t> src, orientation_t orientation, plane_view_t<uint8_t> dst) noexcept(
+    false);